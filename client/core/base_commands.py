@@ -13,6 +13,8 @@ Protocol Commands:
     - open_setup: Enter configuration mode
     - enable_site/disable_site/site_status: Web server control
     - crypto_info: Get encryption status
+    - crypto_bench: Run crypto self-tests and timings on the device
+    - batch: Run several commands from one packet
 
 Author: deadboizxc
 Version: 1.0
@@ -127,4 +129,26 @@ class BaseCommands(ABC):
         Returns:
             Dict with crypto status or "Not supported" error.
         """
+        return {"status": "error", "error": "Not supported"}
+    
+    def batch(self, commands, stop_on_error=False, wol_interval_ms=0, wol_burst=1):
+        """Run several commands in order with one request.
+        
+        Args:
+            commands: List of {"command": name, "data": {...}} entries.
+            stop_on_error: Skip the entries after the first failure.
+            wol_interval_ms: Pause between groups of wake sends.
+            wol_burst: Wake sends per group.
+            
+        Returns:
+            Dict with per-entry results or "Not supported" error.
+        """
+        return {"status": "error", "error": "Not supported"}
+    
+    def crypto_bench(self): 
+        """Run crypto known-answer tests and per-primitive timings.
+        
+        Returns:
+            Dict with self_test results and timings or "Not supported" error.
+        """
         return {"status": "error", "error": "Not supported"}
\ No newline at end of file
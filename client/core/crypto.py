@@ -1,10 +1,12 @@
+import hmac
 import os
 import struct
 import random
+from typing import Optional
 
 
 class Crypto:
-    """Crypto engine 100% compatible with WakeLink v1.0 firmware."""
+    """Crypto engine 100% compatible with WakeLink v1.0/v1.1/v2 firmware."""
 
     def __init__(self, token: str):
         if len(token) < 32:
@@ -176,6 +178,86 @@ class Crypto:
         
         return bytes(ciphertext)
 
+    # --------------------- Poly1305 / AEAD (v1.1) ---------------------
+    def _poly1305(self, key: bytes, msg: bytes) -> bytes:
+        """Poly1305 one-time authenticator (RFC 8439 section 2.5)."""
+        r = int.from_bytes(key[:16], "little") & 0x0ffffffc0ffffffc0ffffffc0fffffff
+        s = int.from_bytes(key[16:32], "little")
+        p = (1 << 130) - 5
+        acc = 0
+        for i in range(0, len(msg), 16):
+            block = msg[i:i+16] + b"\x01"
+            acc = ((acc + int.from_bytes(block, "little")) * r) % p
+        return ((acc + s) & ((1 << 128) - 1)).to_bytes(16, "little")
+
+    def _aead_tag(self, nonce: bytes, aad: bytes, cipher: bytes) -> bytes:
+        otk = self._chacha20_block(self.chacha_key, nonce, 0)[:32]
+        pad = lambda b: b"\x00" * (-len(b) % 16)
+        mac_data = (aad + pad(aad) + cipher + pad(cipher) +
+                    struct.pack("<QQ", len(aad), len(cipher)))
+        return self._poly1305(otk, mac_data)
+
+    def _chacha20_encrypt_from(self, nonce: bytes, data: bytes, counter: int) -> bytes:
+        out = bytearray(len(data))
+        for i in range(0, len(data), 64):
+            ks = self._chacha20_block(self.chacha_key, nonce, counter + i // 64)
+            for j in range(min(64, len(data) - i)):
+                out[i + j] = data[i + j] ^ ks[j]
+        return bytes(out)
+
+    def create_aead_response(self, plaintext: str) -> str:
+        """Seal plaintext as a v1.1 payload: len(2) + cipher + nonce(12) + tag(16)."""
+        return self.seal_aead(plaintext.encode("utf-8")[:500])
+
+    def seal_aead(self, data: bytes) -> str:
+        """Seal raw bytes (e.g. a fragment) as a v1.1 payload."""
+        header = struct.pack(">H", len(data))
+        nonce = os.urandom(12)
+        cipher = self._chacha20_encrypt_from(nonce, data, 1)
+        tag = self._aead_tag(nonce, header, cipher)
+        self.request_counter += 1
+        return (header + cipher + nonce + tag).hex()
+
+    def process_aead_packet(self, hex_packet: str) -> str:
+        """Verify and decrypt a v1.1 payload; returns "ERROR:*" on failure."""
+        plain = self.open_aead(hex_packet)
+        return plain if isinstance(plain, str) else plain.decode("utf-8", errors="ignore")
+
+    def open_aead(self, hex_packet: str):
+        """Verify and decrypt a v1.1 payload to bytes; "ERROR:*" string on failure."""
+        try:
+            p = bytes.fromhex(hex_packet)
+        except ValueError as e:
+            return f"ERROR:DECRYPT: {str(e)}"
+        if len(p) < 2 + 12 + 16:
+            return "ERROR:TOO_SHORT"
+        length = struct.unpack(">H", p[:2])[0]
+        if len(p) != 2 + length + 12 + 16:
+            return "ERROR:INVALID_SIZE"
+        cipher = p[2:2+length]
+        nonce = p[2+length:2+length+12]
+        tag = p[2+length+12:]
+        if not hmac.compare_digest(self._aead_tag(nonce, p[:2], cipher), tag):
+            return "ERROR:INVALID_SIGNATURE"
+        self.request_counter += 1
+        return self._chacha20_encrypt_from(nonce, cipher, 1)
+
+    # --------------------- Binary frames (v2) ---------------------
+    def seal_frame(self, header: bytes, body: bytes) -> bytes:
+        """Encrypt a v2 frame body; returns ciphertext + tag (header is AAD, nonce at [14:26])."""
+        nonce = header[14:26]
+        cipher = self._chacha20_encrypt_from(nonce, body, 1)
+        self.request_counter += 1
+        return cipher + self._aead_tag(nonce, header, cipher)
+
+    def open_frame(self, header: bytes, cipher: bytes, tag: bytes) -> Optional[bytes]:
+        """Verify and decrypt a v2 frame body; None if the tag does not match."""
+        nonce = header[14:26]
+        if not hmac.compare_digest(self._aead_tag(nonce, header, cipher), tag):
+            return None
+        self.request_counter += 1
+        return self._chacha20_encrypt_from(nonce, cipher, 1)
+
     # --------------------- HMAC ---------------------
     def _hmac_sha256(self, key: bytes, data: bytes) -> bytes:
         if len(key) > 64:
@@ -192,7 +274,10 @@ class Crypto:
         return self.calculate_hmac(data) == signature.lower()
 
     def create_secure_response(self, plaintext: str) -> str:
-        data = plaintext.encode("utf-8")[:500]
+        return self.seal_secure(plaintext.encode("utf-8")[:500])
+
+    def seal_secure(self, data: bytes) -> str:
+        """Seal raw bytes (e.g. a fragment) as a v1.0 payload."""
         full_nonce = os.urandom(16)
         nonce12 = full_nonce[:12]
         cipher = self._chacha20_encrypt(self.chacha_key, nonce12, data)
@@ -201,13 +286,18 @@ class Crypto:
         return packet.hex()
 
     def process_secure_packet(self, hex_packet: str) -> str:
+        plain = self.open_secure(hex_packet)
+        return plain if isinstance(plain, str) else plain.decode("utf-8", errors="ignore")
+
+    def open_secure(self, hex_packet: str):
+        """Decrypt a v1.0 payload to bytes; "ERROR:*" string on failure."""
         try:
             p = bytes.fromhex(hex_packet)
             if len(p) < 18: 
                 return "ERROR:TOO_SHORT"
             
             length = struct.unpack(">H", p[:2])[0]
-            if length > 500 or len(p) < 2 + length + 16: 
+            if len(p) < 2 + length + 16: 
                 return "ERROR:INVALID_SIZE"
             
             cipher = p[2:2+length]
@@ -216,6 +306,6 @@ class Crypto:
             
             plain = self._chacha20_encrypt(self.chacha_key, nonce12, cipher)
             self.request_counter += 1
-            return plain.decode("utf-8", errors="ignore")
+            return plain
         except Exception as e:
             return f"ERROR:DECRYPT: {str(e)}"
\ No newline at end of file
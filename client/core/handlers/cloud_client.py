@@ -22,7 +22,8 @@ Version: 1.0
 import json
 import time
 import uuid
-from typing import Any, Dict, Optional
+from collections import OrderedDict, deque
+from typing import Any, Dict, List, Optional, Tuple
 
 import requests
 from requests.adapters import HTTPAdapter
@@ -56,6 +57,7 @@ class CloudClient:
     WSS_TIMEOUT = 10
     DEVICE_RESPONSE_TIMEOUT = 30
     LONG_POLL_WAIT = 15  # Server waits up to 15 seconds for messages
+    PIPELINE_WINDOW = 4  # Requests in flight on the WSS channel
     
     def __init__(
         self,
@@ -63,7 +65,8 @@ class CloudClient:
         device_id: str,
         api_token: str = None,
         base_url: str = None,
-        protocol: str = "wss"
+        protocol: str = "wss",
+        version: str = PacketManager.PROTOCOL_VERSION
     ):
         """Initialize cloud client.
         
@@ -73,6 +76,8 @@ class CloudClient:
             api_token: API bearer token for authentication.
             base_url: Server URL (https:// or wss://).
             protocol: Transport protocol - 'http' or 'wss'.
+            version: Packet version; "2.0" sends binary frames over WSS
+                (HTTP always uses 1.0).
         """
         self.token = token
         self.device_id = device_id
@@ -103,6 +108,7 @@ class CloudClient:
         
         # Initialize packet manager for encryption
         self.packet_manager = PacketManager(token, device_id)
+        self.frame_manager = PacketManager(token, device_id, version) if version == PacketManager.FRAME_VERSION else None
         
         # Stable client ID for WSS sessions
         self._client_id = f"cli_{device_id}_{uuid.uuid4().hex[:8]}"
@@ -131,6 +137,65 @@ class CloudClient:
         else:
             return self._send_wss(command, data)
     
+    def send_commands(
+        self,
+        commands: List[Tuple[str, Optional[Dict[str, Any]]]],
+        window: int = PIPELINE_WINDOW
+    ) -> List[Dict[str, Any]]:
+        """Send several commands without waiting for each reply.
+        
+        Over WSS up to window requests are in flight on the channel; the
+        relay returns the device replies to this client in the order the
+        device runs them, and each is matched to its command by
+        request_id. Commands that need fragments are sent on their own
+        once the pipeline has drained. HTTP sends one command at a time.
+        
+        Args:
+            commands: (command, data) pairs, run by the device in this order.
+            window: Maximum requests in flight.
+            
+        Returns:
+            One result per command, in the order given.
+        """
+        if self.protocol == "http" or not WEBSOCKET_AVAILABLE or not self._connect_wss():
+            return [self.send_command(command, data) for command, data in commands]
+        
+        results: List[Optional[Dict[str, Any]]] = [None] * len(commands)
+        in_flight: "OrderedDict[str, int]" = OrderedDict()
+        unacked: deque = deque()  # request_ids in send order, for the relay ACKs
+        window = max(1, window)
+        failure = None
+        
+        for index, (command, data) in enumerate(commands):
+            try:
+                messages, request_id = self._seal_wss(command, data)
+            except ValueError as e:
+                results[index] = {"status": "error", "message": f"Command too large: {e}"}
+                continue
+            
+            if len(messages) > 1:
+                if not self._drain_wss(in_flight, unacked, results, 0):
+                    break
+                results[index] = self._send_wss(command, data)
+                continue
+            
+            if not self._drain_wss(in_flight, unacked, results, window - 1):
+                break
+            try:
+                self._send_wss_message(messages[0])
+            except Exception as e:
+                self._close_wss()
+                failure = {"status": "error", "message": f"WSS send failed: {e}"}
+                break
+            print(f"[WSS] Command sent: {command}")
+            in_flight[request_id] = index
+            unacked.append(request_id)
+        else:
+            self._drain_wss(in_flight, unacked, results, 0)
+        
+        failure = failure or {"status": "timeout", "message": "No response from device"}
+        return [result or dict(failure) for result in results]
+    
     # ==================== HTTP Transport ====================
     
     def _send_http(self, command: str, data: Dict[str, Any] = None) -> Dict[str, Any]:
@@ -279,28 +344,21 @@ class CloudClient:
             print("[WSS] Connection failed, falling back to HTTP")
             return self._send_http(command, data)
         
-        # Build encrypted packet (returns JSON string)
-        packet_json = self.packet_manager.create_command_packet(command, data or {})
-        packet = json.loads(packet_json)
-        
-        # Extract request_id from inner packet for response matching
         try:
-            inner = self.packet_manager.process_incoming_packet(packet_json)
-            request_id = inner.get("request_id")
-        except Exception:
-            request_id = None
+            messages, request_id = self._seal_wss(command, data)
+        except ValueError as e:
+            return {"status": "error", "message": f"Command too large: {e}"}
         
-        # Send packet
+        # Send packet or frame (or its fragments, one message each)
         try:
-            message = {
-                "device_id": self.device_id,
-                "payload": packet["payload"],
-                "signature": packet["signature"],
-                "version": packet.get("version", "1.0")
-            }
-            
-            self._ws.send(json.dumps(message))
-            print(f"[WSS] Command sent: {command}")
+            for message in messages:
+                self._send_wss_message(message)
+            if self.frame_manager:
+                print(f"[WSS] Command sent: {command} ({sum(len(m) for m in messages)} bytes, v2"
+                      f"{f', {len(messages)} fragments' if len(messages) > 1 else ''})")
+            else:
+                print(f"[WSS] Command sent: {command}"
+                      f"{f' ({len(messages)} fragments)' if len(messages) > 1 else ''}")
             
         except Exception as e:
             self._close_wss()
@@ -309,6 +367,89 @@ class CloudClient:
         # Wait for response
         return self._wait_wss_response(request_id)
     
+    def _seal_wss(self, command: str, data: Optional[Dict[str, Any]]) -> Tuple[List[Any], str]:
+        """Encrypt a command into WebSocket messages and its request_id.
+        
+        Returns:
+            (binary v2 frames or JSON text messages, request_id).
+            
+        Raises:
+            ValueError: The command is too large even for fragments.
+        """
+        if self.frame_manager:
+            return self.frame_manager.create_command_frames(command, data or {})
+        
+        packets, request_id = self.packet_manager.create_command_packets(command, data or {})
+        messages = []
+        for packet_json in packets:
+            packet = json.loads(packet_json)
+            messages.append(json.dumps({
+                "device_id": self.device_id,
+                "payload": packet["payload"],
+                "signature": packet["signature"],
+                "version": packet.get("version", "1.0")
+            }))
+        return messages, request_id
+    
+    def _send_wss_message(self, message) -> None:
+        """Send one text (v1.x) or binary (v2) message."""
+        if isinstance(message, bytes):
+            self._ws.send_binary(message)
+        else:
+            self._ws.send(message)
+    
+    def _drain_wss(
+        self,
+        in_flight: "OrderedDict[str, int]",
+        unacked: deque,
+        results: List[Optional[Dict[str, Any]]],
+        limit: int
+    ) -> bool:
+        """Read pipelined replies until at most limit requests are in flight.
+        
+        Relay ACKs arrive in send order; a "queued" ACK (device offline)
+        answers its request. A device reply without a known request_id
+        (a packet the device could not decrypt) answers the oldest
+        request in flight.
+        
+        Returns:
+            False on timeout or a closed channel.
+        """
+        deadline = time.time() + self.DEVICE_RESPONSE_TIMEOUT
+        while len(in_flight) > limit:
+            if time.time() > deadline:
+                return False
+            try:
+                kind, msg = self._decode_wss_message(self._ws.recv())
+            except WebSocketTimeoutException:
+                return False
+            except Exception as e:
+                print(f"[WSS] Receive error: {e}")
+                self._close_wss()
+                return False
+            
+            if kind == "ack":
+                request_id = unacked.popleft() if unacked else None
+                if request_id in in_flight and msg.get("queued", not msg.get("delivered")):
+                    results[in_flight.pop(request_id)] = {
+                        "status": "queued",
+                        "message": msg.get("message", "Device offline, command queued"),
+                        "device_id": msg.get("device_id")
+                    }
+                continue
+            
+            if kind != "reply" or msg.get("status") in ("pending", "partial"):
+                continue
+            
+            request_id = msg.get("request_id")
+            if request_id not in in_flight:
+                if request_id is not None:
+                    continue  # Late reply to an earlier request
+                request_id = next(iter(in_flight))
+            results[in_flight.pop(request_id)] = msg
+            deadline = time.time() + self.DEVICE_RESPONSE_TIMEOUT
+        return True
+    
     def _connect_wss(self) -> bool:
         """Establish WebSocket connection if not connected.
         
@@ -401,22 +542,11 @@ class CloudClient:
         while time.time() - start_time < self.DEVICE_RESPONSE_TIMEOUT:
             try:
                 raw = self._ws.recv()
-                msg = json.loads(raw)
-                
-                # Skip server status messages (welcome, connection status, etc.)
-                if msg.get("type") in ("welcome", "status", "ping", "pong", "ack"):
-                    continue
-                
-                # Skip server connection confirmation
-                if msg.get("status") == "connected":
-                    continue
+                kind, msg = self._decode_wss_message(raw)
                 
                 # Handle server ACK for command delivery
-                if msg.get("status") == "success" and msg.get("delivered") is not None:
-                    delivered = msg.get("delivered")
-                    queued = msg.get("queued", not delivered)
-                    
-                    if queued:
+                if kind == "ack":
+                    if msg.get("queued", not msg.get("delivered")):
                         return {
                             "status": "queued",
                             "message": msg.get("message", "Device offline, command queued"),
@@ -427,32 +557,19 @@ class CloudClient:
                     print(f"[WSS] Command delivered, waiting for response...")
                     continue
                 
-                # Skip queued/delivered status messages (uppercase variants)
-                if msg.get("status") in ("QUEUED", "DELIVERED"):
-                    status_msg = msg.get("message", msg.get("status"))
-                    print(f"[WSS] Status: {status_msg}")
+                if kind != "reply":
                     continue
                 
-                # Check for payload (device response)
-                payload = msg.get("payload")
-                signature = msg.get("signature")
-                
-                if payload and signature:
-                    try:
-                        full_packet = {
-                            "device_id": self.device_id,
-                            "payload": payload,
-                            "signature": signature,
-                            "request_counter": msg.get("request_counter"),
-                            "version": msg.get("version", "1.0")
-                        }
-                        decrypted = self.packet_manager.process_incoming_packet(json.dumps(full_packet))
-                        if decrypted and decrypted.get("status") == "success":
-                            # Match request_id if provided
-                            if not request_id or decrypted.get("request_id") == request_id:
-                                return decrypted
-                    except Exception as e:
-                        print(f"[WSS] Decrypt error: {e}")
+                if isinstance(raw, bytes):
+                    # Fragment acknowledgements and partial responses
+                    if msg.get("status") in ("pending", "partial"):
+                        continue
+                    if not request_id or msg.get("request_id") in (None, request_id):
+                        return msg
+                elif msg.get("status") == "success":
+                    # Match request_id if provided
+                    if not request_id or msg.get("request_id") == request_id:
+                        return msg
                 
             except WebSocketTimeoutException:
                 break
@@ -463,6 +580,66 @@ class CloudClient:
         
         return {"status": "timeout", "message": "No response from device"}
     
+    def _decode_wss_message(self, raw) -> Tuple[str, Dict[str, Any]]:
+        """Classify one WebSocket message from the server.
+        
+        Args:
+            raw: Text or binary message.
+            
+        Returns:
+            ("ack", server delivery ACK), ("reply", decrypted device reply)
+            or ("skip", {}) for status messages and undecryptable data.
+        """
+        # v2 response frames arrive as binary messages
+        if isinstance(raw, bytes):
+            if not self.frame_manager:
+                return "skip", {}
+            decrypted = self.frame_manager.process_incoming_frame(raw)
+            if decrypted.get("status") == "error" and decrypted.get("error") in (
+                    "INVALID_FRAME", "INVALID_LENGTH", "WRONG_DEVICE", "INVALID_SIGNATURE"):
+                print(f"[WSS] Frame error: {decrypted['error']}")
+                return "skip", {}
+            return "reply", decrypted
+        
+        msg = json.loads(raw)
+        
+        # Skip server status messages (welcome, connection status, etc.)
+        if msg.get("type") in ("welcome", "status", "ping", "pong", "ack"):
+            return "skip", {}
+        
+        # Skip server connection confirmation
+        if msg.get("status") == "connected":
+            return "skip", {}
+        
+        if msg.get("status") == "success" and msg.get("delivered") is not None:
+            return "ack", msg
+        
+        # Skip queued/delivered status messages (uppercase variants)
+        if msg.get("status") in ("QUEUED", "DELIVERED"):
+            status_msg = msg.get("message", msg.get("status"))
+            print(f"[WSS] Status: {status_msg}")
+            return "skip", {}
+        
+        # Check for payload (device response)
+        payload = msg.get("payload")
+        signature = msg.get("signature")
+        
+        if payload and signature:
+            try:
+                full_packet = {
+                    "device_id": self.device_id,
+                    "payload": payload,
+                    "signature": signature,
+                    "request_counter": msg.get("request_counter"),
+                    "version": msg.get("version", "1.0")
+                }
+                decrypted = self.packet_manager.process_incoming_packet(json.dumps(full_packet))
+                if decrypted:
+                    return "reply", decrypted
+            except Exception as e:
+                print(f"[WSS] Decrypt error: {e}")
+        return "skip", {}
+    
     def _close_wss(self):
         """Close WebSocket connection."""
         if self._ws:
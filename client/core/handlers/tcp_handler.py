@@ -2,14 +2,21 @@
 WakeLink TCP Handler.
 
 Provides local TCP transport for direct device communication on port 99.
-Uses protocol v1.0 packet format with ChaCha20 encryption and HMAC-SHA256.
+Uses protocol v1.0 packet format with ChaCha20 encryption and HMAC-SHA256,
+v1.1 (AEAD) or v2 binary frames, selected by the version argument.
 
 This is the simplest and fastest transport for local network communication.
+The device keeps connections open between packets, so with keep_alive
+the handler sends every command (and every fragment) on one socket.
+send_commands() pipelines several commands on that socket and matches
+the replies to them by request_id.
 """
 
+import select
 import socket
 import time
-from typing import Any, Dict, Optional
+from collections import OrderedDict
+from typing import Any, Callable, Dict, List, Optional, Tuple
 
 from ..protocol.packet import PacketManager
 
@@ -25,10 +32,12 @@ class TCPHandler:
         port: TCP port (default 99).
         timeout: Socket timeout in seconds.
         device_id: Device identifier for packets.
+        keep_alive: Reuse one connection across commands.
     """
     
     DEFAULT_PORT = 99
     DEFAULT_TIMEOUT = 10.0
+    PIPELINE_WINDOW = 4  # Requests in flight per connection (device answers TCP_PIPELINE_DEPTH per pass)
     
     def __init__(
         self,
@@ -36,7 +45,9 @@ class TCPHandler:
         ip: str,
         device_id: str = "python_client",
         port: int = DEFAULT_PORT,
-        timeout: float = DEFAULT_TIMEOUT
+        timeout: float = DEFAULT_TIMEOUT,
+        version: str = PacketManager.PROTOCOL_VERSION,
+        keep_alive: bool = True
     ):
         """Initialize TCP handler.
         
@@ -46,20 +57,30 @@ class TCPHandler:
             device_id: Device identifier for packet headers.
             port: TCP port number (default 99).
             timeout: Socket timeout in seconds.
+            version: Protocol version ("1.0", "1.1" or "2.0").
+            keep_alive: Keep the connection open between commands; it is
+                reopened if the device closed it (idle timeout, older
+                firmware that closes after each reply).
         """
         self.ip = ip
         self.port = port
         self.timeout = timeout
         self.device_id = device_id
+        self.keep_alive = keep_alive
+        self._sock: Optional[socket.socket] = None
+        self._rx = b""  # Received bytes after the last reply line
         
         # Initialize packet manager
-        self.packet_manager = PacketManager(token, device_id)
+        self.packet_manager = PacketManager(token, device_id, version)
     
     def send_command(self, command: str, data: Optional[Dict[str, Any]] = None) -> Dict[str, Any]:
         """Send command to device via TCP.
         
-        Opens a TCP connection, sends the encrypted packet, and waits
-        for the response. Connection is closed after each command.
+        Sends the encrypted packet and waits for the response. With
+        keep_alive the connection stays open for the next command,
+        otherwise it is closed after each reply. Commands over 500 bytes
+        go out as fragments; the device acknowledges all but the last
+        with "pending".
         
         Args:
             command: Command name (e.g., "ping", "wake", "info").
@@ -69,36 +90,291 @@ class TCPHandler:
             Dict with command response or error info.
         """
         try:
-            with socket.create_connection((self.ip, self.port), timeout=self.timeout) as sock:
-                sock.settimeout(self.timeout)
-                
-                # Create encrypted packet
-                packet = self.packet_manager.create_command_packet(command, data or {})
-                
-                # Send packet with newline terminator
-                sock.sendall((packet + "\n").encode("utf-8"))
-                print(f"[TCP] Sent: {command} ({len(packet)} bytes)")
-                
-                # Receive response
-                response = self._receive_response(sock)
-                
-                if not response:
-                    return {"status": "error", "error": "NO_RESPONSE"}
-                
-                # Process response packet
-                return self.packet_manager.process_incoming_packet(response)
+            messages, request_id = self._seal(command, data)
+            self._log_sent(command, messages)
+            return self._send_messages(messages, request_id)
                 
+        except ValueError as e:
+            return {"status": "error", "error": f"MESSAGE_TOO_LARGE: {e}"}
         except socket.timeout:
+            self.close()
             return {"status": "error", "error": "TIMEOUT"}
         except ConnectionRefusedError:
             return {"status": "error", "error": "CONNECTION_REFUSED"}
         except OSError as e:
+            self.close()
             return {"status": "error", "error": f"CONNECTION_ERROR: {e}"}
         except Exception as e:
+            self.close()
             return {"status": "error", "error": f"ERROR: {e}"}
     
+    def send_commands(
+        self,
+        commands: List[Tuple[str, Optional[Dict[str, Any]]]],
+        window: int = PIPELINE_WINDOW
+    ) -> List[Dict[str, Any]]:
+        """Send several commands back to back on one connection.
+        
+        Up to window requests are in flight at once, so a wake plus status
+        checks cost about one round trip instead of one each. The device
+        answers in the order it runs them; every reply carries the
+        request_id of its command and is matched by it. A reply without a
+        known request_id (a packet the device could not decrypt) answers
+        the oldest request in flight. Commands that need fragments are
+        sent on their own once the pipeline has drained, since fragment
+        acknowledgements carry no request_id.
+        
+        Args:
+            commands: (command, data) pairs, run by the device in this order.
+            window: Maximum requests in flight.
+            
+        Returns:
+            One result per command, in the order given.
+        """
+        results: List[Optional[Dict[str, Any]]] = [None] * len(commands)
+        in_flight: "OrderedDict[str, int]" = OrderedDict()
+        receive = self._read_frame if self.packet_manager.binary else self._read_packet
+        window = max(1, window)
+        error = None
+        
+        try:
+            for index, (command, data) in enumerate(commands):
+                try:
+                    messages, request_id = self._seal(command, data)
+                except ValueError as e:
+                    results[index] = {"status": "error", "error": f"MESSAGE_TOO_LARGE: {e}"}
+                    continue
+                self._log_sent(command, messages)
+                
+                if len(messages) > 1:
+                    error = self._drain(in_flight, results, receive, 0)
+                    if error:
+                        break
+                    results[index] = self._send_messages(messages, request_id)
+                    continue
+                
+                error = self._drain(in_flight, results, receive, window - 1)
+                if error:
+                    break
+                # Only check for a stale connection while nothing is in flight on it
+                sock = self._sock if in_flight else self._connection()
+                sock.sendall(messages[0])
+                in_flight[request_id] = index
+            
+            if not error:
+                error = self._drain(in_flight, results, receive, 0)
+        except socket.timeout:
+            error = "TIMEOUT"
+        except ConnectionRefusedError:
+            error = "CONNECTION_REFUSED"
+        except OSError as e:
+            error = f"CONNECTION_ERROR: {e}"
+        except Exception as e:
+            error = f"ERROR: {e}"
+        
+        if error or not self.keep_alive:
+            self.close()
+        # Requests never answered (or never sent after a failure)
+        return [result or {"status": "error", "error": error or "NO_RESPONSE"} for result in results]
+    
+    def close(self) -> None:
+        """Close the kept-alive connection, if any."""
+        if self._sock is not None:
+            try:
+                self._sock.close()
+            except OSError:
+                pass
+            self._sock = None
+        self._rx = b""
+    
+    def __enter__(self) -> "TCPHandler":
+        return self
+    
+    def __exit__(self, *exc) -> None:
+        self.close()
+    
+    def _seal(self, command: str, data: Optional[Dict[str, Any]]) -> Tuple[List[bytes], str]:
+        """Encrypt a command into the messages to send and its request_id.
+        
+        Raises:
+            ValueError: The command is too large even for fragments.
+        """
+        if self.packet_manager.binary:
+            return self.packet_manager.create_command_frames(command, data or {})
+        packets, request_id = self.packet_manager.create_command_packets(command, data or {})
+        return [(packet + "\n").encode("utf-8") for packet in packets], request_id
+    
+    def _log_sent(self, command: str, messages: List[bytes]) -> None:
+        version = " v2" if self.packet_manager.binary else ""
+        suffix = f", {len(messages)} fragments" if len(messages) > 1 else ""
+        print(f"[TCP] Sent: {command} ({sum(len(m) for m in messages)} bytes{version}{suffix})")
+    
+    def _send_messages(self, messages: List[bytes], request_id: str) -> Dict[str, Any]:
+        """Send the messages of one command, each waiting for its reply."""
+        exchange = self._exchange_frame if self.packet_manager.binary else self._exchange_packet
+        for index, message in enumerate(messages):
+            result = exchange(message)
+            last = index + 1 == len(messages)
+            if not last and result.get("status") != "pending":
+                return result
+        
+        if result.get("status") == "success" and result.get("request_id") not in (None, request_id):
+            return {"status": "error", "error": "REQUEST_ID_MISMATCH"}
+        return result
+    
+    def _drain(
+        self,
+        in_flight: "OrderedDict[str, int]",
+        results: List[Optional[Dict[str, Any]]],
+        receive: Callable[[socket.socket], Dict[str, Any]],
+        limit: int
+    ) -> Optional[str]:
+        """Read pipelined replies until at most limit requests are in flight.
+        
+        Returns:
+            None, or the error that ended the connection.
+        """
+        while len(in_flight) > limit:
+            result = receive(self._sock)
+            if result.get("error") in ("NO_RESPONSE", "TRUNCATED_FRAME", "INVALID_LENGTH"):
+                return result["error"]
+            request_id = result.get("request_id")
+            if request_id not in in_flight:
+                request_id = next(iter(in_flight))
+            results[in_flight.pop(request_id)] = result
+        return None
+    
+    def _connection(self) -> socket.socket:
+        """Return the open connection, reconnecting if the device closed it."""
+        if self._sock is not None and self._is_stale(self._sock):
+            self.close()
+        if self._sock is None:
+            self._sock = socket.create_connection((self.ip, self.port), timeout=self.timeout)
+            self._sock.settimeout(self.timeout)
+        return self._sock
+    
+    @staticmethod
+    def _is_stale(sock: socket.socket) -> bool:
+        """True if the peer has closed (readable with nothing to read)."""
+        try:
+            readable, _, _ = select.select([sock], [], [], 0)
+            if not readable:
+                return False
+            sock.setblocking(False)
+            try:
+                return sock.recv(1, socket.MSG_PEEK) == b""
+            finally:
+                sock.setblocking(True)
+        except (BlockingIOError, InterruptedError):
+            return False
+        except OSError:
+            return True
+    
+    def _exchange(self, message: bytes, receive) -> Dict[str, Any]:
+        """Send one message and read its reply on the (kept-alive) connection.
+        
+        A reused connection the device closed in the meantime yields no
+        reply and reads as closed; the message is then sent once more on
+        a new connection. The device had stopped reading the old one, so
+        the command runs once (and a duplicate would fail the replay check).
+        
+        Args:
+            message: Packet plus newline, or a complete frame.
+            receive: Reads and decodes the reply from the socket.
+            
+        Returns:
+            Dict with the decrypted reply or error info.
+        """
+        reused = self._sock is not None
+        sock = self._connection()
+        try:
+            sock.settimeout(self.timeout)
+            sock.sendall(message)
+            result = receive(sock)
+            if reused and result.get("error") == "NO_RESPONSE" and self._is_stale(sock):
+                self.close()
+                sock = self._connection()
+                sock.sendall(message)
+                result = receive(sock)
+        except (BrokenPipeError, ConnectionResetError):
+            if not reused:
+                raise
+            self.close()
+            sock = self._connection()
+            sock.sendall(message)
+            result = receive(sock)
+        
+        # A connection out of step with the device is not reused
+        if not self.keep_alive or result.get("error") in ("NO_RESPONSE", "TRUNCATED_FRAME", "INVALID_LENGTH"):
+            self.close()
+        return result
+    
+    def _exchange_packet(self, packet: bytes) -> Dict[str, Any]:
+        """Send one newline-terminated packet and read the reply.
+        
+        Args:
+            packet: Outer packet plus newline.
+            
+        Returns:
+            Dict with the decrypted reply or error info.
+        """
+        return self._exchange(packet, self._read_packet)
+    
+    def _read_packet(self, sock: socket.socket) -> Dict[str, Any]:
+        """Read and decode one newline-terminated reply."""
+        response = self._receive_response(sock)
+        if not response:
+            return {"status": "error", "error": "NO_RESPONSE"}
+        
+        return self.packet_manager.process_incoming_packet(response)
+    
+    def _exchange_frame(self, frame: bytes) -> Dict[str, Any]:
+        """Send a v2 frame and read the response frame (no newline framing).
+        
+        A fragmented response arrives as consecutive frames on the same
+        connection; they are read until the message is complete.
+        
+        Args:
+            frame: Complete frame.
+            
+        Returns:
+            Dict with command response or error info.
+        """
+        return self._exchange(frame, self._read_frame)
+    
+    def _read_frame(self, sock: socket.socket) -> Dict[str, Any]:
+        """Read and decode reply frames until the message is complete."""
+        while True:
+            header = self._receive_exact(sock, PacketManager.FRAME_HEADER.size)
+            if not header:
+                return {"status": "error", "error": "NO_RESPONSE"}
+            total = PacketManager.frame_length(header)
+            if not total:
+                return {"status": "error", "error": "INVALID_LENGTH"}
+            rest = self._receive_exact(sock, total - len(header))
+            if rest is None:
+                return {"status": "error", "error": "TRUNCATED_FRAME"}
+            
+            result = self.packet_manager.process_incoming_frame(header + rest)
+            if result.get("status") != "partial":
+                return result
+    
+    @staticmethod
+    def _receive_exact(sock: socket.socket, size: int) -> Optional[bytes]:
+        """Read exactly size bytes; None if the peer closes first."""
+        buffer = b""
+        while len(buffer) < size:
+            chunk = sock.recv(size - len(buffer))
+            if not chunk:
+                return None
+            buffer += chunk
+        return buffer
+    
     def _receive_response(self, sock: socket.socket) -> Optional[str]:
-        """Receive response from socket until newline or timeout.
+        """Receive one response line from socket, until newline or timeout.
+        
+        Pipelined replies can arrive in one read; bytes after the first
+        newline are kept for the next call.
         
         Args:
             sock: Connected socket.
@@ -106,20 +382,15 @@ class TCPHandler:
         Returns:
             Response string or None if no data received.
         """
-        buffer = b""
         start_time = time.time()
         
-        while time.time() - start_time < self.timeout:
+        while b"\n" not in self._rx and time.time() - start_time < self.timeout:
             try:
                 chunk = sock.recv(4096)
                 if not chunk:
                     break
                     
-                buffer += chunk
-                
-                # Check for newline terminator
-                if b"\n" in buffer:
-                    break
+                self._rx += chunk
                     
             except socket.timeout:
                 break
@@ -127,7 +398,8 @@ class TCPHandler:
                 time.sleep(0.01)
                 continue
         
-        if not buffer:
+        line, _, self._rx = self._rx.partition(b"\n")
+        if not line:
             return None
         
-        return buffer.decode("utf-8", errors="ignore").strip()
+        return line.decode("utf-8", errors="ignore").strip()
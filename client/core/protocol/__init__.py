@@ -11,6 +11,8 @@ Protocol Specification:
     - Payload: hex string = [uint16_be length] + [ciphertext] + [16B nonce]
     - Signature: HMAC-SHA256 of payload hex string only
     - Encryption: ChaCha20 with key derived from SHA256(device_token)
+    - v1.1: AEAD payload (ChaCha20-Poly1305), no signature
+    - v2: binary frame, 28-byte header + MessagePack body + tag
 
 Author: deadboizxc
 Version: 1.0
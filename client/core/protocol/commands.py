@@ -19,16 +19,30 @@ Command Mapping:
     web_control   -> action: enable/disable/status
     cloud_control -> action: enable/disable/status
     crypto_info   -> "crypto_info"   : Encryption status
+    crypto_bench  -> "crypto_bench"  : Crypto self-test and timings
     update_token  -> "update_token"  : Refresh device token
+    batch         -> "batch"         : Several commands in one packet
+    pipeline      -> (any)           : Several packets in flight at once
 
 Author: deadboizxc
 Version: 1.0
 """
 
-from typing import Dict, Any
+from typing import Dict, Any, List, Optional, Tuple
 from core.base_commands import BaseCommands
 
 
+class _RequestRecorder:
+    """Handler stand-in that keeps the request a command method sends."""
+    
+    def __init__(self):
+        self.request: Optional[Tuple[str, Optional[Dict[str, Any]]]] = None
+    
+    def send_command(self, command: str, data: Optional[Dict[str, Any]] = None) -> Dict[str, Any]:
+        self.request = (command, data)
+        return {}
+
+
 class WakeLinkCommands(BaseCommands):
     """Unified command implementation for all WakeLink transports.
     
@@ -138,6 +152,14 @@ class WakeLinkCommands(BaseCommands):
         """
         return self.handler.send_command("crypto_info")
 
+    def crypto_bench(self) -> Dict[str, Any]:
+        """Run crypto known-answer tests and microbenchmarks on the device.
+        
+        Returns:
+            Dict with self_test results, sizes, us_per_op and mb_per_s.
+        """
+        return self.handler.send_command("crypto_bench")
+
     def update_token(self) -> Dict[str, Any]:
         """Request device token refresh.
         
@@ -170,4 +192,77 @@ class WakeLinkCommands(BaseCommands):
         Returns:
             Dict with cloud enabled/disabled state and connection info.
         """
-        return self.handler.send_command("cloud_control", {"action": "status"})
\ No newline at end of file
+        return self.handler.send_command("cloud_control", {"action": "status"})
+
+    def batch(self, commands: List[Dict[str, Any]], stop_on_error: bool = False,
+              wol_interval_ms: int = 0, wol_burst: int = 1) -> Dict[str, Any]:
+        """Run several commands on the device from one packet.
+        
+        The device runs the entries in order and answers once, so the
+        connection, decrypt and counter step are paid once per batch.
+        Large batches travel as fragments.
+        
+        Args:
+            commands: Entries of the form {"command": name, "data": {...}}.
+            stop_on_error: Skip the entries after the first failure.
+            wol_interval_ms: Pause between groups of wake sends (max 1000).
+                The device replies at once; paced wakes are reported as
+                "wol_queued" with their "delay_ms" and sent later.
+            wol_burst: Wake sends per group.
+            
+        Returns:
+            Dict with "results" (one per entry run), executed, failed, skipped.
+        """
+        data: Dict[str, Any] = {"commands": commands}
+        if stop_on_error:
+            data["stop_on_error"] = True
+        if wol_interval_ms:
+            data["wol_interval_ms"] = wol_interval_ms
+            data["wol_burst"] = wol_burst
+        return self.handler.send_command("batch", data)
+
+    def wake_many(self, macs: List[str], wol_interval_ms: int = 0,
+                  wol_burst: int = 1) -> Dict[str, Any]:
+        """Send Wake-on-LAN to several MACs with one batch command.
+        
+        Args:
+            macs: Target MAC addresses.
+            wol_interval_ms: Pause between groups of wake sends.
+            wol_burst: Wake sends per group.
+            
+        Returns:
+            Batch result with one wake result per MAC.
+        """
+        return self.batch([{"command": "wake", "data": {"mac": mac}} for mac in macs],
+                          wol_interval_ms=wol_interval_ms, wol_burst=wol_burst)
+
+    @classmethod
+    def request_for(cls, method: str, *args) -> Tuple[str, Optional[Dict[str, Any]]]:
+        """The (command, data) pair a command method sends, for pipeline().
+        
+        Example:
+            >>> WakeLinkCommands.request_for("enable_site")
+            ('web_control', {'action': 'enable'})
+        """
+        recorder = _RequestRecorder()
+        getattr(cls(recorder), method)(*args)
+        return recorder.request
+
+    def pipeline(self, commands: List[Tuple[str, Optional[Dict[str, Any]]]]) -> List[Dict[str, Any]]:
+        """Send several commands as separate packets without waiting for each reply.
+        
+        Unlike batch(), every command is its own signed packet with its
+        own reply; the handler keeps a few in flight on one connection
+        and matches the replies by request_id. Handlers without
+        send_commands() run them one after another.
+        
+        Args:
+            commands: (command, data) pairs, run by the device in this order.
+            
+        Returns:
+            One result per command, in the order given.
+        """
+        send_commands = getattr(self.handler, "send_commands", None)
+        if send_commands:
+            return send_commands(commands)
+        return [self.handler.send_command(command, data) for command, data in commands]
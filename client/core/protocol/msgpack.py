@@ -0,0 +1,193 @@
+"""
+Minimal MessagePack codec for WakeLink protocol v2.
+
+Covers the types the firmware's ArduinoJson encoder produces and accepts:
+nil, bool, int (all widths), float32/float64, str, bin, array and map.
+Extension types are not used by the protocol and are rejected.
+
+Kept dependency-free so the CLI runs without the msgpack package.
+"""
+
+import struct
+from typing import Any, Tuple
+
+
+class MsgPackError(ValueError):
+    """Raised on malformed or unsupported MessagePack data."""
+
+
+def packb(obj: Any) -> bytes:
+    """Encode obj as MessagePack.
+
+    Args:
+        obj: None, bool, int, float, str, bytes, list/tuple or dict.
+
+    Returns:
+        Encoded bytes.
+    """
+    out = bytearray()
+    _pack(obj, out)
+    return bytes(out)
+
+
+def unpackb(data: bytes) -> Any:
+    """Decode a single MessagePack object that spans all of data.
+
+    Raises:
+        MsgPackError: On truncated, trailing or unsupported data.
+    """
+    obj, pos = _unpack(data, 0)
+    if pos != len(data):
+        raise MsgPackError("trailing data")
+    return obj
+
+
+def _pack(obj: Any, out: bytearray) -> None:
+    if obj is None:
+        out.append(0xC0)
+    elif obj is True:
+        out.append(0xC3)
+    elif obj is False:
+        out.append(0xC2)
+    elif isinstance(obj, int):
+        _pack_int(obj, out)
+    elif isinstance(obj, float):
+        out += b"\xcb" + struct.pack(">d", obj)
+    elif isinstance(obj, str):
+        raw = obj.encode("utf-8")
+        n = len(raw)
+        if n < 32:
+            out.append(0xA0 | n)
+        elif n < 0x100:
+            out += bytes((0xD9, n))
+        elif n < 0x10000:
+            out += b"\xda" + struct.pack(">H", n)
+        else:
+            out += b"\xdb" + struct.pack(">I", n)
+        out += raw
+    elif isinstance(obj, (bytes, bytearray)):
+        n = len(obj)
+        if n < 0x100:
+            out += bytes((0xC4, n))
+        elif n < 0x10000:
+            out += b"\xc5" + struct.pack(">H", n)
+        else:
+            out += b"\xc6" + struct.pack(">I", n)
+        out += obj
+    elif isinstance(obj, (list, tuple)):
+        _pack_len(len(obj), 0x90, 0xDC, out)
+        for item in obj:
+            _pack(item, out)
+    elif isinstance(obj, dict):
+        _pack_len(len(obj), 0x80, 0xDE, out)
+        for key, value in obj.items():
+            _pack(key, out)
+            _pack(value, out)
+    else:
+        raise MsgPackError(f"cannot encode {type(obj).__name__}")
+
+
+def _pack_len(n: int, fix: int, wide: int, out: bytearray) -> None:
+    if n < 16:
+        out.append(fix | n)
+    elif n < 0x10000:
+        out += bytes((wide,)) + struct.pack(">H", n)
+    else:
+        out += bytes((wide + 1,)) + struct.pack(">I", n)
+
+
+def _pack_int(v: int, out: bytearray) -> None:
+    if 0 <= v < 0x80:
+        out.append(v)
+    elif -32 <= v < 0:
+        out.append(v & 0xFF)
+    elif v >= 0:
+        for tag, fmt, limit in ((0xCC, ">B", 1 << 8), (0xCD, ">H", 1 << 16),
+                                (0xCE, ">I", 1 << 32), (0xCF, ">Q", 1 << 64)):
+            if v < limit:
+                out += bytes((tag,)) + struct.pack(fmt, v)
+                return
+        raise MsgPackError("int too large")
+    else:
+        for tag, fmt, limit in ((0xD0, ">b", 1 << 7), (0xD1, ">h", 1 << 15),
+                                (0xD2, ">i", 1 << 31), (0xD3, ">q", 1 << 63)):
+            if v >= -limit:
+                out += bytes((tag,)) + struct.pack(fmt, v)
+                return
+        raise MsgPackError("int too small")
+
+
+# Fixed-width scalars: tag -> (struct format, size)
+_SCALARS = {
+    0xCA: (">f", 4), 0xCB: (">d", 8),
+    0xCC: (">B", 1), 0xCD: (">H", 2), 0xCE: (">I", 4), 0xCF: (">Q", 8),
+    0xD0: (">b", 1), 0xD1: (">h", 2), 0xD2: (">i", 4), 0xD3: (">q", 8),
+}
+
+
+def _take(data: bytes, pos: int, n: int) -> Tuple[bytes, int]:
+    end = pos + n
+    if end > len(data):
+        raise MsgPackError("truncated")
+    return data[pos:end], end
+
+
+def _unpack(data: bytes, pos: int) -> Tuple[Any, int]:
+    if pos >= len(data):
+        raise MsgPackError("truncated")
+    tag = data[pos]
+    pos += 1
+
+    if tag <= 0x7F:
+        return tag, pos
+    if tag >= 0xE0:
+        return tag - 0x100, pos
+    if 0xA0 <= tag <= 0xBF:
+        raw, pos = _take(data, pos, tag & 0x1F)
+        return raw.decode("utf-8"), pos
+    if 0x90 <= tag <= 0x9F:
+        return _unpack_array(data, pos, tag & 0x0F)
+    if 0x80 <= tag <= 0x8F:
+        return _unpack_map(data, pos, tag & 0x0F)
+
+    if tag == 0xC0:
+        return None, pos
+    if tag == 0xC2:
+        return False, pos
+    if tag == 0xC3:
+        return True, pos
+    if tag in _SCALARS:
+        fmt, size = _SCALARS[tag]
+        raw, pos = _take(data, pos, size)
+        return struct.unpack(fmt, raw)[0], pos
+    if tag in (0xD9, 0xDA, 0xDB, 0xC4, 0xC5, 0xC6):
+        size = {0xD9: 1, 0xDA: 2, 0xDB: 4, 0xC4: 1, 0xC5: 2, 0xC6: 4}[tag]
+        raw, pos = _take(data, pos, size)
+        raw, pos = _take(data, pos, int.from_bytes(raw, "big"))
+        return (raw.decode("utf-8") if tag >= 0xD9 else raw), pos
+    if tag in (0xDC, 0xDD, 0xDE, 0xDF):
+        size = 2 if tag in (0xDC, 0xDE) else 4
+        raw, pos = _take(data, pos, size)
+        n = int.from_bytes(raw, "big")
+        if tag in (0xDC, 0xDD):
+            return _unpack_array(data, pos, n)
+        return _unpack_map(data, pos, n)
+
+    raise MsgPackError(f"unsupported type 0x{tag:02x}")
+
+
+def _unpack_array(data: bytes, pos: int, n: int) -> Tuple[list, int]:
+    items = []
+    for _ in range(n):
+        item, pos = _unpack(data, pos)
+        items.append(item)
+    return items, pos
+
+
+def _unpack_map(data: bytes, pos: int, n: int) -> Tuple[dict, int]:
+    result = {}
+    for _ in range(n):
+        key, pos = _unpack(data, pos)
+        value, pos = _unpack(data, pos)
+        result[key] = value
+    return result, pos
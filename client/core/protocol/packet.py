@@ -1,5 +1,5 @@
 """
-WakeLink Protocol v1.0 Packet Manager.
+WakeLink Protocol v1.0/v1.1/v2 Packet Manager.
 
 Handles creation and processing of signed, encrypted packets for
 communication with WakeLink devices. Compatible with firmware packet.cpp.
@@ -9,15 +9,49 @@ Packet format:
 - Payload: hex string = [uint16_be length] + [ciphertext] + [16-byte nonce]
 - Signature: HMAC-SHA256 of payload hex string only
 
+Protocol v1.1 (AEAD) drops the signature field:
+- Payload: hex string = [uint16_be length] + [ciphertext] + [12-byte nonce] + [16-byte tag]
+- Tag: ChaCha20-Poly1305 over the length prefix (AAD) and raw ciphertext
+
+Protocol v2 is a binary frame instead of JSON/hex:
+- Header (28 bytes): 0x02, flags, SHA256(device_id)[:4], uint64_be counter,
+  12-byte nonce, uint16_be body length
+- Body: ChaCha20 ciphertext of the MessagePack inner packet + 16-byte tag
+- Tag: ChaCha20-Poly1305 over the whole header (AAD) and the ciphertext
+- The header counter carries "seq"; responses set flags bit 0
+
+Messages over 500 bytes are fragmented (see firmware fragment.h):
+- Each fragment is sealed as its own packet/frame (fresh nonce); its
+  plaintext is 0xC1, flags, uint32_be message id, uint16_be index,
+  uint16_be count, uint16_be total length, then the next chunk of the
+  inner JSON (v1.x) or MessagePack map (v2)
+- The device answers request fragments with {"status": "pending"} and
+  runs the command once the last one is in; fragmented requests carry
+  "seq" in the inner message, v2 included
+- Fragmented responses are reassembled here; until the last fragment
+  process_incoming_* return {"status": "partial"}
+
+Inner packets carry "sender" (stable per host) and "seq" (strictly
+increasing, microsecond clock). The device keeps a sliding window per
+sender, so pipelined requests may arrive out of order but never twice.
+"seq" is required on v1.1 and v2. All senders share one floor, persisted
+across reboots a few seconds ahead of the newest number, so "seq" must
+stay on the wall-clock microsecond scale and host clocks in sync.
+
 The server acts as a transparent relay and never decrypts the payload.
 """
 
+import hashlib
 import json
+import os
+import struct
+import threading
 import time
 import uuid
-from typing import Any, Dict, Optional
+from typing import Any, Dict, List, Optional, Tuple, Union
 
 from ..crypto import Crypto
+from . import msgpack
 
 
 class PacketManager:
@@ -29,16 +63,71 @@ class PacketManager:
     """
     
     PROTOCOL_VERSION = "1.0"
+    AEAD_VERSION = "1.1"
+    FRAME_VERSION = "2.0"
+    
+    FRAME_HEADER = struct.Struct(">BB4sQ12sH")  # version, flags, device hash, counter, nonce, length
+    FRAME_TAG = 16
+    FRAME_MAX_BODY = 500
+    FRAME_FLAG_RESPONSE = 0x01
     
-    def __init__(self, token: str, device_id: str):
+    FRAGMENT_HEADER = struct.Struct(">BBIHHH")  # marker, flags, message id, index, count, total
+    FRAGMENT_MARKER = 0xC1
+    FRAGMENT_PAYLOAD = 384      # sealed bytes per fragment (fits the device's 1 KB TCP buffer)
+    FRAGMENT_THRESHOLD = 500    # larger messages are fragmented
+    FRAGMENT_MAX_MESSAGE = 4096  # largest request the device reassembles
+    FRAGMENT_PENDING = 8        # partial responses kept before the oldest is dropped
+    
+    def __init__(self, token: str, device_id: str, version: str = PROTOCOL_VERSION):
         """Initialize packet manager.
         
         Args:
             token: Device token (min 32 chars) for key derivation.
             device_id: Device identifier for packet headers.
+            version: "1.0" (HMAC-SHA256), "1.1" (ChaCha20-Poly1305 AEAD)
+                or "2.0" (binary frames, see create_command_frame).
         """
         self.crypto = Crypto(token)
         self.device_id = device_id
+        self.version = version
+        self.sender = self.default_sender()
+        self._seq = 0
+        self._seq_lock = threading.Lock()
+        self.device_hash = hashlib.sha256(device_id.encode("utf-8")).digest()[:4]
+        self._partial: Dict[int, list] = {}  # message id -> [next index, count, total, bytearray]
+
+    @staticmethod
+    def default_sender() -> str:
+        """Stable 8-char sender id for this host (keeps one replay window across runs)."""
+        return hashlib.sha256(uuid.getnode().to_bytes(8, "big")).hexdigest()[:8]
+
+    def next_seq(self) -> int:
+        """Next sequence number: microsecond clock, strictly increasing."""
+        with self._seq_lock:
+            self._seq = max(self._seq + 1, time.time_ns() // 1000)
+            return self._seq
+
+    def _build_outer(self, inner_json: str) -> str:
+        """Encrypt inner JSON and wrap it in the outer packet for self.version."""
+        return self._seal_outer(inner_json.encode("utf-8")[:self.FRAGMENT_THRESHOLD])
+    
+    def _seal_outer(self, plain: bytes) -> str:
+        """Encrypt raw plaintext (message or fragment) into an outer packet."""
+        outer = {"device_id": self.device_id}
+        if self.version == self.AEAD_VERSION:
+            outer["payload"] = self.crypto.seal_aead(plain)
+        else:
+            payload_hex = self.crypto.seal_secure(plain)
+            outer["payload"] = payload_hex
+            # Calculate HMAC on payload only
+            outer["signature"] = self.crypto.calculate_hmac(payload_hex)
+        outer["version"] = self.version
+        return json.dumps(outer, separators=(",", ":"))
+    
+    @property
+    def binary(self) -> bool:
+        """True when this manager speaks v2 binary frames."""
+        return self.version == self.FRAME_VERSION
     
     def create_command_packet(self, command: str, data: Optional[Dict[str, Any]] = None) -> str:
         """Create a signed, encrypted command packet.
@@ -55,25 +144,90 @@ class PacketManager:
             "command": command,
             "data": data or {},
             "request_id": str(uuid.uuid4())[:8],
-            "timestamp": int(time.time())
+            "timestamp": int(time.time()),
+            "sender": self.sender,
+            "seq": self.next_seq()
         }
         
-        # Encrypt inner packet
+        # Encrypt inner packet and build outer packet
         inner_json = json.dumps(inner, separators=(",", ":"))
-        payload_hex = self.crypto.create_secure_response(inner_json)
-        
-        # Calculate HMAC on payload only
-        signature = self.crypto.calculate_hmac(payload_hex)
+        return self._build_outer(inner_json)
+    
+    def create_command_packets(self, command: str, data: Optional[Dict[str, Any]] = None) -> Tuple[List[str], str]:
+        """Create a command as one packet, or as fragments if it is large.
         
-        # Build outer packet
-        outer = {
-            "device_id": self.device_id,
-            "payload": payload_hex,
-            "signature": signature,
-            "version": self.PROTOCOL_VERSION
+        Args:
+            command: Command name.
+            data: Optional command parameters.
+            
+        Returns:
+            Tuple of (outer packets to send in order, request_id).
+        """
+        request_id = str(uuid.uuid4())[:8]
+        inner = {
+            "command": command,
+            "data": data or {},
+            "request_id": request_id,
+            "timestamp": int(time.time()),
+            "sender": self.sender,
+            "seq": self.next_seq()
         }
+        message = json.dumps(inner, separators=(",", ":")).encode("utf-8")
+        return [self._seal_outer(part) for part in self.split_message(message)], request_id
+    
+    def split_message(self, message: bytes) -> List[bytes]:
+        """Split a message into fragment plaintexts (or return it whole).
         
-        return json.dumps(outer, separators=(",", ":"))
+        Raises:
+            ValueError: If the message exceeds FRAGMENT_MAX_MESSAGE.
+        """
+        if len(message) <= self.FRAGMENT_THRESHOLD:
+            return [message]
+        if len(message) > self.FRAGMENT_MAX_MESSAGE:
+            raise ValueError(f"Message too large ({len(message)} > {self.FRAGMENT_MAX_MESSAGE})")
+        
+        chunk = self.FRAGMENT_PAYLOAD - self.FRAGMENT_HEADER.size
+        count = (len(message) + chunk - 1) // chunk
+        message_id = struct.unpack(">I", os.urandom(4))[0]
+        return [
+            self.FRAGMENT_HEADER.pack(self.FRAGMENT_MARKER, 0, message_id, index, count, len(message))
+            + message[index * chunk:(index + 1) * chunk]
+            for index in range(count)
+        ]
+    
+    def _reassemble(self, plain: bytes) -> Union[bytes, Dict[str, Any]]:
+        """Add a response fragment; returns the whole message once complete.
+        
+        Returns:
+            Message bytes, or a "partial"/"error" result dict.
+        """
+        size = self.FRAGMENT_HEADER.size
+        if len(plain) <= size:
+            return {"status": "error", "error": "BAD_FRAGMENT"}
+        _, flags, message_id, index, count, total = self.FRAGMENT_HEADER.unpack_from(plain)
+        if flags or index >= count or total == 0:
+            return {"status": "error", "error": "BAD_FRAGMENT"}
+        
+        entry = self._partial.get(message_id)
+        if entry is None:
+            if index != 0:
+                return {"status": "error", "error": "FRAGMENT_OUT_OF_ORDER"}
+            if len(self._partial) >= self.FRAGMENT_PENDING:
+                self._partial.pop(next(iter(self._partial)))
+            entry = self._partial[message_id] = [0, count, total, bytearray()]
+        if index != entry[0] or count != entry[1] or total != entry[2]:
+            del self._partial[message_id]
+            return {"status": "error", "error": "FRAGMENT_OUT_OF_ORDER"}
+        
+        entry[0] += 1
+        entry[3] += plain[size:]
+        if index + 1 < count:
+            return {"status": "partial", "fragment": {"id": message_id, "index": index, "count": count}}
+        
+        del self._partial[message_id]
+        if len(entry[3]) != total:
+            return {"status": "error", "error": "BAD_FRAGMENT"}
+        return bytes(entry[3])
     
     def process_incoming_packet(self, packet_json: str) -> Dict[str, Any]:
         """Process an incoming signed, encrypted packet.
@@ -90,28 +244,38 @@ class PacketManager:
         except json.JSONDecodeError as e:
             return {"status": "error", "error": f"JSON_PARSE_ERROR: {e}"}
         
+        aead = outer.get("version") == self.AEAD_VERSION
+        
         # Validate required fields
-        required = ["device_id", "payload", "signature"]
+        required = ["device_id", "payload"] if aead else ["device_id", "payload", "signature"]
         for field in required:
             if field not in outer:
                 return {"status": "error", "error": f"MISSING_FIELD: {field}"}
         
         payload_hex = outer["payload"]
-        signature = outer["signature"]
         
-        # Verify HMAC signature (on payload only)
-        if not self.crypto.verify_hmac(payload_hex, signature):
-            return {"status": "error", "error": "INVALID_SIGNATURE"}
+        if aead:
+            # Tag check and decryption in one step
+            plain = self.crypto.open_aead(payload_hex)
+        else:
+            # Verify HMAC signature (on payload only)
+            if not self.crypto.verify_hmac(payload_hex, outer["signature"]):
+                return {"status": "error", "error": "INVALID_SIGNATURE"}
+            
+            # Decrypt payload
+            plain = self.crypto.open_secure(payload_hex)
         
-        # Decrypt payload
-        decrypted = self.crypto.process_secure_packet(payload_hex)
+        if isinstance(plain, str):
+            return {"status": "error", "error": plain}
         
-        if decrypted.startswith("ERROR:"):
-            return {"status": "error", "error": decrypted}
+        if plain[:1] == bytes([self.FRAGMENT_MARKER]):
+            plain = self._reassemble(plain)
+            if isinstance(plain, dict):
+                return plain
         
         # Parse inner packet
         try:
-            inner = json.loads(decrypted)
+            inner = json.loads(plain.decode("utf-8", errors="ignore"))
         except json.JSONDecodeError as e:
             return {"status": "error", "error": f"INNER_JSON_ERROR: {e}"}
         
@@ -141,19 +305,119 @@ class PacketManager:
         if "timestamp" not in response_data:
             response_data["timestamp"] = int(time.time())
         
-        # Encrypt response
+        # Encrypt response and build outer packet
         inner_json = json.dumps(response_data, separators=(",", ":"))
-        payload_hex = self.crypto.create_secure_response(inner_json)
+        return self._build_outer(inner_json)
+    
+    # --------------------- Binary frames (v2) ---------------------
+    
+    def create_command_frame(self, command: str, data: Optional[Dict[str, Any]] = None) -> Tuple[bytes, str]:
+        """Create an encrypted v2 command frame.
         
-        # Calculate HMAC on payload only
-        signature = self.crypto.calculate_hmac(payload_hex)
+        The sequence number travels in the header counter, so the body
+        only carries command, data, request_id and sender.
         
-        # Build outer packet
-        outer = {
-            "device_id": self.device_id,
-            "payload": payload_hex,
-            "signature": signature,
-            "version": self.PROTOCOL_VERSION
+        Args:
+            command: Command name (e.g., "ping", "wake", "info").
+            data: Optional command parameters.
+            
+        Returns:
+            Tuple of (frame bytes, request_id).
+        """
+        request_id = str(uuid.uuid4())[:8]
+        inner = {
+            "command": command,
+            "data": data or {},
+            "request_id": request_id,
+            "sender": self.sender
         }
+        return self._seal_frame(msgpack.packb(inner), 0, self.next_seq()), request_id
+    
+    def create_command_frames(self, command: str, data: Optional[Dict[str, Any]] = None) -> Tuple[List[bytes], str]:
+        """Create a command as one v2 frame, or as fragment frames if it is large.
         
-        return json.dumps(outer, separators=(",", ":"))
+        A fragmented command carries "seq" in its map, since the device
+        does not sequence the individual fragment frames.
+        
+        Returns:
+            Tuple of (frames to send in order, request_id).
+        """
+        request_id = str(uuid.uuid4())[:8]
+        inner = {
+            "command": command,
+            "data": data or {},
+            "request_id": request_id,
+            "sender": self.sender
+        }
+        body = msgpack.packb(inner)
+        if len(body) <= self.FRAME_MAX_BODY:
+            return [self._seal_frame(body, 0, self.next_seq())], request_id
+        
+        inner["seq"] = self.next_seq()
+        parts = self.split_message(msgpack.packb(inner))
+        return [self._seal_frame(part, 0, self.next_seq()) for part in parts], request_id
+    
+    def create_response_frame(self, response_data: Dict[str, Any]) -> bytes:
+        """Create an encrypted v2 response frame (device side, for testing)."""
+        return self._seal_frame(msgpack.packb(response_data), self.FRAME_FLAG_RESPONSE,
+                                self.crypto.request_counter)
+    
+    def _seal_frame(self, body: bytes, flags: int, counter: int) -> bytes:
+        if len(body) > self.FRAME_MAX_BODY:
+            raise ValueError(f"Frame body too large ({len(body)} > {self.FRAME_MAX_BODY})")
+        header = self.FRAME_HEADER.pack(0x02, flags, self.device_hash, counter,
+                                        os.urandom(12), len(body))
+        return header + self.crypto.seal_frame(header, body)
+    
+    @classmethod
+    def frame_length(cls, header: bytes) -> int:
+        """Total frame length announced by a v2 header (0 if out of range)."""
+        length = struct.unpack_from(">H", header, 26)[0]
+        if length > cls.FRAME_MAX_BODY:
+            return 0
+        return cls.FRAME_HEADER.size + length + cls.FRAME_TAG
+    
+    def process_incoming_frame(self, frame: bytes) -> Dict[str, Any]:
+        """Verify, decrypt and decode a v2 frame.
+        
+        Args:
+            frame: Complete frame bytes.
+            
+        Returns:
+            Dict with status, decoded inner packet and "request_counter"
+            (device responses) or "seq" (requests) from the header counter.
+        """
+        size = self.FRAME_HEADER.size
+        if len(frame) < size + self.FRAME_TAG or frame[0] != 0x02:
+            return {"status": "error", "error": "INVALID_FRAME"}
+        if self.frame_length(frame) != len(frame):
+            return {"status": "error", "error": "INVALID_LENGTH"}
+        
+        _, flags, device_hash, counter, _, length = self.FRAME_HEADER.unpack_from(frame)
+        if device_hash != self.device_hash:
+            return {"status": "error", "error": "WRONG_DEVICE"}
+        
+        header = frame[:size]
+        body = self.crypto.open_frame(header, frame[size:size + length], frame[size + length:])
+        if body is None:
+            return {"status": "error", "error": "INVALID_SIGNATURE"}
+        
+        if body[:1] == bytes([self.FRAGMENT_MARKER]):
+            body = self._reassemble(body)
+            if isinstance(body, dict):
+                return body
+        
+        try:
+            inner = msgpack.unpackb(body)
+        except (msgpack.MsgPackError, UnicodeDecodeError) as e:
+            return {"status": "error", "error": f"INVALID_MSGPACK: {e}"}
+        if not isinstance(inner, dict):
+            return {"status": "error", "error": "INVALID_MSGPACK"}
+        
+        result = {"status": "success"}
+        if flags & self.FRAME_FLAG_RESPONSE:
+            result["request_counter"] = counter
+        else:
+            result["seq"] = counter
+        result.update(inner)
+        return result
@@ -305,6 +305,7 @@ class SmartParser:
         'cloud-off': 'disable_cloud', 'disable-cloud': 'disable_cloud',  # Cloud disable
         'cloud-status': 'cloud_status',  # Cloud status
         'crypto': 'crypto_info', 'crypto-info': 'crypto_info', 'security': 'crypto_info',  # Crypto info
+        'bench': 'crypto_bench', 'crypto-bench': 'crypto_bench',  # Crypto self-test + benchmark
         
         # Device management helpers (no -- prefix)
         'list': 'list_devices', 'ls': 'list_devices', 'l': 'list_devices',  # List local devices
@@ -359,6 +360,7 @@ class SmartParser:
         p.add_argument("--disable-site", action="store_true")
         p.add_argument("--site-status", action="store_true")
         p.add_argument("--crypto-info", action="store_true")
+        p.add_argument("--crypto-bench", action="store_true")
         p.add_argument("--update-token", action="store_true")
         p.add_argument("--list-devices", action="store_true")
         p.add_argument("--cloud-list-devices", action="store_true")
@@ -637,7 +639,7 @@ class SmartParser:
     def _has_device_command(self, parsed) -> bool:
         return any(getattr(parsed, cmd, False) for cmd in [
             'ping', 'info', 'wake', 'restart', 'ota_start', 'open_setup',
-            'enable_site', 'disable_site', 'site_status', 'crypto_info',
+            'enable_site', 'disable_site', 'site_status', 'crypto_info', 'crypto_bench',
             'update_token', 'enable_cloud', 'disable_cloud', 'cloud_status'
         ])
     
@@ -652,9 +654,13 @@ class SmartParser:
         Example: wl pico ping
 
   \033[33mwl DEVICE wake MAC\033[0m
-        → Send Wake-on-LAN
+        → Send Wake-on-LAN (comma-separated MACs go in one batch packet)
         Example: wl pico wake 00:11:22:33:44:55
 
+  \033[33mwl DEVICE COMMAND COMMAND ...\033[0m
+        → Send several commands together (pipelined, one reply each)
+        Example: wl pico wake 00:11:22:33:44:55 info cloud-status
+
 \033[1;32mDEVICE MANAGEMENT:\033[0m
   \033[33mwl add NAME token TOKEN ip IP [port PORT]\033[0m
         → Add TCP device (local network)
@@ -681,7 +687,7 @@ class SmartParser:
 
 \033[1;32mDEVICE COMMANDS:\033[0m
   ping, info, wake MAC, restart, ota, setup,
-  site-on, site-off, site-status, crypto, update-token,
+  site-on, site-off, site-status, crypto, bench, update-token,
   cloud-on, cloud-off, cloud-status
 
 \033[1;32mTRANSPORT MODES:\033[0m
@@ -1153,6 +1159,8 @@ class WakeLinkClient:
         
         protocol = dev.get("protocol", "").lower()
         handler_kwargs = {"token": dev["token"], "device_id": dev["device_id"]}
+        if dev.get("version"):
+            handler_kwargs["version"] = dev["version"]
         
         # Check for on-the-fly mode override (tcp/http/wss)
         mode_override = getattr(args, 'mode', None)
@@ -1246,16 +1254,48 @@ class WakeLinkClient:
             "disable_cloud": client.disable_cloud,
             "cloud_status": client.cloud_status,
             "crypto_info": client.crypto_info,
+            "crypto_bench": client.crypto_bench,
             "update_token": client.update_token,
         }
 
         executed = False
         
+        # Several commands on one line go out together, pipelined on one
+        # connection (update_token changes the key, so it always runs alone)
+        requested = [cmd for cmd in cmd_map if cmd != "wake" and getattr(args, cmd, False)]
+        if getattr(args, 'wake', None):
+            requested.insert(0, "wake")
+        if len(requested) > 1 and "update_token" not in requested:
+            self.printer.print_command(" + ".join(requested), mode)
+            try:
+                calls = []
+                for cmd in requested:
+                    if cmd != "wake":
+                        calls.append(WakeLinkCommands.request_for(cmd_map[cmd].__name__))
+                        continue
+                    macs = [format_mac_address(m) for m in args.wake.split(",") if m]
+                    if len(macs) > 1:
+                        calls.append(WakeLinkCommands.request_for("wake_many", macs))
+                    else:
+                        calls.append(WakeLinkCommands.request_for("wake_device", macs[0]))
+                
+                for cmd, result in zip(requested, client.pipeline(calls)):
+                    print(f"\n{self.printer.colorize(cmd, 'cyan')}\n{self.printer.format_response(result)}")
+            except Exception as e:
+                self.printer.print_error(f"Failed: {e}")
+            handler.close()
+            return
+        
         # Handle wake command separately
         if hasattr(args, 'wake') and args.wake:
             self.printer.print_command("wake", mode)
             try:
-                result = client.wake_device(format_mac_address(args.wake))
+                macs = [m for m in args.wake.split(",") if m]
+                if len(macs) > 1:
+                    # One batch packet instead of a connection per MAC
+                    result = client.wake_many([format_mac_address(m) for m in macs])
+                else:
+                    result = client.wake_device(format_mac_address(args.wake))
                 print(f"\n{self.printer.format_response(result)}")
                 executed = True
             except Exception as e:
@@ -1287,6 +1327,9 @@ class WakeLinkClient:
         if not executed:
             self.printer.print_warning("No command - use 'wl help'")
 
+        # Release the kept-alive TCP connection / HTTP session
+        handler.close()
+
 
 # =============================
 # Main Entry Point
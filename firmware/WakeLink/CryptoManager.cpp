@@ -3,221 +3,34 @@
  * @brief Cryptographic operations for WakeLink firmware.
  *
  * Implements ChaCha20 encryption, SHA256 hashing, HMAC, and request counter management.
- * All crypto operations are custom implementations without external libraries.
+ * The primitives are reached through CryptoBackend (crypto_backend.h); the
+ * default software backend lives in chacha20.cpp, poly1305.cpp and sha256.cpp.
  */
 
 #include "CryptoManager.h"
-#include "tcp_handler.h"
+#include "secure_random.h"
+#include "hex_codec.h"
+#include "payload_codec.h"
 #include <EEPROM.h>
 
-// SHA256 constants
-static const uint32_t SHA256_K[64] = {
-    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-};
-
-// SHA256 helper functions
-uint32_t CryptoManager::sha256_rotr(uint32_t x, uint32_t n) {
-    return (x >> n) | (x << (32 - n));
-}
-
-uint32_t CryptoManager::sha256_ch(uint32_t x, uint32_t y, uint32_t z) {
-    return (x & y) ^ (~x & z);
-}
-
-uint32_t CryptoManager::sha256_maj(uint32_t x, uint32_t y, uint32_t z) {
-    return (x & y) ^ (x & z) ^ (y & z);
-}
-
-uint32_t CryptoManager::sha256_sigma0(uint32_t x) {
-    return sha256_rotr(x, 2) ^ sha256_rotr(x, 13) ^ sha256_rotr(x, 22);
-}
-
-uint32_t CryptoManager::sha256_sigma1(uint32_t x) {
-    return sha256_rotr(x, 6) ^ sha256_rotr(x, 11) ^ sha256_rotr(x, 25);
-}
-
-uint32_t CryptoManager::sha256_gamma0(uint32_t x) {
-    return sha256_rotr(x, 7) ^ sha256_rotr(x, 18) ^ (x >> 3);
-}
-
-uint32_t CryptoManager::sha256_gamma1(uint32_t x) {
-    return sha256_rotr(x, 17) ^ sha256_rotr(x, 19) ^ (x >> 10);
-}
-
-void CryptoManager::sha256_transform() {
-    uint32_t a, b, c, d, e, f, g, h;
-    uint32_t w[64];
-    int32_t i;
-
-    // Prepare message schedule
-    for (i = 0; i < 16; i++) {
-        w[i] = (sha256_buffer[i * 4] << 24) | (sha256_buffer[i * 4 + 1] << 16) | 
-               (sha256_buffer[i * 4 + 2] << 8) | sha256_buffer[i * 4 + 3];
-    }
-    
-    for (i = 16; i < 64; i++) {
-        w[i] = sha256_gamma1(w[i - 2]) + w[i - 7] + sha256_gamma0(w[i - 15]) + w[i - 16];
-    }
-
-    // Initialize working variables
-    a = sha256_state[0]; b = sha256_state[1]; c = sha256_state[2]; d = sha256_state[3];
-    e = sha256_state[4]; f = sha256_state[5]; g = sha256_state[6]; h = sha256_state[7];
-
-    // Main compression loop
-    for (i = 0; i < 64; i++) {
-        uint32_t t1 = h + sha256_sigma1(e) + sha256_ch(e, f, g) + SHA256_K[i] + w[i];
-        uint32_t t2 = sha256_sigma0(a) + sha256_maj(a, b, c);
-        h = g; g = f; f = e; e = d + t1;
-        d = c; c = b; b = a; a = t1 + t2;
-    }
-
-    // Add to hash state
-    sha256_state[0] += a; sha256_state[1] += b; sha256_state[2] += c; sha256_state[3] += d;
-    sha256_state[4] += e; sha256_state[5] += f; sha256_state[6] += g; sha256_state[7] += h;
-}
-
-void CryptoManager::sha256_init() {
-    sha256_bitlen = 0;
-    sha256_buffer_len = 0;
-    sha256_state[0] = 0x6a09e667; sha256_state[1] = 0xbb67ae85;
-    sha256_state[2] = 0x3c6ef372; sha256_state[3] = 0xa54ff53a;
-    sha256_state[4] = 0x510e527f; sha256_state[5] = 0x9b05688c;
-    sha256_state[6] = 0x1f83d9ab; sha256_state[7] = 0x5be0cd19;
-}
-
-void CryptoManager::sha256_update(const uint8_t* data, size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        sha256_buffer[sha256_buffer_len++] = data[i];
-        if (sha256_buffer_len == 64) {
-            sha256_transform();
-            sha256_bitlen += 512;
-            sha256_buffer_len = 0;
-        }
-    }
-}
-
-void CryptoManager::sha256_final(uint8_t* hash) {
-    uint32_t i = sha256_buffer_len;
-    
-    // Append '1' bit
-    sha256_buffer[i++] = 0x80;
-    
-    // Pad with zeros until 56 bytes
-    if (i > 56) {
-        while (i < 64) sha256_buffer[i++] = 0x00;
-        sha256_transform();
-        i = 0;
-    }
-    
-    while (i < 56) sha256_buffer[i++] = 0x00;
-    
-    // Append message length (in bits) - BIG ENDIAN
-    sha256_bitlen += sha256_buffer_len * 8;
-    sha256_buffer[56] = (sha256_bitlen >> 56) & 0xFF;
-    sha256_buffer[57] = (sha256_bitlen >> 48) & 0xFF;
-    sha256_buffer[58] = (sha256_bitlen >> 40) & 0xFF;
-    sha256_buffer[59] = (sha256_bitlen >> 32) & 0xFF;
-    sha256_buffer[60] = (sha256_bitlen >> 24) & 0xFF;
-    sha256_buffer[61] = (sha256_bitlen >> 16) & 0xFF;
-    sha256_buffer[62] = (sha256_bitlen >> 8) & 0xFF;
-    sha256_buffer[63] = sha256_bitlen & 0xFF;
-    
-    sha256_transform();
-    
-    // Get final hash - BIG ENDIAN
-    for (i = 0; i < 4; i++) {
-        hash[i]      = (sha256_state[0] >> (24 - i * 8)) & 0xFF;
-        hash[i + 4]  = (sha256_state[1] >> (24 - i * 8)) & 0xFF;
-        hash[i + 8]  = (sha256_state[2] >> (24 - i * 8)) & 0xFF;
-        hash[i + 12] = (sha256_state[3] >> (24 - i * 8)) & 0xFF;
-        hash[i + 16] = (sha256_state[4] >> (24 - i * 8)) & 0xFF;
-        hash[i + 20] = (sha256_state[5] >> (24 - i * 8)) & 0xFF;
-        hash[i + 24] = (sha256_state[6] >> (24 - i * 8)) & 0xFF;
-        hash[i + 28] = (sha256_state[7] >> (24 - i * 8)) & 0xFF;
-    }
-}
-
-// ChaCha20 constants
-static const uint32_t SIGMA[4] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
-
-void CryptoManager::chacha20_block(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter, uint8_t output[64]) {
-    uint32_t state[16];
-    
-    // Initialize state
-    state[0] = SIGMA[0]; state[1] = SIGMA[1]; state[2] = SIGMA[2]; state[3] = SIGMA[3];
-    
-    // Key
-    for (int32_t i = 0; i < 8; i++) {
-        state[4 + i] = ((uint32_t)key[i * 4]) | ((uint32_t)key[i * 4 + 1] << 8) | 
-                      ((uint32_t)key[i * 4 + 2] << 16) | ((uint32_t)key[i * 4 + 3] << 24);
-    }
-    
-    // Counter and nonce
-    state[12] = counter;
-    state[13] = ((uint32_t)nonce[0]) | ((uint32_t)nonce[1] << 8) | ((uint32_t)nonce[2] << 16) | ((uint32_t)nonce[3] << 24);
-    state[14] = ((uint32_t)nonce[4]) | ((uint32_t)nonce[5] << 8) | ((uint32_t)nonce[6] << 16) | ((uint32_t)nonce[7] << 24);
-    state[15] = ((uint32_t)nonce[8]) | ((uint32_t)nonce[9] << 8) | ((uint32_t)nonce[10] << 16) | ((uint32_t)nonce[11] << 24);
-
-    uint32_t working_state[16];
-    memcpy(working_state, state, sizeof(working_state));
-
-    // 20 rounds (10 double rounds)
-    for (int32_t i = 0; i < 10; i++) {
-        // Quarter rounds
-        #define QR(a, b, c, d) \
-            a += b; d ^= a; d = (d << 16) | (d >> 16); \
-            c += d; b ^= c; b = (b << 12) | (b >> 20); \
-            a += b; d ^= a; d = (d << 8) | (d >> 24); \
-            c += d; b ^= c; b = (b << 7) | (b >> 25);
-
-        // Column rounds
-        QR(working_state[0], working_state[4], working_state[8], working_state[12])
-        QR(working_state[1], working_state[5], working_state[9], working_state[13])
-        QR(working_state[2], working_state[6], working_state[10], working_state[14])
-        QR(working_state[3], working_state[7], working_state[11], working_state[15])
-        
-        // Diagonal rounds
-        QR(working_state[0], working_state[5], working_state[10], working_state[15])
-        QR(working_state[1], working_state[6], working_state[11], working_state[12])
-        QR(working_state[2], working_state[7], working_state[8], working_state[13])
-        QR(working_state[3], working_state[4], working_state[9], working_state[14])
-    }
+/**
+ * @brief ChaCha20 encrypt/decrypt in place with counter 0.
+ *
+ * Key/nonce state is set up once for the whole message; the cycle cost
+ * is accumulated for the cipher_cycles_per_byte diagnostic.
+ *
+ * @param nonce 96-bit nonce.
+ * @param data Buffer to transform in place.
+ * @param length Data length in bytes.
+ */
+void CryptoManager::cipherInPlace(const uint8_t nonce[12], uint8_t* data, size_t length) {
+    uint32_t start = ESP.getCycleCount();
 
-    // Add to original state
-    for (int32_t i = 0; i < 16; i++) {
-        working_state[i] += state[i];
-    }
+    CryptoBackend::chacha20(chacha_key, nonce, 0, data, data, length);
 
-    // Convert to bytes (little-endian)
-    for (int32_t i = 0; i < 16; i++) {
-        output[i * 4] = working_state[i] & 0xFF;
-        output[i * 4 + 1] = (working_state[i] >> 8) & 0xFF;
-        output[i * 4 + 2] = (working_state[i] >> 16) & 0xFF;
-        output[i * 4 + 3] = (working_state[i] >> 24) & 0xFF;
-    }
-}
-
-void CryptoManager::chacha20_encrypt(const uint8_t key[32], const uint8_t nonce[12], const uint8_t* input, uint8_t* output, size_t length) {
-    uint8_t block[64];
-    uint32_t counter = 0;
-    
-    for (size_t i = 0; i < length; i += 64) {
-        chacha20_block(key, nonce, counter, block);
-        
-        size_t block_len = (length - i) < 64 ? (length - i) : 64;
-        for (size_t j = 0; j < block_len; j++) {
-            output[i + j] = input[i + j] ^ block[j];
-        }
-        
-        counter++;
-    }
+    cipherCyclesLast = ESP.getCycleCount() - start;
+    cipherCyclesTotal += cipherCyclesLast;
+    cipherBytesTotal += length;
 }
 
 // ==================== MAIN FUNCTIONS ====================
@@ -225,8 +38,11 @@ void CryptoManager::chacha20_encrypt(const uint8_t key[32], const uint8_t nonce[
 /**
  * @brief Initialize crypto manager.
  *
- * Derives ChaCha20 and HMAC keys from device_token using SHA256.
- * Sets enabled=true and loads request counter from EEPROM.
+ * Derives ChaCha20 and HMAC keys from device_token using SHA256 and
+ * keys the backend HMAC context (the software backend caches the
+ * ipad/opad midstates so packets skip the key blocks).
+ * Sets enabled=true and recovers the request counter and the replay
+ * floor from their journals.
  *
  * @return true on success, false if token is too short.
  */
@@ -234,111 +50,143 @@ bool CryptoManager::begin() {
     String token = cfg.device_token;
     if (token.length() < 32) return false;
 
-    sha256_init();
-    sha256_update((const uint8_t*)token.c_str(), token.length());
     uint8_t hash[32];
-    sha256_final(hash);
+    CryptoBackend::sha256((const uint8_t*)token.c_str(), token.length(), hash);
 
     memcpy(chacha_key, hash, 32);
     memcpy(hmac_key, hash, 32);
+    hmac.begin(hmac_key, 32);
     
     enabled = true;
     loadRequestCounter();
+    loadReplayFloor();
+
+    Serial.printf("Crypto backend: %s\n", CryptoBackend::name());
+    Serial.printf("ChaCha20 self-test (%s): %s\n", CHACHA20_KERNEL,
+                  ChaCha20::selfTest() ? "PASSED" : "FAILED");
+    Serial.printf("ChaCha20-Poly1305 self-test: %s\n",
+                  ChaCha20Poly1305::selfTest() ? "PASSED" : "FAILED");
 
-    Serial.printf("CryptoManager initialized | Requests: %lu/%lu\n", requestCounter, requestLimit);
+    Serial.printf("CryptoManager initialized | Requests: %lu\n", (unsigned long)requestCounter);
     return true;
 }
 
 /**
- * @brief Process encrypted packet.
+ * @brief Process encrypted packet in place.
  *
  * Accepts hex-encoded packet: length(2 bytes) | ciphertext | nonce(16 bytes).
- * Validates format, decodes hex to bytes, decrypts with ChaCha20, returns plaintext.
- * Checks request limit and returns error codes as strings starting with "ERROR:".
+ * Validates format, decodes the hex onto itself and decrypts the
+ * ciphertext where it lies; no copy of the payload is made.
+ * Returns error codes as strings starting with "ERROR:".
  *
- * @param hexPacket Hex-encoded encrypted packet.
- * @return Decrypted plaintext or error string.
+ * @param hexPacket Hex-encoded encrypted packet (overwritten).
+ * @param hexLen Length of hexPacket.
+ * @param plaintext Receives a pointer into hexPacket (NUL-terminated).
+ * @param plainLen Receives the plaintext length.
+ * @return nullptr on success, otherwise an "ERROR:*" string.
  */
-String CryptoManager::processSecurePacket(const String& hexPacket) {
+const char* CryptoManager::processSecurePacket(char* hexPacket, size_t hexLen,
+                                               char*& plaintext, size_t& plainLen) {
     if (!enabled) return "ERROR:CRYPTO_DISABLED";
-    if (isLimitExceeded()) return "ERROR:LIMIT_EXCEEDED";
-    
-    size_t len = hexPacket.length();
-    if (len % 2 != 0) return "ERROR:HEX_LEN";
-
-    size_t byteLen = len / 2;
-    if (byteLen < 22) return "ERROR:INVALID_PACKET_SIZE";
-
-    uint8_t packet[512];
-    for (size_t i = 0; i < byteLen && i < sizeof(packet); i++) {
-        char c1 = hexPacket[i*2], c2 = hexPacket[i*2+1];
-        c1 = (c1 >= 'a' && c1 <= 'f') ? c1 - 'a' + 10 : (c1 >= 'A' && c1 <= 'F') ? c1 - 'A' + 10 : c1 - '0';
-        c2 = (c2 >= 'a' && c2 <= 'f') ? c2 - 'a' + 10 : (c2 >= 'A' && c2 <= 'F') ? c2 - 'A' + 10 : c2 - '0';
-        packet[i] = (c1 << 4) | c2;
-    }
 
-    uint16_t data_len = (uint16_t(packet[0]) << 8) | uint16_t(packet[1]);
-    if (data_len == 0 || data_len > 500) return "ERROR:INVALID_DATA_LENGTH";
-    if (byteLen != (size_t)(2 + data_len + 16)) return "ERROR:INVALID_PACKET_SIZE";
+    PayloadView view;
+    const char* error = PayloadCodec::decodeSigned(hexPacket, hexLen, view);
+    if (error) return error;
 
-    uint8_t* encrypted_data = packet + 2;
-    uint8_t* nonce_ptr = packet + 2 + data_len;
+    // Nonce follows the ciphertext; decrypt in place
+    cipherInPlace(view.nonce, view.data, view.length);
 
-    uint8_t chacha_nonce[12];
-    memcpy(chacha_nonce, nonce_ptr, 12);
+    view.terminate();
+    plaintext = (char*)view.data;
+    plainLen = view.length;
 
-    uint8_t decrypted_data[512];
-    chacha20_encrypt(chacha_key, chacha_nonce, encrypted_data, decrypted_data, data_len);
+    return nullptr;
+}
 
-    String commandData;
-    commandData.reserve(data_len + 1);
-    for (uint16_t i = 0; i < data_len; i++) commandData += (char)decrypted_data[i];
+/**
+ * @brief Verify and decrypt protocol v1.1 AEAD payload in place.
+ *
+ * Accepts hex-encoded packet: length(2 bytes) | ciphertext | nonce(12) | tag(16).
+ * The Poly1305 tag covers the length prefix (as AAD) and the raw ciphertext,
+ * so the hex string itself is never hashed. The hex is decoded onto itself
+ * and the ciphertext is decrypted where it lies on success.
+ *
+ * @param hexPacket Hex-encoded AEAD packet (overwritten).
+ * @param hexLen Length of hexPacket.
+ * @param plaintext Receives a pointer into hexPacket (NUL-terminated).
+ * @param plainLen Receives the plaintext length.
+ * @return nullptr on success, otherwise an "ERROR:*" string.
+ */
+const char* CryptoManager::processAeadPacket(char* hexPacket, size_t hexLen,
+                                             char*& plaintext, size_t& plainLen) {
+    if (!enabled) return "ERROR:CRYPTO_DISABLED";
 
-    // Increment counter and save to EEPROM
-    incrementCounter();
-    
-    Serial.printf("Request processed | Total: %lu/%lu\n", requestCounter, requestLimit);
-    
-    return commandData;
+    PayloadView view;
+    const char* error = PayloadCodec::decodeAead(hexPacket, hexLen, view);
+    if (error) return error;
+
+    uint32_t start = ESP.getCycleCount();
+    bool ok = CryptoBackend::aeadOpen(chacha_key, view.nonce, view.prefix, 2,
+                                       view.data, view.length, view.tag);
+    aeadCyclesLast = ESP.getCycleCount() - start;
+
+    if (!ok) {
+        signatureFailures++;
+        return "ERROR:INVALID_SIGNATURE";
+    }
+
+    view.terminate();
+    plaintext = (char*)view.data;
+    plainLen = view.length;
+
+    return nullptr;
 }
 
 /**
- * @brief Create encrypted response packet.
+ * @brief Verify and decrypt a protocol v2 frame body in place.
  *
- * Encrypts plaintext with ChaCha20 and forms hex packet: len(2) | ciphertext | nonce(16).
- * Nonce is generated locally (16 bytes), first 12 bytes used as ChaCha20 nonce.
+ * The whole fixed header is the AAD, so device hash, counter, nonce and
+ * length are all covered by the tag.
  *
- * @param plaintext Plain text to encrypt.
- * @return Hex-encoded encrypted packet.
+ * @param nonce 96-bit nonce.
+ * @param aad Frame header.
+ * @param aadLen Header length.
+ * @param data Ciphertext, replaced by plaintext on success.
+ * @param len Ciphertext length.
+ * @param tag Received tag.
+ * @return nullptr on success, otherwise an "ERROR:*" string.
  */
-String CryptoManager::createSecureResponse(const String& plaintext) {
-    uint16_t len = plaintext.length();
-    if (len > 500) len = 500;
-
-    // Generate nonce - fixed: use local variable
-    uint8_t local_nonce[16];
-    for (int32_t i = 0; i < 16; i++) local_nonce[i] = (uint8_t)random(0,256);
-
-    // Use only first 12 bytes for ChaCha20
-    uint8_t chacha_nonce[12];
-    memcpy(chacha_nonce, local_nonce, 12);
-
-    uint8_t ciphertext[512];
-    chacha20_encrypt(chacha_key, chacha_nonce, (const uint8_t*)plaintext.c_str(), ciphertext, len);
-
-    uint8_t packet[2 + 512 + 16];
-    packet[0] = (len >> 8) & 0xFF;
-    packet[1] = len & 0xFF;
-    memcpy(packet + 2, ciphertext, len);
-    memcpy(packet + 2 + len, local_nonce, 16);
-
-    char hex[2048];
-    char* p = hex;
-    for(int32_t i = 0; i < 2 + len + 16; i++) {
-        p += sprintf(p, "%02x", packet[i]);
+const char* CryptoManager::openFrame(const uint8_t nonce[12], const uint8_t* aad, size_t aadLen,
+                                     uint8_t* data, size_t len, const uint8_t tag[16]) {
+    if (!enabled) return "ERROR:CRYPTO_DISABLED";
+
+    uint32_t start = ESP.getCycleCount();
+    bool ok = CryptoBackend::aeadOpen(chacha_key, nonce, aad, aadLen, data, len, tag);
+    aeadCyclesLast = ESP.getCycleCount() - start;
+
+    if (!ok) {
+        signatureFailures++;
+        return "ERROR:INVALID_SIGNATURE";
     }
-    *p = 0;
-    return String(hex);
+
+    return nullptr;
+}
+
+/**
+ * @brief Encrypt a protocol v2 frame body in place and compute its tag.
+ *
+ * @param nonce 96-bit nonce (already part of the header).
+ * @param aad Frame header.
+ * @param aadLen Header length.
+ * @param data Plaintext, replaced by ciphertext.
+ * @param len Plaintext length.
+ * @param tag Receives the tag.
+ */
+void CryptoManager::sealFrame(const uint8_t nonce[12], const uint8_t* aad, size_t aadLen,
+                              uint8_t* data, size_t len, uint8_t tag[16]) {
+    uint32_t start = ESP.getCycleCount();
+    CryptoBackend::aeadSeal(chacha_key, nonce, aad, aadLen, data, len, tag);
+    aeadCyclesLast = ESP.getCycleCount() - start;
 }
 
 // ==================== REQUEST COUNTER ====================
@@ -346,22 +194,27 @@ String CryptoManager::createSecureResponse(const String& plaintext) {
 /**
  * @brief Increment request counter.
  *
- * Increments requestCounter and periodically saves to EEPROM (every 10 requests).
+ * Increments requestCounter and persists it: one journal record per
+ * request, or every 10 requests on the EEPROM fallback. Called by
+ * PacketManager once a request has passed the replay check, so replayed
+ * or malformed packets never cost a flash write.
  */
 void CryptoManager::incrementCounter() {
-    if (requestCounter < requestLimit) {
-        requestCounter++;
-        // Save every 10 requests or when limit is reached
-        if (requestCounter % 10 == 0 || requestCounter >= requestLimit) {
-            saveRequestCounter();
+    requestCounter++;
+    if (counterJournal.isMounted()) {
+        if (!counterJournal.append(requestCounter)) {
+            Serial.println("Failed to journal request counter");
         }
+    } else if (requestCounter % 10 == 0) {
+        // EEPROM fallback: save every 10 requests
+        saveEepromCounter();
     }
 }
 
 /**
  * @brief Reset request counter.
  *
- * Resets local request counter and saves state to EEPROM.
+ * Resets local request counter and persists the new state.
  */
 void CryptoManager::resetRequestCounter() {
     requestCounter = 0;
@@ -369,13 +222,100 @@ void CryptoManager::resetRequestCounter() {
     Serial.println("Request counter reset to 0");
 }
 
+/**
+ * @brief Recover request counter at boot.
+ *
+ * Mounts the flash journal and replays it. On the first boot with a
+ * journal, the legacy EEPROM value is migrated into a freshly formatted
+ * journal. If the flash layout reserves no room, EEPROM is used as before.
+ */
+void CryptoManager::loadRequestCounter() {
+    if (counterFlash.begin()) {
+        uint32_t stored = 0;
+        if (counterJournal.mount(stored)) {
+            requestCounter = stored;
+            Serial.printf("Loaded request counter: %lu (journal)\n", (unsigned long)requestCounter);
+            return;
+        }
+
+        uint32_t legacy = loadEepromCounter();
+        if (counterJournal.format(legacy)) {
+            requestCounter = legacy;
+            Serial.printf("Request counter journal created at %lu\n", (unsigned long)requestCounter);
+            return;
+        }
+        Serial.println("Counter journal unavailable, using EEPROM");
+    }
+
+    requestCounter = loadEepromCounter();
+}
+
+/**
+ * @brief Recover the replay floor at boot.
+ *
+ * The stored lease is above every sequence number and legacy timestamp
+ * accepted before the reboot. Without room in flash the windows start
+ * empty, as they did before the floor was persisted.
+ */
+void CryptoManager::loadReplayFloor() {
+    uint32_t lease = 0;
+    if (!floorFlash.begin()) {
+        Serial.println("Replay floor journal unavailable, windows start empty");
+        return;
+    }
+    if (!floorJournal.mount(lease) && !floorJournal.format(0)) {
+        Serial.println("Replay floor journal unavailable, windows start empty");
+        return;
+    }
+    replayGuard.restore(lease);
+    Serial.printf("Replay floor: %lu (x2^%d)\n", (unsigned long)lease, REPLAY_FLOOR_SHIFT);
+}
+
+/**
+ * @brief Write a moved lease before the request it covers runs.
+ *
+ * A request whose lease cannot be stored is refused: after a reboot it
+ * would be accepted again.
+ */
+ReplayVerdict CryptoManager::persistLease(ReplayVerdict verdict) {
+    uint32_t lease;
+    if (verdict != REPLAY_OK || !replayGuard.pendingLease(lease) || !floorJournal.isMounted()) {
+        return verdict;
+    }
+    if (!floorJournal.append(lease)) {
+        Serial.println("Failed to journal replay floor");
+        return REPLAY_STALE;
+    }
+    replayGuard.leaseStored();
+    return verdict;
+}
+
+/**
+ * @brief Persist request counter.
+ *
+ * Appends to the journal when mounted, otherwise commits to EEPROM.
+ */
+void CryptoManager::saveRequestCounter() {
+    if (counterJournal.isMounted()) {
+        if (counterJournal.append(requestCounter)) {
+            Serial.printf("Saved request counter: %lu\n", (unsigned long)requestCounter);
+        } else {
+            Serial.println("Failed to save request counter");
+        }
+        return;
+    }
+    saveEepromCounter();
+}
+
 /**
  * @brief Load request counter from EEPROM.
  *
  * Reads saved request counter from EEPROM if validity marker is present.
  * Storage address is calculated as offset after cfg structure.
+ *
+ * @return Saved counter, or 0 if no valid value is stored.
  */
-void CryptoManager::loadRequestCounter() {
+uint32_t CryptoManager::loadEepromCounter() {
     EEPROM.begin(EEPROM_SIZE);
     
     // Read counter from EEPROM (address after config + marker)
@@ -390,14 +330,14 @@ void CryptoManager::loadRequestCounter() {
     // Check validity marker
     if (EEPROM.read(eepromAddr + sizeof(savedCounter)) == 0xCC &&
         EEPROM.read(eepromAddr + sizeof(savedCounter) + 1) == 0xDD) {
-        requestCounter = savedCounter;
-        Serial.printf("Loaded request counter: %lu\n", requestCounter);
+        Serial.printf("Loaded request counter: %lu\n", (unsigned long)savedCounter);
     } else {
-        requestCounter = 0;
+        savedCounter = 0;
         Serial.println("No valid request counter found, starting from 0");
     }
     
     EEPROM.end();
+    return savedCounter;
 }
 
 /**
@@ -405,7 +345,7 @@ void CryptoManager::loadRequestCounter() {
  *
  * Saves requestCounter to EEPROM and sets validity marker.
  */
-void CryptoManager::saveRequestCounter() {
+void CryptoManager::saveEepromCounter() {
     EEPROM.begin(EEPROM_SIZE);
     
     // Save counter to EEPROM
@@ -425,7 +365,7 @@ void CryptoManager::saveRequestCounter() {
     EEPROM.end();
     
     if (success) {
-        Serial.printf("Saved request counter: %lu\n", requestCounter);
+        Serial.printf("Saved request counter: %lu\n", (unsigned long)requestCounter);
     } else {
         Serial.println("Failed to save request counter");
     }
@@ -434,39 +374,52 @@ void CryptoManager::saveRequestCounter() {
 // ==================== TOKEN GENERATION ====================
 
 /**
- * @brief Generate random security token.
+ * @brief Generate random security token into a caller buffer.
  *
- * Generates random alphanumeric token of 96 characters.
- * Used on first run to populate cfg.device_token.
+ * Alphanumeric characters drawn from the DRBG pool. Used on first run
+ * to populate cfg.device_token.
  *
- * @return Generated token string.
+ * @param out Receives length characters and a NUL.
+ * @param length Token length (CRYPTO_TOKEN_LENGTH for device tokens).
  */
-String CryptoManager::generateToken() {
+static_assert(CRYPTO_TOKEN_LENGTH < sizeof(DeviceConfig::device_token), "token must fit the config field");
+
+void CryptoManager::generateToken(char* out, size_t length) {
     const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    String token = "";
-    
-    // Generate random token of 96 characters
-    for (int32_t i = 0; i < 96; ++i) {
-        token += chars[random(0, 62)];
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = chars[secureRandom.uniform(62)];
     }
-    
+    out[length] = 0;
+
     Serial.println("Generated new security token");
-    return token;
+}
+
+/**
+ * @brief Generate random security token.
+ *
+ * String convenience wrapper; the token is CRYPTO_TOKEN_LENGTH characters.
+ *
+ * @return Generated token string.
+ */
+String CryptoManager::generateToken() {
+    char token[CRYPTO_TOKEN_LENGTH + 1];
+    generateToken(token, CRYPTO_TOKEN_LENGTH);
+    return String(token);
 }
 
 /**
  * @brief Get crypto status information.
  *
- * Forms informative string about cryptography status and request counter.
+ * Forms informative string about cryptography status, request counter
+ * and replay window occupancy.
  *
  * @return Status information string.
  */
 String CryptoManager::getKeyInfo() const {
     char info[128];
-    const char* statusStr = isLimitExceeded() ? "LIMIT_EXCEEDED" : "ACTIVE";
     
-    snprintf(info, sizeof(info), "SECURE|REQUESTS:%lu/%lu|STATUS:%s",
-             requestCounter, requestLimit, statusStr);
+    snprintf(info, sizeof(info), "SECURE|REQUESTS:%lu|SENDERS:%u/%u|STATUS:ACTIVE",
+             (unsigned long)requestCounter, (unsigned)replayGuard.activeSenders(), (unsigned)REPLAY_SENDERS);
     
     return String(info);
 }
@@ -474,91 +427,81 @@ String CryptoManager::getKeyInfo() const {
 // ==================== HMAC FUNCTIONS ====================
 
 /**
- * @brief Compute HMAC-SHA256.
+ * @brief Compute HMAC-SHA256 with the backend key context.
  *
- * Implements HMAC-SHA256 using internal SHA256 implementation.
- * Accepts key, data, and returns 32-byte result.
+ * With the software backend this clones the inner/outer states prepared
+ * in begin(), so each call compresses only the message blocks plus one
+ * outer block.
  *
- * @param key HMAC key.
- * @param key_len Key length in bytes.
  * @param data Data to authenticate.
- * @param data_len Data length in bytes.
- * @param result 32-byte output buffer for HMAC.
+ * @param len Data length in bytes.
+ * @param mac 32-byte output buffer for HMAC.
  */
-void CryptoManager::hmac_sha256(const uint8_t* key, size_t key_len, const uint8_t* data, size_t data_len, uint8_t* result) {
-    uint8_t k_ipad[64];
-    uint8_t k_opad[64];
-    uint8_t tmp_hash[32];
-    
-    // Prepare key
-    if (key_len > 64) {
-        sha256_init();
-        sha256_update(key, key_len);
-        sha256_final(k_ipad);
-        key_len = 32;
-        key = k_ipad;
-    }
-    
-    memset(k_ipad, 0, 64);
-    memset(k_opad, 0, 64);
-    memcpy(k_ipad, key, key_len);
-    memcpy(k_opad, key, key_len);
-    
-    // XOR with constants
-    for (size_t i = 0; i < 64; i++) {
-        k_ipad[i] ^= 0x36;
-        k_opad[i] ^= 0x5C;
-    }
-    
-    // Inner hash
-    sha256_init();
-    sha256_update(k_ipad, 64);
-    sha256_update(data, data_len);
-    sha256_final(tmp_hash);
-    
-    // Outer hash
-    sha256_init();
-    sha256_update(k_opad, 64);
-    sha256_update(tmp_hash, 32);
-    sha256_final(result);
+void CryptoManager::computeMac(const uint8_t* data, size_t len, uint8_t mac[32]) {
+    uint32_t start = ESP.getCycleCount();
+    hmac.compute(data, len, mac);
+    hmacCyclesLast = ESP.getCycleCount() - start;
+}
+
+/**
+ * @brief Calculate HMAC-SHA256 as hex into a caller buffer.
+ *
+ * @param data Data to authenticate.
+ * @param len Data length in bytes.
+ * @param hex Receives 64 lowercase hex digits and a NUL.
+ */
+void CryptoManager::calculateHMAC(const uint8_t* data, size_t len, char hex[65]) {
+    uint8_t hmac_result[32];
+    computeMac(data, len, hmac_result);
+    HexCodec::encode(hmac_result, sizeof(hmac_result), hex);
+    hex[64] = 0;
 }
 
 /**
  * @brief Calculate HMAC-SHA256 as hex string.
  *
- * Computes HMAC-SHA256 and returns hex representation for given string.
+ * String convenience wrapper over the buffer variant.
  *
  * @param data Data string to authenticate.
  * @return Hex-encoded HMAC-SHA256.
  */
 String CryptoManager::calculateHMAC(const String& data) {
-    uint8_t hmac_result[32];
-    hmac_sha256(hmac_key, 32, (const uint8_t*)data.c_str(), data.length(), hmac_result);
-    
     char hex[65];
-    for (int32_t i = 0; i < 32; i++) {
-        sprintf(hex + i * 2, "%02x", hmac_result[i]);
-    }
-    hex[64] = 0;
-    
+    calculateHMAC((const uint8_t*)data.c_str(), data.length(), hex);
     return String(hex);
 }
 
 /**
  * @brief Verify HMAC signature.
  *
- * Compares calculated HMAC with received one (case-insensitive).
- * Returns true on match and logs the result.
+ * String convenience wrapper over the binary verification path.
  *
  * @param data Data that was signed.
  * @param received_hmac Received HMAC signature to verify.
  * @return true if HMAC matches, false otherwise.
  */
 bool CryptoManager::verifyHMAC(const String& data, const String& received_hmac) {
-    String calculated_hmac = calculateHMAC(data);
-    // Compare case-insensitively
-    bool result = calculated_hmac.equalsIgnoreCase(received_hmac);
-    Serial.printf("[HMAC] Verification: %s\n", result ? "PASSED" : "FAILED");
-    
-    return result;
-}
\ No newline at end of file
+    return verifyHMAC((const uint8_t*)data.c_str(), data.length(),
+                      received_hmac.c_str(), received_hmac.length());
+}
+
+/**
+ * @brief Verify HMAC signature in binary form.
+ *
+ * Rejects malformed signatures before hashing, then computes exactly one
+ * HMAC and compares all 32 bytes in constant time. No String is built.
+ *
+ * @param data Data that was signed.
+ * @param len Data length in bytes.
+ * @param sigHex Received hex signature.
+ * @param sigLen Length of sigHex.
+ * @return true if HMAC matches, false otherwise.
+ */
+bool CryptoManager::verifyHMAC(const uint8_t* data, size_t len, const char* sigHex, size_t sigLen) {
+    uint32_t start = ESP.getCycleCount();
+    bool ok = PayloadCodec::checkSignature(hmac, data, len, sigHex, sigLen);
+    hmacCyclesLast = ESP.getCycleCount() - start;
+
+    if (!ok) signatureFailures++;
+    return ok;
+}
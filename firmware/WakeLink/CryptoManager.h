@@ -3,23 +3,43 @@
  * @brief Cryptographic operations manager for WakeLink firmware.
  * 
  * Implements all cryptographic operations required by protocol v1.0:
- * - ChaCha20 stream cipher for encryption/decryption
- * - SHA256 hash function (software implementation)
- * - HMAC-SHA256 for packet authentication
- * - Request counter for replay protection
+ * - ChaCha20 stream cipher for encryption/decryption (see chacha20.h)
+ * - SHA256 hash function (software implementation, see sha256.h)
+ * - HMAC-SHA256 for packet authentication (key pads precomputed in begin())
+ * - ChaCha20-Poly1305 AEAD for protocol v1.1 (see poly1305.h)
+ * - SHA-256, HMAC, ChaCha20 and RNG are reached through CryptoBackend
+ *   (see crypto_backend.h), selected at compile time
+ * - Per-sender sliding-window replay protection (see replay_window.h)
  * 
  * Key Derivation:
  * - Both ChaCha20 and HMAC keys are SHA256 of device_token
  * - Nonces are randomly generated per packet
  * 
  * Packet Format (hex payload):
- * - [2 bytes BE length] + [ciphertext] + [16 bytes nonce (first 12 used)]
+ * - v1.0: [2 bytes BE length] + [ciphertext] + [16 bytes nonce (first 12 used)]
+ * - v1.1: [2 bytes BE length] + [ciphertext] + [12 bytes nonce] + [16 bytes tag],
+ *         length prefix is the AAD
+ * - Outgoing payloads are produced by PayloadStream (payload_stream.h)
+ *   while they are written, with no size limit beyond the length prefix
+ * - Incoming payloads are decoded in place by PayloadCodec
+ *   (payload_codec.h); no entry point allocates, the String overloads
+ *   are wrappers for callers that want one
  * 
  * Request Counter:
- * - Stored in EEPROM at address 386
- * - Incremented on every decrypt operation
- * - Persisted every 10 operations
- * - Limit: 1000 requests before reset required
+ * - Stored in an append-only flash journal (see counter_journal.h)
+ * - Incremented on every decrypt operation and persisted every time
+ * - Falls back to EEPROM address 386 (every 10 operations) if the flash
+ *   layout has no room for the journal; the EEPROM value is migrated
+ *   into the journal on first boot
+ * - Statistic only; there is no request limit
+ *
+ * Replay Protection:
+ * - Inner JSON "sender" + "seq" checked against a per-sender window
+ *   (acceptSequence), so pipelined requests may arrive out of order
+ * - v1.0 requests without "seq" are checked on request_id + timestamp
+ *   (acceptLegacy)
+ * - The replay floor lease is kept in a second flash journal and
+ *   restored at boot, so a reboot does not reopen old sequence numbers
  * 
  * @note Must call begin() before any crypto operations.
  * 
@@ -32,6 +52,14 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "chacha20.h"
+#include "poly1305.h"
+#include "crypto_backend.h"
+#include "counter_journal.h"
+#include "replay_window.h"
+
+/// @brief Characters in a generated device token
+#define CRYPTO_TOKEN_LENGTH 96
 
 // Forward declaration instead of extern
 struct DeviceConfig;
@@ -40,9 +68,11 @@ struct DeviceConfig;
  * @brief Cryptographic operations manager class.
  *
  * Provides all crypto primitives needed for WakeLink protocol.
- * Software implementation - no external crypto libraries required.
+ * The default software backend needs no external crypto libraries.
  */
 class CryptoManager {
+    friend class PayloadStream;  ///< Seals responses with the keys while they stream out
+
 private:
     // =============================
     // Cryptographic Keys and State
@@ -55,93 +85,78 @@ private:
     bool enabled = false;       ///< True if crypto is initialized with valid token
     
     // =============================
-    // Request Counter (Replay Protection)
+    // Request Counter and Replay Protection
     // =============================
     
-    uint32_t requestCounter = 0;        ///< Current request counter value
-    const uint32_t requestLimit = 1000; ///< Maximum requests before reset required
+    uint32_t requestCounter = 0;        ///< Requests decrypted (persistent statistic)
+    ReplayGuard replayGuard;            ///< Per-sender sequence windows
 
-    // =============================
-    // SHA256 Internal State
-    // =============================
-    
-    uint32_t sha256_state[8];    ///< SHA256 hash state (8x32-bit words)
-    uint8_t sha256_buffer[64];   ///< SHA256 input buffer
-    uint64_t sha256_bitlen;      ///< Total bits processed
-    uint32_t sha256_buffer_len;  ///< Bytes in buffer
+    DeviceFlashRegion counterFlash{0, COUNTER_JOURNAL_SECTORS};  ///< Reserved flash sectors for the journal
+    CounterJournal counterJournal{counterFlash}; ///< Per-request counter persistence
+
+    DeviceFlashRegion floorFlash{COUNTER_JOURNAL_SECTORS, REPLAY_FLOOR_SECTORS};  ///< Sectors for the floor journal
+    CounterJournal floorJournal{floorFlash};     ///< Replay floor lease persistence
 
     // =============================
-    // SHA256 Helper Functions
-    // =============================
-    
-    /** @brief Rotate right operation. */
-    uint32_t sha256_rotr(uint32_t x, uint32_t n);
-    /** @brief Choice function: (x AND y) XOR (NOT x AND z). */
-    uint32_t sha256_ch(uint32_t x, uint32_t y, uint32_t z);
-    /** @brief Majority function: (x AND y) XOR (x AND z) XOR (y AND z). */
-    uint32_t sha256_maj(uint32_t x, uint32_t y, uint32_t z);
-    /** @brief Sigma0 transformation. */
-    uint32_t sha256_sigma0(uint32_t x);
-    /** @brief Sigma1 transformation. */
-    uint32_t sha256_sigma1(uint32_t x);
-    /** @brief Gamma0 transformation. */
-    uint32_t sha256_gamma0(uint32_t x);
-    /** @brief Gamma1 transformation. */
-    uint32_t sha256_gamma1(uint32_t x);
-    /** @brief Process one 512-bit block. */
-    void sha256_transform();
-    /** @brief Initialize SHA256 state. */
-    void sha256_init();
-    /** @brief Update hash with data. */
-    void sha256_update(const uint8_t* data, size_t len);
-    /** @brief Finalize and output hash. */
-    void sha256_final(uint8_t* hash);
-
-    // =============================
-    // ChaCha20 Functions
+    // Cipher Timing
     // =============================
-    
-    /**
-     * @brief Generate one ChaCha20 keystream block.
-     * @param key 256-bit encryption key.
-     * @param nonce 96-bit nonce.
-     * @param counter Block counter.
-     * @param output 64-byte output buffer.
-     */
-    void chacha20_block(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter, uint8_t output[64]);
-    
+
+    uint64_t cipherCyclesTotal = 0;  ///< CPU cycles spent in ChaCha20 since boot
+    uint64_t cipherBytesTotal = 0;   ///< Bytes encrypted/decrypted since boot
+    uint32_t cipherCyclesLast = 0;   ///< Cycles spent on the last message
+
     /**
-     * @brief ChaCha20 encrypt/decrypt (symmetric).
-     * @param key 256-bit encryption key.
+     * @brief ChaCha20 encrypt/decrypt in place and record cycle cost.
      * @param nonce 96-bit nonce.
-     * @param input Input data.
-     * @param output Output buffer.
+     * @param data Data buffer.
      * @param length Data length.
      */
-    void chacha20_encrypt(const uint8_t key[32], const uint8_t nonce[12], const uint8_t* input, uint8_t* output, size_t length);
+    void cipherInPlace(const uint8_t nonce[12], uint8_t* data, size_t length);
 
     // =============================
-    // HMAC-SHA256 Functions
+    // HMAC-SHA256 State
     // =============================
-    
-    /**
-     * @brief HMAC-SHA256 with additional nonce.
-     */
-    void hmac_sha256_with_nonce(const uint8_t* key, size_t key_len, const uint8_t* nonce, size_t nonce_len, const uint8_t* data, size_t data_len, uint8_t* result);
-    
+
+    CryptoBackend::Hmac hmac;        ///< Backend HMAC context for hmac_key
+    uint32_t hmacCyclesLast = 0;     ///< Cycles spent on the last HMAC
+    uint32_t signatureFailures = 0;  ///< Rejected signatures since boot
+
     /**
-     * @brief Standard HMAC-SHA256.
+     * @brief HMAC-SHA256 over data using the cached key midstates.
+     * @param data Data to authenticate.
+     * @param len Data length.
+     * @param mac 32-byte output buffer.
      */
-    void hmac_sha256(const uint8_t* key, size_t key_len, const uint8_t* data, size_t data_len, uint8_t* result);
-    
+    void computeMac(const uint8_t* data, size_t len, uint8_t mac[32]);
+
+    // =============================
+    // AEAD State (protocol v1.1)
+    // =============================
+
+    uint32_t aeadCyclesLast = 0;     ///< Cycles spent sealing/opening the last v1.1 payload
+
     // =============================
-    // EEPROM Persistence
+    // Counter Persistence
     // =============================
     
-    /** @brief Load request counter from EEPROM address 386. */
+    /** @brief Recover request counter from the journal (or EEPROM fallback). */
     void loadRequestCounter();
-    /** @brief Save request counter to EEPROM address 386. */
+    /** @brief Persist request counter to the journal (or EEPROM fallback). */
     void saveRequestCounter();
+    /** @brief Read legacy counter from EEPROM address 386 (0 if unset). */
+    uint32_t loadEepromCounter();
+    /** @brief Write counter to EEPROM address 386 (full sector commit). */
+    void saveEepromCounter();
+
+    /** @brief Restore the replay floor lease from its journal. */
+    void loadReplayFloor();
+
+    /**
+     * @brief Persist the replay lease if the last accepted request moved it.
+     * @param verdict Verdict of that request.
+     * @return verdict, or REPLAY_STALE if the lease could not be written.
+     */
+    ReplayVerdict persistLease(ReplayVerdict verdict);
 
 public:
     // =============================
@@ -151,8 +166,9 @@ public:
     /**
      * @brief Initialize crypto manager with device token.
      *
-     * Derives ChaCha20 and HMAC keys from cfg.device_token using SHA256.
-     * Loads request counter from EEPROM.
+     * Derives ChaCha20 and HMAC keys from cfg.device_token using SHA256,
+     * hands hmac_key to the backend HMAC context and recovers the request
+     * counter from the flash journal.
      *
      * @return true if initialization successful, false if token invalid/empty.
      */
@@ -163,38 +179,111 @@ public:
     // =============================
     
     /**
-     * @brief Decrypt and validate incoming encrypted packet.
+     * @brief Decrypt and validate incoming encrypted packet in place.
      *
-     * Parses hex payload, extracts nonce, decrypts with ChaCha20,
-     * and increments request counter.
+     * Decodes the hex payload onto itself and decrypts the ciphertext
+     * where it lies. The payload buffer is
+     * destroyed; the plaintext points into it.
      *
      * @param hexPacket Hex-encoded encrypted packet (without outer JSON wrapper).
-     * @return Decrypted plaintext JSON, or "ERROR:*" string on failure.
+     * @param hexLen Length of hexPacket.
+     * @param plaintext Receives the NUL-terminated plaintext JSON inside hexPacket.
+     * @param plainLen Receives the plaintext length.
+     * @return nullptr on success, or an "ERROR:*" string on failure.
      * 
-     * @note Possible errors: LIMIT_EXCEEDED, INVALID_PACKET
+     * @note Possible errors: CRYPTO_DISABLED, HEX_LEN, HEX_CHAR,
+     *       INVALID_PACKET_SIZE, INVALID_DATA_LENGTH
+     */
+    const char* processSecurePacket(char* hexPacket, size_t hexLen,
+                                    char*& plaintext, size_t& plainLen);
+
+    /**
+     * @brief Verify and decrypt a protocol v1.1 AEAD payload in place.
+     *
+     * Decodes the hex payload onto itself, checks the Poly1305 tag over
+     * the raw ciphertext in constant time and decrypts where it lies.
+     * No HMAC is computed.
+     *
+     * @param hexPacket Hex payload: len(2) | ciphertext | nonce(12) | tag(16) (overwritten).
+     * @param hexLen Length of hexPacket.
+     * @param plaintext Receives the NUL-terminated plaintext JSON inside hexPacket.
+     * @param plainLen Receives the plaintext length.
+     * @return nullptr on success, or an "ERROR:*" string on failure.
+     *
+     * @note A tag mismatch returns ERROR:INVALID_SIGNATURE and counts as a
+     *       signature failure.
      */
-    String processSecurePacket(const String& hexPacket);
+    const char* processAeadPacket(char* hexPacket, size_t hexLen,
+                                  char*& plaintext, size_t& plainLen);
 
     /**
-     * @brief Encrypt plaintext for transmission.
+     * @brief Verify and decrypt a protocol v2 frame body in place.
      *
-     * Generates random nonce, encrypts with ChaCha20, and formats
-     * as hex packet ready for outer JSON wrapper.
+     * Checks the Poly1305 tag over the frame header (AAD) and the
+     * ciphertext and decrypts in place.
      *
-     * @param plaintext Plain text JSON to encrypt.
-     * @return Hex-encoded encrypted packet.
+     * @param nonce 96-bit nonce from the frame header.
+     * @param aad Frame header.
+     * @param aadLen Header length.
+     * @param data Ciphertext, replaced by plaintext.
+     * @param len Ciphertext length.
+     * @param tag Received 16-byte tag.
+     * @return nullptr on success, or "ERROR:INVALID_SIGNATURE".
+     */
+    const char* openFrame(const uint8_t nonce[12], const uint8_t* aad, size_t aadLen,
+                          uint8_t* data, size_t len, const uint8_t tag[16]);
+
+    /**
+     * @brief Encrypt a protocol v2 frame body in place and compute its tag.
+     * @param nonce 96-bit nonce already written into the header.
+     * @param aad Frame header.
+     * @param aadLen Header length.
+     * @param data Plaintext, replaced by ciphertext.
+     * @param len Plaintext length.
+     * @param tag Receives the 16-byte tag.
      */
-    String createSecureResponse(const String& plaintext);
+    void sealFrame(const uint8_t nonce[12], const uint8_t* aad, size_t aadLen,
+                   uint8_t* data, size_t len, uint8_t tag[16]);
 
     // =============================
     // Counter Management
     // =============================
     
-    /** @brief Increment request counter and persist if needed. */
+    /**
+     * @brief Count an accepted request and persist the counter.
+     *
+     * Call once per request, after decryption and the replay check have
+     * both succeeded (PacketManager::finishIncoming); each call may
+     * program a journal record.
+     */
     void incrementCounter();
     
-    /** @brief Check if request limit exceeded. */
-    bool isLimitExceeded() const { return requestCounter >= requestLimit; }
+    /**
+     * @brief Check and record a request's sequence number.
+     *
+     * Call after the inner JSON has been authenticated and decrypted.
+     * May program a floor journal record before the request runs.
+     *
+     * @param sender Sender id from the inner JSON ("" if absent).
+     * @param seq Sequence number from the inner JSON.
+     * @return REPLAY_OK if the request is new.
+     */
+    ReplayVerdict acceptSequence(const char* sender, uint64_t seq) {
+        return persistLease(replayGuard.accept(sender, seq));
+    }
+
+    /**
+     * @brief Check and record a v1.0 request without "seq".
+     * @param requestId request_id from the inner JSON ("" if absent).
+     * @param timestamp timestamp from the inner JSON (seconds, 0 if absent).
+     * @return REPLAY_OK if the request is new.
+     */
+    ReplayVerdict acceptLegacy(const char* requestId, uint64_t timestamp) {
+        return persistLease(replayGuard.acceptLegacy(requestId, timestamp));
+    }
+
+    /** @brief Replay windows and their statistics. */
+    const ReplayGuard& getReplayGuard() const { return replayGuard; }
     
     /** @brief Check if crypto is enabled (token configured). */
     bool isEnabled() const { return enabled; }
@@ -205,16 +294,41 @@ public:
     /** @brief Get current request counter value. */
     uint32_t getRequestCount() const { return requestCounter; }
     
-    /** @brief Get maximum request limit. */
-    uint32_t getRequestLimit() const { return requestLimit; }
-    
-    /** @brief Reset request counter to zero and save to EEPROM. */
+    /** @brief Reset request counter to zero and persist it. */
     void resetRequestCounter();
 
+    /** @brief Counter journal (mounted unless running on the EEPROM fallback). */
+    const CounterJournal& getCounterJournal() const { return counterJournal; }
+
+    /** @brief Replay floor journal (not mounted if the flash layout has no room). */
+    const CounterJournal& getFloorJournal() const { return floorJournal; }
+
+    /** @brief Average ChaCha20 cost in CPU cycles per byte since boot. */
+    float getCipherCyclesPerByte() const {
+        return cipherBytesTotal ? (float)cipherCyclesTotal / (float)cipherBytesTotal : 0.0f;
+    }
+
+    /** @brief CPU cycles spent encrypting/decrypting the last message. */
+    uint32_t getCipherCyclesLast() const { return cipherCyclesLast; }
+
+    /** @brief CPU cycles spent on the last HMAC computation. */
+    uint32_t getHmacCyclesLast() const { return hmacCyclesLast; }
+
+    /** @brief CPU cycles spent sealing/opening the last v1.1 AEAD payload. */
+    uint32_t getAeadCyclesLast() const { return aeadCyclesLast; }
+
     // =============================
     // HMAC Functions (Public API)
     // =============================
     
+    /**
+     * @brief Calculate HMAC-SHA256 signature into a caller buffer.
+     * @param data Data to sign.
+     * @param len Data length.
+     * @param hex Receives 64 hex characters and a NUL.
+     */
+    void calculateHMAC(const uint8_t* data, size_t len, char hex[65]);
+
     /**
      * @brief Calculate HMAC-SHA256 signature for data.
      * @param data String data to sign.
@@ -229,13 +343,37 @@ public:
      * @return true if signature matches, false otherwise.
      */
     bool verifyHMAC(const String& data, const String& received_hmac);
+
+    /**
+     * @brief Verify HMAC signature without heap allocation.
+     *
+     * Decodes the received hex signature straight into 32 bytes and
+     * compares it with the computed digest in constant time.
+     *
+     * @param data Signed data.
+     * @param len Data length.
+     * @param sigHex Received hex signature (case-insensitive).
+     * @param sigLen Length of sigHex (must be 64).
+     * @return true if signature matches, false otherwise.
+     */
+    bool verifyHMAC(const uint8_t* data, size_t len, const char* sigHex, size_t sigLen);
+
+    /** @brief Number of packets rejected for a bad signature since boot. */
+    uint32_t getSignatureFailures() const { return signatureFailures; }
     
     // =============================
     // Token Generation
     // =============================
     
     /**
-     * @brief Generate random 32-character security token.
+     * @brief Generate a random alphanumeric token into a caller buffer.
+     * @param out Receives length characters and a NUL.
+     * @param length Token length.
+     */
+    static void generateToken(char* out, size_t length);
+
+    /**
+     * @brief Generate random CRYPTO_TOKEN_LENGTH-character security token.
      * @return Random alphanumeric token string.
      */
     static String generateToken();
@@ -9,6 +9,7 @@
 #include "CryptoManager.h"
 #include "cloud.h"
 #include "command.h"
+#include "secure_random.h"
 
 /**
  * @file WakeLink.ino
@@ -23,6 +24,9 @@
  * - WSS (cloud real-time)
  */
 
+/// DRBG for nonces, request IDs and tokens (seeded on first use)
+SecureRandom secureRandom;
+
 /// Crypto manager instance for encryption/decryption operations
 CryptoManager crypto;
 
@@ -78,6 +82,9 @@ void setup() {
     digitalWrite(STATUS_LED, HIGH);
     pinMode(RESET_BUTTON_PIN, INPUT_PULLUP);
 
+    // Seed the DRBG before anything generates IDs or tokens
+    secureRandom.seedFromHardware();
+
     // Load configuration from EEPROM
     EEPROM.begin(EEPROM_SIZE);
     loadConfig();
@@ -97,8 +104,7 @@ void setup() {
         id.toUpperCase();
         strncpy(cfg.device_id, id.c_str(), sizeof(cfg.device_id) - 1);
 
-        String token = crypto.generateToken();
-        strncpy(cfg.device_token, token.c_str(), sizeof(cfg.device_token) - 1);
+        CryptoManager::generateToken(cfg.device_token, CRYPTO_TOKEN_LENGTH);
 
         cfg.initialized = 1;
         cfg.cloud_enabled = 0;
@@ -156,6 +162,7 @@ void setup() {
  * - OTA update checks
  * - Web server requests
  * - Scheduled command restarts
+ * - Random pool refill
  */
 void loop() {
     unsigned long currentMillis = millis();
@@ -188,6 +195,12 @@ void loop() {
     // Check for scheduled restarts
     CommandManager::handleScheduledRestart();
 
+    // Release paced batch wake packets that are due
+    CommandManager::handlePendingWol();
+
+    // Top up the random pool while nothing else is pending
+    secureRandom.idle();
+
     // High-frequency loop tasks
     if (currentMillis - lastLoopTime >= 1) {
         lastLoopTime = currentMillis;
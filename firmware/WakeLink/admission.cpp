@@ -0,0 +1,111 @@
+/**
+ * @file admission.cpp
+ * @brief Per-source admission control for the local TCP server.
+ */
+
+#include "admission.h"
+
+AdmissionSource* AdmissionControl::lookup(uint32_t addr) {
+    for (AdmissionSource& source : sources) {
+        if (source.used && source.addr == addr) return &source;
+    }
+    return nullptr;
+}
+
+AdmissionSource& AdmissionControl::find(uint32_t addr, uint32_t now) {
+    if (AdmissionSource* source = lookup(addr)) return *source;
+
+    // Free entry, else the quietest one; blocked sources are kept while possible
+    AdmissionSource* victim = nullptr;
+    for (AdmissionSource& source : sources) {
+        if (!source.used) {
+            victim = &source;
+            break;
+        }
+        if (!victim ||
+            (blocked(*victim, now) && !blocked(source, now)) ||
+            (blocked(*victim, now) == blocked(source, now) &&
+             now - source.lastSeen > now - victim->lastSeen)) {
+            victim = &source;
+        }
+    }
+    if (victim->used) recycled++;
+
+    *victim = AdmissionSource();
+    victim->addr = addr;
+    victim->used = true;
+    victim->tokens = ADMISSION_BURST * 1000UL;
+    victim->refilled = now;
+    victim->lastSeen = now;
+    return *victim;
+}
+
+AdmissionVerdict AdmissionControl::charge(AdmissionSource& source, uint32_t now) {
+    source.lastSeen = now;
+    if (blocked(source, now)) {
+        refusedBackoff++;
+        return ADMIT_BACKOFF;
+    }
+
+    // Rate per second = milli-tokens per ms; capped before it can overflow
+    uint32_t elapsed = now - source.refilled;
+    source.refilled = now;
+    if (elapsed > ADMISSION_BURST * 1000UL) elapsed = ADMISSION_BURST * 1000UL;
+    source.tokens += elapsed * ADMISSION_RATE;
+    if (source.tokens > ADMISSION_BURST * 1000UL) source.tokens = ADMISSION_BURST * 1000UL;
+
+    if (source.tokens < 1000) {
+        refusedRate++;
+        return ADMIT_RATE;
+    }
+    source.tokens -= 1000;
+    return ADMIT_OK;
+}
+
+AdmissionVerdict AdmissionControl::admitConnection(uint32_t addr, size_t open, uint32_t now) {
+    AdmissionSource& source = find(addr, now);
+    AdmissionVerdict verdict = charge(source, now);
+    if (verdict != ADMIT_OK) return verdict;
+
+    if (open >= ADMISSION_MAX_PER_SOURCE) {
+        source.tokens += 1000;  // Not served, not charged
+        refusedBusy++;
+        return ADMIT_BUSY;
+    }
+    admitted++;
+    return ADMIT_OK;
+}
+
+AdmissionVerdict AdmissionControl::admitRequest(uint32_t addr, uint32_t now) {
+    return charge(find(addr, now), now);
+}
+
+void AdmissionControl::failed(uint32_t addr, uint32_t now) {
+    AdmissionSource& source = find(addr, now);
+    failures++;
+    if (source.failures < 255) source.failures++;
+
+    uint32_t backoff = ADMISSION_BACKOFF_MS;
+    for (uint8_t i = 1; i < source.failures && backoff < ADMISSION_BACKOFF_MAX_MS; i++) {
+        backoff *= 2;
+    }
+    if (backoff > ADMISSION_BACKOFF_MAX_MS) backoff = ADMISSION_BACKOFF_MAX_MS;
+    source.blockedUntil = now + backoff;
+}
+
+void AdmissionControl::succeeded(uint32_t addr) {
+    if (AdmissionSource* source = lookup(addr)) {
+        source->failures = 0;
+        source->blockedUntil = source->lastSeen;
+    }
+}
+
+const char* AdmissionControl::verdictName(AdmissionVerdict verdict) {
+    switch (verdict) {
+        case ADMIT_OK: return "ok";
+        case ADMIT_RATE: return "rate";
+        case ADMIT_BACKOFF: return "backoff";
+        case ADMIT_BUSY: return "busy";
+    }
+    return "unknown";
+}
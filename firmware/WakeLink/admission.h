@@ -0,0 +1,177 @@
+/**
+ * @file admission.h
+ * @brief Per-source admission control for the local TCP server.
+ *
+ * Every request costs parsing and crypto (HMAC or AEAD) before the device
+ * knows whether it is genuine, so a port scan or a flood of bad packets
+ * could keep loop() busy and delay a real wake request. Admission runs
+ * before any of that work, on the remote address alone:
+ *
+ * - Token bucket per source: a new connection and every request take one
+ *   token; tokens refill at ADMISSION_RATE per second up to ADMISSION_BURST
+ * - Connection cap per source: at most ADMISSION_MAX_PER_SOURCE of the
+ *   TCP_MAX_SESSIONS slots, so one host cannot hold them all
+ * - Global concurrency: at most ADMISSION_MAX_PER_PASS requests go
+ *   through parsing and crypto per loop() pass, across all connections;
+ *   the rest wait in their buffers, round robin
+ * - Failure backoff: a request that fails authentication blocks its
+ *   source for ADMISSION_BACKOFF_MS, doubling with each further failure
+ *   up to ADMISSION_BACKOFF_MAX_MS; a genuine request clears it
+ *
+ * A refused connection is closed unread; a refused request closes its
+ * connection without a reply (a reply would itself cost crypto).
+ *
+ * Sources:
+ * - ADMISSION_SOURCES addresses are tracked; when a new one appears the
+ *   longest-quiet entry is recycled, blocked entries last
+ * - State lives in RAM and starts empty after a reboot
+ *
+ * @note Pure C++; also built on the host (firmware/host/admission_sim.cpp).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef ADMISSION_SOURCES
+/// @brief Remote addresses tracked
+#define ADMISSION_SOURCES 16
+#endif
+
+#ifndef ADMISSION_RATE
+/// @brief Tokens refilled per second per source
+#define ADMISSION_RATE 4
+#endif
+
+#ifndef ADMISSION_BURST
+/// @brief Tokens a source can save up (covers a fully fragmented request)
+#define ADMISSION_BURST 16
+#endif
+
+#ifndef ADMISSION_MAX_PER_SOURCE
+/// @brief Open connections per source
+#define ADMISSION_MAX_PER_SOURCE 2
+#endif
+
+#ifndef ADMISSION_MAX_PER_PASS
+/// @brief Requests parsed and decrypted per TCPHandler::handle() call, all connections together
+#define ADMISSION_MAX_PER_PASS 2
+#endif
+
+#ifndef ADMISSION_BACKOFF_MS
+/// @brief Block after the first failed request
+#define ADMISSION_BACKOFF_MS 1000
+#endif
+
+#ifndef ADMISSION_BACKOFF_MAX_MS
+/// @brief Longest block after repeated failures
+#define ADMISSION_BACKOFF_MAX_MS 60000
+#endif
+
+/**
+ * @brief Result of an admission check.
+ */
+enum AdmissionVerdict : uint8_t {
+    ADMIT_OK = 0,
+    ADMIT_RATE,        ///< Token bucket empty
+    ADMIT_BACKOFF,     ///< Source blocked after failed requests
+    ADMIT_BUSY         ///< Source already holds ADMISSION_MAX_PER_SOURCE connections
+};
+
+/**
+ * @brief Admission state of one remote address.
+ */
+struct AdmissionSource {
+    uint32_t addr = 0;          ///< Remote IPv4 address
+    bool used = false;          ///< Entry holds a source
+    uint32_t tokens = 0;        ///< Tokens x 1000
+    uint32_t refilled = 0;      ///< Time tokens were last topped up (ms)
+    uint32_t lastSeen = 0;      ///< Last connection or request (ms)
+    uint32_t blockedUntil = 0;  ///< End of the current backoff (ms)
+    uint8_t failures = 0;       ///< Failed requests since the last genuine one
+};
+
+/**
+ * @brief Token buckets and failure backoff per remote address.
+ */
+class AdmissionControl {
+private:
+    AdmissionSource sources[ADMISSION_SOURCES];
+
+    uint32_t admitted = 0;          ///< Connections admitted
+    uint32_t refusedRate = 0;       ///< Connections and requests refused: bucket empty
+    uint32_t refusedBackoff = 0;    ///< Connections and requests refused: source blocked
+    uint32_t refusedBusy = 0;       ///< Connections refused: per-source cap
+    uint32_t failures = 0;          ///< Failed requests reported
+    uint32_t recycled = 0;          ///< Entries reused for a new source
+
+    /**
+     * @brief Entry of an address, created (full bucket) if missing.
+     * @param addr Remote address.
+     * @param now Current time (ms).
+     */
+    AdmissionSource& find(uint32_t addr, uint32_t now);
+
+    /** @brief Entry of an address, or nullptr if not tracked. */
+    AdmissionSource* lookup(uint32_t addr);
+
+    /**
+     * @brief Check backoff and take one token.
+     * @param source Entry to charge.
+     * @param now Current time (ms).
+     */
+    AdmissionVerdict charge(AdmissionSource& source, uint32_t now);
+
+    /** @brief True while a backoff runs (wrap-safe). */
+    static bool blocked(const AdmissionSource& source, uint32_t now) {
+        return (int32_t)(source.blockedUntil - now) > 0;
+    }
+
+public:
+    /**
+     * @brief Decide on a new connection, before anything is read from it.
+     * @param addr Remote address.
+     * @param open Connections this address already has open.
+     * @param now Current time (ms).
+     * @return ADMIT_OK to serve it; anything else to close it at once.
+     */
+    AdmissionVerdict admitConnection(uint32_t addr, size_t open, uint32_t now);
+
+    /**
+     * @brief Decide on a complete request, before it is parsed or decrypted.
+     * @param addr Remote address.
+     * @param now Current time (ms).
+     * @return ADMIT_OK to process it; anything else to close the connection.
+     */
+    AdmissionVerdict admitRequest(uint32_t addr, uint32_t now);
+
+    /**
+     * @brief Report a request that failed parsing or authentication.
+     *
+     * Starts or doubles the backoff of its source.
+     *
+     * @param addr Remote address.
+     * @param now Current time (ms).
+     */
+    void failed(uint32_t addr, uint32_t now);
+
+    /** @brief Report a genuine request; clears the failure count of its source. */
+    void succeeded(uint32_t addr);
+
+    /** @brief Short name of a verdict for logs. */
+    static const char* verdictName(AdmissionVerdict verdict);
+
+    uint32_t getAdmitted() const { return admitted; }
+    uint32_t getRefusedRate() const { return refusedRate; }
+    uint32_t getRefusedBackoff() const { return refusedBackoff; }
+    uint32_t getRefusedBusy() const { return refusedBusy; }
+    uint32_t getFailures() const { return failures; }
+    uint32_t getRecycled() const { return recycled; }
+};
+
+#endif // ADMISSION_H
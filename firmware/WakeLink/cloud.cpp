@@ -10,6 +10,20 @@
  * - Inner encrypted: {command, data, request_id, timestamp}
  * - Hex payload: [2B len][ciphertext][16B nonce]
  * 
+ * Protocol v2:
+ * - One binary WebSocket message per frame (see packet.h)
+ * - Responses go back as binary messages
+ *
+ * Fragments (v1.x and v2):
+ * - One message per fragment in both directions; request fragments
+ *   are acknowledged with "pending"
+ * - Large replies are built one fragment at a time in the arena
+ *
+ * Pipelining:
+ * - Clients may send several requests without waiting; each message is
+ *   run as it arrives and answered in that order, every reply carrying
+ *   the request_id of its request
+ * 
  * Authentication:
  * - After connecting, firmware sends auth message:
  *   {"type": "auth", "token": "<api_token>"}
@@ -19,7 +33,10 @@
 #include "cloud.h"
 #include "command.h"
 #include "packet.h"
+#include "payload_stream.h"
+#include "request_arena.h"
 #include "platform.h"
+#include "command_cache.h"
 
 extern PacketManager packetManager;
 extern String DEVICE_TOKEN;
@@ -57,8 +74,12 @@ static String _api_token;
 
 static bool _parseUrl(const String& url);
 static void _onWsEvent(WStype_t type, uint8_t* payload, size_t length);
-static void _processPacket(const String& packet_json);
+static void _processPacket(char* packet, size_t length);
+static void _processFrame(uint8_t* frame, size_t length);
+static void _sendArenaMessage(uint8_t* buf, size_t length, bool binary);
+static void _sendPacketResponse(const JsonDocument& reply, const char* version);
 static void _sendAuthMessage();
+static void _setConnected(bool connected);
 
 // ============================================================================
 // Public API
@@ -137,7 +158,7 @@ void handleCloud() {
     if (WiFi.status() != WL_CONNECTED) {
         if (_ws_connected) {
             Serial.println("[CLOUD] WiFi lost");
-            _ws_connected = false;
+            _setConnected(false);
         }
         return;
     }
@@ -229,36 +250,42 @@ static bool _parseUrl(const String& url) {
     return _host.length() > 0;
 }
 
+/**
+ * @brief Track the WebSocket state and drop cached status on a change.
+ */
+static void _setConnected(bool connected) {
+    if (_ws_connected == connected) return;
+    _ws_connected = connected;
+    commandCache.invalidate(CACHE_BIT(CACHE_INFO) | CACHE_BIT(CACHE_CLOUD_STATUS));
+}
+
 /**
  * @brief WebSocket event handler.
  */
 static void _onWsEvent(WStype_t type, uint8_t* payload, size_t length) {
     switch (type) {
         case WStype_DISCONNECTED:
-            _ws_connected = false;
+            _setConnected(false);
             _auth_sent = false;  // Reset auth flag on disconnect
             break;
             
         case WStype_CONNECTED:
-            _ws_connected = true;
+            _setConnected(true);
             Serial.printf("[CLOUD] Connected to %s\n", (char*)payload);
             // Send auth message immediately after connection
             _sendAuthMessage();
             break;
             
         case WStype_TEXT: {
-            String json;
-            json.reserve(length + 1);
-            for (size_t i = 0; i < length; i++) {
-                json += (char)payload[i];
-            }
+            // The library NUL-terminates text frames; work on its buffer directly
+            char* json = (char*)payload;
             
             // Skip server status messages (welcome, auth response, etc.)
-            if (json.indexOf("\"status\"") != -1 && json.indexOf("\"payload\"") == -1) {
-                Serial.printf("[CLOUD] Server: %s\n", json.c_str());
+            if (strstr(json, "\"status\"") && !strstr(json, "\"payload\"")) {
+                Serial.printf("[CLOUD] Server: %s\n", json);
                 
                 // Check for auth error
-                if (json.indexOf("\"error\"") != -1) {
+                if (strstr(json, "\"error\"")) {
                     Serial.println("[CLOUD] Auth failed, disconnecting");
                     _ws_client.disconnect();
                 }
@@ -266,9 +293,14 @@ static void _onWsEvent(WStype_t type, uint8_t* payload, size_t length) {
             }
             
             Serial.printf("[CLOUD] RX: %u bytes\n", length);
-            _processPacket(json);
+            _processPacket(json, length);
             break;
         }
+
+        case WStype_BIN:
+            Serial.printf("[CLOUD] RX frame: %u bytes\n", length);
+            _processFrame(payload, length);
+            break;
             
         case WStype_PING:
             Serial.println("[CLOUD] Ping");
@@ -338,7 +370,7 @@ void disableCloud() {
     }
     
     _cloud_enabled = false;
-    _ws_connected = false;
+    _setConnected(false);
     _auth_sent = false;  // Reset auth flag
     _ws_client.disconnect();
     
@@ -356,21 +388,95 @@ bool isCloudEnabled() {
 }
 
 /**
- * @brief Process incoming encrypted packet.
+ * @brief Send a whole message from a request-arena buffer.
+ *
+ * buf starts with WEBSOCKETS_MAX_HEADER_SIZE spare bytes, so the library
+ * builds the frame header and masks the payload in place instead of
+ * copying the message to the heap.
+ *
+ * @param buf Header room followed by the payload.
+ * @param length Payload length.
+ * @param binary Binary (v2) instead of text message.
+ */
+static void _sendArenaMessage(uint8_t* buf, size_t length, bool binary) {
+    if (!_cloud_enabled || !_ws_connected) {
+        Serial.println("[CLOUD] Cannot send - not connected");
+        return;
+    }
+    
+    bool sent = binary ? _ws_client.sendBIN(buf, length, true)
+                       : _ws_client.sendTXT(buf, length, true);
+    Serial.println(sent ? "[CLOUD] Response sent" : "[CLOUD] Response failed");
+}
+
+/**
+ * @brief Seal a v1.x reply into a request-arena buffer and send it.
+ *
+ * Replies over FRAGMENT_THRESHOLD go out as one text message per
+ * fragment, reusing a buffer sized for the first (longest) one.
+ */
+static void _sendPacketResponse(const JsonDocument& reply, const char* version) {
+    FragmentInfo fragment;
+    if (packetManager.planFragments(reply, version, fragment)) {
+        size_t capacity = packetManager.measureResponseFragment(fragment, version);
+        uint8_t* buf = (uint8_t*)requestArena.allocate(WEBSOCKETS_MAX_HEADER_SIZE + capacity);
+        if (!buf) {
+            Serial.println("[CLOUD] Response failed: out of memory");
+            return;
+        }
+        
+        for (; fragment.index < fragment.count; fragment.index++) {
+            BufferPrint out(buf + WEBSOCKETS_MAX_HEADER_SIZE, capacity);
+            packetManager.writeResponseFragment(reply, version, fragment, out);
+            _sendArenaMessage(buf, out.length(), false);
+        }
+        requestArena.deallocate(buf);
+        return;
+    }
+    
+    size_t length = packetManager.measureResponse(reply, version);
+    uint8_t* buf = (uint8_t*)requestArena.allocate(WEBSOCKETS_MAX_HEADER_SIZE + length);
+    if (!buf) {
+        Serial.println("[CLOUD] Response failed: out of memory");
+        return;
+    }
+    
+    length = packetManager.createResponsePacket(reply, version,
+                                                (char*)buf + WEBSOCKETS_MAX_HEADER_SIZE, length);
+    _sendArenaMessage(buf, length, false);
+    requestArena.deallocate(buf);
+}
+
+/**
+ * @brief Process incoming encrypted packet in the WebSocket frame buffer.
+ *
+ * Documents and the reply buffer come from the request arena, which is
+ * reset when the scope closes.
  */
-static void _processPacket(const String& packet_json) {
-    JsonDocument incoming = packetManager.processIncomingPacket(packet_json);
+static void _processPacket(char* packet, size_t length) {
+    RequestScope scope(requestArena);
+    JsonDocument incoming = packetManager.processIncomingPacket(packet, length);
+    const char* version = incoming["version"] | PROTOCOL_V1_0;
+    
+    if (incoming["status"] == "pending") {
+        JsonDocument ack(&requestJson);
+        ack["status"] = "pending";
+        ack["fragment"] = incoming["fragment"];
+        
+        _sendPacketResponse(ack, version);
+        return;
+    }
     
     if (incoming["status"] != "success") {
         const char* error = incoming["error"] | "DECRYPT_FAILED";
         Serial.printf("[CLOUD] Error: %s\n", error);
         
-        JsonDocument err;
+        JsonDocument err(&requestJson);
         err["status"] = "error";
         err["error"] = error;
         err["request_id"] = incoming["request_id"];
         
-        sendCloudResponse(packetManager.createResponsePacket(err));
+        _sendPacketResponse(err, version);
         return;
     }
     
@@ -379,8 +485,64 @@ static void _processPacket(const String& packet_json) {
     
     Serial.printf("[CLOUD] Command: %s\n", command);
     
-    JsonDocument result = CommandManager::executeCommand(String(command), data);
+    JsonDocument result = CommandManager::executeCommand(command, data);
     result["request_id"] = incoming["request_id"];
     
-    sendCloudResponse(packetManager.createResponsePacket(result));
+    _sendPacketResponse(result, version);
+}
+
+/**
+ * @brief Process incoming v2 frame in the WebSocket message buffer.
+ */
+static void _processFrame(uint8_t* frame, size_t length) {
+    RequestScope scope(requestArena);
+    JsonDocument incoming = packetManager.processIncomingFrame(frame, length);
+    JsonDocument reply(&requestJson);
+    
+    if (incoming["status"] == "pending") {
+        reply["status"] = "pending";
+        reply["fragment"] = incoming["fragment"];
+    } else if (incoming["status"] != "success") {
+        const char* error = incoming["error"] | "DECRYPT_FAILED";
+        Serial.printf("[CLOUD] Error: %s\n", error);
+        
+        reply["status"] = "error";
+        reply["error"] = error;
+        reply["request_id"] = incoming["request_id"];
+    } else {
+        const char* command = incoming["command"];
+        JsonObject data = incoming["data"].as<JsonObject>();
+        
+        Serial.printf("[CLOUD] Command: %s\n", command);
+        
+        reply = CommandManager::executeCommand(command, data);
+        reply["request_id"] = incoming["request_id"];
+    }
+    
+    if (!_cloud_enabled || !_ws_connected) return;
+    
+    uint8_t* buf = (uint8_t*)requestArena.allocate(WEBSOCKETS_MAX_HEADER_SIZE + FRAME_V2_MAX);
+    if (!buf) {
+        Serial.println("[CLOUD] Response failed: out of memory");
+        return;
+    }
+    
+    FragmentInfo fragment;
+    if (packetManager.planFragments(reply, PROTOCOL_V2, fragment)) {
+        for (; fragment.index < fragment.count; fragment.index++) {
+            size_t outLen = packetManager.createResponseFragment(reply, fragment,
+                                                                 buf + WEBSOCKETS_MAX_HEADER_SIZE, FRAME_V2_MAX);
+            if (!outLen) break;
+            _sendArenaMessage(buf, outLen, true);
+        }
+    } else {
+        size_t outLen = packetManager.createResponseFrame(reply, buf + WEBSOCKETS_MAX_HEADER_SIZE,
+                                                          FRAME_V2_MAX);
+        if (outLen) {
+            _sendArenaMessage(buf, outLen, true);
+        } else {
+            Serial.println("[CLOUD] Response failed");
+        }
+    }
+    requestArena.deallocate(buf);
 }
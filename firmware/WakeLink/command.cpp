@@ -11,15 +11,102 @@
 #include "ota_manager.h"
 #include "wifi_manager.h"
 #include "CryptoManager.h"
+#include "packet.h"
+#include "request_arena.h"
 #include "cloud.h"
+#include "crypto_bench.h"
+#include "command_cache.h"
+#include "log_throttle.h"
 #include "platform.h"
 
 extern CryptoManager crypto;
+extern PacketManager packetManager;
 extern bool webServerEnabled;
 
 // Variables for asynchronous restart
 unsigned long CommandManager::scheduledRestartTime = 0;
 bool CommandManager::restartScheduled = false;
+PendingWol CommandManager::pendingWol[WOL_QUEUE_SIZE] = {};
+uint8_t CommandManager::pendingWolCount = 0;
+
+// One line per executed command would flood Serial under batch or polling load
+static LogThrottle commandLog;
+
+/**
+ * @brief Put the stable fields of a cacheable result into doc.
+ *
+ * Decodes them from the cache slot, or runs build() and stores its
+ * MessagePack in the slot. "fresh": true in data skips the slot both
+ * ways. Must run first: the volatile fields are added afterwards.
+ */
+static void fill_cached(CacheSlot slot, JsonDocument& doc, JsonObject data, void (*build)(JsonDocument&)) {
+    bool fresh = data["fresh"] | false;
+    uint32_t start = ESP.getCycleCount();
+
+    size_t length;
+    const uint8_t* cached = fresh ? nullptr : commandCache.get(slot, length);
+    if (cached && !deserializeMsgPack(doc, cached, length)) {
+        commandCache.recordHit(ESP.getCycleCount() - start);
+        return;
+    }
+
+    doc.clear();
+    build(doc);
+    if (!fresh) {
+        size_t capacity;
+        uint8_t* buffer = commandCache.begin(slot, capacity);
+        commandCache.commit(slot, measureMsgPack(doc) <= capacity ? serializeMsgPack(doc, buffer, capacity) : 0);
+    }
+    commandCache.recordBuild(ESP.getCycleCount() - start);
+}
+
+static void info_stable(JsonDocument& doc) {
+    doc["status"] = "success";
+    doc["device_id"] = DEVICE_ID;
+    doc["ip"] = WiFi.localIP().toString();
+    doc["ssid"] = WiFi.SSID();
+    doc["rssi"] = WiFi.RSSI();
+    doc["crypto_enabled"] = crypto.isEnabled();
+    doc["mode"] = (WiFi.getMode() == WIFI_AP ? "AP" : "STA");
+    doc["web_enabled"] = (bool)webServerEnabled;
+    doc["cloud_enabled"] = (cfg.cloud_enabled == 1);
+    doc["cloud_status"] = getCloudStatus();
+}
+
+static void crypto_info_stable(JsonDocument& doc) {
+    doc["status"] = "success";
+    doc["enabled"] = crypto.isEnabled();
+    doc["crypto_backend"] = CryptoBackend::name();
+    doc["cipher_kernel"] = CHACHA20_KERNEL;
+    doc["counter_store"] = crypto.getCounterJournal().isMounted() ? "journal" : "eeprom";
+}
+
+static void counter_info_stable(JsonDocument& doc) {
+    doc["status"] = "success";
+    doc["replay_window"] = REPLAY_WINDOW_BITS;
+}
+
+static void web_status(JsonDocument& doc) {
+    doc["status"] = "success";
+    doc["web_enabled"] = (bool)webServerEnabled;
+    doc["mode"] = inAPMode ? "AP" : "STA";
+}
+
+static void cloud_status(JsonDocument& doc) {
+    doc["status"] = "success";
+    doc["cloud_enabled"] = isCloudEnabled();
+    doc["cloud_status"] = getCloudStatus();
+}
+
+/**
+ * @brief Round a non-negative timing to a fixed number of decimals.
+ *
+ * Stored as a number, not serialized(): raw JSON text would be copied
+ * as-is into a MessagePack (v2) reply and corrupt it.
+ */
+static double round_to(float value, double scale) {
+    return (double)(long)(value * scale + 0.5) / scale;
+}
 
 /**
  * @brief Ping command handler.
@@ -59,24 +146,26 @@ void CommandManager::cmd_wake(JsonDocument& doc, JsonObject data) {
  * @brief Device info command handler.
  *
  * Returns diagnostic information including device ID, IP, SSID, RSSI,
- * crypto status, etc.
+ * crypto status, etc. free_heap/max_free_block show heap fragmentation;
+ * arena_high_water/arena_overflows size the request arena. The
+ * connection fields come from the result cache (RSSI to within
+ * CACHE_RSSI_BUCKET dB); cache_* report its hits and average cycles.
  *
  * @param doc JsonDocument to store the response.
- * @param data Command data (unused).
+ * @param data Command data with optional "fresh" (bypass the cache).
  */
 void CommandManager::cmd_info(JsonDocument& doc, JsonObject data) {
-    doc["status"] = "success";
-    doc["device_id"] = DEVICE_ID;
-    doc["ip"] = WiFi.localIP().toString();
-    doc["ssid"] = WiFi.SSID();
-    doc["rssi"] = WiFi.RSSI();
+    commandCache.noteRssi(WiFi.RSSI());
+    fill_cached(CACHE_INFO, doc, data, info_stable);
     doc["request_counter"] = crypto.getRequestCount();
-    doc["crypto_enabled"] = crypto.isEnabled();
-    doc["mode"] = (WiFi.getMode() == WIFI_AP ? "AP" : "STA");
-    doc["web_enabled"] = (bool)webServerEnabled;
-    doc["cloud_enabled"] = (cfg.cloud_enabled == 1);
-    doc["cloud_status"] = getCloudStatus();
     doc["free_heap"] = ESP.getFreeHeap();
+    doc["max_free_block"] = getMaxFreeBlock();
+    doc["arena_high_water"] = requestArena.getHighWater();
+    doc["arena_overflows"] = requestArena.getOverflows();
+    doc["cache_hits"] = commandCache.getHits();
+    doc["cache_builds"] = commandCache.getBuilds();
+    doc["cache_hit_cycles"] = commandCache.getHitCycles();
+    doc["cache_build_cycles"] = commandCache.getBuildCycles();
 }
 
 /**
@@ -147,9 +236,7 @@ void CommandManager::cmd_web_control(JsonDocument& doc, JsonObject data) {
     }
 
     if (strcmp(action, "status") == 0) {
-        doc["status"] = "success";
-        doc["web_enabled"] = (bool)webServerEnabled;
-        doc["mode"] = inAPMode ? "AP" : "STA";
+        fill_cached(CACHE_WEB_STATUS, doc, data, web_status);
 
     } else if (strcmp(action, "enable") == 0) {
         webServerEnabled = true;
@@ -195,9 +282,7 @@ void CommandManager::cmd_cloud_control(JsonDocument& doc, JsonObject data) {
     }
 
     if (strcmp(action, "status") == 0) {
-        doc["status"] = "success";
-        doc["cloud_enabled"] = isCloudEnabled();
-        doc["cloud_status"] = getCloudStatus();
+        fill_cached(CACHE_CLOUD_STATUS, doc, data, cloud_status);
 
     } else if (strcmp(action, "enable") == 0) {
         enableCloud();
@@ -219,31 +304,97 @@ void CommandManager::cmd_cloud_control(JsonDocument& doc, JsonObject data) {
 /**
  * @brief Crypto info command handler.
  *
- * Returns information about the cryptographic module and request counter.
+ * Returns information about the cryptographic module and request counter,
+ * plus the measured ChaCha20 cost (cycles per byte since boot and cycles
+ * spent on the last message). A v1.0 packet costs cipher_last_cycles plus
+ * hmac_last_cycles; a v1.1 packet costs aead_last_cycles.
  *
  * @param doc JsonDocument to store the response.
- * @param data Command data (unused).
+ * @param data Command data with optional "fresh" (bypass the cache).
  */
 void CommandManager::cmd_crypto_info(JsonDocument& doc, JsonObject data) {
-    doc["status"] = "success";
-    doc["enabled"] = crypto.isEnabled();
+    fill_cached(CACHE_CRYPTO_INFO, doc, data, crypto_info_stable);
     doc["request_counter"] = crypto.getRequestCount();
-    doc["request_limit"] = crypto.getRequestLimit();
+    doc["replay_rejects"] = crypto.getReplayGuard().getDuplicates() + crypto.getReplayGuard().getStale();
     doc["key_info"] = crypto.getKeyInfo();
+    doc["cipher_cycles_per_byte"] = crypto.getCipherCyclesPerByte();
+    doc["cipher_last_cycles"] = crypto.getCipherCyclesLast();
+    doc["hmac_last_cycles"] = crypto.getHmacCyclesLast();
+    doc["aead_last_cycles"] = crypto.getAeadCyclesLast();
+    doc["signature_failures"] = crypto.getSignatureFailures();
+    doc["journal_programs"] = crypto.getCounterJournal().getProgramOps();
+    doc["journal_erases"] = crypto.getCounterJournal().getEraseOps();
+    doc["rx_parse_cycles"] = packetManager.getRxCyclesLast();
+    doc["rx_heap"] = packetManager.getRxHeapLast();
+}
+
+/**
+ * @brief Crypto bench command handler.
+ *
+ * Runs the FIPS 180-4 / RFC 4231 / RFC 8439 known-answer tests, then
+ * times SHA-256, HMAC-SHA256, ChaCha20 and ChaCha20-Poly1305 at 64, 256
+ * and 500 bytes. Timings are grouped per primitive as arrays indexed
+ * like "sizes" so the reply stays under the 500-byte payload cap.
+ *
+ * @param doc JsonDocument to store the response.
+ * @param data Command data with optional "iterations" (1-500, default 20).
+ */
+void CommandManager::cmd_crypto_bench(JsonDocument& doc, JsonObject data) {
+    uint32_t iterations = data["iterations"] | 20;
+    if (iterations == 0) iterations = 1;
+    if (iterations > 500) iterations = 500;
+
+    CryptoSelfTest kat = CryptoBench::selfTest();
+    CryptoBenchResult results[CRYPTO_BENCH_RESULTS];
+    size_t count = CryptoBench::run(results, iterations);
+
+    doc["status"] = kat.passed() ? "success" : "error";
+    if (!kat.passed()) doc["error"] = "SELF_TEST_FAILED";
+    doc["backend"] = CryptoBackend::name();
+    doc["iterations"] = iterations;
+
+    JsonObject selfTest = doc["self_test"].to<JsonObject>();
+    selfTest["sha256"] = kat.sha256;
+    selfTest["hmac"] = kat.hmac;
+    selfTest["chacha20"] = kat.chacha20;
+    selfTest["aead"] = kat.aead;
+
+    JsonArray sizes = doc["sizes"].to<JsonArray>();
+    JsonObject usPerOp = doc["us_per_op"].to<JsonObject>();
+    JsonObject mbPerS = doc["mb_per_s"].to<JsonObject>();
+    for (size_t i = 0; i < count; i++) {
+        const CryptoBenchResult& r = results[i];
+        if (i % CRYPTO_BENCH_PRIMITIVES == 0) sizes.add(r.bytes);
+
+        JsonArray us = usPerOp[r.primitive].is<JsonArray>()
+            ? usPerOp[r.primitive].as<JsonArray>() : usPerOp[r.primitive].to<JsonArray>();
+        JsonArray mb = mbPerS[r.primitive].is<JsonArray>()
+            ? mbPerS[r.primitive].as<JsonArray>() : mbPerS[r.primitive].to<JsonArray>();
+        us.add(round_to(r.us_per_op, 10));
+        mb.add(round_to(r.mb_per_s, 100));
+    }
+
+    Serial.printf("[CMD] crypto_bench: self-test %s, %u iterations\n",
+                  kat.passed() ? "PASSED" : "FAILED", (unsigned)iterations);
 }
 
 /**
  * @brief Counter info command handler.
  *
- * Returns current request counter value and limit.
+ * Returns current request counter value and replay window statistics.
  *
  * @param doc JsonDocument to store the response.
- * @param data Command data (unused).
+ * @param data Command data with optional "fresh" (bypass the cache).
  */
 void CommandManager::cmd_counter_info(JsonDocument& doc, JsonObject data) {
-    doc["status"] = "success";
+    const ReplayGuard& replay = crypto.getReplayGuard();
+    fill_cached(CACHE_COUNTER_INFO, doc, data, counter_info_stable);
     doc["request_counter"] = crypto.getRequestCount();
-    doc["request_limit"] = crypto.getRequestLimit();
+    doc["replay_senders"] = replay.activeSenders();
+    doc["replay_accepted"] = replay.getAccepted();
+    doc["replay_duplicates"] = replay.getDuplicates();
+    doc["replay_stale"] = replay.getStale();
+    doc["replay_evictions"] = replay.getEvictions();
 }
 
 /**
@@ -270,12 +421,13 @@ void CommandManager::cmd_reset_counter(JsonDocument& doc, JsonObject data) {
  */
 void CommandManager::cmd_update_token(JsonDocument& doc, JsonObject data) {
     // Generate new token
-    String newToken = crypto.generateToken();
+    char newToken[CRYPTO_TOKEN_LENGTH + 1];
+    CryptoManager::generateToken(newToken, CRYPTO_TOKEN_LENGTH);
 
     Serial.println("[TOKEN] Generating new token...");
 
     // Save to configuration
-    strncpy(cfg.device_token, newToken.c_str(), sizeof(cfg.device_token) - 1);
+    strncpy(cfg.device_token, newToken, sizeof(cfg.device_token) - 1);
     cfg.device_token[sizeof(cfg.device_token) - 1] = '\0';
 
     // Save configuration
@@ -312,20 +464,155 @@ void CommandManager::handleScheduledRestart() {
     }
 }
 
+/**
+ * @brief Queue a paced wake send.
+ *
+ * @param mac Target MAC address.
+ * @param due millis() at which to send it.
+ * @return false if all WOL_QUEUE_SIZE entries are taken.
+ */
+bool CommandManager::queueWol(const uint8_t mac[6], uint32_t due) {
+    for (PendingWol& entry : pendingWol) {
+        if (entry.used) continue;
+        memcpy(entry.mac, mac, 6);
+        entry.due = due;
+        entry.used = true;
+        pendingWolCount++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Send paced wake packets whose time has come.
+ *
+ * Called in the main loop(); costs one counter check while nothing is queued.
+ */
+void CommandManager::handlePendingWol() {
+    if (!pendingWolCount) return;
+
+    uint32_t now = millis();
+    for (PendingWol& entry : pendingWol) {
+        if (!entry.used || (int32_t)(now - entry.due) < 0) continue;
+        entry.used = false;
+        pendingWolCount--;
+        if (!sendWOL(entry.mac)) {
+            Serial.println("[WOL] Failed to send paced WOL packet");
+        }
+    }
+}
+
+/**
+ * @brief Batch command handler.
+ *
+ * Runs each {command, data} entry through executeCommand() in order and
+ * returns the results in the same order, so one packet (one decrypt, one
+ * counter step, one response) covers many commands. Nested batches are
+ * refused. With "stop_on_error" the entries after the first failure are
+ * not run.
+ *
+ * Consecutive wake entries can be paced: the first "wol_burst" are sent
+ * at once, each following group "wol_interval_ms" later than the one
+ * before (default 0, no pacing). The batch never waits for its pacing:
+ * paced wakes are validated, queued with their send time and released
+ * by handlePendingWol() from loop(), so the reply goes out at once with
+ * "wol_queued" and "delay_ms" for them. WOL_QUEUE_SIZE wakes can wait at
+ * a time; a wake that finds the queue full fails with WOL_QUEUE_FULL.
+ *
+ * @param doc JsonDocument to store the response.
+ * @param data Command data containing "commands" array.
+ */
+void CommandManager::cmd_batch(JsonDocument& doc, JsonObject data) {
+    JsonArray commands = data["commands"];
+    if (commands.isNull() || commands.size() == 0) {
+        doc["status"] = "error";
+        doc["error"] = "COMMANDS_REQUIRED";
+        return;
+    }
+    if (commands.size() > BATCH_MAX_COMMANDS) {
+        doc["status"] = "error";
+        doc["error"] = "BATCH_TOO_LARGE";
+        doc["limit"] = BATCH_MAX_COMMANDS;
+        return;
+    }
+
+    bool stopOnError = data["stop_on_error"] | false;
+    uint32_t interval = data["wol_interval_ms"] | 0;
+    if (interval > BATCH_MAX_WOL_INTERVAL_MS) interval = BATCH_MAX_WOL_INTERVAL_MS;
+    uint32_t burst = data["wol_burst"] | 1;
+    if (burst == 0) burst = 1;
+
+    JsonArray results = doc["results"].to<JsonArray>();
+    uint32_t executed = 0, failed = 0, wolSent = 0;
+    uint32_t start = millis();
+
+    for (JsonObject entry : commands) {
+        const char* cmd = entry["command"] | "";
+        bool wake = strcmp_P(cmd, PSTR("wake")) == 0;
+
+        if (strcmp_P(cmd, PSTR("batch")) == 0) {
+            JsonObject r = results.add<JsonObject>();
+            r["status"] = "error";
+            r["error"] = "NESTED_BATCH";
+            failed++;
+        } else if (wake && interval > 0 && wolSent >= burst) {
+            // Paced: queued with its send time instead of waiting here
+            uint32_t delayMs = (wolSent / burst) * interval;
+            const char* mac = entry["data"]["mac"];
+            uint8_t addr[6];
+            JsonObject r = results.add<JsonObject>();
+            if (!mac) {
+                r["status"] = "error";
+                r["error"] = "MAC_ADDRESS_REQUIRED";
+            } else if (!parseMac(mac, addr)) {
+                r["status"] = "error";
+                r["error"] = "INVALID_MAC";
+            } else if (!queueWol(addr, start + delayMs)) {
+                r["status"] = "error";
+                r["error"] = "WOL_QUEUE_FULL";
+            } else {
+                r["status"] = "success";
+                r["result"] = "wol_queued";
+                r["mac"] = mac;
+                r["delay_ms"] = delayMs;
+            }
+            if (strcmp(r["status"] | "", "success") != 0) failed++;
+            wolSent++;
+        } else {
+            JsonDocument result = executeCommand(cmd, entry["data"]);
+            if (wake) wolSent++;
+            if (strcmp(result["status"] | "", "success") != 0) failed++;
+            results.add(result);
+        }
+        executed++;
+
+        if (failed && stopOnError) break;
+        yield();
+    }
+
+    doc["status"] = !failed ? "success" : failed < executed ? "partial" : "error";
+    doc["executed"] = executed;
+    doc["failed"] = failed;
+    doc["skipped"] = commands.size() - executed;
+}
+
 /**
  * @brief Execute command by routing string command to appropriate handler.
  *
  * Routes the command string to the corresponding handler based on prefix.
  *
- * @param command The command string to execute.
+ * @param command The command name to execute.
  * @param data Command data as JsonObject.
  * @return JsonDocument containing the response or error.
  */
-JsonDocument CommandManager::executeCommand(const String& command, JsonObject data) {
-    JsonDocument doc;
-    const char* cmd = command.c_str();
+JsonDocument CommandManager::executeCommand(const char* command, JsonObject data) {
+    JsonDocument doc(&requestJson);
+    const char* cmd = command ? command : "";
 
-    Serial.printf("[CMD] Executing: %s\n", cmd);
+    if (commandLog.allow(millis())) {
+        Serial.printf("[CMD] Executing: %s (+%lu suppressed)\n", cmd,
+                      (unsigned long)commandLog.takeSuppressed());
+    }
 
     switch (cmd[0]) {
         case 'p':
@@ -348,6 +635,7 @@ JsonDocument CommandManager::executeCommand(const String& command, JsonObject da
             break;
         case 'c':
             if (strcmp_P(cmd, PSTR("crypto_info")) == 0) { cmd_crypto_info(doc, data); return doc; }
+            if (strcmp_P(cmd, PSTR("crypto_bench")) == 0) { cmd_crypto_bench(doc, data); return doc; }
             if (strcmp_P(cmd, PSTR("counter_info")) == 0) { cmd_counter_info(doc, data); return doc; }
             if (strcmp_P(cmd, PSTR("cloud_control")) == 0) { cmd_cloud_control(doc, data); return doc; }
             break;
@@ -358,11 +646,14 @@ JsonDocument CommandManager::executeCommand(const String& command, JsonObject da
                 return doc;
             }
             break;
+        case 'b':
+            if (strcmp_P(cmd, PSTR("batch")) == 0) { cmd_batch(doc, data); return doc; }
+            break;
     }
 
     Serial.printf("[CMD] UNKNOWN COMMAND: %s\n", cmd);
     doc["status"] = "error";
     doc["error"] = "UNKNOWN_COMMAND";
-    doc["command"] = command;
+    doc["command"] = cmd;
     return doc;
 }
\ No newline at end of file
@@ -16,9 +16,11 @@
  * - web_control: Enable/disable/status web server
  * - cloud_control: Enable/disable/status cloud WSS connection
  * - crypto_info: Get encryption status and counters
+ * - crypto_bench: Run crypto known-answer tests and time each primitive
  * - counter_info: Get request counter details
  * - reset_counter: Reset request counter
  * - update_token: Generate new device token
+ * - batch: Run several of the above in order, one combined response
  * 
  * Error Handling:
  * - Unknown commands return UNKNOWN_COMMAND error
@@ -33,6 +35,26 @@
 
 #include <ArduinoJson.h>
 
+/// @brief Most entries in one batch
+#define BATCH_MAX_COMMANDS 64
+
+/// @brief Longest pause between Wake-on-LAN sends in a batch
+#define BATCH_MAX_WOL_INTERVAL_MS 1000
+
+#ifndef WOL_QUEUE_SIZE
+/// @brief Paced Wake-on-LAN sends waiting for their time (all batches together)
+#define WOL_QUEUE_SIZE 32
+#endif
+
+/**
+ * @brief Wake-on-LAN send deferred by batch pacing.
+ */
+struct PendingWol {
+    uint8_t mac[6];      ///< Target MAC address
+    bool used;           ///< Entry holds a send
+    uint32_t due;        ///< millis() at which to send
+};
+
 /**
  * @brief Command execution manager class.
  * 
@@ -44,6 +66,16 @@ private:
     static unsigned long scheduledRestartTime;  ///< Time when restart is scheduled
     static bool restartScheduled;               ///< Flag indicating pending restart
     static String newTokenForRestart;           ///< New token to apply after restart
+    static PendingWol pendingWol[WOL_QUEUE_SIZE]; ///< Paced batch wake sends
+    static uint8_t pendingWolCount;             ///< Used entries in pendingWol
+
+    /**
+     * @brief Queue a paced wake send.
+     * @param mac Target MAC address.
+     * @param due millis() at which handlePendingWol() sends it.
+     * @return false if the queue is full.
+     */
+    static bool queueWol(const uint8_t mac[6], uint32_t due);
 
 public:
     /**
@@ -51,11 +83,13 @@ public:
      * 
      * Routes the command string to the appropriate handler.
      * 
-     * @param command Command name string (e.g., "ping", "wake").
+     * The result document is allocated from the request arena.
+     * 
+     * @param command Command name (e.g., "ping", "wake").
      * @param data Command parameters as JsonObject.
      * @return JsonDocument with command result or error.
      */
-    static JsonDocument executeCommand(const String& command, JsonObject data);
+    static JsonDocument executeCommand(const char* command, JsonObject data);
 
     /**
      * @brief Handle scheduled restart operation.
@@ -65,6 +99,13 @@ public:
      */
     static void handleScheduledRestart();
 
+    /**
+     * @brief Send the paced batch wake packets that are due.
+     *
+     * Must be called from loop(); batches never wait for their pacing.
+     */
+    static void handlePendingWol();
+
     // =============================
     // Command Handlers
     // =============================
@@ -132,6 +173,13 @@ public:
      */
     static void cmd_crypto_info(JsonDocument& doc, JsonObject data);
 
+    /**
+     * @brief Crypto bench command - known-answer tests and microbenchmark.
+     * @param doc Output JsonDocument for result.
+     * @param data Input parameters (optional "iterations", default 20, max 500).
+     */
+    static void cmd_crypto_bench(JsonDocument& doc, JsonObject data);
+
     /**
      * @brief Counter info command - get request counter details.
      * @param doc Output JsonDocument for result.
@@ -152,6 +200,14 @@ public:
      * @param data Input parameters (unused).
      */
     static void cmd_update_token(JsonDocument& doc, JsonObject data);
+
+    /**
+     * @brief Batch command - run several commands from one packet.
+     * @param doc Output JsonDocument for result ("results", one per entry).
+     * @param data Input parameters ("commands": [{command, data}], optional
+     *             "stop_on_error", "wol_interval_ms", "wol_burst").
+     */
+    static void cmd_batch(JsonDocument& doc, JsonObject data);
 };
 
 #endif // COMMAND_H
\ No newline at end of file
@@ -0,0 +1,41 @@
+/**
+ * @file command_cache.cpp
+ * @brief Slots and invalidation of pre-serialized command results.
+ */
+
+#include "command_cache.h"
+
+CommandCache commandCache;
+
+const uint8_t* CommandCache::get(CacheSlot slot, size_t& length) const {
+    length = entries[slot].length;
+    return length ? entries[slot].data : nullptr;
+}
+
+uint8_t* CommandCache::begin(CacheSlot slot, size_t& capacity) {
+    entries[slot].length = 0;
+    capacity = COMMAND_CACHE_ENTRY;
+    return entries[slot].data;
+}
+
+void CommandCache::commit(CacheSlot slot, size_t length) {
+    entries[slot].length = length <= COMMAND_CACHE_ENTRY ? (uint16_t)length : 0;
+}
+
+void CommandCache::invalidate(uint32_t mask) {
+    for (uint8_t i = 0; i < CACHE_SLOTS; i++) {
+        if ((mask & CACHE_BIT(i)) && entries[i].length) {
+            entries[i].length = 0;
+            invalidations++;
+        }
+    }
+}
+
+void CommandCache::noteRssi(int rssi) {
+    // Floor division, so -1 and +1 dBm do not share bucket 0
+    int bucket = rssi >= 0 ? rssi / CACHE_RSSI_BUCKET : -((-rssi + CACHE_RSSI_BUCKET - 1) / CACHE_RSSI_BUCKET);
+    if (rssiKnown && bucket == rssiBucket) return;
+    rssiBucket = bucket;
+    rssiKnown = true;
+    invalidate(CACHE_BIT(CACHE_INFO));
+}
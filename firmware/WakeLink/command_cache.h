@@ -0,0 +1,138 @@
+/**
+ * @file command_cache.h
+ * @brief Pre-serialized results of read-only commands.
+ *
+ * info, crypto_info, counter_info and the "status" actions of
+ * web_control / cloud_control are polled constantly by monitoring. Their
+ * slowly changing fields (IP, SSID, mode, cloud state, backend names)
+ * are built once, serialized as MessagePack into a fixed slot and
+ * decoded into the reply on later calls; only the volatile fields (heap,
+ * counters, cycle timings) are filled in fresh every time.
+ *
+ * MessagePack keeps the slot independent of the reply encoding: the
+ * decoded document goes out as JSON (v1.x) or MessagePack (v2) as usual.
+ *
+ * Invalidation (invalidate() with CACHE_BIT masks):
+ * - config saved (web/cloud enable flags, token, WiFi settings): all
+ * - WiFi connected, reconnected or AP started (IP, SSID, mode): all
+ * - cloud connected/disconnected: info and cloud status
+ * - RSSI moved to another CACHE_RSSI_BUCKET dB bucket: info
+ *
+ * The request counter and replay statistics change on every packet, so
+ * they are never cached (invalidating on each step would leave nothing
+ * to hit) and are always read fresh.
+ *
+ * A request with "fresh": true bypasses the cache, so a poller can
+ * compare both paths; hit/build counts and cycles are reported by info.
+ *
+ * @note Pure C++; the document glue lives in command.cpp.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef COMMAND_CACHE_H
+#define COMMAND_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Bytes per cached result (MessagePack of the stable fields)
+#define COMMAND_CACHE_ENTRY 192
+
+/// @brief Width of an RSSI bucket in dB
+#define CACHE_RSSI_BUCKET 5
+
+/**
+ * @brief Cacheable results.
+ */
+enum CacheSlot : uint8_t {
+    CACHE_INFO = 0,
+    CACHE_CRYPTO_INFO,
+    CACHE_COUNTER_INFO,
+    CACHE_WEB_STATUS,
+    CACHE_CLOUD_STATUS,
+    CACHE_SLOTS
+};
+
+/// @brief Invalidation mask bit of a slot
+#define CACHE_BIT(slot) (1u << (slot))
+
+/// @brief Mask of every slot
+#define CACHE_ALL ((1u << CACHE_SLOTS) - 1)
+
+/**
+ * @brief Fixed slots of serialized command results.
+ */
+class CommandCache {
+private:
+    struct Entry {
+        uint8_t data[COMMAND_CACHE_ENTRY];
+        uint16_t length = 0;      ///< Serialized bytes, 0 if invalid
+    };
+
+    Entry entries[CACHE_SLOTS];
+    int rssiBucket = 0;           ///< Bucket the cached info was built in
+    bool rssiKnown = false;
+
+    uint32_t hits = 0;
+    uint32_t builds = 0;
+    uint32_t invalidations = 0;
+    uint64_t hitCycles = 0;
+    uint64_t buildCycles = 0;
+
+public:
+    /**
+     * @brief Cached bytes of a slot.
+     * @param slot Result slot.
+     * @param length Receives the length.
+     * @return Serialized result, or nullptr if the slot is invalid.
+     */
+    const uint8_t* get(CacheSlot slot, size_t& length) const;
+
+    /**
+     * @brief Buffer to serialize a fresh result into.
+     * @param slot Result slot (invalid until commit()).
+     * @param capacity Receives COMMAND_CACHE_ENTRY.
+     */
+    uint8_t* begin(CacheSlot slot, size_t& capacity);
+
+    /**
+     * @brief Validate the bytes written after begin().
+     * @param slot Result slot.
+     * @param length Bytes written; 0 (did not fit) leaves the slot invalid.
+     */
+    void commit(CacheSlot slot, size_t length);
+
+    /**
+     * @brief Drop slots after a state change.
+     * @param mask CACHE_BIT() of each slot, or CACHE_ALL.
+     */
+    void invalidate(uint32_t mask);
+
+    /**
+     * @brief Drop the info slot when RSSI leaves its bucket.
+     * @param rssi Current RSSI in dBm.
+     */
+    void noteRssi(int rssi);
+
+    /** @brief Count a reply served from a slot. */
+    void recordHit(uint32_t cycles) { hits++; hitCycles += cycles; }
+
+    /** @brief Count a reply built from scratch. */
+    void recordBuild(uint32_t cycles) { builds++; buildCycles += cycles; }
+
+    uint32_t getHits() const { return hits; }
+    uint32_t getBuilds() const { return builds; }
+    uint32_t getInvalidations() const { return invalidations; }
+
+    /** @brief Average cycles of a cached reply (stable fields). */
+    uint32_t getHitCycles() const { return hits ? (uint32_t)(hitCycles / hits) : 0; }
+
+    /** @brief Average cycles of a rebuilt reply (stable fields). */
+    uint32_t getBuildCycles() const { return builds ? (uint32_t)(buildCycles / builds) : 0; }
+};
+
+extern CommandCache commandCache;
+
+#endif // COMMAND_CACHE_H
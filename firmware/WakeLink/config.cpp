@@ -1,6 +1,8 @@
 #include "config.h"
 #include "CryptoManager.h"
 #include "platform.h"
+#include "hex_codec.h"
+#include "command_cache.h"
 
 extern CryptoManager crypto;
 
@@ -52,8 +54,7 @@ void loadConfig() {
         }
 
         if (strlen(cfg.device_token) == 0) {
-            String token = crypto.generateToken();
-            token.toCharArray(cfg.device_token, sizeof(cfg.device_token));
+            CryptoManager::generateToken(cfg.device_token, CRYPTO_TOKEN_LENGTH);
         }
 
         saveConfig();
@@ -87,6 +88,7 @@ bool saveConfig() {
 
     bool success = EEPROM.commit();
     EEPROM.end();
+    commandCache.invalidate(CACHE_ALL);
 
     Serial.printf("Config save %s\n", success ? "successful" : "failed");
     return success;
@@ -113,11 +115,9 @@ void blink(int times, int ms) {
  * @brief Convert hex character to integer value.
  *
  * @param c Hex character ('0'-'9', 'a'-'f', 'A'-'F').
- * @return Integer value (0-15).
+ * @return Integer value (0-15), or 0 for invalid input.
  */
 uint8_t hex_char_to_int(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return 0;
+    int8_t v = HexCodec::nibble(c);
+    return v < 0 ? 0 : (uint8_t)v;
 }
\ No newline at end of file
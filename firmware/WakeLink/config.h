@@ -8,7 +8,8 @@
  * EEPROM Layout:
  * - Bytes 0-383: DeviceConfig structure
  * - Bytes 384-385: Validity marker (0xAA, 0xBB)
- * - Bytes 386-389: Request counter (uint32_t)
+ * - Bytes 386-389: Request counter (uint32_t), fallback when the flash
+ *   counter journal is unavailable (see counter_journal.h)
  * 
  * Configuration Fields:
  * - device_token: 128-char secret for encryption key derivation
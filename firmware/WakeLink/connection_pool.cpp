@@ -0,0 +1,203 @@
+/**
+ * @file connection_pool.cpp
+ * @brief Non-blocking connection slots for the local TCP server.
+ */
+
+#include "connection_pool.h"
+
+void ConnectionPool::setFrameFormat(uint8_t marker, size_t header, size_t (*lengthOf)(const uint8_t*)) {
+    format.marker = marker;
+    format.header = header;
+    format.lengthOf = lengthOf;
+}
+
+int ConnectionPool::reserve(uint32_t now) {
+    int quietest = -1;
+    for (size_t i = 0; i < TCP_MAX_SESSIONS; i++) {
+        if (slots[i].state == SLOT_FREE) return (int)i;
+        if (slots[i].state == SLOT_IDLE &&
+            (quietest < 0 || now - slots[i].lastActivity > now - slots[quietest].lastActivity)) {
+            quietest = (int)i;
+        }
+    }
+
+    if (quietest < 0) {
+        refused++;
+        return -1;
+    }
+    evicted++;
+    close(slots[quietest]);
+    return quietest;
+}
+
+void ConnectionPool::attach(size_t index, NetConnection& conn, uint32_t now, uint32_t source) {
+    ConnectionSlot& slot = slots[index];
+    slot.conn = &conn;
+    slot.source = source;
+    slot.state = SLOT_IDLE;
+    slot.reader.reset(&format);
+    slot.message = nullptr;
+    slot.messageLength = 0;
+    slot.lastActivity = now;
+    slot.deadline = now + TCP_IDLE_TIMEOUT_MS;
+    accepted++;
+}
+
+void ConnectionPool::poll(uint32_t now) {
+    for (ConnectionSlot& slot : slots) {
+        slot.burst = 0;
+        if (slot.state == SLOT_WRITING) drain(slot, now);
+        if (slot.state != SLOT_FREE && slot.state != SLOT_WRITING) advance(slot, now);
+    }
+}
+
+void ConnectionPool::drain(ConnectionSlot& slot, uint32_t now) {
+    NetConnection& conn = *slot.conn;
+    if (slot.tx.flush(conn) || slot.tx.empty()) {
+        // Progress pushes the deadline out; only a stalled reply times out
+        slot.deadline = now + TCP_WRITE_TIMEOUT_MS;
+    }
+
+    if (slot.tx.empty()) {
+        await(slot, now);
+    } else if (!conn.connected()) {
+        close(slot);
+    } else if (expired(now, slot.deadline)) {
+        writeTimeouts++;
+        close(slot);
+    }
+}
+
+void ConnectionPool::await(ConnectionSlot& slot, uint32_t now) {
+    // A pipelined next message may already be buffered
+    if (slot.reader.pending()) {
+        slot.state = SLOT_READING;
+        slot.deadline = now + TCP_READ_TIMEOUT_MS;
+    } else {
+        slot.state = SLOT_IDLE;
+        slot.deadline = now + TCP_IDLE_TIMEOUT_MS;
+    }
+}
+
+void ConnectionPool::advance(ConnectionSlot& slot, uint32_t now) {
+    if (slot.state == SLOT_READY) return;  // Later bytes wait in the buffer
+
+    NetConnection& conn = *slot.conn;
+    size_t got = slot.reader.fill(conn);
+    bool eof = !conn.connected() && conn.available() <= 0;
+
+    if (take(slot, eof)) return;
+
+    if (eof) {
+        close(slot);
+        return;
+    }
+
+    if (slot.reader.pending() == 0) {
+        if (got) {
+            // Only blank lines: they keep the connection alive
+            slot.state = SLOT_IDLE;
+            slot.lastActivity = now;
+            slot.deadline = now + TCP_IDLE_TIMEOUT_MS;
+        }
+    } else if (slot.state == SLOT_IDLE) {
+        slot.state = SLOT_READING;
+        slot.deadline = now + TCP_READ_TIMEOUT_MS;
+    }
+
+    if (slot.state == SLOT_READING && expired(now, slot.deadline)) {
+        timeouts++;
+        close(slot);
+    } else if (slot.state == SLOT_IDLE && expired(now, slot.deadline)) {
+        idleClosed++;
+        close(slot);
+    }
+}
+
+bool ConnectionPool::take(ConnectionSlot& slot, bool eof) {
+    FrameView view;
+    switch (slot.reader.next(view, eof)) {
+        case FRAME_READY:
+            slot.message = view.data;
+            slot.messageLength = view.length;
+            slot.frame = view.frame;
+            slot.state = SLOT_READY;
+            return true;
+        case FRAME_OVERSIZE:
+        case FRAME_INVALID:
+            dropped++;
+            close(slot);
+            return true;
+        case FRAME_NONE:
+            break;
+    }
+    return false;
+}
+
+ConnectionSlot* ConnectionPool::next() {
+    for (size_t i = 0; i < TCP_MAX_SESSIONS; i++) {
+        size_t index = (cursor + i) % TCP_MAX_SESSIONS;
+        if (slots[index].state == SLOT_READY) {
+            cursor = index + 1;
+            messages++;
+            slots[index].burst++;
+            return &slots[index];
+        }
+    }
+    return nullptr;
+}
+
+void ConnectionPool::complete(ConnectionSlot& slot, uint32_t now) {
+    if (slot.state != SLOT_READY) return;
+    slot.reader.release();
+    slot.message = nullptr;
+    slot.messageLength = 0;
+    slot.lastActivity = now;
+
+    if (slot.tx.empty()) {
+        await(slot, now);
+    } else {
+        slot.state = SLOT_WRITING;
+        slot.deadline = now + TCP_WRITE_TIMEOUT_MS;
+        drain(slot, now);
+    }
+
+    // Reply out and the next request already here: no need to wait a pass
+    if (slot.state == SLOT_READING && slot.burst < TCP_PIPELINE_DEPTH &&
+        take(slot, false) && slot.state == SLOT_READY) {
+        pipelined++;
+    }
+}
+
+void ConnectionPool::close(ConnectionSlot& slot) {
+    if (slot.conn) slot.conn->stop();
+    reads += slot.reader.getReads();
+    received += slot.reader.getReceived();
+    if (!slot.tx.empty()) truncated++;
+    writes += slot.tx.getWrites();
+    partialWrites += slot.tx.getPartial();
+    stalls += slot.tx.getStalls();
+    sent += slot.tx.getSent();
+    slot.tx.reset();
+    slot.conn = nullptr;
+    slot.state = SLOT_FREE;
+    slot.reader.reset(&format);
+    slot.message = nullptr;
+    slot.messageLength = 0;
+}
+
+size_t ConnectionPool::active() const {
+    size_t n = 0;
+    for (const ConnectionSlot& slot : slots) {
+        if (slot.state != SLOT_FREE) n++;
+    }
+    return n;
+}
+
+size_t ConnectionPool::activeFrom(uint32_t source) const {
+    size_t n = 0;
+    for (const ConnectionSlot& slot : slots) {
+        if (slot.state != SLOT_FREE && slot.source == source) n++;
+    }
+    return n;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file connection_pool.h
+ * @brief Non-blocking connection slots for the local TCP server.
+ *
+ * A fixed table of TCP_MAX_SESSIONS slots, each with its own receive
+ * buffer (FrameReader) and deadline. poll() advances every slot by
+ * whatever bytes its socket has right now and never waits, so one slow
+ * client cannot hold up loop() (WSS, web server, OTA, WiFi). Complete
+ * messages are handed out one slot at a time, round robin.
+ *
+ * Pipelining: a client may send several messages without waiting for
+ * replies. Once a reply has gone out in full, the next message already
+ * buffered is handed out in the same pass, up to TCP_PIPELINE_DEPTH per
+ * connection per poll(). What is in flight per connection is bounded:
+ * at most FRAME_READER_SIZE bytes of requests plus one reply; further
+ * requests wait in the client's TCP window.
+ *
+ * Replies are queued per slot (ResponseQueue) and flushed by poll() as
+ * the send window allows; a slot reads nothing while its reply is going
+ * out, so a client that stops reading gets no further replies queued.
+ *
+ * Slot States:
+ * - SLOT_FREE: unused
+ * - SLOT_IDLE: connected, between messages; closed at the idle deadline
+ * - SLOT_READING: message started; closed if it is not complete by the
+ *   read deadline, counted from its first byte (slowloris senders)
+ * - SLOT_READY: complete message waiting for next()/complete()
+ * - SLOT_WRITING: reply partly sent; closed if the client takes none of
+ *   it for TCP_WRITE_TIMEOUT_MS (counted as a write timeout, never a
+ *   silently shortened reply)
+ *
+ * Framing (frame_reader.h):
+ * - A first byte equal to the frame marker starts a length-prefixed
+ *   frame; its total length comes from the header (setFrameFormat)
+ * - Anything else is a packet terminated by a newline; it is trimmed
+ *   and NUL-terminated in the slot buffer
+ * - Bytes after a message stay buffered for the next one
+ *
+ * @note Pure C++; runs against any NetConnection, also built on the
+ *       host (firmware/host/tcp_pool_sim.cpp).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame_reader.h"
+#include "response_queue.h"
+
+#ifndef TCP_MAX_SESSIONS
+/// @brief Connection slots (each holds FRAME_READER_SIZE bytes)
+#define TCP_MAX_SESSIONS 4
+#endif
+
+#ifndef TCP_IDLE_TIMEOUT_MS
+/// @brief A connection without a message for this long is closed
+#define TCP_IDLE_TIMEOUT_MS 15000
+#endif
+
+#ifndef TCP_READ_TIMEOUT_MS
+/// @brief Time to receive a whole message once its first byte is in
+#define TCP_READ_TIMEOUT_MS 5000
+#endif
+
+#ifndef TCP_PIPELINE_DEPTH
+/// @brief Buffered messages answered per connection per poll()
+#define TCP_PIPELINE_DEPTH 4
+#endif
+
+#ifndef TCP_WRITE_TIMEOUT_MS
+/// @brief Time for the client to take a whole reply
+#define TCP_WRITE_TIMEOUT_MS 5000
+#endif
+
+/**
+ * @brief State of a connection slot.
+ */
+enum SlotState : uint8_t {
+    SLOT_FREE = 0,
+    SLOT_IDLE,
+    SLOT_READING,
+    SLOT_READY,
+    SLOT_WRITING
+};
+
+/**
+ * @brief One client connection and its receive/send state.
+ */
+struct ConnectionSlot {
+    NetConnection* conn = nullptr; ///< Socket (owned by the caller)
+    SlotState state = SLOT_FREE;   ///< Receive state
+    FrameReader reader;            ///< Receive buffer and framing
+    ResponseQueue tx;              ///< Reply being sent
+    uint32_t deadline = 0;         ///< Idle, read or write deadline (ms)
+    uint32_t lastActivity = 0;     ///< Accept or last complete message (ms)
+    uint8_t burst = 0;             ///< Messages handed out since the last poll()
+    uint32_t source = 0;           ///< Remote address (admission.h)
+
+    uint8_t* message = nullptr;    ///< Ready message (inside the reader's buffer)
+    size_t messageLength = 0;      ///< Ready message length
+    bool frame = false;            ///< Ready message is a length-prefixed frame
+};
+
+/**
+ * @brief Fixed pool of non-blocking connection slots.
+ */
+class ConnectionPool {
+private:
+    ConnectionSlot slots[TCP_MAX_SESSIONS];
+    size_t cursor = 0;             ///< Round-robin start for next()
+
+    FrameFormat format;            ///< Frame format shared by all readers
+
+    uint32_t accepted = 0;         ///< Connections attached
+    uint32_t refused = 0;          ///< Connections refused (all slots busy)
+    uint32_t evicted = 0;          ///< Idle connections closed for a new one
+    uint32_t timeouts = 0;         ///< Read deadlines missed
+    uint32_t idleClosed = 0;       ///< Idle deadlines reached
+    uint32_t dropped = 0;          ///< Oversized or invalid messages
+    uint32_t messages = 0;         ///< Messages handed out
+    uint32_t pipelined = 0;        ///< Messages taken straight after the previous reply
+    uint32_t writeTimeouts = 0;    ///< Write deadlines missed (reply cut off, connection closed)
+    uint32_t truncated = 0;        ///< Connections closed with reply bytes unsent
+    uint32_t writes = 0;           ///< write() calls (closed slots included)
+    uint32_t partialWrites = 0;    ///< write() calls the socket took only in part
+    uint32_t stalls = 0;           ///< Flushes that found the send window full
+    uint64_t sent = 0;             ///< Bytes sent (closed slots included)
+    uint32_t reads = 0;            ///< Bulk socket reads (closed slots included)
+    uint64_t received = 0;         ///< Bytes received (closed slots included)
+
+    /**
+     * @brief Move received bytes of one slot forward, without waiting.
+     * @param slot Slot to advance.
+     * @param now Current time (ms).
+     */
+    void advance(ConnectionSlot& slot, uint32_t now);
+
+    /**
+     * @brief Frame the next buffered message of a slot.
+     * @param slot Slot in SLOT_IDLE or SLOT_READING.
+     * @param eof Peer has closed; an unterminated packet counts as complete.
+     * @return true if the slot became SLOT_READY or was closed (bad message).
+     */
+    bool take(ConnectionSlot& slot, bool eof);
+
+    /**
+     * @brief Send what the window takes of a slot's reply, without waiting.
+     *
+     * Once the reply is out the slot goes back to reading.
+     *
+     * @param slot Slot in SLOT_WRITING.
+     * @param now Current time (ms).
+     */
+    void drain(ConnectionSlot& slot, uint32_t now);
+
+    /** @brief Start waiting for the next message (idle or already pipelined). */
+    void await(ConnectionSlot& slot, uint32_t now);
+
+    /** @brief True once time has reached deadline (wrap-safe). */
+    static bool expired(uint32_t now, uint32_t deadline) {
+        return (int32_t)(now - deadline) >= 0;
+    }
+
+public:
+    /**
+     * @brief Enable length-prefixed frames.
+     * @param marker First byte that starts a frame.
+     * @param header Bytes needed before lengthOf can be called.
+     * @param lengthOf Total frame length from its header, 0 if invalid.
+     */
+    void setFrameFormat(uint8_t marker, size_t header, size_t (*lengthOf)(const uint8_t*));
+
+    /**
+     * @brief Find a slot for a new connection.
+     *
+     * When all slots are taken, the idle connection quiet for the longest
+     * time is closed to make room; connections in the middle of a message
+     * are never evicted.
+     *
+     * @param now Current time (ms).
+     * @return Slot index, or -1 if the connection must be refused.
+     */
+    int reserve(uint32_t now);
+
+    /**
+     * @brief Start serving a connection in a reserved slot.
+     * @param index Slot index from reserve().
+     * @param conn Connected socket (must stay valid until the slot is freed).
+     * @param now Current time (ms).
+     * @param source Remote address of the connection.
+     */
+    void attach(size_t index, NetConnection& conn, uint32_t now, uint32_t source = 0);
+
+    /**
+     * @brief Advance every slot without blocking.
+     *
+     * Sends queued reply bytes, reads available bytes, completes
+     * messages, enforces deadlines and frees slots whose peer has closed.
+     *
+     * @param now Current time (ms).
+     */
+    void poll(uint32_t now);
+
+    /**
+     * @brief Next slot holding a complete message, round robin.
+     * @return Slot, or nullptr if none is ready.
+     */
+    ConnectionSlot* next();
+
+    /**
+     * @brief Release the message of a slot; the connection stays open.
+     *
+     * A reply queued in slot.tx starts going out at once; whatever the
+     * send window does not take is sent by later poll() calls. If it
+     * went out in full and another message is already buffered, the slot
+     * is ready again at once (up to TCP_PIPELINE_DEPTH per poll()).
+     *
+     * @param slot Slot returned by next().
+     * @param now Current time (ms).
+     */
+    void complete(ConnectionSlot& slot, uint32_t now);
+
+    /**
+     * @brief Close a connection and free its slot.
+     * @param slot Slot to close.
+     */
+    void close(ConnectionSlot& slot);
+
+    /** @brief Slot by index. */
+    ConnectionSlot& slot(size_t index) { return slots[index]; }
+
+    /** @brief Slots in use. */
+    size_t active() const;
+
+    /** @brief Slots in use by connections from one remote address. */
+    size_t activeFrom(uint32_t source) const;
+
+    /** @brief read(buf, n) calls and bytes of the connections closed so far. */
+    uint32_t getReads() const { return reads; }
+    uint64_t getReceived() const { return received; }
+
+    uint32_t getAccepted() const { return accepted; }
+    uint32_t getRefused() const { return refused; }
+    uint32_t getEvicted() const { return evicted; }
+    uint32_t getTimeouts() const { return timeouts; }
+    uint32_t getIdleClosed() const { return idleClosed; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getMessages() const { return messages; }
+    uint32_t getPipelined() const { return pipelined; }
+
+    /** @brief write() calls, partial writes, full-window flushes and bytes sent. */
+    uint32_t getWrites() const { return writes; }
+    uint32_t getPartialWrites() const { return partialWrites; }
+    uint32_t getStalls() const { return stalls; }
+    uint64_t getSent() const { return sent; }
+
+    uint32_t getWriteTimeouts() const { return writeTimeouts; }
+    uint32_t getTruncated() const { return truncated; }
+};
+
+#endif // CONNECTION_POOL_H
@@ -0,0 +1,114 @@
+/**
+ * @file counter_journal.cpp
+ * @brief Append-only request-counter journal with sector rotation.
+ */
+
+#include "counter_journal.h"
+
+/// "WLCJ" little-endian
+static const uint32_t JOURNAL_MAGIC = 0x4A434C57;
+
+/// Header: magic, sequence, base, ~base
+static const uint32_t HEADER_SIZE = 16;
+
+/// Record: value, ~value
+static const uint32_t RECORD_SIZE = 8;
+
+/// Records read per flash access during recovery
+static const uint32_t SCAN_RECORDS = 16;
+
+bool CounterJournal::startSector(size_t sector, uint32_t seq, uint32_t base) {
+    if (!flash.erase(sector)) return false;
+    eraseOps++;
+
+    uint32_t header[4] = {JOURNAL_MAGIC, seq, base, ~base};
+    if (!flash.program((uint32_t)(sector * flash.sectorSize()), header, sizeof(header))) return false;
+    programOps++;
+
+    active = sector;
+    sequence = seq;
+    writePos = HEADER_SIZE;
+    value = base;
+    return true;
+}
+
+bool CounterJournal::mount(uint32_t& out) {
+    mounted = false;
+    const size_t sectors = flash.sectorCount();
+    const uint32_t sectorSize = (uint32_t)flash.sectorSize();
+    if (sectors == 0) return false;
+
+    // Newest valid header wins
+    bool found = false;
+    for (size_t s = 0; s < sectors; s++) {
+        uint32_t header[4];
+        if (!flash.read((uint32_t)(s * sectorSize), header, sizeof(header))) continue;
+        if (header[0] != JOURNAL_MAGIC || header[3] != ~header[2]) continue;
+        if (!found || header[1] > sequence) {
+            found = true;
+            active = s;
+            sequence = header[1];
+            value = header[2];
+        }
+    }
+    if (!found) return false;
+
+    // Replay records until the first erased slot
+    const uint32_t sectorBase = (uint32_t)(active * sectorSize);
+    uint32_t pos = HEADER_SIZE;
+    bool done = false;
+    while (!done && pos + RECORD_SIZE <= sectorSize) {
+        uint32_t words[SCAN_RECORDS * 2];
+        uint32_t count = (sectorSize - pos) / RECORD_SIZE;
+        if (count > SCAN_RECORDS) count = SCAN_RECORDS;
+        if (!flash.read(sectorBase + pos, words, count * RECORD_SIZE)) return false;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t v = words[i * 2], inv = words[i * 2 + 1];
+            if (v == 0xFFFFFFFF && inv == 0xFFFFFFFF) {
+                done = true;
+                break;
+            }
+            if (inv == ~v) value = v;   // Torn records are skipped, slot stays used
+            pos += RECORD_SIZE;
+        }
+    }
+
+    writePos = pos;
+    mounted = true;
+    out = value;
+    return true;
+}
+
+bool CounterJournal::format(uint32_t initial) {
+    mounted = false;
+    const size_t sectors = flash.sectorCount();
+    if (sectors == 0) return false;
+
+    // Clear stale headers first so none can outrank the new one
+    for (size_t s = 1; s < sectors; s++) {
+        if (!flash.erase(s)) return false;
+        eraseOps++;
+    }
+    if (!startSector(0, 1, initial)) return false;
+
+    mounted = true;
+    return true;
+}
+
+bool CounterJournal::append(uint32_t newValue) {
+    if (!mounted) return false;
+
+    const uint32_t sectorSize = (uint32_t)flash.sectorSize();
+    if (writePos + RECORD_SIZE > sectorSize) {
+        // Active sector full: carry the value into the next one
+        return startSector((active + 1) % flash.sectorCount(), sequence + 1, newValue);
+    }
+
+    uint32_t record[2] = {newValue, ~newValue};
+    bool ok = flash.program((uint32_t)(active * sectorSize) + writePos, record, sizeof(record));
+    programOps++;
+    writePos += RECORD_SIZE;  // Consume the slot even on failure; recovery skips it
+    if (ok) value = newValue;
+    return ok;
+}
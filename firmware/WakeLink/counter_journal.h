@@ -0,0 +1,104 @@
+/**
+ * @file counter_journal.h
+ * @brief Append-only, wear-levelled request-counter journal in raw flash.
+ *
+ * Every counter update is one 8-byte program operation into erased
+ * flash; no sector is erased on the request path except when the active
+ * sector fills up. Compaction then erases the next sector in the ring
+ * and writes a header carrying the current value, so the cost of an
+ * erase is spread over (sector size - 16) / 8 updates and the sectors
+ * wear evenly.
+ *
+ * Sector Layout:
+ * - Header (16 bytes): magic "WLCJ", sequence, base value, ~base value
+ * - Records (8 bytes each): value, ~value
+ *
+ * Recovery:
+ * - The valid header with the highest sequence marks the active sector
+ * - The last record whose value matches its complement wins; a torn
+ *   record (power loss mid-program) is skipped
+ * - A crash between erase and header write leaves the previous sector
+ *   active, so no value is lost
+ *
+ * @note Pure C++; runs against any FlashRegion.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef COUNTER_JOURNAL_H
+#define COUNTER_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "flash_region.h"
+
+/**
+ * @brief Log-structured persistent uint32 counter.
+ */
+class CounterJournal {
+private:
+    FlashRegion& flash;          ///< Backing flash
+    size_t active = 0;           ///< Sector holding the newest header
+    uint32_t sequence = 0;       ///< Sequence number of the active sector
+    uint32_t writePos = 0;       ///< Next free record offset inside active sector
+    uint32_t value = 0;          ///< Last stored value
+    bool mounted = false;        ///< True after mount() or format()
+
+    uint32_t programOps = 0;     ///< Program operations since boot
+    uint32_t eraseOps = 0;       ///< Sector erases since boot
+
+    /**
+     * @brief Start a fresh sector holding value in its header.
+     * @param sector Sector to erase and initialise.
+     * @param seq Sequence number for the new header.
+     * @param base Value carried over.
+     * @return true on success.
+     */
+    bool startSector(size_t sector, uint32_t seq, uint32_t base);
+
+public:
+    /**
+     * @brief Construct journal on a flash region.
+     * @param region Backing flash (must outlive the journal).
+     */
+    explicit CounterJournal(FlashRegion& region) : flash(region) {}
+
+    /**
+     * @brief Recover the counter from flash.
+     * @param out Recovered value.
+     * @return false if the region holds no journal yet (call format()).
+     */
+    bool mount(uint32_t& out);
+
+    /**
+     * @brief Erase the region and start a journal at value.
+     * @param initial Starting value (e.g. migrated from EEPROM).
+     * @return true on success.
+     */
+    bool format(uint32_t initial);
+
+    /**
+     * @brief Persist a new value with one program operation.
+     *
+     * Compacts into the next sector when the active one is full.
+     *
+     * @param newValue Value to store.
+     * @return true on success.
+     */
+    bool append(uint32_t newValue);
+
+    /** @brief True if mount() or format() succeeded. */
+    bool isMounted() const { return mounted; }
+
+    /** @brief Last stored value. */
+    uint32_t getValue() const { return value; }
+
+    /** @brief Program operations since boot. */
+    uint32_t getProgramOps() const { return programOps; }
+
+    /** @brief Sector erases since boot. */
+    uint32_t getEraseOps() const { return eraseOps; }
+};
+
+#endif // COUNTER_JOURNAL_H
@@ -0,0 +1,144 @@
+/**
+ * @file crypto_backend.cpp
+ * @brief Portable software crypto backend (default).
+ *
+ * Thin wrappers over chacha20.cpp, poly1305.cpp and sha256.cpp. The RNG is the Arduino
+ * random() source on the device (hardware RNG on ESP8266/ESP32) and
+ * getentropy() on a native host; a host without entropy aborts rather
+ * than hand out partly filled key or nonce material.
+ */
+
+#include "crypto_backend.h"
+
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_SOFTWARE
+
+#include <string.h>
+
+#if defined(ARDUINO)
+  #include <Arduino.h>
+#else
+  #include <stdio.h>
+  #include <stdlib.h>
+  #include <unistd.h>
+#endif
+
+const char* CryptoBackend::name() {
+    return "software";
+}
+
+void CryptoBackend::sha256(const uint8_t* data, size_t len, uint8_t hash[32]) {
+    Sha256Ctx::hash(data, len, hash);
+}
+
+void CryptoBackend::chacha20(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter,
+                             const uint8_t* input, uint8_t* output, size_t length) {
+    ChaCha20 cipher;
+    cipher.init(key, nonce, counter);
+    cipher.crypt(input, output, length);
+    cipher.wipe();
+}
+
+void CryptoBackend::aeadSeal(const uint8_t key[32], const uint8_t nonce[12],
+                             const uint8_t* aad, size_t aadLen,
+                             uint8_t* data, size_t len, uint8_t tag[16]) {
+    ChaCha20Poly1305::seal(key, nonce, aad, aadLen, data, len, tag);
+}
+
+bool CryptoBackend::aeadOpen(const uint8_t key[32], const uint8_t nonce[12],
+                             const uint8_t* aad, size_t aadLen,
+                             uint8_t* data, size_t len, const uint8_t tag[16]) {
+    return ChaCha20Poly1305::open(key, nonce, aad, aadLen, data, len, tag);
+}
+
+void CryptoBackend::randomBytes(uint8_t* out, size_t len) {
+#if defined(ARDUINO)
+    for (size_t i = 0; i < len; i++) out[i] = (uint8_t)random(0, 256);
+#else
+    // getentropy() is limited to 256 bytes per call
+    while (len > 0) {
+        size_t chunk = len > 256 ? 256 : len;
+        if (getentropy(out, chunk) != 0) {
+            fprintf(stderr, "CryptoBackend: getentropy failed\n");
+            abort();
+        }
+        out += chunk;
+        len -= chunk;
+    }
+#endif
+}
+
+void CryptoBackend::Hmac::begin(const uint8_t* key, size_t key_len) {
+    ctx.begin(key, key_len);
+}
+
+void CryptoBackend::Hmac::compute(const uint8_t* data, size_t len, uint8_t mac[32]) const {
+    ctx.compute(data, len, mac);
+}
+
+void CryptoBackend::Hmac::start(Message& msg) const {
+    ctx.start(msg);
+}
+
+void CryptoBackend::Hmac::update(Message& msg, const uint8_t* data, size_t len) const {
+    msg.update(data, len);
+}
+
+void CryptoBackend::Hmac::finish(Message& msg, uint8_t mac[32]) const {
+    ctx.finish(msg, mac);
+}
+
+void CryptoBackend::Cipher::init(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter) {
+    state.init(key, nonce, counter);
+}
+
+void CryptoBackend::Cipher::crypt(const uint8_t* input, uint8_t* output, size_t length) {
+    state.crypt(input, output, length);
+}
+
+void CryptoBackend::Cipher::wipe() {
+    state.wipe();
+}
+
+void CryptoBackend::Aead::begin(const uint8_t key[32], const uint8_t nonce[12],
+                                const uint8_t* aad, size_t len) {
+    // One-time Poly1305 key from block 0, payload from block 1 (RFC 8439)
+    uint8_t otk[32];
+    memset(otk, 0, sizeof(otk));
+    cipher.init(key, nonce, 0);
+    cipher.crypt(otk, sizeof(otk));
+    poly.init(otk);
+    memset(otk, 0, sizeof(otk));
+    cipher.init(key, nonce, 1);
+
+    poly.update(aad, len);
+    poly.padTo16();
+    aadLen = len;
+    dataLen = 0;
+}
+
+void CryptoBackend::Aead::seal(const uint8_t* input, uint8_t* output, size_t length) {
+    cipher.crypt(input, output, length);
+    poly.update(output, length);
+    dataLen += length;
+}
+
+void CryptoBackend::Aead::finish(uint8_t tag[16]) {
+    uint8_t lengths[16];
+    for (size_t i = 0; i < 8; i++) {
+        lengths[i] = (uint8_t)((uint64_t)aadLen >> (8 * i));
+        lengths[8 + i] = (uint8_t)((uint64_t)dataLen >> (8 * i));
+    }
+    poly.padTo16();
+    poly.update(lengths, sizeof(lengths));
+    poly.finish(tag);
+    wipe();
+}
+
+void CryptoBackend::Aead::wipe() {
+    cipher.wipe();
+    poly.wipe();
+    aadLen = 0;
+    dataLen = 0;
+}
+
+#endif // CRYPTO_BACKEND_SOFTWARE
@@ -0,0 +1,262 @@
+/**
+ * @file crypto_backend.h
+ * @brief Compile-time selectable provider of SHA-256, HMAC, ChaCha20,
+ *        ChaCha20-Poly1305 and RNG.
+ *
+ * CryptoManager and PayloadStream call these primitives only through
+ * CryptoBackend, so the implementation can be swapped without touching
+ * the packet code.
+ *
+ * Backends (select with -DCRYPTO_BACKEND=...):
+ * - CRYPTO_BACKEND_SOFTWARE: chacha20.cpp/sha256.cpp, default on the device
+ * - CRYPTO_BACKEND_OPENSSL:  libcrypto reference, native host builds only
+ * - CRYPTO_BACKEND_MBEDTLS:  reserved for the ESP32 hardware-accelerated path
+ *
+ * The OpenSSL backend exists to measure the software path against an
+ * optimised implementation and to run differential tests on a workstation.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef CRYPTO_BACKEND_H
+#define CRYPTO_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRYPTO_BACKEND_SOFTWARE 0
+#define CRYPTO_BACKEND_OPENSSL  1
+#define CRYPTO_BACKEND_MBEDTLS  2
+
+#ifndef CRYPTO_BACKEND
+  #define CRYPTO_BACKEND CRYPTO_BACKEND_SOFTWARE
+#endif
+
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_SOFTWARE
+  #include "chacha20.h"
+  #include "poly1305.h"
+  #include "sha256.h"
+#elif CRYPTO_BACKEND == CRYPTO_BACKEND_OPENSSL
+  // The host Arduino shim defines ARDUINO too, so test for a real core
+  #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+    #error "CRYPTO_BACKEND_OPENSSL is only available in native host builds"
+  #endif
+#elif CRYPTO_BACKEND == CRYPTO_BACKEND_MBEDTLS
+  #error "CRYPTO_BACKEND_MBEDTLS is not implemented yet"
+#else
+  #error "Unknown CRYPTO_BACKEND"
+#endif
+
+/**
+ * @brief Static facade over the selected crypto implementation.
+ */
+class CryptoBackend {
+public:
+    /** @brief Backend name for diagnostics ("software", "openssl"). */
+    static const char* name();
+
+    /**
+     * @brief One-shot SHA-256.
+     * @param data Input bytes.
+     * @param len Input length.
+     * @param hash 32-byte output buffer.
+     */
+    static void sha256(const uint8_t* data, size_t len, uint8_t hash[32]);
+
+    /**
+     * @brief ChaCha20 XOR of input into output (RFC 8439).
+     * @param key 256-bit key.
+     * @param nonce 96-bit nonce.
+     * @param counter Initial block counter.
+     * @param input Input data.
+     * @param output Output buffer (may equal input).
+     * @param length Data length in bytes.
+     */
+    static void chacha20(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter,
+                         const uint8_t* input, uint8_t* output, size_t length);
+
+    /**
+     * @brief ChaCha20-Poly1305 encrypt in place and compute the tag (RFC 8439).
+     * @param key 256-bit key.
+     * @param nonce 96-bit nonce.
+     * @param aad Additional authenticated data (may be NULL if aadLen is 0).
+     * @param aadLen AAD length.
+     * @param data Plaintext in, ciphertext out.
+     * @param len Data length.
+     * @param tag 16-byte output tag.
+     */
+    static void aeadSeal(const uint8_t key[32], const uint8_t nonce[12],
+                         const uint8_t* aad, size_t aadLen,
+                         uint8_t* data, size_t len, uint8_t tag[16]);
+
+    /**
+     * @brief ChaCha20-Poly1305 verify and decrypt in place.
+     *
+     * The data is left as ciphertext when the tag does not match.
+     *
+     * @return true if the tag is valid.
+     */
+    static bool aeadOpen(const uint8_t key[32], const uint8_t nonce[12],
+                         const uint8_t* aad, size_t aadLen,
+                         uint8_t* data, size_t len, const uint8_t tag[16]);
+
+    /**
+     * @brief Fill buffer from the platform random source.
+     *
+     * Never returns with the buffer partly filled: a host build aborts if
+     * the OS or OpenSSL cannot supply entropy.
+     *
+     * @param out Output buffer.
+     * @param len Number of bytes.
+     */
+    static void randomBytes(uint8_t* out, size_t len);
+
+    /**
+     * @brief HMAC-SHA256 key context; read-only after begin().
+     */
+    class Hmac {
+    private:
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_SOFTWARE
+        HmacSha256Ctx ctx;       ///< Cached ipad/opad midstates
+#else
+        uint8_t key[64];         ///< Raw key (hashed first if over 64 bytes)
+        size_t key_len = 0;      ///< Key length
+#endif
+
+    public:
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_SOFTWARE
+        typedef Sha256Ctx Message;   ///< Per-message state (inner hash)
+#else
+        /// Per-message state (inner hash)
+        struct Message {
+            void* md = nullptr;      ///< EVP_MD_CTX
+        };
+#endif
+
+        /**
+         * @brief Set the key and precompute what the backend can.
+         * @param key HMAC key.
+         * @param key_len Key length.
+         */
+        void begin(const uint8_t* key, size_t key_len);
+
+        /**
+         * @brief MAC a complete message.
+         * @param data Message bytes.
+         * @param len Message length.
+         * @param mac 32-byte output buffer.
+         */
+        void compute(const uint8_t* data, size_t len, uint8_t mac[32]) const;
+
+        /**
+         * @brief Start an incremental MAC (for data produced piecewise).
+         * @param msg Per-message state to initialise.
+         */
+        void start(Message& msg) const;
+
+        /**
+         * @brief Absorb the next piece of the message.
+         * @param msg State from start().
+         * @param data Message bytes.
+         * @param len Length.
+         */
+        void update(Message& msg, const uint8_t* data, size_t len) const;
+
+        /**
+         * @brief Output the MAC; msg must be started again before reuse.
+         * @param msg State from start().
+         * @param mac 32-byte output buffer.
+         */
+        void finish(Message& msg, uint8_t mac[32]) const;
+    };
+
+    /**
+     * @brief ChaCha20 keystream whose position follows the data (v1.0 payloads).
+     */
+    class Cipher {
+    private:
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_SOFTWARE
+        ChaCha20 state;
+#else
+        void* ctx = nullptr;     ///< EVP_CIPHER_CTX
+#endif
+
+    public:
+        Cipher() = default;
+        Cipher(const Cipher&) = delete;
+        Cipher& operator=(const Cipher&) = delete;
+        ~Cipher() { wipe(); }
+
+        /**
+         * @brief Set key, nonce and starting block.
+         * @param key 256-bit key.
+         * @param nonce 96-bit nonce.
+         * @param counter Initial block counter.
+         */
+        void init(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter);
+
+        /**
+         * @brief XOR the next keystream bytes into the data.
+         * @param input Input data.
+         * @param output Output buffer (may equal input).
+         * @param length Data length.
+         */
+        void crypt(const uint8_t* input, uint8_t* output, size_t length);
+
+        /** @brief Erase key material (and release backend state). */
+        void wipe();
+    };
+
+    /**
+     * @brief ChaCha20-Poly1305 seal of a message produced piecewise (v1.1 payloads).
+     *
+     * Same output as aeadSeal() over the concatenated pieces.
+     */
+    class Aead {
+    private:
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_SOFTWARE
+        ChaCha20 cipher;         ///< Payload keystream from block 1
+        Poly1305 poly;           ///< Tag over AAD and ciphertext
+        size_t aadLen = 0;       ///< AAD length for the final length block
+        size_t dataLen = 0;      ///< Ciphertext bytes so far
+#else
+        void* ctx = nullptr;     ///< EVP_CIPHER_CTX
+#endif
+
+    public:
+        Aead() = default;
+        Aead(const Aead&) = delete;
+        Aead& operator=(const Aead&) = delete;
+        ~Aead() { wipe(); }
+
+        /**
+         * @brief Start a message; the AAD is given whole up front.
+         * @param key 256-bit key.
+         * @param nonce 96-bit nonce.
+         * @param aad Additional authenticated data.
+         * @param aadLen AAD length.
+         */
+        void begin(const uint8_t key[32], const uint8_t nonce[12],
+                   const uint8_t* aad, size_t aadLen);
+
+        /**
+         * @brief Encrypt the next piece of plaintext and absorb the ciphertext.
+         * @param input Plaintext.
+         * @param output Ciphertext (may equal input).
+         * @param length Piece length.
+         */
+        void seal(const uint8_t* input, uint8_t* output, size_t length);
+
+        /**
+         * @brief Output the tag and wipe the context.
+         * @param tag 16-byte output tag.
+         */
+        void finish(uint8_t tag[16]);
+
+        /** @brief Erase key material (and release backend state). */
+        void wipe();
+    };
+};
+
+#endif // CRYPTO_BACKEND_H
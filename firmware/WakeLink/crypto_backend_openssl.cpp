@@ -0,0 +1,186 @@
+/**
+ * @file crypto_backend_openssl.cpp
+ * @brief OpenSSL libcrypto backend for native host builds.
+ *
+ * Reference implementation for benchmarking and differential testing of
+ * the software backend. Build with -DCRYPTO_BACKEND=CRYPTO_BACKEND_OPENSSL
+ * and link -lcrypto. Compiles to nothing in device builds.
+ */
+
+#include "crypto_backend.h"
+
+#if CRYPTO_BACKEND == CRYPTO_BACKEND_OPENSSL
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char* CryptoBackend::name() {
+    return "openssl";
+}
+
+void CryptoBackend::sha256(const uint8_t* data, size_t len, uint8_t hash[32]) {
+    SHA256(data, len, hash);
+}
+
+void CryptoBackend::chacha20(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter,
+                             const uint8_t* input, uint8_t* output, size_t length) {
+    // EVP_chacha20 takes a 16-byte IV: 32-bit little-endian counter || 96-bit nonce
+    uint8_t iv[16];
+    iv[0] = (uint8_t)counter;
+    iv[1] = (uint8_t)(counter >> 8);
+    iv[2] = (uint8_t)(counter >> 16);
+    iv[3] = (uint8_t)(counter >> 24);
+    memcpy(iv + 4, nonce, 12);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int outl = 0;
+    EVP_EncryptInit_ex(ctx, EVP_chacha20(), NULL, key, iv);
+    EVP_EncryptUpdate(ctx, output, &outl, input, (int)length);
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+void CryptoBackend::aeadSeal(const uint8_t key[32], const uint8_t nonce[12],
+                             const uint8_t* aad, size_t aadLen,
+                             uint8_t* data, size_t len, uint8_t tag[16]) {
+    Aead aead;
+    aead.begin(key, nonce, aad, aadLen);
+    aead.seal(data, data, len);
+    aead.finish(tag);
+}
+
+bool CryptoBackend::aeadOpen(const uint8_t key[32], const uint8_t nonce[12],
+                             const uint8_t* aad, size_t aadLen,
+                             uint8_t* data, size_t len, const uint8_t tag[16]) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int outl = 0;
+    EVP_DecryptInit_ex(ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL);
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, 12, NULL);
+    EVP_DecryptInit_ex(ctx, NULL, NULL, key, nonce);
+    if (aadLen) EVP_DecryptUpdate(ctx, NULL, &outl, aad, (int)aadLen);
+    EVP_DecryptUpdate(ctx, data, &outl, data, (int)len);
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, 16, (void*)tag);
+    bool ok = EVP_DecryptFinal_ex(ctx, data + len, &outl) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+
+    // libcrypto decrypts before it verifies; put the ciphertext back on failure
+    if (!ok) chacha20(key, nonce, 1, data, data, len);
+    return ok;
+}
+
+void CryptoBackend::randomBytes(uint8_t* out, size_t len) {
+    if (RAND_bytes(out, (int)len) != 1) {
+        fprintf(stderr, "CryptoBackend: RAND_bytes failed\n");
+        abort();
+    }
+}
+
+void CryptoBackend::Hmac::begin(const uint8_t* k, size_t k_len) {
+    if (k_len > sizeof(key)) {
+        SHA256(k, k_len, key);
+        key_len = 32;
+    } else {
+        memcpy(key, k, k_len);
+        key_len = k_len;
+    }
+}
+
+void CryptoBackend::Hmac::compute(const uint8_t* data, size_t len, uint8_t mac[32]) const {
+    unsigned int mac_len = 32;
+    HMAC(EVP_sha256(), key, (int)key_len, data, len, mac, &mac_len);
+}
+
+/**
+ * @brief Hash one 64-byte key pad into a digest context.
+ */
+static void absorb_pad(EVP_MD_CTX* md, const uint8_t* key, size_t key_len, uint8_t fill) {
+    uint8_t pad[64];
+    memset(pad, fill, sizeof(pad));
+    for (size_t i = 0; i < key_len; i++) pad[i] ^= key[i];
+    EVP_DigestUpdate(md, pad, sizeof(pad));
+}
+
+void CryptoBackend::Hmac::start(Message& msg) const {
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+    absorb_pad(md, key, key_len, 0x36);
+    msg.md = md;
+}
+
+void CryptoBackend::Hmac::update(Message& msg, const uint8_t* data, size_t len) const {
+    EVP_DigestUpdate((EVP_MD_CTX*)msg.md, data, len);
+}
+
+void CryptoBackend::Hmac::finish(Message& msg, uint8_t mac[32]) const {
+    EVP_MD_CTX* md = (EVP_MD_CTX*)msg.md;
+    uint8_t inner[32];
+    unsigned int len = 0;
+    EVP_DigestFinal_ex(md, inner, &len);
+
+    EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+    absorb_pad(md, key, key_len, 0x5c);
+    EVP_DigestUpdate(md, inner, sizeof(inner));
+    EVP_DigestFinal_ex(md, mac, &len);
+
+    EVP_MD_CTX_free(md);
+    msg.md = nullptr;
+}
+
+void CryptoBackend::Cipher::init(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter) {
+    uint8_t iv[16];
+    iv[0] = (uint8_t)counter;
+    iv[1] = (uint8_t)(counter >> 8);
+    iv[2] = (uint8_t)(counter >> 16);
+    iv[3] = (uint8_t)(counter >> 24);
+    memcpy(iv + 4, nonce, 12);
+
+    if (!ctx) ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex((EVP_CIPHER_CTX*)ctx, EVP_chacha20(), NULL, key, iv);
+}
+
+void CryptoBackend::Cipher::crypt(const uint8_t* input, uint8_t* output, size_t length) {
+    int outl = 0;
+    EVP_EncryptUpdate((EVP_CIPHER_CTX*)ctx, output, &outl, input, (int)length);
+}
+
+void CryptoBackend::Cipher::wipe() {
+    // EVP_CIPHER_CTX_free() cleanses the key schedule
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
+    ctx = nullptr;
+}
+
+void CryptoBackend::Aead::begin(const uint8_t key[32], const uint8_t nonce[12],
+                                const uint8_t* aad, size_t aadLen) {
+    if (!ctx) ctx = EVP_CIPHER_CTX_new();
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    int outl = 0;
+    EVP_EncryptInit_ex(c, EVP_chacha20_poly1305(), NULL, NULL, NULL);
+    EVP_CIPHER_CTX_ctrl(c, EVP_CTRL_AEAD_SET_IVLEN, 12, NULL);
+    EVP_EncryptInit_ex(c, NULL, NULL, key, nonce);
+    if (aadLen) EVP_EncryptUpdate(c, NULL, &outl, aad, (int)aadLen);
+}
+
+void CryptoBackend::Aead::seal(const uint8_t* input, uint8_t* output, size_t length) {
+    int outl = 0;
+    EVP_EncryptUpdate((EVP_CIPHER_CTX*)ctx, output, &outl, input, (int)length);
+}
+
+void CryptoBackend::Aead::finish(uint8_t tag[16]) {
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    uint8_t none[16];
+    int outl = 0;
+    EVP_EncryptFinal_ex(c, none, &outl);
+    EVP_CIPHER_CTX_ctrl(c, EVP_CTRL_AEAD_GET_TAG, 16, tag);
+    wipe();
+}
+
+void CryptoBackend::Aead::wipe() {
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
+    ctx = nullptr;
+}
+
+#endif // CRYPTO_BACKEND_OPENSSL
@@ -0,0 +1,81 @@
+/**
+ * @file crypto_bench.h
+ * @brief Crypto known-answer tests and microbenchmarks.
+ *
+ * Shared by the crypto_bench command on the device and by the native
+ * benchmark in firmware/host/, so both time exactly the same code paths
+ * (CryptoBackend primitives plus the v1.1 AEAD).
+ *
+ * Known-answer tests:
+ * - SHA-256: FIPS 180-4 examples "abc" and the 448-bit two-block message
+ * - HMAC-SHA256: RFC 4231 test case 2
+ * - ChaCha20: RFC 8439 sections 2.3.2 and 2.4.2
+ * - ChaCha20-Poly1305: RFC 8439 sections 2.5.2 and 2.8.2
+ *
+ * @note Pure C++; uses micros()/yield() on the device and a monotonic
+ *       clock on a native host.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef CRYPTO_BENCH_H
+#define CRYPTO_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Payload sizes timed by CryptoBench::run (500 = protocol payload cap)
+#define CRYPTO_BENCH_SIZES {64, 256, 500}
+
+/// @brief Number of timed primitives
+#define CRYPTO_BENCH_PRIMITIVES 4
+
+/// @brief Number of results produced by CryptoBench::run
+#define CRYPTO_BENCH_RESULTS (CRYPTO_BENCH_PRIMITIVES * 3)
+
+/**
+ * @brief Outcome of the known-answer tests.
+ */
+struct CryptoSelfTest {
+    bool sha256;              ///< FIPS 180-4 vectors
+    bool hmac;                ///< RFC 4231 vector
+    bool chacha20;            ///< RFC 8439 cipher vectors
+    bool aead;                ///< RFC 8439 Poly1305/AEAD vectors
+
+    /** @brief True if every vector matched. */
+    bool passed() const { return sha256 && hmac && chacha20 && aead; }
+};
+
+/**
+ * @brief Timing of one primitive at one payload size.
+ */
+struct CryptoBenchResult {
+    const char* primitive;    ///< "sha256", "hmac_sha256", "chacha20", "chacha20_poly1305"
+    uint32_t bytes;           ///< Payload size per operation
+    uint32_t iterations;      ///< Operations timed
+    float us_per_op;          ///< Microseconds per operation
+    float mb_per_s;           ///< Throughput in MB/s (10^6 bytes)
+};
+
+/**
+ * @brief Static crypto self-test and benchmark runner.
+ */
+class CryptoBench {
+public:
+    /**
+     * @brief Run all known-answer tests through the selected backend.
+     * @return Per-primitive pass/fail.
+     */
+    static CryptoSelfTest selfTest();
+
+    /**
+     * @brief Time every primitive at every CRYPTO_BENCH_SIZES payload.
+     * @param out Array of at least CRYPTO_BENCH_RESULTS entries.
+     * @param iterations Operations per primitive and size.
+     * @return Number of results written.
+     */
+    static size_t run(CryptoBenchResult* out, uint32_t iterations);
+};
+
+#endif // CRYPTO_BENCH_H
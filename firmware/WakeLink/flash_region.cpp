@@ -0,0 +1,63 @@
+/**
+ * @file flash_region.cpp
+ * @brief Device flash access for the counter and replay-floor journals (ESP8266/ESP32).
+ */
+
+#include "flash_region.h"
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+
+#ifdef ESP8266
+  #include <flash_hal.h>
+
+bool DeviceFlashRegion::begin() {
+    uint32_t start = (uint32_t)&_FS_start - 0x40200000;
+    uint32_t end = (uint32_t)&_FS_end - 0x40200000;
+    ready = end > start && end - start >= FLASH_RESERVED_SECTORS * sectorSize();
+    base = start + first * sectorSize();
+    return ready;
+}
+
+bool DeviceFlashRegion::read(uint32_t offset, void* buf, size_t len) {
+    return ready && ESP.flashRead(base + offset, (uint32_t*)buf, len);
+}
+
+bool DeviceFlashRegion::program(uint32_t offset, const void* buf, size_t len) {
+    return ready && ESP.flashWrite(base + offset, (uint32_t*)buf, len);
+}
+
+bool DeviceFlashRegion::erase(size_t sector) {
+    return ready && sector < count && ESP.flashEraseSector(base / sectorSize() + sector);
+}
+
+#else  // ESP32
+  #include <esp_partition.h>
+
+bool DeviceFlashRegion::begin() {
+    const esp_partition_t* p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                        ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+    partition = p;
+    base = first * sectorSize();
+    ready = p && p->size >= FLASH_RESERVED_SECTORS * sectorSize();
+    return ready;
+}
+
+bool DeviceFlashRegion::read(uint32_t offset, void* buf, size_t len) {
+    return ready && esp_partition_read((const esp_partition_t*)partition, base + offset, buf, len) == ESP_OK;
+}
+
+bool DeviceFlashRegion::program(uint32_t offset, const void* buf, size_t len) {
+    return ready && esp_partition_write((const esp_partition_t*)partition, base + offset, buf, len) == ESP_OK;
+}
+
+bool DeviceFlashRegion::erase(size_t sector) {
+    return ready && sector < count &&
+           esp_partition_erase_range((const esp_partition_t*)partition,
+                                     base + sector * sectorSize(), sectorSize()) == ESP_OK;
+}
+
+#endif
+
+#endif // ARDUINO
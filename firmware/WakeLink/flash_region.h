@@ -0,0 +1,113 @@
+/**
+ * @file flash_region.h
+ * @brief Raw NOR flash regions used by the counter and replay-floor journals.
+ *
+ * FlashRegion models what NOR flash allows: erase whole sectors to 0xFF,
+ * then program individual 4-byte-aligned words (bits only go 1 -> 0).
+ * CounterJournal is written against this interface, so it runs unchanged
+ * on the device and against the file-backed simulator in firmware/host/.
+ *
+ * Device Regions:
+ * - ESP8266: first FLASH_RESERVED_SECTORS sectors of the filesystem
+ *   area (_FS_start). Select a flash layout with an FS region.
+ * - ESP32: first FLASH_RESERVED_SECTORS sectors of the "spiffs" data
+ *   partition from the default partition table.
+ * - The request counter journal takes the first COUNTER_JOURNAL_SECTORS,
+ *   the replay floor journal (replay_window.h) the REPLAY_FLOOR_SECTORS
+ *   after them; each DeviceFlashRegion sees only its own sectors
+ * WakeLink mounts no filesystem, so those sectors are otherwise unused.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Flash sectors reserved for the counter journal
+#define COUNTER_JOURNAL_SECTORS 2
+
+/// @brief Flash sectors reserved for the replay floor journal
+#define REPLAY_FLOOR_SECTORS 2
+
+/// @brief Flash sectors reserved in total, from the start of the FS area
+#define FLASH_RESERVED_SECTORS (COUNTER_JOURNAL_SECTORS + REPLAY_FLOOR_SECTORS)
+
+/**
+ * @brief Sector-erasable, word-programmable flash region.
+ */
+class FlashRegion {
+public:
+    virtual ~FlashRegion() {}
+
+    /** @brief Sector size in bytes (4096 on ESP8266/ESP32). */
+    virtual size_t sectorSize() const = 0;
+
+    /** @brief Number of sectors in the region. */
+    virtual size_t sectorCount() const = 0;
+
+    /**
+     * @brief Read bytes.
+     * @param offset Byte offset in the region (4-byte aligned).
+     * @param buf Output buffer (4-byte aligned).
+     * @param len Length (multiple of 4).
+     * @return true on success.
+     */
+    virtual bool read(uint32_t offset, void* buf, size_t len) = 0;
+
+    /**
+     * @brief Program bytes into erased flash (no erase).
+     * @param offset Byte offset in the region (4-byte aligned).
+     * @param buf Input buffer (4-byte aligned).
+     * @param len Length (multiple of 4).
+     * @return true on success.
+     */
+    virtual bool program(uint32_t offset, const void* buf, size_t len) = 0;
+
+    /**
+     * @brief Erase one sector to 0xFF.
+     * @param sector Sector index in the region.
+     * @return true on success.
+     */
+    virtual bool erase(size_t sector) = 0;
+};
+
+#if defined(ARDUINO)
+
+/**
+ * @brief Reserved area of the device's own SPI flash.
+ */
+class DeviceFlashRegion : public FlashRegion {
+private:
+    size_t first;              ///< First sector inside the reserved area
+    size_t count;              ///< Sectors of this region
+    uint32_t base = 0;         ///< Absolute flash address (ESP8266) or partition offset (ESP32)
+    const void* partition = nullptr; ///< esp_partition_t* on ESP32
+    bool ready = false;        ///< True if a region was found
+
+public:
+    /**
+     * @param firstSector First sector inside the reserved area.
+     * @param sectors Sectors of this region.
+     */
+    DeviceFlashRegion(size_t firstSector, size_t sectors) : first(firstSector), count(sectors) {}
+
+    /**
+     * @brief Locate the reserved region.
+     * @return false if the flash layout has no room for the journal.
+     */
+    bool begin();
+
+    size_t sectorSize() const override { return 4096; }
+    size_t sectorCount() const override { return ready ? count : 0; }
+    bool read(uint32_t offset, void* buf, size_t len) override;
+    bool program(uint32_t offset, const void* buf, size_t len) override;
+    bool erase(size_t sector) override;
+};
+
+#endif // ARDUINO
+
+#endif // FLASH_REGION_H
@@ -0,0 +1,165 @@
+/**
+ * @file fragment.cpp
+ * @brief Fragment header coding and in-order reassembly.
+ */
+
+#include "fragment.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void put_be(uint8_t* p, uint32_t v, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static uint32_t get_be(const uint8_t* p, size_t n) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < n; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+// ==================== HEADER ====================
+
+void FragmentInfo::plan(uint32_t messageId, size_t length) {
+    id = messageId;
+    index = 0;
+    total = (uint16_t)length;
+    count = (uint16_t)((length + FRAGMENT_CHUNK - 1) / FRAGMENT_CHUNK);
+}
+
+size_t FragmentInfo::chunkLength() const {
+    size_t at = offset();
+    if (at >= total) return 0;
+    return total - at < FRAGMENT_CHUNK ? total - at : FRAGMENT_CHUNK;
+}
+
+void FragmentInfo::writeHeader(uint8_t* out) const {
+    out[0] = FRAGMENT_MARKER;
+    out[1] = 0;
+    put_be(out + 2, id, 4);
+    put_be(out + 6, index, 2);
+    put_be(out + 8, count, 2);
+    put_be(out + 10, total, 2);
+}
+
+bool FragmentInfo::readHeader(const uint8_t* in, size_t length) {
+    if (length <= FRAGMENT_HEADER || in[0] != FRAGMENT_MARKER || in[1] != 0) return false;
+    id = get_be(in + 2, 4);
+    index = (uint16_t)get_be(in + 6, 2);
+    count = (uint16_t)get_be(in + 8, 2);
+    total = (uint16_t)get_be(in + 10, 2);
+    return count > 0 && index < count && total > 0;
+}
+
+// ==================== REASSEMBLY ====================
+
+FragmentAssembler::~FragmentAssembler() {
+    for (size_t i = 0; i < FRAGMENT_SLOTS; i++) free(slots[i].buf);
+}
+
+void FragmentAssembler::drop(Slot& slot) {
+    free(slot.buf);
+    slot = Slot();
+}
+
+const char* FragmentAssembler::add(const uint8_t* data, size_t length, uint32_t now, FragmentInfo& info) {
+    release();
+    expire(now);
+
+    if (!info.readHeader(data, length)) return "BAD_FRAGMENT";
+    if (info.total > FRAGMENT_MAX_MESSAGE) return "FRAGMENT_TOO_LARGE";
+
+    const uint8_t* chunk = data + FRAGMENT_HEADER;
+    size_t chunkLen = length - FRAGMENT_HEADER;
+
+    Slot* slot = nullptr;
+    for (size_t i = 0; i < FRAGMENT_SLOTS; i++) {
+        if (slots[i].buf && slots[i].id == info.id) slot = &slots[i];
+    }
+
+    if (!slot) {
+        // Only the first fragment may open a message
+        if (info.index != 0) return "FRAGMENT_OUT_OF_ORDER";
+
+        Slot* oldest = &slots[0];
+        for (size_t i = 0; i < FRAGMENT_SLOTS && !slot; i++) {
+            if (!slots[i].buf) slot = &slots[i];
+            else if ((int32_t)(slots[i].touched - oldest->touched) < 0) oldest = &slots[i];
+        }
+        if (!slot) {
+            drop(*oldest);
+            dropped++;
+            slot = oldest;
+        }
+
+        slot->buf = (uint8_t*)malloc(info.total);
+        if (!slot->buf) return "OUT_OF_MEMORY";
+        slot->id = info.id;
+        slot->count = info.count;
+        slot->total = info.total;
+    } else if (info.count != slot->count || info.total != slot->total) {
+        drop(*slot);
+        dropped++;
+        return "BAD_FRAGMENT";
+    } else if (info.index < slot->next) {
+        return "FRAGMENT_DUPLICATE";
+    } else if (info.index > slot->next) {
+        // A fragment went missing; the message can no longer complete
+        drop(*slot);
+        dropped++;
+        return "FRAGMENT_OUT_OF_ORDER";
+    }
+
+    bool last = info.index + 1 == info.count;
+    if (chunkLen > (size_t)(slot->total - slot->filled) ||
+        (last && slot->filled + chunkLen != slot->total)) {
+        drop(*slot);
+        dropped++;
+        return "BAD_FRAGMENT";
+    }
+
+    memcpy(slot->buf + slot->filled, chunk, chunkLen);
+    slot->filled += (uint16_t)chunkLen;
+    slot->next++;
+    slot->touched = now;
+
+    if (last) {
+        ready = (int)(slot - slots);
+        completed++;
+    }
+    return nullptr;
+}
+
+const uint8_t* FragmentAssembler::message(size_t& length) const {
+    if (ready < 0) {
+        length = 0;
+        return nullptr;
+    }
+    length = slots[ready].total;
+    return slots[ready].buf;
+}
+
+void FragmentAssembler::release() {
+    if (ready < 0) return;
+    drop(slots[ready]);
+    ready = -1;
+}
+
+void FragmentAssembler::expire(uint32_t now) {
+    for (size_t i = 0; i < FRAGMENT_SLOTS; i++) {
+        if (slots[i].buf && (int)i != ready && now - slots[i].touched >= FRAGMENT_TIMEOUT_MS) {
+            drop(slots[i]);
+            dropped++;
+        }
+    }
+}
+
+size_t FragmentAssembler::buffered() const {
+    size_t n = 0;
+    for (size_t i = 0; i < FRAGMENT_SLOTS; i++) {
+        if (slots[i].buf) n += slots[i].total;
+    }
+    return n;
+}
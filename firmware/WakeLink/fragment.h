@@ -0,0 +1,171 @@
+/**
+ * @file fragment.h
+ * @brief Fragmentation of protocol messages larger than one packet.
+ *
+ * A single v1.x payload or v2 frame body carries at most 500 bytes. A
+ * longer message (inner JSON for v1.x, MessagePack map for v2) is cut
+ * into fragments, and every fragment is sealed as an ordinary packet or
+ * frame with its own nonce. The fragment plaintext is:
+ *
+ * - marker 0xC1 (1): never starts JSON, and is the one byte MessagePack
+ *   leaves unused, so fragments and whole messages cannot be confused
+ * - flags (1): 0
+ * - message id (4, BE): random, the same for all fragments of a message
+ * - index (2, BE), count (2, BE)
+ * - total message length (2, BE)
+ * - chunk: the next bytes of the message
+ *
+ * The header is inside the encrypted and authenticated plaintext, so
+ * fragments cannot be relabelled or moved between messages.
+ *
+ * Reassembly (FragmentAssembler):
+ * - Fragments must arrive in order; a duplicate is refused, a gap drops
+ *   the message
+ * - FRAGMENT_SLOTS messages are assembled at once, each in a buffer of
+ *   its announced length (at most FRAGMENT_MAX_MESSAGE); the oldest is
+ *   evicted for a new one and idle slots expire after FRAGMENT_TIMEOUT_MS
+ * - Replay protection runs once, on the "seq" of the completed message
+ *
+ * @note Pure C++; also built on the host (firmware/host/fragment_sim.cpp).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef FRAGMENT_H
+#define FRAGMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief First plaintext byte of every fragment
+#define FRAGMENT_MARKER 0xC1
+
+/// @brief Fragment header size
+#define FRAGMENT_HEADER 12
+
+/// @brief Sealed plaintext per fragment (a v1.0 fragment packet stays under 1 KB)
+#define FRAGMENT_PAYLOAD 384
+
+/// @brief Message bytes per fragment
+#define FRAGMENT_CHUNK (FRAGMENT_PAYLOAD - FRAGMENT_HEADER)
+
+/// @brief Messages up to this size go out as one packet or frame
+#define FRAGMENT_THRESHOLD 500
+
+#ifndef FRAGMENT_MAX_MESSAGE
+/// @brief Largest incoming message that is reassembled
+#define FRAGMENT_MAX_MESSAGE 4096
+#endif
+
+/// @brief Messages reassembled at the same time
+#define FRAGMENT_SLOTS 2
+
+/// @brief A message not completed within this time is dropped
+#define FRAGMENT_TIMEOUT_MS 10000
+
+/**
+ * @brief Fragment header fields.
+ */
+struct FragmentInfo {
+    uint32_t id = 0;      ///< Message id
+    uint16_t index = 0;   ///< Fragment number, from 0
+    uint16_t count = 0;   ///< Fragments in the message
+    uint16_t total = 0;   ///< Message length
+
+    /**
+     * @brief Plan the fragments of an outgoing message.
+     * @param messageId Random message id.
+     * @param length Message length (at most 0xFFFF).
+     */
+    void plan(uint32_t messageId, size_t length);
+
+    /** @brief Message offset of this fragment's chunk (outgoing, FRAGMENT_CHUNK steps). */
+    size_t offset() const { return (size_t)index * FRAGMENT_CHUNK; }
+
+    /** @brief Chunk length of this fragment (outgoing). */
+    size_t chunkLength() const;
+
+    /** @brief Write the FRAGMENT_HEADER bytes. */
+    void writeHeader(uint8_t* out) const;
+
+    /**
+     * @brief Parse a fragment header.
+     * @param in Fragment plaintext.
+     * @param length Plaintext length.
+     * @return false if it is not a well-formed fragment.
+     */
+    bool readHeader(const uint8_t* in, size_t length);
+
+    /** @brief True if plaintext starts with the fragment marker. */
+    static bool isFragment(const uint8_t* in, size_t length) {
+        return length > 0 && in[0] == FRAGMENT_MARKER;
+    }
+};
+
+/**
+ * @brief Bounded in-order reassembly of incoming fragments.
+ */
+class FragmentAssembler {
+private:
+    struct Slot {
+        uint8_t* buf = nullptr;   ///< Message buffer (total bytes), nullptr if free
+        uint32_t id = 0;          ///< Message id
+        uint16_t next = 0;        ///< Next expected index
+        uint16_t count = 0;       ///< Announced fragment count
+        uint16_t total = 0;       ///< Announced message length
+        uint16_t filled = 0;      ///< Bytes received
+        uint32_t touched = 0;     ///< Time of the last fragment
+    };
+
+    Slot slots[FRAGMENT_SLOTS];
+    int ready = -1;               ///< Slot holding a completed message
+
+    uint32_t completed = 0;       ///< Messages reassembled
+    uint32_t dropped = 0;         ///< Messages evicted, expired or broken
+
+    /** @brief Free a slot. */
+    void drop(Slot& slot);
+
+public:
+    FragmentAssembler() = default;
+    ~FragmentAssembler();
+
+    FragmentAssembler(const FragmentAssembler&) = delete;
+    FragmentAssembler& operator=(const FragmentAssembler&) = delete;
+
+    /**
+     * @brief Add one decrypted fragment.
+     *
+     * When the fragment completes its message, message() returns it
+     * until release().
+     *
+     * @param data Fragment plaintext (header and chunk).
+     * @param length Plaintext length.
+     * @param now Current time in ms.
+     * @param info Receives the parsed header (valid unless BAD_FRAGMENT).
+     * @return nullptr if accepted, otherwise the error code.
+     */
+    const char* add(const uint8_t* data, size_t length, uint32_t now, FragmentInfo& info);
+
+    /**
+     * @brief The message completed by the last add(), if any.
+     * @param length Receives its length.
+     * @return Message bytes, or nullptr.
+     */
+    const uint8_t* message(size_t& length) const;
+
+    /** @brief Free the completed message. */
+    void release();
+
+    /** @brief Drop messages idle for FRAGMENT_TIMEOUT_MS. */
+    void expire(uint32_t now);
+
+    /** @brief Bytes held by partial and completed messages. */
+    size_t buffered() const;
+
+    uint32_t getCompleted() const { return completed; }
+    uint32_t getDropped() const { return dropped; }
+};
+
+#endif // FRAGMENT_H
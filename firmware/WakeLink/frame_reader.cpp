@@ -0,0 +1,105 @@
+/**
+ * @file frame_reader.cpp
+ * @brief Buffered receive path with memchr framing.
+ */
+
+#include "frame_reader.h"
+#include <ctype.h>
+#include <string.h>
+
+void FrameReader::reset(const FrameFormat* fmt) {
+    format = fmt;
+    head = tail = scanned = 0;
+    held = 0;
+}
+
+void FrameReader::compact() {
+    size_t unread = tail - head;
+    memmove(buffer, buffer + head, unread);
+    scanned -= head;
+    tail = unread;
+    head = 0;
+    compactions++;
+}
+
+size_t FrameReader::fill(NetConnection& conn) {
+    const size_t capacity = FRAME_READER_SIZE - 1;  // One byte for a final NUL
+    size_t total = 0;
+
+    // Twice at most: the socket may have more than the space behind tail
+    for (int pass = 0; pass < 2; pass++) {
+        int avail = conn.available();
+        if (avail <= 0) break;
+
+        if (held == 0 && head > 0 && tail + (size_t)avail > capacity) compact();
+        size_t space = capacity - tail;
+        if (space == 0) break;
+
+        size_t want = (size_t)avail < space ? (size_t)avail : space;
+        int n = conn.read(buffer + tail, want);
+        if (n <= 0) break;
+        tail += (size_t)n;
+        total += (size_t)n;
+        reads++;
+        if ((size_t)n < want) break;
+    }
+
+    received += total;
+    return total;
+}
+
+FrameStatus FrameReader::next(FrameView& out, bool eof) {
+    for (;;) {
+        size_t avail = tail - head;
+        if (avail == 0) return FRAME_NONE;
+        uint8_t* start = buffer + head;
+
+        if (format && format->marker && start[0] == format->marker) {
+            if (avail < format->header) return eof ? FRAME_INVALID : FRAME_NONE;
+            size_t length = format->lengthOf(start);
+            if (length == 0) return FRAME_INVALID;
+            if (length > FRAME_READER_SIZE - 1) return FRAME_OVERSIZE;
+            if (avail < length) return eof ? FRAME_INVALID : FRAME_NONE;
+
+            head += length;
+            scanned = head;
+            held++;
+            out.data = start;
+            out.length = length;
+            out.frame = true;
+            return FRAME_READY;
+        }
+
+        // Resume where the last search stopped; memchr beats a byte loop
+        size_t end;
+        uint8_t* nl = (uint8_t*)memchr(buffer + scanned, '\n', tail - scanned);
+        if (nl) {
+            end = (size_t)(nl - buffer);
+        } else if (eof) {
+            end = tail;  // Unterminated last packet
+        } else {
+            scanned = tail;
+            return avail >= FRAME_READER_SIZE - 1 ? FRAME_OVERSIZE : FRAME_NONE;
+        }
+
+        size_t consumed = nl ? end + 1 : end;
+        size_t first = head;
+        while (first < end && isspace(buffer[first])) first++;
+        while (end > first && isspace(buffer[end - 1])) end--;
+        head = scanned = consumed;
+
+        if (end == first) continue;  // Blank line
+
+        buffer[end] = '\0';  // Over the newline or trailing whitespace
+        held++;
+        out.data = buffer + first;
+        out.length = end - first;
+        out.frame = false;
+        return FRAME_READY;
+    }
+}
+
+void FrameReader::release() {
+    if (held > 0) held--;
+    if (held == 0 && head == tail) head = tail = scanned = 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file frame_reader.h
+ * @brief Buffered receive path: bulk socket reads, memchr framing, in-place views.
+ *
+ * FrameReader pulls whatever the socket has with one read(buf, n) call
+ * instead of a read() per byte (each goes through WiFiClient and the
+ * lwIP pbuf chain on the device), then cuts messages out of its buffer:
+ *
+ * - A first byte equal to FrameFormat::marker starts a length-prefixed
+ *   frame (v2); its total length comes from the header
+ * - Anything else is a packet up to the next newline, found with memchr;
+ *   it is trimmed and NUL-terminated where it lies
+ *
+ * Messages are handed out as views into the buffer and are decoded in
+ * place by the caller; bytes after a message (the next packet of a
+ * keep-alive connection) stay buffered. The buffer is linear and is
+ * compacted (unread bytes moved to the front) only when a read would
+ * not fit and no view is held, so every message is contiguous.
+ *
+ * @note Pure C++; runs against any NetConnection, also built on the
+ *       host (firmware/host/frame_reader_bench.cpp).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net_connection.h"
+
+#ifndef FRAME_READER_SIZE
+/// @brief Receive buffer of one connection (largest message is one byte less)
+#define FRAME_READER_SIZE 1024
+#endif
+
+/**
+ * @brief Length-prefixed frame format recognised next to newline packets.
+ */
+struct FrameFormat {
+    uint8_t marker = 0;          ///< First byte of a frame (0 = newline packets only)
+    size_t header = 0;           ///< Bytes needed before lengthOf can be called
+    size_t (*lengthOf)(const uint8_t* header) = nullptr; ///< Total length, 0 if invalid
+};
+
+/**
+ * @brief Result of FrameReader::next().
+ */
+enum FrameStatus : uint8_t {
+    FRAME_NONE = 0,    ///< No complete message buffered yet
+    FRAME_READY,       ///< View filled in
+    FRAME_OVERSIZE,    ///< Message cannot fit the buffer
+    FRAME_INVALID      ///< Bad frame header, or frame cut short by EOF
+};
+
+/**
+ * @brief Complete message inside the reader's buffer.
+ */
+struct FrameView {
+    uint8_t* data = nullptr;     ///< First byte (NUL-terminated for packets)
+    size_t length = 0;           ///< Length without terminator
+    bool frame = false;          ///< Length-prefixed frame, not a packet
+};
+
+/**
+ * @brief Per-connection receive buffer with message framing.
+ */
+class FrameReader {
+private:
+    uint8_t buffer[FRAME_READER_SIZE];
+    size_t head = 0;             ///< First byte not yet handed out
+    size_t tail = 0;             ///< End of received bytes
+    size_t scanned = 0;          ///< Newline search resumes here
+    uint8_t held = 0;            ///< Views handed out and not yet released
+    const FrameFormat* format = nullptr;
+
+    uint32_t reads = 0;          ///< read(buf, n) calls that returned data
+    uint32_t compactions = 0;    ///< Times unread bytes were moved to the front
+    uint64_t received = 0;       ///< Bytes read
+
+    /** @brief Move unread bytes to the front of the buffer. */
+    void compact();
+
+public:
+    /**
+     * @brief Empty the buffer and set the frame format.
+     * @param fmt Frame format (must outlive the reader), nullptr for packets only.
+     */
+    void reset(const FrameFormat* fmt);
+
+    /**
+     * @brief Read what the connection has, without waiting.
+     *
+     * At most FRAME_READER_SIZE - 1 bytes are buffered; the rest stays in
+     * the socket until messages are handed out.
+     *
+     * @param conn Connection to read from.
+     * @return Bytes read.
+     */
+    size_t fill(NetConnection& conn);
+
+    /**
+     * @brief Cut the next complete message out of the buffer.
+     *
+     * Blank lines between packets are skipped.
+     *
+     * @param out View of the message; valid until release().
+     * @param eof Peer has closed: an unterminated last packet is
+     *            returned as is, a partial frame is FRAME_INVALID.
+     * @return Status; FRAME_OVERSIZE/FRAME_INVALID leave the stream
+     *         unusable (close the connection).
+     */
+    FrameStatus next(FrameView& out, bool eof = false);
+
+    /** @brief Give back the oldest view handed out by next(). */
+    void release();
+
+    /** @brief Bytes received but not handed out yet. */
+    size_t pending() const { return tail - head; }
+
+    uint32_t getReads() const { return reads; }
+    uint32_t getCompactions() const { return compactions; }
+    uint64_t getReceived() const { return received; }
+};
+
+#endif // FRAME_READER_H
@@ -0,0 +1,179 @@
+/**
+ * @file hex_codec.cpp
+ * @brief Table encoder and validating SWAR/SSSE3 hex decoder.
+ */
+
+#include "hex_codec.h"
+#include <string.h>
+
+#if defined(__SSSE3__)
+  #include <tmmintrin.h>
+#endif
+
+/// Both digits of every byte value, lowercase
+static const char HEX_PAIRS[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+void HexCodec::encodeScalar(const uint8_t* in, size_t len, char* out) {
+    for (size_t i = 0; i < len; i++) {
+        memcpy(out + 2 * i, HEX_PAIRS + 2 * in[i], 2);
+    }
+}
+
+bool HexCodec::decodeScalar(const char* in, size_t len, uint8_t* out) {
+    for (size_t i = 0; i < len; i++) {
+        int8_t hi = nibble(in[2 * i]);
+        int8_t lo = nibble(in[2 * i + 1]);
+        if ((hi | lo) < 0) return false;
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+// ==================== DECODE KERNELS ====================
+
+#if defined(__SSSE3__)
+
+/**
+ * @brief Validate 16 digits and turn them into nibbles.
+ * @return false if any lane is not a hex digit.
+ */
+static inline bool ssse3_nibbles(__m128i c, __m128i& nib) {
+    const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    // Signed compares: characters >= 0x80 are negative and fail both ranges
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                        _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xFFFF) return false;
+
+    nib = _mm_add_epi8(_mm_and_si128(c, _mm_set1_epi8(0x0F)),
+                       _mm_and_si128(alpha, _mm_set1_epi8(9)));
+    return true;
+}
+
+/**
+ * @brief Decode 32 digits into 16 bytes.
+ */
+static inline bool decode_step(const char* in, uint8_t* out) {
+    __m128i n0, n1;
+    if (!ssse3_nibbles(_mm_loadu_si128((const __m128i*)in), n0)) return false;
+    if (!ssse3_nibbles(_mm_loadu_si128((const __m128i*)(in + 16)), n1)) return false;
+
+    // Each 16-bit lane: first digit * 16 + second digit
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(n0, weights),
+                                     _mm_maddubs_epi16(n1, weights));
+    _mm_storeu_si128((__m128i*)out, bytes);
+    return true;
+}
+
+#define HEX_DECODE_STEP 16
+
+#elif !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+typedef uint64_t hex_word_t;
+#else
+typedef uint32_t hex_word_t;
+#endif
+
+static const hex_word_t ONES = (hex_word_t)~(hex_word_t)0 / 0xFF;
+static const hex_word_t HIGH = ONES * 0x80;
+
+/**
+ * @brief Validate sizeof(word) digits and turn them into nibbles.
+ *
+ * Lanes are 7-bit after the high-bit check, so adding a bias below 0x80
+ * never carries into the next lane and bit 7 of each lane holds the
+ * comparison result.
+ *
+ * @return false if any lane is not a hex digit.
+ */
+static inline bool swar_nibbles(hex_word_t x, hex_word_t& nib) {
+    if (x & HIGH) return false;
+
+    const hex_word_t lower = x | (ONES * 0x20);
+    const hex_word_t digit = (x + ONES * (0x80 - '0')) & ~(x + ONES * (0x7F - '9')) & HIGH;
+    const hex_word_t alpha = (lower + ONES * (0x80 - 'a')) & ~(lower + ONES * (0x7F - 'f')) & HIGH;
+    if ((digit | alpha) != HIGH) return false;
+
+    nib = (x & (ONES * 0x0F)) + (alpha >> 7) * 9;
+    return true;
+}
+
+/**
+ * @brief Store the bytes of a nibble word (first digit in the low lane).
+ */
+static inline void swar_store(hex_word_t nib, uint8_t* out) {
+    hex_word_t t = ((nib << 4) | (nib >> 8)) & ((hex_word_t)~(hex_word_t)0 / 0xFFFF * 0xFF);
+#if UINTPTR_MAX > 0xFFFFFFFFu
+    t = (t | (t >> 8)) & 0x0000FFFF0000FFFFull;
+    uint32_t packed = (uint32_t)(t | (t >> 16));
+#else
+    uint16_t packed = (uint16_t)(t | (t >> 8));
+#endif
+    memcpy(out, &packed, sizeof(packed));
+}
+
+static const size_t WORD_DIGITS = sizeof(hex_word_t);
+static const size_t STEP_WORDS = 16 / WORD_DIGITS;
+
+/**
+ * @brief Decode 16 digits into 8 bytes.
+ *
+ * All words are loaded before anything is stored, which keeps in-place
+ * decoding safe.
+ */
+static inline bool decode_step(const char* in, uint8_t* out) {
+    hex_word_t nib[STEP_WORDS];
+    for (size_t w = 0; w < STEP_WORDS; w++) {
+        hex_word_t x;
+        memcpy(&x, in + w * WORD_DIGITS, sizeof(x));
+        if (!swar_nibbles(x, nib[w])) return false;
+    }
+    for (size_t w = 0; w < STEP_WORDS; w++) {
+        swar_store(nib[w], out + w * WORD_DIGITS / 2);
+    }
+    return true;
+}
+
+#define HEX_DECODE_STEP 8
+
+#endif
+
+// ==================== PUBLIC API ====================
+
+void HexCodec::encode(const uint8_t* in, size_t len, char* out) {
+    size_t i = 0;
+#if defined(__SSSE3__)
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    for (; len - i >= 16; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(x, mask));
+        _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    encodeScalar(in + i, len - i, out + 2 * i);
+}
+
+bool HexCodec::decode(const char* in, size_t len, uint8_t* out) {
+    size_t i = 0;
+#ifdef HEX_DECODE_STEP
+    for (; len - i >= HEX_DECODE_STEP; i += HEX_DECODE_STEP) {
+        if (!decode_step(in + 2 * i, out + i)) return false;
+    }
+#endif
+    return decodeScalar(in + 2 * i, len - i, out + i);
+}
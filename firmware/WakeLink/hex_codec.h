@@ -0,0 +1,86 @@
+/**
+ * @file hex_codec.h
+ * @brief Shared hex encoder/decoder for payloads, signatures and config.
+ *
+ * Every hex conversion in the firmware goes through HexCodec:
+ * - Encoding looks up both digits of a byte in one 256-entry pair table
+ *   (lowercase, as the protocol signs the exact text)
+ * - Decoding validates while it converts and accepts upper- and lowercase;
+ *   any other character rejects the whole input
+ * - Decoding may run in place (out == in): a word of digits is always
+ *   read before the shorter run of bytes it produces is stored
+ *
+ * Decode Kernels (selected at compile time):
+ * - SSSE3:  32 digits per step with PSHUFB/PMADDUBSW (host build)
+ * - SWAR64: 16 digits per step in two 64-bit words (64-bit hosts)
+ * - SWAR32: 16 digits per step in four 32-bit words (ESP8266/ESP32)
+ *
+ * Inputs shorter than one step, and big-endian targets, use the
+ * byte-at-a-time path, which doubles as the reference for the host
+ * checks (firmware/host/hex_codec_bench.cpp).
+ *
+ * @note Pure C++ with no Arduino dependencies.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef HEX_CODEC_H
+#define HEX_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSSE3__)
+  #define HEX_CODEC_KERNEL "ssse3"
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  #define HEX_CODEC_KERNEL "scalar"
+#elif UINTPTR_MAX > 0xFFFFFFFFu
+  #define HEX_CODEC_KERNEL "swar64"
+#else
+  #define HEX_CODEC_KERNEL "swar32"
+#endif
+
+/**
+ * @brief Hex conversion helpers (stateless).
+ */
+class HexCodec {
+public:
+    /**
+     * @brief Encode bytes as lowercase hex.
+     * @param in Input bytes.
+     * @param len Number of input bytes.
+     * @param out Receives 2 * len characters (not NUL-terminated).
+     */
+    static void encode(const uint8_t* in, size_t len, char* out);
+
+    /**
+     * @brief Decode and validate hex digits.
+     * @param in 2 * len hex characters.
+     * @param len Number of bytes to produce.
+     * @param out Receives len bytes; may alias in.
+     * @return false on a non-hex character (out is then unspecified).
+     */
+    static bool decode(const char* in, size_t len, uint8_t* out);
+
+    /**
+     * @brief Decode one hex digit.
+     * @return Value 0-15, or -1 for a non-hex character.
+     */
+    static int8_t nibble(char c) {
+        uint8_t v = (uint8_t)c;
+        uint8_t digit = (uint8_t)(v - '0');
+        uint8_t alpha = (uint8_t)((v | 0x20) - 'a');
+        if (digit < 10) return (int8_t)digit;
+        if (alpha < 6) return (int8_t)(alpha + 10);
+        return -1;
+    }
+
+    /** @brief Byte-at-a-time encoder (reference and short tails). */
+    static void encodeScalar(const uint8_t* in, size_t len, char* out);
+
+    /** @brief Byte-at-a-time decoder (reference and short tails). */
+    static bool decodeScalar(const char* in, size_t len, uint8_t* out);
+};
+
+#endif // HEX_CODEC_H
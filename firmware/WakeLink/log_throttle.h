@@ -0,0 +1,75 @@
+/**
+ * @file log_throttle.h
+ * @brief Rate limit for repetitive Serial log lines.
+ *
+ * A flood of bad packets would otherwise print one line per packet, and
+ * at 115200 baud each line costs the loop about a millisecond. A throttle
+ * lets LOG_THROTTLE_LINES lines through per LOG_THROTTLE_WINDOW_MS and
+ * counts the rest; the next line that gets through reports how many
+ * were dropped before it.
+ *
+ * Usage:
+ * @code
+ * if (log.allow(millis())) {
+ *     Serial.printf("[X] Rejected (+%lu suppressed)\n", (unsigned long)log.takeSuppressed());
+ * }
+ * @endcode
+ *
+ * @note Pure C++, header only.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef LOG_THROTTLE_H
+#define LOG_THROTTLE_H
+
+#include <stdint.h>
+
+#ifndef LOG_THROTTLE_WINDOW_MS
+/// @brief Length of one throttle window
+#define LOG_THROTTLE_WINDOW_MS 10000
+#endif
+
+#ifndef LOG_THROTTLE_LINES
+/// @brief Lines printed per window
+#define LOG_THROTTLE_LINES 5
+#endif
+
+/**
+ * @brief Per-window line budget of one log category.
+ */
+class LogThrottle {
+private:
+    uint32_t windowStart = 0;   ///< Start of the current window (ms)
+    uint16_t printed = 0;       ///< Lines let through in the current window
+    uint32_t suppressed = 0;    ///< Lines dropped since the last takeSuppressed()
+
+public:
+    /**
+     * @brief Decide whether a line may be printed now.
+     * @param now Current time (ms).
+     * @return true to print it; false if it was counted as suppressed.
+     */
+    bool allow(uint32_t now) {
+        if (now - windowStart >= LOG_THROTTLE_WINDOW_MS) {
+            windowStart = now;
+            printed = 0;
+        }
+        if (printed < LOG_THROTTLE_LINES) {
+            printed++;
+            return true;
+        }
+        suppressed++;
+        return false;
+    }
+
+    /** @brief Lines dropped since the last call; resets the count. */
+    uint32_t takeSuppressed() {
+        uint32_t n = suppressed;
+        suppressed = 0;
+        return n;
+    }
+};
+
+#endif // LOG_THROTTLE_H
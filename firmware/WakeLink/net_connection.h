@@ -0,0 +1,54 @@
+/**
+ * @file net_connection.h
+ * @brief Non-blocking byte stream used by the TCP connection code.
+ *
+ * ConnectionPool and FrameReader are written against this interface,
+ * so they run unchanged on the device (WiFiConnection in tcp_handler.h)
+ * and over loopback or in-memory streams in firmware/host/.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef NET_CONNECTION_H
+#define NET_CONNECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Non-blocking byte stream (mirrors Arduino's Client).
+ */
+class NetConnection {
+public:
+    virtual ~NetConnection() {}
+
+    /** @brief Bytes that can be read without waiting. */
+    virtual int available() = 0;
+
+    /** @brief Read one byte; -1 if none is available. */
+    virtual int read() = 0;
+
+    /**
+     * @brief Read up to len bytes without waiting.
+     * @return Bytes read (0 if none are available).
+     */
+    virtual int read(uint8_t* buf, size_t len) = 0;
+
+    /** @brief Bytes that can be written without waiting (send window). */
+    virtual size_t writable() = 0;
+
+    /**
+     * @brief Write bytes.
+     * @return Bytes accepted by the socket.
+     */
+    virtual size_t write(const uint8_t* buf, size_t len) = 0;
+
+    /** @brief True while the peer has not closed the connection. */
+    virtual bool connected() = 0;
+
+    /** @brief Close the connection. */
+    virtual void stop() = 0;
+};
+
+#endif // NET_CONNECTION_H
@@ -1,5 +1,9 @@
 #include "packet.h"
 #include "platform.h"
+#include "secure_random.h"
+#include "payload_stream.h"
+#include "hex_codec.h"
+#include "request_arena.h"
 
 extern DeviceConfig cfg;
 extern String DEVICE_ID;
@@ -7,146 +11,536 @@ extern String DEVICE_ID;
 /**
  * @brief Generate short unique request identifier.
  *
- * Creates simple 8-character ID from limited character set.
- * Used to bind response to request.
+ * Creates simple 8-character ID from limited character set, drawn from
+ * the DRBG pool. Used to bind response to request.
  *
- * @return Request ID string.
+ * @param id Receives 8 characters and a NUL.
  */
-String PacketManager::generateRequestId() {
+void PacketManager::generateRequestId(char id[9]) {
     const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    String id = "";
     for (int i = 0; i < 8; ++i) {
-        id += chars[random(0, 36)];
+        id[i] = chars[secureRandom.uniform(36)];
     }
-    return id;
+    id[8] = '\0';
 }
 
 /**
- * @brief Create signed command packet.
+ * @brief Fill the inner document of a command.
  *
- * Assembles internal JSON with command, data, request_id, timestamp.
- * Encrypts internal JSON and forms outer packet via createOuterPacket.
+ * @param inner Document to fill.
+ * @param command Command name.
+ * @param data Command data object.
+ */
+void PacketManager::fillCommand(JsonDocument& inner, const char* command, JsonObject data) {
+    char requestId[9];
+    generateRequestId(requestId);
+
+    inner["command"] = command;
+    inner["data"] = data;
+    inner["request_id"] = (const char*)requestId;
+    inner["timestamp"] = millis();
+}
+
+/**
+ * @brief Create signed command packet in a caller buffer.
+ *
+ * Assembles internal JSON with command, data, request_id, timestamp
+ * in the request arena and seals the outer packet straight into out;
+ * nothing is taken from the heap.
  *
  * @param command Command name.
  * @param data Command data object.
- * @return Serialized signed outer packet.
+ * @param out Output buffer.
+ * @param capacity Size of out.
+ * @return Packet length, or 0 if capacity is too small.
  */
-String PacketManager::createCommandPacket(const String& command, const JsonObject& data) {
-    JsonDocument innerDoc;
-    innerDoc["command"] = command;
-    innerDoc["data"] = data;
-    innerDoc["request_id"] = generateRequestId();
-    innerDoc["timestamp"] = millis();
+size_t PacketManager::createCommandPacket(const char* command, JsonObject data, char* out, size_t capacity) {
+    JsonDocument innerDoc(&requestJson);
+    fillCommand(innerDoc, command, data);
 
-    String encryptedPayload = encryptJson(innerDoc);
-    return createOuterPacket(encryptedPayload);
+    if (measureOuterPacket(innerDoc, PROTOCOL_V1_0) > capacity) return 0;
+    BufferPrint sink((uint8_t*)out, capacity);
+    writeOuterPacket(innerDoc, PROTOCOL_V1_0, sink);
+    return sink.length();
 }
 
 /**
- * @brief Create outer JSON packet.
+ * @brief Create signed command packet as a String.
  *
- * Forms JSON with device_id, payload, signature, counter, and version fields.
- * Signature is computed via crypto.calculateHMAC for payload.
+ * String convenience wrapper; the packet is streamed into a String
+ * reserved at its exact size.
  *
- * @param encryptedPayload Hex-encoded encrypted payload.
- * @return Serialized outer JSON packet.
+ * @param command Command name.
+ * @param data Command data object.
+ * @return Serialized signed outer packet.
  */
-String PacketManager::createOuterPacket(const String& encryptedPayload) {
-    JsonDocument doc;
-    doc["device_id"] = DEVICE_ID;
-    doc["payload"] = encryptedPayload;
-    doc["signature"] = crypto.calculateHMAC(encryptedPayload);
-    doc["request_counter"] = crypto.getRequestCount();
-    doc["version"] = "1.0";
+String PacketManager::createCommandPacket(const String& command, const JsonObject& data) {
+    JsonDocument innerDoc(&requestJson);
+    fillCommand(innerDoc, command.c_str(), data);
 
     String out;
-    serializeJson(doc, out);
+    out.reserve(measureOuterPacket(innerDoc, PROTOCOL_V1_0));
+    StringPrint sink(out);
+    writeOuterPacket(innerDoc, PROTOCOL_V1_0, sink);
     return out;
 }
 
+// Outer packet pieces, shared by writeOuterPacket and measureOuterPacket
+static const char OUTER_OPEN[] = "{\"device_id\":";
+static const char OUTER_PAYLOAD[] = ",\"payload\":\"";
+static const char OUTER_SIGNATURE[] = "\",\"signature\":\"";
+static const char OUTER_COUNTER[] = "\",\"request_counter\":";
+static const char OUTER_COUNTER_NO_SIG[] = ",\"request_counter\":";
+static const char OUTER_VERSION[] = ",\"version\":\"";
+static const char OUTER_CLOSE[] = "\"}";
+
 /**
- * @brief Parse outer JSON packet.
+ * @brief Pick the document that will actually be sealed.
  *
- * Deserializes outer JSON, validates required fields and version.
- * Verifies HMAC signature using crypto.verifyHMAC.
- * Returns JsonDocument with status and encrypted_payload or error.
+ * Documents longer than the 16-bit payload length are replaced by a
+ * RESPONSE_TOO_LARGE error rather than being cut off.
  *
- * @param packet Raw outer JSON packet.
- * @return JsonDocument with parsing result.
+ * @param inner Document to send.
+ * @param fallback Storage for the replacement.
+ * @return inner, or fallback filled with the error.
  */
-JsonDocument PacketManager::parseOuterPacket(const String& packet) {
-    JsonDocument doc, result;
+const JsonDocument& PacketManager::fitPayload(const JsonDocument& inner, JsonDocument& fallback) {
+    if (measureJson(inner) <= PAYLOAD_MAX_PLAIN) return inner;
+    fallback["status"] = "error";
+    fallback["error"] = "RESPONSE_TOO_LARGE";
+    fallback["request_id"] = inner["request_id"];
+    return fallback;
+}
 
-    if (deserializeJson(doc, packet)) {
-        result["status"] = "error";
-        result["error"] = "JSON_PARSE";
-        return result;
+/**
+ * @brief Number of decimal digits of a counter value.
+ */
+static size_t decimal_length(uint32_t v) {
+    size_t n = 1;
+    while (v >= 10) {
+        v /= 10;
+        n++;
     }
+    return n;
+}
 
-    String payload = doc["payload"] | "";
-    String sig = doc["signature"] | "";
-    String version = doc["version"] | "";
+/**
+ * @brief Stream a sealed outer packet.
+ *
+ * Emits {device_id, payload, signature (v1.0 only), request_counter,
+ * version}. The payload is produced by PayloadStream while the inner
+ * document is serialized, so only fixed-size buffers are used.
+ *
+ * @param inner Inner document to seal.
+ * @param version PROTOCOL_V1_1 for AEAD, anything else for v1.0.
+ * @param out Destination.
+ * @return Characters written.
+ */
+size_t PacketManager::writeOuterPacket(const JsonDocument& inner, const char* version, Print& out) {
+    JsonDocument tooLarge(&requestJson);
+    const JsonDocument& doc = fitPayload(inner, tooLarge);
+    return writeOuter(doc, nullptr, strcmp(version, PROTOCOL_V1_1) == 0, out);
+}
 
-    if (version != "1.0" || payload.isEmpty() || sig.isEmpty()) {
-        result["status"] = "error";
-        result["error"] = "BAD_PACKET";
-        return result;
+/**
+ * @brief Stream an outer packet around doc or one fragment of it.
+ *
+ * For a fragment, the sealed plaintext is the fragment header followed
+ * by the window of doc's JSON text that the fragment covers.
+ *
+ * @param doc Inner document (at most PAYLOAD_MAX_PLAIN bytes of JSON).
+ * @param fragment Fragment to emit, or nullptr for the whole document.
+ * @param aead v1.1 instead of v1.0.
+ * @param out Destination.
+ * @return Characters written.
+ */
+size_t PacketManager::writeOuter(const JsonDocument& doc, const FragmentInfo* fragment, bool aead, Print& out) {
+    size_t n = writeOuterHead(out);
+
+    PayloadStream payload(crypto, out, aead);
+    if (fragment) {
+        uint8_t header[FRAGMENT_HEADER];
+        fragment->writeHeader(header);
+        payload.begin(FRAGMENT_HEADER + fragment->chunkLength());
+        payload.write(header, sizeof(header));
+        WindowPrint window(payload, fragment->offset(), fragment->chunkLength());
+        serializeJson(doc, window);
+    } else {
+        payload.begin(measureJson(doc));
+        serializeJson(doc, payload);
     }
+    uint8_t mac[32];
+    payload.end(mac);
+    n += payload.written();
 
-    if (!crypto.verifyHMAC(payload, sig)) {
-        Serial.printf("[SIGN] Expected: %s\n", crypto.calculateHMAC(payload).c_str());
-        Serial.printf("[SIGN] Received: %s\n", sig.c_str());
-        result["status"] = "error";
-        result["error"] = "INVALID_SIGNATURE";
-        return result;
+    return n + writeOuterTail(mac, aead, out);
+}
+
+/**
+ * @brief Stream the outer packet up to the opening quote of the payload.
+ *
+ * @param out Destination.
+ * @return Characters written.
+ */
+size_t PacketManager::writeOuterHead(Print& out) {
+    JsonDocument id(&requestJson);
+    id.set(DEVICE_ID);
+
+    size_t n = out.print(OUTER_OPEN);
+    n += serializeJson(id, out);
+    n += out.print(OUTER_PAYLOAD);
+    return n;
+}
+
+/**
+ * @brief Stream the outer packet after the payload.
+ *
+ * @param mac v1.0 HMAC of the hex payload (ignored for v1.1).
+ * @param aead v1.1 instead of v1.0.
+ * @param out Destination.
+ * @return Characters written.
+ */
+size_t PacketManager::writeOuterTail(const uint8_t mac[32], bool aead, Print& out) {
+    size_t n = 0;
+    if (aead) {
+        n += out.print('"');
+        n += out.print(OUTER_COUNTER_NO_SIG);
+    } else {
+        char sig[64];
+        HexCodec::encode(mac, 32, sig);
+        n += out.print(OUTER_SIGNATURE);
+        n += out.write((const uint8_t*)sig, sizeof(sig));
+        n += out.print(OUTER_COUNTER);
     }
 
-    Serial.println("[SIGN] Signature OK");
+    n += out.print((unsigned long)crypto.getRequestCount());
+    n += out.print(OUTER_VERSION);
+    n += out.print(aead ? PROTOCOL_V1_1 : PROTOCOL_V1_0);
+    n += out.print(OUTER_CLOSE);
+    return n;
+}
 
-    result["status"] = "success";
-    result["encrypted_payload"] = payload;
-    return result;
+/**
+ * @brief Exact length writeOuterPacket will produce right now.
+ *
+ * @param inner Inner document.
+ * @param version Protocol version.
+ * @return Characters.
+ */
+size_t PacketManager::measureOuterPacket(const JsonDocument& inner, const char* version) {
+    JsonDocument tooLarge(&requestJson);
+    const JsonDocument& doc = fitPayload(inner, tooLarge);
+    return outerLength(measureJson(doc), strcmp(version, PROTOCOL_V1_1) == 0);
 }
 
 /**
- * @brief Process incoming encrypted packet.
+ * @brief Length of an outer packet sealing plainLen bytes.
  *
- * Parses outer packet, decrypts internal JSON via crypto.processSecurePacket.
- * Validates internal JSON structure (presence of command field).
- * Returns JsonDocument with status and data/error.
+ * @param plainLen Plaintext length.
+ * @param aead v1.1 instead of v1.0.
+ * @return Characters.
+ */
+size_t PacketManager::outerLength(size_t plainLen, bool aead) {
+    JsonDocument id(&requestJson);
+    id.set(DEVICE_ID);
+
+    size_t n = strlen(OUTER_OPEN) + measureJson(id) + strlen(OUTER_PAYLOAD);
+    n += PayloadStream::hexLength(plainLen, aead);
+    n += aead ? 1 + strlen(OUTER_COUNTER_NO_SIG) : strlen(OUTER_SIGNATURE) + 64 + strlen(OUTER_COUNTER);
+    n += decimal_length(crypto.getRequestCount());
+    n += strlen(OUTER_VERSION) + strlen(aead ? PROTOCOL_V1_1 : PROTOCOL_V1_0) + strlen(OUTER_CLOSE);
+    return n;
+}
+
+/**
+ * @brief Skip JSON whitespace.
+ */
+static const char* json_skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+/**
+ * @brief Skip a JSON string starting at its opening quote.
+ * @return Pointer past the closing quote, or nullptr if unterminated.
+ */
+static const char* json_skip_string(const char* p, const char* end) {
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Skip any JSON value (string, number, literal, object, array).
+ * @return Pointer past the value, or nullptr if malformed.
+ */
+static const char* json_skip_value(const char* p, const char* end) {
+    if (p >= end) return nullptr;
+    if (*p == '"') return json_skip_string(p, end);
+    if (*p != '{' && *p != '[') {
+        const char* start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+               *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+        return p > start ? p : nullptr;
+    }
+
+    // Nested container: track depth, strings may contain brackets
+    int depth = 0;
+    while (p < end) {
+        if (*p == '"') {
+            p = json_skip_string(p, end);
+            if (!p) return nullptr;
+            continue;
+        }
+        if (*p == '{' || *p == '[') depth++;
+        else if (*p == '}' || *p == ']') {
+            if (--depth == 0) return p + 1;
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Locate top-level string members of the outer envelope in place.
  *
- * @param packetData Raw incoming packet.
- * @return JsonDocument with processing result.
+ * Only "payload", "signature" and "version" are picked up; other members
+ * (device_id, request_counter, ...) are skipped without being copied.
+ * Escaped strings never match, since none of these fields may contain one.
+ *
+ * @return false if the text is not a JSON object.
  */
-JsonDocument PacketManager::processIncomingPacket(const String& packetData) {
-    JsonDocument result;
-    
-    JsonDocument outerResult = parseOuterPacket(packetData);
-    if (outerResult["status"] != "success") {
-        return outerResult;
+static bool scan_outer_packet(char* json, size_t length,
+                              char*& payload, size_t& payloadLen,
+                              const char*& sig, size_t& sigLen,
+                              const char*& version, size_t& versionLen) {
+    const char* end = json + length;
+    const char* p = json_skip_ws(json, end);
+    if (p >= end || *p != '{') return false;
+    p = json_skip_ws(p + 1, end);
+    if (p < end && *p == '}') return true;
+
+    while (p < end) {
+        if (*p != '"') return false;
+        const char* key = p + 1;
+        p = json_skip_string(p, end);
+        if (!p) return false;
+        size_t keyLen = (size_t)(p - 1 - key);
+
+        p = json_skip_ws(p, end);
+        if (p >= end || *p != ':') return false;
+        p = json_skip_ws(p + 1, end);
+
+        const char* value = p;
+        p = json_skip_value(p, end);
+        if (!p) return false;
+
+        if (*value == '"' && !memchr(value + 1, '\\', (size_t)(p - 2 - value))) {
+            size_t valueLen = (size_t)(p - 2 - value);
+            if (keyLen == 7 && memcmp(key, "payload", 7) == 0) {
+                payload = (char*)(value + 1);
+                payloadLen = valueLen;
+            } else if (keyLen == 9 && memcmp(key, "signature", 9) == 0) {
+                sig = value + 1;
+                sigLen = valueLen;
+            } else if (keyLen == 7 && memcmp(key, "version", 7) == 0) {
+                version = value + 1;
+                versionLen = valueLen;
+            }
+        }
+
+        p = json_skip_ws(p, end);
+        if (p < end && *p == ',') {
+            p = json_skip_ws(p + 1, end);
+            continue;
+        }
+        return p < end && *p == '}';
     }
+    return false;
+}
+
+/**
+ * @brief Parse outer JSON packet in place.
+ *
+ * Scans the outer envelope without building a document and validates
+ * required fields and version. For v1.0, verifies HMAC signature using
+ * the binary crypto.verifyHMAC path over the payload as it lies in the
+ * receive buffer. v1.1 has no signature field; its AEAD tag is checked
+ * on decryption.
+ *
+ * @param packet Raw outer JSON packet (not modified).
+ * @param length Length of packet.
+ * @param payload Receives a pointer to the hex payload inside packet.
+ * @param payloadLen Receives the payload length.
+ * @param version Receives PROTOCOL_V1_0 / PROTOCOL_V1_1 once known.
+ * @return nullptr on success, otherwise the error code.
+ */
+const char* PacketManager::parseOuterPacket(char* packet, size_t length,
+                                            char*& payload, size_t& payloadLen,
+                                            const char*& version) {
+    const char* sig = nullptr;
+    const char* ver = nullptr;
+    size_t sigLen = 0, verLen = 0;
+    payload = nullptr;
+    payloadLen = 0;
+    version = nullptr;
+
+    if (!scan_outer_packet(packet, length, payload, payloadLen, sig, sigLen, ver, verLen)) {
+        return "JSON_PARSE";
+    }
+
+    if (ver && verLen == 3 && memcmp(ver, PROTOCOL_V1_1, 3) == 0) {
+        if (payloadLen == 0) return "BAD_PACKET";
+        version = PROTOCOL_V1_1;
+        return nullptr;
+    }
+
+    if (!ver || verLen != 3 || memcmp(ver, PROTOCOL_V1_0, 3) != 0 ||
+        payloadLen == 0 || sigLen == 0) {
+        return "BAD_PACKET";
+    }
+
+    version = PROTOCOL_V1_0;
+    if (!crypto.verifyHMAC((const uint8_t*)payload, payloadLen, sig, sigLen)) {
+        if (failureLog.allow(millis())) {
+            Serial.printf("[SIGN] Signature FAILED (%lu rejected, +%lu suppressed)\n",
+                          (unsigned long)crypto.getSignatureFailures(),
+                          (unsigned long)failureLog.takeSuppressed());
+        }
+        return "INVALID_SIGNATURE";
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Process incoming encrypted packet in the receive buffer.
+ *
+ * Locates the payload inside packet, then hex-decodes and decrypts it in
+ * place via crypto.processSecurePacket (v1.0) or crypto.processAeadPacket
+ * (v1.1). The only copy is the inner JSON going into the result document.
+ * Validates internal JSON structure (presence of command field), then
+ * checks "sender"/"seq" against the replay window. v1.0 packets without
+ * "seq" (older clients) are checked on request_id/timestamp instead.
+ * Fills result with status and data/error. A fragment is handed
+ * to the assembler; the result is "pending" until its message completes.
+ *
+ * @param packet Raw incoming packet; overwritten by decoding.
+ * @param length Length of packet.
+ * @param result Receives the processing result (cleared first).
+ */
+void PacketManager::processIncomingPacket(char* packet, size_t length, JsonDocument& result) {
+    uint32_t startCycles = ESP.getCycleCount();
+    uint32_t startHeap = ESP.getFreeHeap();
+    result.clear();
     
-    String encryptedPayload = outerResult["encrypted_payload"];
-    
-    String decrypted = crypto.processSecurePacket(encryptedPayload);
-    if (decrypted.startsWith("ERROR:")) {
+    char* payload;
+    size_t payloadLen;
+    const char* version;
+    const char* error = parseOuterPacket(packet, length, payload, payloadLen, version);
+    if (error) {
         result["status"] = "error";
-        result["error"] = decrypted;
-        return result;
+        result["error"] = error;
+        if (version) result["version"] = version;
+        return;
     }
     
-    DeserializationError error = deserializeJson(result, decrypted);
+    bool aead = strcmp(version, PROTOCOL_V1_1) == 0;
+    char* decrypted;
+    size_t decryptedLen;
+    error = aead
+        ? crypto.processAeadPacket(payload, payloadLen, decrypted, decryptedLen)
+        : crypto.processSecurePacket(payload, payloadLen, decrypted, decryptedLen);
     if (error) {
+        result["status"] = "error";
+        result["error"] = error;
+        result["version"] = version;
+        return;
+    }
+    
+    const uint8_t* plain = (const uint8_t*)decrypted;
+    size_t plainLen = decryptedLen;
+    bool fragmented = FragmentInfo::isFragment(plain, plainLen);
+    if (fragmented && !takeFragment(plain, plainLen, version, result)) return;
+
+    DeserializationError jsonError = deserializeJson(result, (const char*)plain, plainLen);
+    if (fragmented) fragments.release();
+    if (jsonError || !result.is<JsonObject>()) {
+        // A non-object root (or a partial one) cannot take members
+        result.clear();
         result["status"] = "error";
         result["error"] = "INVALID_JSON";
-        result["raw_error"] = error.c_str();
-        return result;
+        result["version"] = version;
+        if (jsonError) result["raw_error"] = jsonError.c_str();
+        return;
     }
     
+    result["version"] = version;
+    finishIncoming(result, fragmented);
+
+    rxCyclesLast = ESP.getCycleCount() - startCycles;
+    uint32_t heapNow = ESP.getFreeHeap();
+    rxHeapLast = startHeap > heapNow ? startHeap - heapNow : 0;
+}
+
+/**
+ * @brief Process incoming encrypted packet into a new arena document.
+ *
+ * @param packet Raw incoming packet; overwritten by decoding.
+ * @param length Length of packet.
+ * @return JsonDocument with processing result.
+ */
+JsonDocument PacketManager::processIncomingPacket(char* packet, size_t length) {
+    JsonDocument result(&requestJson);
+    processIncomingPacket(packet, length, result);
+    return result;
+}
+
+/**
+ * @brief Common checks on a decoded inner document.
+ *
+ * Requires a command, runs the replay window and normalizes "data" to
+ * an object. "seq" is required except on unfragmented v1.0 packets,
+ * which may use the legacy request_id/timestamp check instead
+ * (replay_window.h).
+ *
+ * @param result Decoded inner document; status/error are set here.
+ * @param requireSeq Reject a message without "seq" whatever its version.
+ */
+void PacketManager::finishIncoming(JsonDocument& result, bool requireSeq) {
     if (result["command"].isNull()) {
         result["status"] = "error";
         result["error"] = "NO_COMMAND";
-        return result;
+        return;
+    }
+
+    // Sequence numbers are inside the authenticated payload, so only the key holder can pick them
+    JsonVariant seq = result["seq"];
+    bool legacy = strcmp(result["version"] | "", PROTOCOL_V1_0) == 0;
+    if (seq.isNull() && (requireSeq || !legacy)) {
+        result["status"] = "error";
+        result["error"] = "NO_SEQUENCE";
+        return;
+    }
+    uint64_t number = seq.isNull() ? result["timestamp"].as<uint64_t>() : seq.as<uint64_t>();
+    ReplayVerdict verdict = seq.isNull()
+        ? crypto.acceptLegacy(result["request_id"] | "", number)
+        : crypto.acceptSequence(result["sender"] | "", number);
+    if (verdict != REPLAY_OK) {
+        if (failureLog.allow(millis())) {
+            Serial.printf("[REPLAY] Rejected %s %llu (%s, +%lu suppressed)\n",
+                          seq.isNull() ? "timestamp" : "seq", (unsigned long long)number,
+                          ReplayGuard::verdictName(verdict), (unsigned long)failureLog.takeSuppressed());
+        }
+        result["status"] = "error";
+        result["error"] = "REPLAY_DETECTED";
+        result["replay"] = ReplayGuard::verdictName(verdict);
+        return;
     }
     
     JsonVariant dataVar = result["data"];
@@ -155,32 +549,380 @@ JsonDocument PacketManager::processIncomingPacket(const String& packetData) {
     }
     
     result["status"] = "success";
+
+    // Counted (and journaled) only once the request is known to be new
+    crypto.incrementCounter();
+    if (requestLog.allow(millis())) {
+        Serial.printf("Request processed (%s) | Total: %lu (+%lu suppressed)\n",
+                      result["version"] | "?", (unsigned long)crypto.getRequestCount(),
+                      (unsigned long)requestLog.takeSuppressed());
+    }
+}
+
+/**
+ * @brief Hand a decrypted fragment to the assembler.
+ *
+ * Non-final fragments produce a "pending" result echoing the fragment
+ * header so the sender can pace itself; rejected ones an error.
+ *
+ * @param plain Fragment plaintext; on completion the whole message.
+ * @param length Its length; on completion the message length.
+ * @param version Protocol version of the fragment.
+ * @param result Pending or error result when false is returned.
+ * @return true if a complete message is ready.
+ */
+bool PacketManager::takeFragment(const uint8_t*& plain, size_t& length, const char* version,
+                                 JsonDocument& result) {
+    FragmentInfo info;
+    const char* error = fragments.add(plain, length, millis(), info);
+    result["version"] = version;
+    if (error) {
+        if (failureLog.allow(millis())) {
+            Serial.printf("[FRAG] Rejected fragment (%s, +%lu suppressed)\n",
+                          error, (unsigned long)failureLog.takeSuppressed());
+        }
+        result["status"] = "error";
+        result["error"] = error;
+        return false;
+    }
+
+    plain = fragments.message(length);
+    if (plain) return true;
+
+    result["status"] = "pending";
+    JsonObject fragment = result["fragment"].to<JsonObject>();
+    fragment["id"] = info.id;
+    fragment["index"] = info.index;
+    fragment["count"] = info.count;
+    return false;
+}
+
+// ==================== PROTOCOL V2 ====================
+
+/// @brief Read a big-endian integer of n bytes.
+static uint64_t read_be(const uint8_t* p, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+/// @brief Write a big-endian integer of n bytes.
+static void write_be(uint8_t* p, uint64_t v, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+/**
+ * @brief v2 device-id hash, computed once.
+ *
+ * Lets the relay and the device drop frames meant for another device
+ * without touching the crypto.
+ *
+ * @return First 4 bytes of SHA256(DEVICE_ID), big endian.
+ */
+uint32_t PacketManager::getDeviceIdHash() {
+    if (!deviceIdHashed) {
+        uint8_t hash[32];
+        CryptoBackend::sha256((const uint8_t*)DEVICE_ID.c_str(), DEVICE_ID.length(), hash);
+        deviceIdHash = (uint32_t)read_be(hash, 4);
+        deviceIdHashed = true;
+    }
+    return deviceIdHash;
+}
+
+/**
+ * @brief Total frame length announced by a v2 header.
+ *
+ * @param header At least FRAME_V2_HEADER bytes.
+ * @return Header + body + tag, or 0 if the body length is out of range.
+ */
+size_t PacketManager::frameLength(const uint8_t* header) {
+    size_t bodyLen = (size_t)read_be(header + 26, 2);
+    if (bodyLen > FRAME_V2_MAX_BODY) return 0;
+    return FRAME_V2_HEADER + bodyLen + FRAME_V2_TAG;
+}
+
+/**
+ * @brief Process an incoming v2 binary frame in its receive buffer.
+ *
+ * Header layout: version, flags, device hash (4), counter (8), nonce (12),
+ * body length (2). The header counter becomes "seq" of the inner document,
+ * so v2 requests always go through the replay window. A reassembled
+ * fragmented request uses the "seq" of its inner map instead.
+ *
+ * @param frame Complete frame; the body is decrypted in place.
+ * @param length Frame length.
+ * @param result Receives status and command/data or error (cleared first).
+ */
+void PacketManager::processIncomingFrame(uint8_t* frame, size_t length, JsonDocument& result) {
+    uint32_t startCycles = ESP.getCycleCount();
+    uint32_t startHeap = ESP.getFreeHeap();
+    result.clear();
+    result["version"] = PROTOCOL_V2;
+
+    if (length < FRAME_V2_HEADER + FRAME_V2_TAG || frame[0] != FRAME_V2_VERSION) {
+        result["status"] = "error";
+        result["error"] = "INVALID_FRAME";
+        return;
+    }
+    if (frameLength(frame) != length) {
+        result["status"] = "error";
+        result["error"] = "INVALID_LENGTH";
+        return;
+    }
+    if (frame[1] & FRAME_V2_FLAG_RESPONSE) {
+        result["status"] = "error";
+        result["error"] = "INVALID_FRAME";
+        return;
+    }
+    if ((uint32_t)read_be(frame + 2, 4) != getDeviceIdHash()) {
+        result["status"] = "error";
+        result["error"] = "WRONG_DEVICE";
+        return;
+    }
+
+    uint8_t* body = frame + FRAME_V2_HEADER;
+    size_t bodyLen = length - FRAME_V2_HEADER - FRAME_V2_TAG;
+    const char* error = crypto.openFrame(frame + 14, frame, FRAME_V2_HEADER,
+                                         body, bodyLen, body + bodyLen);
+    if (error) {
+        result["status"] = "error";
+        result["error"] = error;
+        return;
+    }
+
+    const uint8_t* plain = body;
+    size_t plainLen = bodyLen;
+    bool fragmented = FragmentInfo::isFragment(plain, plainLen);
+    if (fragmented && !takeFragment(plain, plainLen, PROTOCOL_V2, result)) return;
+
+    DeserializationError msgpackError = deserializeMsgPack(result, (const char*)plain, plainLen);
+    if (fragmented) fragments.release();
+    if (msgpackError || !result.is<JsonObject>()) {
+        result.clear();
+        result["status"] = "error";
+        result["error"] = "INVALID_MSGPACK";
+        result["version"] = PROTOCOL_V2;
+        if (msgpackError) result["raw_error"] = msgpackError.c_str();
+        return;
+    }
+
+    result["version"] = PROTOCOL_V2;
+    if (fragmented) {
+        // Fragment counters are not sequenced; the message brings its own "seq"
+        finishIncoming(result, true);
+    } else {
+        result["seq"] = read_be(frame + 6, 8);
+        finishIncoming(result);
+    }
+
+    rxCyclesLast = ESP.getCycleCount() - startCycles;
+    uint32_t heapNow = ESP.getFreeHeap();
+    rxHeapLast = startHeap > heapNow ? startHeap - heapNow : 0;
+}
+
+/**
+ * @brief Process an incoming v2 frame into a new arena document.
+ *
+ * @param frame Complete frame; the body is decrypted in place.
+ * @param length Frame length.
+ * @return JsonDocument with status and command/data or error.
+ */
+JsonDocument PacketManager::processIncomingFrame(uint8_t* frame, size_t length) {
+    JsonDocument result(&requestJson);
+    processIncomingFrame(frame, length, result);
     return result;
 }
 
 /**
- * @brief Create encrypted response packet.
+ * @brief Build an encrypted v2 response frame.
+ *
+ * Serializes the result as MessagePack straight into the body area of
+ * out, then seals it in place with a fresh DRBG nonce. A result larger
+ * than FRAME_V2_MAX_BODY is replaced by a RESPONSE_TOO_LARGE error.
+ *
+ * @param resultData Response data.
+ * @param out Output buffer.
+ * @param capacity Size of out.
+ * @return Frame length, or 0 if capacity is too small.
+ */
+size_t PacketManager::createResponseFrame(const JsonDocument& resultData, uint8_t* out, size_t capacity) {
+    if (capacity < FRAME_V2_HEADER + FRAME_V2_TAG) return 0;
+    size_t maxBody = capacity - FRAME_V2_HEADER - FRAME_V2_TAG;
+    if (maxBody > FRAME_V2_MAX_BODY) maxBody = FRAME_V2_MAX_BODY;
+
+    uint8_t* body = out + FRAME_V2_HEADER;
+    size_t bodyLen = 0;
+    if (measureMsgPack(resultData) <= maxBody) {
+        bodyLen = serializeMsgPack(resultData, body, maxBody);
+    } else {
+        JsonDocument tooLarge(&requestJson);
+        tooLarge["status"] = "error";
+        tooLarge["error"] = "RESPONSE_TOO_LARGE";
+        if (measureMsgPack(tooLarge) > maxBody) return 0;
+        bodyLen = serializeMsgPack(tooLarge, body, maxBody);
+    }
+
+    return sealResponseFrame(out, bodyLen);
+}
+
+/**
+ * @brief Write the v2 response header and seal the body in place.
  *
- * Encrypts JsonDocument result and forms outer signed packet.
+ * @param out Frame buffer; the body is already at FRAME_V2_HEADER.
+ * @param bodyLen Body length.
+ * @return Frame length.
+ */
+size_t PacketManager::sealResponseFrame(uint8_t* out, size_t bodyLen) {
+    uint8_t* body = out + FRAME_V2_HEADER;
+    out[0] = FRAME_V2_VERSION;
+    out[1] = FRAME_V2_FLAG_RESPONSE;
+    write_be(out + 2, getDeviceIdHash(), 4);
+    write_be(out + 6, crypto.getRequestCount(), 8);
+    secureRandom.fill(out + 14, 12);
+    write_be(out + 26, bodyLen, 2);
+
+    crypto.sealFrame(out + 14, out, FRAME_V2_HEADER, body, bodyLen, body + bodyLen);
+    return FRAME_V2_HEADER + bodyLen + FRAME_V2_TAG;
+}
+
+// ==================== FRAGMENTED RESPONSES ====================
+
+/**
+ * @brief Decide whether a response is sent in fragments.
+ *
+ * @param resultData Response data.
+ * @param version Request version (MessagePack size for v2, JSON otherwise).
+ * @param info Receives count, total and a random message id.
+ * @return true if the response needs more than one packet or frame.
+ */
+bool PacketManager::planFragments(const JsonDocument& resultData, const char* version, FragmentInfo& info) {
+    bool frame = strcmp(version, PROTOCOL_V2) == 0;
+    size_t length = frame ? measureMsgPack(resultData) : measureJson(resultData);
+    // Beyond the 16-bit length the single-packet path answers RESPONSE_TOO_LARGE
+    if (length <= FRAGMENT_THRESHOLD || length > PAYLOAD_MAX_PLAIN) return false;
+
+    uint8_t id[4];
+    secureRandom.fill(id, sizeof(id));
+    info.plan((uint32_t)read_be(id, sizeof(id)), length);
+    return true;
+}
+
+/**
+ * @brief Build the v2 frame carrying fragment info.index.
+ *
+ * The result is re-encoded through a window that keeps only this
+ * fragment's chunk, written straight into the frame body.
+ *
+ * @param resultData Response data.
+ * @param info Fragment plan with index set.
+ * @param out Output buffer.
+ * @param capacity Size of out.
+ * @return Frame length, or 0 if capacity is too small.
+ */
+size_t PacketManager::createResponseFragment(const JsonDocument& resultData, const FragmentInfo& info,
+                                             uint8_t* out, size_t capacity) {
+    size_t chunkLen = info.chunkLength();
+    size_t bodyLen = FRAGMENT_HEADER + chunkLen;
+    if (capacity < FRAME_V2_HEADER + bodyLen + FRAME_V2_TAG) return 0;
+
+    uint8_t* body = out + FRAME_V2_HEADER;
+    info.writeHeader(body);
+    BufferPrint chunk(body + FRAGMENT_HEADER, chunkLen);
+    WindowPrint window(chunk, info.offset(), chunkLen);
+    serializeMsgPack(resultData, window);
+
+    return sealResponseFrame(out, bodyLen);
+}
+
+/**
+ * @brief Stream the v1.x packet carrying fragment info.index.
+ *
+ * @param resultData Response data.
+ * @param version Protocol version of the request.
+ * @param info Fragment plan with index set.
+ * @param out Destination.
+ * @return Characters written.
+ */
+size_t PacketManager::writeResponseFragment(const JsonDocument& resultData, const char* version,
+                                            const FragmentInfo& info, Print& out) {
+    return writeOuter(resultData, &info, strcmp(version, PROTOCOL_V1_1) == 0, out);
+}
+
+/**
+ * @brief Length of the packet writeResponseFragment would stream.
+ *
+ * @param info Fragment plan with index set.
+ * @param version Protocol version of the request.
+ * @return Characters.
+ */
+size_t PacketManager::measureResponseFragment(const FragmentInfo& info, const char* version) {
+    return outerLength(FRAGMENT_HEADER + info.chunkLength(), strcmp(version, PROTOCOL_V1_1) == 0);
+}
+
+// ==================== WHOLE RESPONSES ====================
+
+/**
+ * @brief Stream an encrypted response packet.
+ *
+ * Seals the result in the version the request arrived in (signed for
+ * v1.0, AEAD for v1.1) straight into out; no intermediate copies.
  *
  * @param resultData Result data to send.
- * @return Serialized signed outer packet.
+ * @param version Protocol version of the request.
+ * @param out Destination (e.g. the WiFiClient).
+ * @return Characters written.
+ */
+size_t PacketManager::writeResponse(const JsonDocument& resultData, const char* version, Print& out) {
+    return writeOuterPacket(resultData, version, out);
+}
+
+/**
+ * @brief Length of the packet writeResponse would stream.
+ *
+ * @param resultData Result data to send.
+ * @param version Protocol version of the request.
+ * @return Characters writeResponse will write.
  */
-String PacketManager::createResponsePacket(const JsonDocument& resultData) {
-    String encryptedPayload = encryptJson(resultData);
-    return createOuterPacket(encryptedPayload);
+size_t PacketManager::measureResponse(const JsonDocument& resultData, const char* version) {
+    return measureOuterPacket(resultData, version);
 }
 
 /**
- * @brief Encrypt JSON document.
+ * @brief Create encrypted response packet in a caller buffer.
  *
- * Serializes json to string and calls crypto.createSecureResponse to get hex packet.
+ * Same bytes as writeResponse, sealed straight into out.
  *
- * @param json JSON document to encrypt.
- * @return Hex-encoded encrypted payload.
+ * @param resultData Result data to send.
+ * @param version Protocol version of the request.
+ * @param out Output buffer.
+ * @param capacity Size of out (measureResponse() is enough).
+ * @return Packet length, or 0 if capacity is too small.
  */
-String PacketManager::encryptJson(const JsonDocument& json) {
-    String plaintext;
-    serializeJson(json, plaintext);
-    return crypto.createSecureResponse(plaintext);
-}
\ No newline at end of file
+size_t PacketManager::createResponsePacket(const JsonDocument& resultData, const char* version,
+                                           char* out, size_t capacity) {
+    if (measureOuterPacket(resultData, version) > capacity) return 0;
+    BufferPrint sink((uint8_t*)out, capacity);
+    writeOuterPacket(resultData, version, sink);
+    return sink.length();
+}
+
+/**
+ * @brief Create encrypted response packet as a String.
+ *
+ * For transports that need the whole message at once (WebSocket text
+ * frames); the String is reserved at its final size.
+ *
+ * @param resultData Result data to send.
+ * @param version Protocol version of the request.
+ * @return Serialized outer packet.
+ */
+String PacketManager::createResponsePacket(const JsonDocument& resultData, const char* version) {
+    String out;
+    out.reserve(measureOuterPacket(resultData, version));
+    StringPrint sink(out);
+    writeOuterPacket(resultData, version, sink);
+    return out;
+}
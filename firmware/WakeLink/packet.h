@@ -1,27 +1,68 @@
 /**
  * @file packet.h
- * @brief Protocol v1.0 packet manager for WakeLink firmware.
+ * @brief Protocol v1.0/v1.1/v2 packet manager for WakeLink firmware.
  * 
  * Handles creation and parsing of encrypted, signed protocol packets.
  * Implements the WakeLink communication protocol used across all transports
  * (TCP, HTTP, WSS).
  * 
- * Packet Structure:
+ * Packet Structure (v1.0):
  * - Outer JSON: {device_id, payload, signature, counter, version}
  * - Payload: hex string = [uint16_be length] + [ciphertext] + [16B nonce]
  * - Signature: HMAC-SHA256 of payload hex string only
- * - Inner JSON: {command, data, request_id, timestamp}
+ * - Inner JSON: {command, data, request_id, timestamp, sender, seq}
  * - Counter: Current request counter from ESP (for client sync)
+ *
+ * Packet Structure (v1.1, AEAD):
+ * - Outer JSON: {device_id, payload, counter, version: "1.1"} (no signature)
+ * - Payload: hex string = [uint16_be length] + [ciphertext] + [12B nonce] + [16B tag]
+ * - Tag: Poly1305 over length prefix (AAD) and raw ciphertext
+ *
+ * Frame Structure (v2, binary):
+ * - Header (28 bytes): version 0x02, flags, device-id hash (4, BE),
+ *   counter (8, BE), nonce (12), body length (2, BE)
+ * - Body: ChaCha20 ciphertext of a MessagePack map with the same keys
+ *   as the v1 inner JSON, followed by the 16-byte Poly1305 tag
+ * - Tag covers the whole header (AAD) and the ciphertext
+ * - Device-id hash: first 4 bytes of SHA256(device_id), big endian
+ * - Counter: request sequence number (replay window) or, in responses,
+ *   the device request counter
+ * - TCP: frames are self-delimiting (header carries the length);
+ *   WSS: one frame per binary message
+ *
+ * Fragments (see fragment.h):
+ * - Messages over FRAGMENT_THRESHOLD bytes travel as several packets
+ *   or frames, each sealing a fragment header plus one chunk of the
+ *   inner JSON (v1.x) or MessagePack map (v2) with its own nonce
+ * - Incoming fragments are acknowledged with {"status": "pending"}
+ *   until the message is complete, then it is processed as usual; a
+ *   fragmented request must carry "seq" in its inner message
+ * - Responses are cut the same way when they do not fit one v2 frame,
+ *   or for v1.x over WSS; only one fragment is built at a time
+ *
+ * Buffers:
+ * - Every entry point has a form that works on caller-provided buffers
+ *   with an explicit capacity (receive buffer decoded in place, result
+ *   into a caller document, packets and frames into caller memory);
+ *   with documents on the request arena nothing touches the heap
+ * - The String and JsonDocument-returning forms wrap them
+ *
+ * The mode is selected by the first byte (0x02 = v2 frame, '{' = JSON)
+ * and, for JSON, by the outer "version" field; responses are sent in
+ * the same version as the request.
  * 
  * Security:
  * - Encryption: ChaCha20 with key derived from device_token
- * - Authentication: HMAC-SHA256 signature over payload
- * - Replay protection: Request counter with EEPROM persistence
+ * - Authentication: HMAC-SHA256 signature over payload (v1.0) or
+ *   ChaCha20-Poly1305 tag (v1.1, v2)
+ * - Replay protection: per-sender sequence window over inner "sender"
+ *   and "seq" (see replay_window.h); out-of-order delivery within
+ *   REPLAY_WINDOW_BITS is accepted
  * 
  * @note Compatible with Python client packet.py implementation.
  * 
  * @author deadboizxc
- * @version 1.0
+ * @version 2.0
  */
 
 #ifndef PACKET_H
@@ -30,8 +71,37 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include "CryptoManager.h"
+#include "fragment.h"
+#include "log_throttle.h"
 #include "config.h"
 
+/// @brief Protocol version with hex payload and HMAC-SHA256 signature
+#define PROTOCOL_V1_0 "1.0"
+
+/// @brief Protocol version with ChaCha20-Poly1305 AEAD payload
+#define PROTOCOL_V1_1 "1.1"
+
+/// @brief Protocol version of binary frames (reported in results)
+#define PROTOCOL_V2 "2.0"
+
+/// @brief First byte of every v2 frame
+#define FRAME_V2_VERSION 0x02
+
+/// @brief Set in the flags byte of device responses
+#define FRAME_V2_FLAG_RESPONSE 0x01
+
+/// @brief Fixed v2 header size
+#define FRAME_V2_HEADER 28
+
+/// @brief Poly1305 tag size
+#define FRAME_V2_TAG 16
+
+/// @brief Largest v2 body (MessagePack)
+#define FRAME_V2_MAX_BODY 500
+
+/// @brief Largest complete v2 frame
+#define FRAME_V2_MAX (FRAME_V2_HEADER + FRAME_V2_MAX_BODY + FRAME_V2_TAG)
+
 /**
  * @brief Protocol packet manager class.
  * 
@@ -40,9 +110,21 @@
  * CryptoManager for encryption and signing.
  */
 class PacketManager {
+    friend class ResponseStream;  ///< Streams v1.x replies with the outer helpers below
+
 private:
     CryptoManager& crypto;  ///< Reference to crypto manager
 
+    uint32_t deviceIdHash = 0;      ///< Cached v2 device-id hash
+    bool deviceIdHashed = false;    ///< True once deviceIdHash is valid
+
+    uint32_t rxCyclesLast = 0;      ///< Cycles from receive buffer to inner document (last request)
+    uint32_t rxHeapLast = 0;        ///< Heap taken by the last request's parse
+
+    FragmentAssembler fragments;    ///< Incoming fragmented messages
+    LogThrottle failureLog;         ///< Signature, replay and fragment rejections
+    LogThrottle requestLog;         ///< Per-request success lines
+
 public:
     /**
      * @brief Construct packet manager with crypto reference.
@@ -68,25 +150,186 @@ public:
     String createCommandPacket(const String& command, const JsonObject& data);
 
     /**
-     * @brief Process an incoming encrypted packet.
+     * @brief Create a signed, encrypted command packet in a caller buffer.
      * 
-     * Parses outer JSON, verifies HMAC signature, decrypts payload,
-     * and returns the inner command data.
+     * @param command Command name.
+     * @param data Command parameters.
+     * @param out Output buffer (not NUL-terminated).
+     * @param capacity Size of out.
+     * @return Packet length, or 0 if capacity is too small.
+     */
+    size_t createCommandPacket(const char* command, JsonObject data, char* out, size_t capacity);
+
+    /**
+     * @brief Process an incoming encrypted packet in its receive buffer.
+     * 
+     * Locates the payload in the outer JSON without copying it, verifies
+     * the HMAC signature (v1.0) or AEAD tag (v1.1), hex-decodes and
+     * decrypts in place, and returns the inner command data.
+     * The result carries the request "version" whenever it was valid.
      * 
-     * @param packetData Raw packet JSON string.
+     * @param packet Raw packet JSON; the payload region is overwritten.
+     * @param length Length of packet.
      * @return JsonDocument with status and command/data or error.
      */
-    JsonDocument processIncomingPacket(const String& packetData);
+    JsonDocument processIncomingPacket(char* packet, size_t length);
+
+    /**
+     * @brief Process an incoming packet into a caller document.
+     * 
+     * Same as processIncomingPacket(packet, length); result is cleared
+     * first, so one document can serve request after request.
+     * 
+     * @param packet Raw packet JSON; the payload region is overwritten.
+     * @param length Length of packet.
+     * @param result Receives status and command/data or error.
+     */
+    void processIncomingPacket(char* packet, size_t length, JsonDocument& result);
+
+    /**
+     * @brief Process an incoming v2 binary frame in its receive buffer.
+     * 
+     * Checks header, device hash and tag, decrypts the body in place and
+     * decodes the MessagePack map. The header counter is used as "seq"
+     * for the replay window, so every v2 request is sequenced.
+     * 
+     * @param frame Complete frame; the body is decrypted in place.
+     * @param length Frame length.
+     * @return JsonDocument with status and command/data or error,
+     *         "version" set to PROTOCOL_V2.
+     */
+    JsonDocument processIncomingFrame(uint8_t* frame, size_t length);
+
+    /**
+     * @brief Process an incoming v2 frame into a caller document.
+     * @param frame Complete frame; the body is decrypted in place.
+     * @param length Frame length.
+     * @param result Receives status and command/data or error (cleared first).
+     */
+    void processIncomingFrame(uint8_t* frame, size_t length, JsonDocument& result);
+
+    /**
+     * @brief Build an encrypted v2 response frame.
+     * 
+     * @param resultData Response data (encoded as MessagePack).
+     * @param out Output buffer.
+     * @param capacity Size of out (FRAME_V2_MAX is always enough).
+     * @return Frame length, or 0 if capacity is too small.
+     */
+    size_t createResponseFrame(const JsonDocument& resultData, uint8_t* out, size_t capacity);
+
+    /**
+     * @brief Decide whether a response must be fragmented.
+     * 
+     * @param resultData Response data.
+     * @param version Protocol version of the request (PROTOCOL_V2 measures
+     *        MessagePack, anything else JSON).
+     * @param info Receives the fragment plan with a fresh message id.
+     * @return true if the response is longer than FRAGMENT_THRESHOLD and
+     *         fits the 16-bit message length.
+     */
+    bool planFragments(const JsonDocument& resultData, const char* version, FragmentInfo& info);
+
+    /**
+     * @brief Build the v2 frame of fragment info.index.
+     * 
+     * The MessagePack encoding is regenerated and only this fragment's
+     * chunk is kept, so no buffer beyond the frame is needed.
+     * 
+     * @param resultData Response data (same document for every fragment).
+     * @param info Plan from planFragments with index set.
+     * @param out Output buffer.
+     * @param capacity Size of out (FRAME_V2_MAX is always enough).
+     * @return Frame length, or 0 if capacity is too small.
+     */
+    size_t createResponseFragment(const JsonDocument& resultData, const FragmentInfo& info,
+                                  uint8_t* out, size_t capacity);
+
+    /**
+     * @brief Stream the v1.x packet of fragment info.index.
+     * 
+     * @param resultData Response data (same document for every fragment).
+     * @param version Protocol version of the request.
+     * @param info Plan from planFragments with index set.
+     * @param out Destination.
+     * @return Characters written.
+     */
+    size_t writeResponseFragment(const JsonDocument& resultData, const char* version,
+                                 const FragmentInfo& info, Print& out);
+
+    /**
+     * @brief Exact number of characters writeResponseFragment will produce.
+     * @param info Plan with index set (index 0 is the longest).
+     * @param version Protocol version of the request.
+     */
+    size_t measureResponseFragment(const FragmentInfo& info, const char* version);
+
+    /** @brief True if data starts a v2 frame rather than JSON. */
+    static bool isFrame(const uint8_t* data, size_t length) {
+        return length > 0 && data[0] == FRAME_V2_VERSION;
+    }
+
+    /**
+     * @brief Total frame length announced by a v2 header.
+     * @param header At least FRAME_V2_HEADER bytes.
+     * @return Frame length, or 0 if the body length is out of range.
+     */
+    static size_t frameLength(const uint8_t* header);
+
+    /** @brief Cycles from receive buffer to inner document for the last request. */
+    uint32_t getRxCyclesLast() const { return rxCyclesLast; }
+
+    /** @brief Heap held by the last request's parse (free-heap drop). */
+    uint32_t getRxHeapLast() const { return rxHeapLast; }
+
+    /**
+     * @brief Stream a signed, encrypted response packet.
+     * 
+     * Serializes, encrypts, authenticates and hex-encodes the result in
+     * one pass into out, with fixed-size buffers only. Results of any
+     * size up to the 16-bit payload length are sent whole.
+     * 
+     * @param resultData Response data as JsonDocument.
+     * @param version Protocol version of the request being answered.
+     * @param out Destination, e.g. a WiFiClient.
+     * @return Characters written.
+     */
+    size_t writeResponse(const JsonDocument& resultData, const char* version, Print& out);
+
+    /**
+     * @brief Exact number of characters writeResponse will produce.
+     * 
+     * Lets callers that need the whole message size a buffer first.
+     * 
+     * @param resultData Response data as JsonDocument.
+     * @param version Protocol version of the request being answered.
+     */
+    size_t measureResponse(const JsonDocument& resultData, const char* version);
 
     /**
-     * @brief Create a signed, encrypted response packet.
+     * @brief Create a signed, encrypted response packet as a String.
      * 
-     * Encrypts the result data and wraps in outer JSON with signature.
+     * Same bytes as writeResponse, for transports that send whole
+     * messages; the String is allocated once at its final size.
      * 
      * @param resultData Response data as JsonDocument.
+     * @param version Protocol version of the request being answered.
      * @return Serialized outer packet JSON string.
      */
-    String createResponsePacket(const JsonDocument& resultData);
+    String createResponsePacket(const JsonDocument& resultData,
+                                const char* version = PROTOCOL_V1_0);
+
+    /**
+     * @brief Create a signed, encrypted response packet in a caller buffer.
+     * 
+     * @param resultData Response data as JsonDocument.
+     * @param version Protocol version of the request being answered.
+     * @param out Output buffer (not NUL-terminated).
+     * @param capacity Size of out (measureResponse() is enough).
+     * @return Packet length, or 0 if capacity is too small.
+     */
+    size_t createResponsePacket(const JsonDocument& resultData, const char* version,
+                                char* out, size_t capacity);
 
 private:
     /**
@@ -94,39 +337,135 @@ private:
      * 
      * Creates random alphanumeric ID for request/response correlation.
      * 
-     * @return Request ID string.
+     * @param id Receives 8 characters and a NUL.
+     */
+    void generateRequestId(char id[9]);
+
+    /**
+     * @brief Fill the inner document of an outgoing command.
+     * @param inner Document to fill.
+     * @param command Command name.
+     * @param data Command parameters.
      */
-    String generateRequestId();
+    void fillCommand(JsonDocument& inner, const char* command, JsonObject data);
 
     /**
-     * @brief Encrypt JSON document to hex payload.
+     * @brief Stream the outer JSON packet around a sealed inner document.
      * 
-     * Serializes JSON, encrypts with ChaCha20, and returns hex string.
+     * Writes device_id, payload, signature (v1.0 only), request_counter
+     * and version; the payload is encrypted while it is written.
      * 
-     * @param json JSON document to encrypt.
-     * @return Hex-encoded encrypted payload.
+     * @param inner Inner document to seal.
+     * @param version Protocol version to emit.
+     * @param out Destination.
+     * @return Characters written.
      */
-    String encryptJson(const JsonDocument& json);
+    size_t writeOuterPacket(const JsonDocument& inner, const char* version, Print& out);
 
     /**
-     * @brief Create outer JSON packet wrapper.
+     * @brief Exact length writeOuterPacket would produce.
+     * @param inner Inner document.
+     * @param version Protocol version.
+     * @return Characters.
+     */
+    size_t measureOuterPacket(const JsonDocument& inner, const char* version);
+
+    /**
+     * @brief Stream an outer packet sealing doc, or one fragment of it.
+     * @param doc Inner document.
+     * @param fragment Fragment to emit, or nullptr for the whole document.
+     * @param aead v1.1 instead of v1.0.
+     * @param out Destination.
+     * @return Characters written.
+     */
+    size_t writeOuter(const JsonDocument& doc, const FragmentInfo* fragment, bool aead, Print& out);
+
+    /**
+     * @brief Outer packet up to the opening quote of the payload.
+     * @param out Destination.
+     * @return Characters written.
+     */
+    size_t writeOuterHead(Print& out);
+
+    /**
+     * @brief Outer packet after the payload (signature, counter, version).
+     * @param mac v1.0 HMAC of the hex payload (unused for v1.1).
+     * @param aead v1.1 instead of v1.0.
+     * @param out Destination.
+     * @return Characters written.
+     */
+    size_t writeOuterTail(const uint8_t mac[32], bool aead, Print& out);
+
+    /**
+     * @brief The document that is sealed for inner: itself, or a
+     *        RESPONSE_TOO_LARGE error in fallback if it exceeds the
+     *        16-bit payload length.
+     */
+    static const JsonDocument& fitPayload(const JsonDocument& inner, JsonDocument& fallback);
+
+    /**
+     * @brief Length of an outer packet for a plaintext length.
+     * @param plainLen Sealed plaintext bytes.
+     * @param aead v1.1 instead of v1.0.
+     */
+    size_t outerLength(size_t plainLen, bool aead);
+
+    /**
+     * @brief Locate and validate the outer JSON envelope in place.
      * 
-     * Adds device_id, payload, signature, and version fields.
+     * Validates structure and version; checks the HMAC signature for
+     * v1.0. v1.1 payloads are authenticated later by the AEAD tag.
      * 
-     * @param encryptedPayload Hex-encoded encrypted payload.
-     * @return Serialized outer JSON packet.
+     * @param packet Raw outer JSON.
+     * @param length Length of packet.
+     * @param payload Receives a pointer to the hex payload inside packet.
+     * @param payloadLen Receives the payload length.
+     * @param version Receives PROTOCOL_V1_0 or PROTOCOL_V1_1 once known.
+     * @return nullptr on success, otherwise the error code.
      */
-    String createOuterPacket(const String& encryptedPayload);
+    const char* parseOuterPacket(char* packet, size_t length,
+                                 char*& payload, size_t& payloadLen,
+                                 const char*& version);
 
     /**
-     * @brief Parse and validate outer JSON packet.
+     * @brief Common checks on a decoded inner document.
+     * 
+     * Requires a command, runs the replay window on "sender"/"seq" and
+     * makes sure "data" is an object. "seq" may only be missing on v1.0,
+     * which is then checked on "request_id"/"timestamp". Sets status on
+     * the result; on success counts the request
+     * (CryptoManager::incrementCounter).
      * 
-     * Validates structure, version, and HMAC signature.
+     * @param result Decoded inner document.
+     * @param requireSeq Reject a missing "seq" on v1.0 too (reassembled
+     *        messages, whose fragments are not sequenced themselves).
+     */
+    void finishIncoming(JsonDocument& result, bool requireSeq = false);
+
+    /**
+     * @brief Feed a decrypted fragment to the assembler.
      * 
-     * @param outerPacket Raw outer JSON string.
-     * @return JsonDocument with status and encrypted_payload or error.
+     * @param plain Fragment plaintext; replaced by the whole message
+     *        once it is complete.
+     * @param length Plaintext length; replaced likewise.
+     * @param version Protocol version, recorded in result.
+     * @param result Receives "pending" or the error when false is returned.
+     * @return true if plain now holds a complete message (release it
+     *         with fragments.release() after decoding).
+     */
+    bool takeFragment(const uint8_t*& plain, size_t& length, const char* version,
+                      JsonDocument& result);
+
+    /**
+     * @brief Fill in the v2 response header and seal the body in place.
+     * @param out Frame buffer with the body already at FRAME_V2_HEADER.
+     * @param bodyLen Body length.
+     * @return Frame length.
      */
-    JsonDocument parseOuterPacket(const String& outerPacket);
+    size_t sealResponseFrame(uint8_t* out, size_t bodyLen);
+
+    /** @brief v2 device-id hash: first 4 bytes of SHA256(DEVICE_ID). */
+    uint32_t getDeviceIdHash();
 };
 
 #endif // PACKET_H
\ No newline at end of file
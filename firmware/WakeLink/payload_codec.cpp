@@ -0,0 +1,59 @@
+/**
+ * @file payload_codec.cpp
+ * @brief In-place decoding of v1.x hex payloads.
+ */
+
+#include "payload_codec.h"
+#include "hex_codec.h"
+
+/**
+ * @brief Hex-decode onto itself and read the length prefix.
+ * @return nullptr on success, or an "ERROR:*" string.
+ */
+static const char* decode_prefixed(char* hex, size_t hexLen, size_t trailer, PayloadView& view) {
+    if (hexLen % 2 != 0) return "ERROR:HEX_LEN";
+
+    size_t byteLen = hexLen / 2;
+    if (byteLen < 2 + 1 + trailer || byteLen > 2 + PAYLOAD_MAX_REQUEST + trailer) {
+        return "ERROR:INVALID_PACKET_SIZE";
+    }
+
+    uint8_t* packet = (uint8_t*)hex;
+    if (!HexCodec::decode(hex, byteLen, packet)) return "ERROR:HEX_CHAR";
+
+    size_t dataLen = ((size_t)packet[0] << 8) | packet[1];
+    if (dataLen == 0 || dataLen > PAYLOAD_MAX_REQUEST) return "ERROR:INVALID_DATA_LENGTH";
+    if (byteLen != 2 + dataLen + trailer) return "ERROR:INVALID_PACKET_SIZE";
+
+    view.prefix = packet;
+    view.data = packet + 2;
+    view.length = dataLen;
+    view.nonce = view.data + dataLen;
+    view.tag = nullptr;
+    return nullptr;
+}
+
+const char* PayloadCodec::decodeSigned(char* hex, size_t hexLen, PayloadView& view) {
+    return decode_prefixed(hex, hexLen, 16, view);
+}
+
+const char* PayloadCodec::decodeAead(char* hex, size_t hexLen, PayloadView& view) {
+    const char* error = decode_prefixed(hex, hexLen, 12 + 16, view);
+    if (!error) view.tag = view.nonce + 12;
+    return error;
+}
+
+bool PayloadCodec::checkSignature(const CryptoBackend::Hmac& hmac, const uint8_t* data, size_t len,
+                                  const char* sigHex, size_t sigLen) {
+    uint8_t received[32];
+    if (sigLen != 64 || !HexCodec::decode(sigHex, sizeof(received), received)) return false;
+
+    uint8_t expected[32];
+    hmac.compute(data, len, expected);
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 32; i++) {
+        diff |= expected[i] ^ received[i];
+    }
+    return diff == 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file payload_codec.h
+ * @brief In-place layout checks for v1.x hex payloads.
+ *
+ * The receive path works on caller-owned spans only: the hex payload is
+ * validated and decoded onto itself, and the decoded view points into
+ * the same buffer. CryptoManager decrypts through the view; the host
+ * bench (firmware/host/span_api_bench.cpp) runs the same code with an
+ * allocation counter.
+ *
+ * Payload (after hex decoding):
+ * - v1.0: len(2, BE) | ciphertext | nonce(16, first 12 used)
+ * - v1.1: len(2, BE) | ciphertext | nonce(12) | Poly1305 tag(16);
+ *   the length prefix is the AAD
+ *
+ * @note Pure C++ with no Arduino dependencies.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "crypto_backend.h"
+
+/// @brief Largest ciphertext of a single v1.x request payload
+#define PAYLOAD_MAX_REQUEST 500
+
+/**
+ * @brief Decoded v1.x payload inside its receive buffer.
+ */
+struct PayloadView {
+    uint8_t* prefix = nullptr;      ///< Length prefix (v1.1 AAD)
+    uint8_t* data = nullptr;        ///< Ciphertext, decrypted in place
+    size_t length = 0;              ///< Ciphertext length
+    const uint8_t* nonce = nullptr; ///< 12 nonce bytes used by ChaCha20
+    const uint8_t* tag = nullptr;   ///< v1.1 tag (nullptr for v1.0)
+
+    /**
+     * @brief NUL-terminate the decrypted data.
+     *
+     * The byte after the ciphertext is the first nonce byte, which has
+     * been consumed once the data is decrypted.
+     */
+    void terminate() { data[length] = 0; }
+};
+
+/**
+ * @brief v1.x payload helpers (stateless).
+ */
+class PayloadCodec {
+public:
+    /**
+     * @brief Decode a v1.0 hex payload onto itself and check its layout.
+     * @param hex Hex payload (overwritten).
+     * @param hexLen Length of hex.
+     * @param view Receives the decoded layout.
+     * @return nullptr on success, or an "ERROR:*" string.
+     */
+    static const char* decodeSigned(char* hex, size_t hexLen, PayloadView& view);
+
+    /**
+     * @brief Decode a v1.1 hex payload onto itself and check its layout.
+     * @param hex Hex payload (overwritten).
+     * @param hexLen Length of hex.
+     * @param view Receives the decoded layout.
+     * @return nullptr on success, or an "ERROR:*" string.
+     */
+    static const char* decodeAead(char* hex, size_t hexLen, PayloadView& view);
+
+    /**
+     * @brief Check a hex HMAC-SHA256 signature in constant time.
+     * @param hmac Keyed HMAC context.
+     * @param data Signed bytes.
+     * @param len Length of data.
+     * @param sigHex Received signature (64 hex characters, any case).
+     * @param sigLen Length of sigHex.
+     * @return true if the signature matches.
+     */
+    static bool checkSignature(const CryptoBackend::Hmac& hmac, const uint8_t* data, size_t len,
+                               const char* sigHex, size_t sigLen);
+};
+
+#endif // PAYLOAD_CODEC_H
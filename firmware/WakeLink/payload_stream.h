@@ -0,0 +1,207 @@
+/**
+ * @file payload_stream.h
+ * @brief Streaming encoder for v1.0/v1.1 hex payloads.
+ *
+ * PayloadStream is an Arduino Print: serializeJson() writes plaintext
+ * into it and every chunk is encrypted, authenticated and hex-encoded on
+ * the way to the underlying Print (WiFiClient, String, ...). Neither the
+ * plaintext, the ciphertext nor the hex payload is ever held in full, so
+ * RAM use does not depend on the response size.
+ *
+ * Payload (hex):
+ * - v1.0: len(2, BE) | ChaCha20 ciphertext | nonce(16, first 12 used);
+ *   HMAC-SHA256 runs over the hex characters as they are emitted
+ * - v1.1: len(2, BE) | ciphertext | nonce(12) | Poly1305 tag(16);
+ *   the length prefix is the AAD
+ *
+ * The plaintext length must be known up front (measureJson()) because it
+ * leads the payload; bytes beyond it are dropped.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef PAYLOAD_STREAM_H
+#define PAYLOAD_STREAM_H
+
+#include <Arduino.h>
+#include "CryptoManager.h"
+
+/// @brief Largest plaintext a payload can carry (16-bit length prefix)
+#define PAYLOAD_MAX_PLAIN 0xFFFF
+
+/// @brief Hex characters buffered before they are passed on
+#define PAYLOAD_STREAM_BUFFER 256
+
+/**
+ * @brief Print that seals plaintext into a hex payload on the fly.
+ */
+class PayloadStream : public Print {
+private:
+    CryptoManager& crypto;   ///< Keys and cycle statistics
+    Print& out;              ///< Destination of the hex payload
+    bool aead;               ///< v1.1 (AEAD) instead of v1.0
+
+    CryptoBackend::Cipher cipher;         ///< v1.0 keystream, position follows the plaintext
+    CryptoBackend::Aead aeadCtx;          ///< v1.1 cipher and tag over AAD and ciphertext
+    CryptoBackend::Hmac::Message hmacMsg; ///< v1.0 MAC over the emitted hex
+    uint8_t nonce[16];                    ///< v1.0 uses 16, v1.1 the first 12
+
+    char hex[PAYLOAD_STREAM_BUFFER];      ///< Pending hex characters
+    size_t hexLen = 0;                    ///< Characters in hex
+    size_t plainLen = 0;                  ///< Declared plaintext length
+    size_t plainDone = 0;                 ///< Plaintext bytes consumed
+    size_t emitted = 0;                   ///< Hex characters passed to out
+    uint32_t cipherCycles = 0;            ///< Cycles spent in ChaCha20
+    uint32_t macCycles = 0;               ///< Cycles spent in HMAC/Poly1305
+
+    /** @brief Hex-encode raw bytes into the buffer (and v1.0 MAC). */
+    void emit(const uint8_t* raw, size_t len);
+
+    /** @brief Pass buffered hex to out. */
+    void flushHex();
+
+public:
+    /**
+     * @brief Bind to keys and destination.
+     * @param cryptoManager Initialized crypto manager.
+     * @param output Destination for the hex payload.
+     * @param aeadMode true for v1.1, false for v1.0.
+     */
+    PayloadStream(CryptoManager& cryptoManager, Print& output, bool aeadMode)
+        : crypto(cryptoManager), out(output), aead(aeadMode) {}
+
+    /**
+     * @brief Draw a nonce and emit the length prefix.
+     * @param length Exact plaintext length that will be written.
+     */
+    void begin(size_t length);
+
+    /**
+     * @brief Encrypt and emit plaintext.
+     * @return Bytes accepted (0 once the declared length is reached).
+     */
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    /**
+     * @brief Emit nonce (and tag) and flush.
+     *
+     * A short plaintext is padded with spaces so the declared length holds.
+     *
+     * @param mac Receives the v1.0 HMAC of the hex payload (unused for v1.1).
+     */
+    void end(uint8_t mac[32]);
+
+    /** @brief Hex characters written to the destination so far. */
+    size_t written() const { return emitted; }
+
+    /**
+     * @brief Hex payload length for a plaintext length.
+     * @param length Plaintext length.
+     * @param aeadMode true for v1.1.
+     */
+    static size_t hexLength(size_t length, bool aeadMode) {
+        return 2 * (2 + length + (aeadMode ? 12 + 16 : 16));
+    }
+};
+
+/**
+ * @brief Print that appends to a String (reserve() first to avoid regrowth).
+ */
+class StringPrint : public Print {
+private:
+    String& str;
+
+public:
+    explicit StringPrint(String& target) : str(target) {}
+
+    size_t write(uint8_t c) override {
+        str += (char)c;
+        return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        for (size_t i = 0; i < size; i++) str += (char)buffer[i];
+        return size;
+    }
+};
+
+/**
+ * @brief Print that fills a fixed buffer; excess output is dropped.
+ */
+class BufferPrint : public Print {
+private:
+    uint8_t* buf;
+    size_t cap;
+    size_t len = 0;
+
+public:
+    BufferPrint(uint8_t* buffer, size_t capacity) : buf(buffer), cap(capacity) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (size > cap - len) size = cap - len;
+        memcpy(buf + len, buffer, size);
+        len += size;
+        return size;
+    }
+
+    /** @brief Bytes stored so far. */
+    size_t length() const { return len; }
+};
+
+/**
+ * @brief Print that forwards to a destination chosen per write.
+ *
+ * Lets a long-lived PayloadStream emit each piece of a streamed reply
+ * into a different chunk buffer.
+ */
+class RelayPrint : public Print {
+public:
+    Print* target = nullptr;   ///< Current destination (writes are dropped while unset)
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return target ? target->write(buffer, size) : 0;
+    }
+};
+
+/**
+ * @brief Print that passes on one window of the bytes written to it.
+ *
+ * Serializing a document through it yields a single fragment of the
+ * output without ever holding the rest (see fragment.h).
+ */
+class WindowPrint : public Print {
+private:
+    Print& out;
+    size_t start;
+    size_t end;
+    size_t pos = 0;
+
+public:
+    /**
+     * @param output Destination of the window.
+     * @param offset First byte passed on.
+     * @param length Bytes passed on.
+     */
+    WindowPrint(Print& output, size_t offset, size_t length)
+        : out(output), start(offset), end(offset + length) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        size_t at = pos;
+        pos += size;
+        size_t from = at < start ? start : at;
+        size_t to = pos < end ? pos : end;
+        if (from < to) out.write(buffer + (from - at), to - from);
+        // Report everything as taken so the serializer keeps going
+        return size;
+    }
+};
+
+#endif // PAYLOAD_STREAM_H
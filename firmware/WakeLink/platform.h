@@ -49,6 +49,13 @@
    * @return WiFiClient if available, empty otherwise.
    */
   inline WiFiClient getServerClient(WiFiServer& server) { return server.available(); }
+
+  /**
+   * @brief Bytes the client can send now without blocking.
+   * @param client Connected client.
+   * @return Free space in the TCP send window.
+   */
+  inline size_t getClientWritable(WiFiClient& client) { return client.availableForWrite(); }
   
   /**
    * @brief Check if network is encrypted.
@@ -57,6 +64,12 @@
    */
   inline bool isNetworkEncrypted(int i) { return WiFi.encryptionType(i) != ENC_TYPE_NONE; }
 
+  /**
+   * @brief Largest block malloc() can currently return.
+   * @return Bytes; less than free heap when the heap is fragmented.
+   */
+  inline uint32_t getMaxFreeBlock() { return ESP.getMaxFreeBlockSize(); }
+
 #else  // ESP32
   #include <WiFi.h>
   #include <WebServer.h>
@@ -81,6 +94,20 @@
    * @return WiFiClient if available, empty otherwise.
    */
   inline WiFiClient getServerClient(WiFiServer& server) { return server.accept(); }
+
+  /// @brief Bytes offered to an ESP32 client per pass (one TCP segment)
+  #define TCP_WRITE_CHUNK 1436
+
+  /**
+   * @brief Bytes the client can send now without blocking.
+   *
+   * ESP32's WiFiClient cannot report its send window; one segment per
+   * pass fits the lwIP send buffer behind a slow peer.
+   *
+   * @param client Connected client.
+   * @return TCP_WRITE_CHUNK while connected, 0 otherwise.
+   */
+  inline size_t getClientWritable(WiFiClient& client) { return client.connected() ? TCP_WRITE_CHUNK : 0; }
   
   /**
    * @brief Check if network is encrypted.
@@ -88,6 +115,12 @@
    * @return true if encrypted, false if open.
    */
   inline bool isNetworkEncrypted(int i) { return WiFi.encryptionType(i) != WIFI_AUTH_OPEN; }
+
+  /**
+   * @brief Largest block malloc() can currently return.
+   * @return Bytes; less than free heap when the heap is fragmented.
+   */
+  inline uint32_t getMaxFreeBlock() { return ESP.getMaxAllocHeap(); }
 #endif
 
 // ============================================
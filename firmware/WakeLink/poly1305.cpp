@@ -0,0 +1,288 @@
+/**
+ * @file poly1305.cpp
+ * @brief Poly1305 (26-bit limbs) and the ChaCha20-Poly1305 AEAD construction.
+ */
+
+#include "poly1305.h"
+#include "chacha20.h"
+#include <string.h>
+
+static inline uint32_t load32_le(const uint8_t* p) {
+    return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void store64_le(uint8_t* p, uint64_t v) {
+    store32_le(p, (uint32_t)v);
+    store32_le(p + 4, (uint32_t)(v >> 32));
+}
+
+// ==================== POLY1305 ====================
+
+void Poly1305::init(const uint8_t key[32]) {
+    // r &= 0xffffffc0ffffffc0ffffffc0fffffff, split into 26-bit limbs
+    r[0] = (load32_le(key + 0)) & 0x3ffffff;
+    r[1] = (load32_le(key + 3) >> 2) & 0x3ffff03;
+    r[2] = (load32_le(key + 6) >> 4) & 0x3ffc0ff;
+    r[3] = (load32_le(key + 9) >> 6) & 0x3f03fff;
+    r[4] = (load32_le(key + 12) >> 8) & 0x00fffff;
+
+    for (int32_t i = 0; i < 5; i++) h[i] = 0;
+    for (int32_t i = 0; i < 4; i++) pad[i] = load32_le(key + 16 + i * 4);
+    buffer_len = 0;
+}
+
+void Poly1305::blocks(const uint8_t* data, size_t len, uint32_t hibit) {
+    const uint32_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+    while (len >= 16) {
+        // h += m
+        h0 += (load32_le(data + 0)) & 0x3ffffff;
+        h1 += (load32_le(data + 3) >> 2) & 0x3ffffff;
+        h2 += (load32_le(data + 6) >> 4) & 0x3ffffff;
+        h3 += (load32_le(data + 9) >> 6) & 0x3ffffff;
+        h4 += (load32_le(data + 12) >> 8) | hibit;
+
+        // h *= r (mod 2^130 - 5)
+        uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        // Partial carry propagation
+        uint32_t c;
+        c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        data += 16;
+        len -= 16;
+    }
+
+    h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+}
+
+void Poly1305::update(const uint8_t* data, size_t len) {
+    if (buffer_len) {
+        size_t take = 16 - buffer_len;
+        if (take > len) take = len;
+        memcpy(buffer + buffer_len, data, take);
+        buffer_len += take;
+        data += take;
+        len -= take;
+        if (buffer_len < 16) return;
+        blocks(buffer, 16, 1UL << 24);
+        buffer_len = 0;
+    }
+
+    size_t whole = len & ~(size_t)15;
+    if (whole) {
+        blocks(data, whole, 1UL << 24);
+        data += whole;
+        len -= whole;
+    }
+
+    if (len) {
+        memcpy(buffer, data, len);
+        buffer_len = len;
+    }
+}
+
+void Poly1305::padTo16() {
+    if (buffer_len) {
+        memset(buffer + buffer_len, 0, 16 - buffer_len);
+        blocks(buffer, 16, 1UL << 24);
+        buffer_len = 0;
+    }
+}
+
+void Poly1305::finish(uint8_t tag[16]) {
+    if (buffer_len) {
+        // Final partial block: append 0x01, zero-fill, no 2^128 bit
+        buffer[buffer_len] = 1;
+        memset(buffer + buffer_len + 1, 0, 16 - buffer_len - 1);
+        blocks(buffer, 16, 0);
+    }
+
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+    // Fully carry h
+    uint32_t c;
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // g = h + -p
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1UL << 26);
+
+    // Select h if h < p, or g otherwise, without branching
+    uint32_t mask = (g4 >> 31) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    // h = h % 2^128
+    h0 = (h0) | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    // tag = (h + s) % 2^128
+    uint64_t f;
+    f = (uint64_t)h0 + pad[0];             h0 = (uint32_t)f;
+    f = (uint64_t)h1 + pad[1] + (f >> 32); h1 = (uint32_t)f;
+    f = (uint64_t)h2 + pad[2] + (f >> 32); h2 = (uint32_t)f;
+    f = (uint64_t)h3 + pad[3] + (f >> 32); h3 = (uint32_t)f;
+
+    store32_le(tag + 0, h0);
+    store32_le(tag + 4, h1);
+    store32_le(tag + 8, h2);
+    store32_le(tag + 12, h3);
+
+    wipe();
+}
+
+void Poly1305::wipe() {
+    volatile uint8_t* p = (volatile uint8_t*)this;
+    for (size_t i = 0; i < sizeof(*this); i++) p[i] = 0;
+}
+
+// ==================== AEAD ====================
+
+/**
+ * @brief Derive the one-time key from block 0 and MAC AAD || ciphertext || lengths.
+ */
+static void aead_tag(const uint8_t key[32], const uint8_t nonce[12],
+                     const uint8_t* aad, size_t aadLen,
+                     const uint8_t* ciphertext, size_t len, uint8_t tag[16]) {
+    uint8_t otk[32];
+    memset(otk, 0, sizeof(otk));
+    ChaCha20 block0;
+    block0.init(key, nonce, 0);
+    block0.crypt(otk, sizeof(otk));
+    block0.wipe();
+
+    Poly1305 mac;
+    mac.init(otk);
+    memset(otk, 0, sizeof(otk));
+
+    if (aadLen) {
+        mac.update(aad, aadLen);
+        mac.padTo16();
+    }
+    mac.update(ciphertext, len);
+    mac.padTo16();
+
+    uint8_t lengths[16];
+    store64_le(lengths, (uint64_t)aadLen);
+    store64_le(lengths + 8, (uint64_t)len);
+    mac.update(lengths, sizeof(lengths));
+    mac.finish(tag);
+}
+
+void ChaCha20Poly1305::seal(const uint8_t key[32], const uint8_t nonce[12],
+                            const uint8_t* aad, size_t aadLen,
+                            uint8_t* data, size_t len, uint8_t tag[16]) {
+    ChaCha20 cipher;
+    cipher.init(key, nonce, 1);
+    cipher.crypt(data, len);
+    cipher.wipe();
+
+    aead_tag(key, nonce, aad, aadLen, data, len, tag);
+}
+
+bool ChaCha20Poly1305::open(const uint8_t key[32], const uint8_t nonce[12],
+                            const uint8_t* aad, size_t aadLen,
+                            uint8_t* data, size_t len, const uint8_t tag[16]) {
+    uint8_t expected[16];
+    aead_tag(key, nonce, aad, aadLen, data, len, expected);
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 16; i++) {
+        diff |= expected[i] ^ tag[i];
+    }
+    if (diff != 0) return false;
+
+    ChaCha20 cipher;
+    cipher.init(key, nonce, 1);
+    cipher.crypt(data, len);
+    cipher.wipe();
+    return true;
+}
+
+bool ChaCha20Poly1305::selfTest() {
+    // RFC 8439 section 2.5.2: Poly1305 MAC
+    static const uint8_t polyKey[32] = {
+        0x85, 0xd6, 0xbe, 0x78, 0x57, 0x55, 0x6d, 0x33, 0x7f, 0x44, 0x52, 0xfe, 0x42, 0xd5, 0x06, 0xa8,
+        0x01, 0x03, 0x80, 0x8a, 0xfb, 0x0d, 0xb2, 0xfd, 0x4a, 0xbf, 0xf6, 0xaf, 0x41, 0x49, 0xf5, 0x1b
+    };
+    static const char polyMsg[] = "Cryptographic Forum Research Group";
+    static const uint8_t polyTag[16] = {
+        0xa8, 0x06, 0x1d, 0xc1, 0x30, 0x51, 0x36, 0xc6, 0xc2, 0x2b, 0x8b, 0xaf, 0x0c, 0x01, 0x27, 0xa9
+    };
+
+    uint8_t tag[16];
+    Poly1305 mac;
+    mac.init(polyKey);
+    mac.update((const uint8_t*)polyMsg, 5);
+    mac.update((const uint8_t*)polyMsg + 5, sizeof(polyMsg) - 1 - 5);
+    mac.finish(tag);
+    bool ok = memcmp(tag, polyTag, 16) == 0;
+
+    // RFC 8439 section 2.8.2: AEAD encryption
+    uint8_t key[32];
+    for (int32_t i = 0; i < 32; i++) key[i] = (uint8_t)(0x80 + i);
+    static const uint8_t nonce[12] = {0x07, 0, 0, 0, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47};
+    static const uint8_t aad[12] = {0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7};
+    static const char plaintext[] =
+        "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+        "for the future, sunscreen would be it.";
+    static const uint8_t ciphertext[114] = {
+        0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+        0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe, 0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+        0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+        0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29, 0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+        0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c, 0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+        0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+        0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+        0x61, 0x16
+    };
+    static const uint8_t aeadTag[16] = {
+        0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91
+    };
+
+    uint8_t buf[114];
+    memcpy(buf, plaintext, sizeof(buf));
+    seal(key, nonce, aad, sizeof(aad), buf, sizeof(buf), tag);
+    ok = ok && memcmp(buf, ciphertext, sizeof(buf)) == 0 && memcmp(tag, aeadTag, 16) == 0;
+
+    // Round trip, then a flipped ciphertext bit must be rejected
+    ok = ok && open(key, nonce, aad, sizeof(aad), buf, sizeof(buf), tag)
+            && memcmp(buf, plaintext, sizeof(buf)) == 0;
+    seal(key, nonce, aad, sizeof(aad), buf, sizeof(buf), tag);
+    buf[0] ^= 1;
+    ok = ok && !open(key, nonce, aad, sizeof(aad), buf, sizeof(buf), tag);
+
+    return ok;
+}
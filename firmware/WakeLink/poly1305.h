@@ -0,0 +1,117 @@
+/**
+ * @file poly1305.h
+ * @brief Poly1305 one-time authenticator and ChaCha20-Poly1305 AEAD (RFC 8439).
+ *
+ * Poly1305 uses five 26-bit limbs and 32x32->64 multiplies only, so it
+ * runs on the ESP8266 without a wide multiplier.
+ *
+ * ChaCha20Poly1305 is the RFC 8439 section 2.8 construction: the one-time
+ * Poly1305 key is the first 32 bytes of ChaCha20 block 0, the payload is
+ * encrypted from block 1, and the tag covers AAD || ciphertext || lengths.
+ * Encryption and authentication run over the raw bytes in one pass each,
+ * with no hex encoding in between (protocol v1.1).
+ *
+ * @note Pure C++ with no Arduino dependencies.
+ *
+ * @author deadboizxc
+ * @version 1.1
+ */
+
+#ifndef POLY1305_H
+#define POLY1305_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Streaming Poly1305 context for one message.
+ */
+class Poly1305 {
+private:
+    uint32_t r[5];           ///< Clamped key part r (26-bit limbs)
+    uint32_t h[5];           ///< Accumulator (26-bit limbs)
+    uint32_t pad[4];         ///< Key part s
+    uint8_t buffer[16];      ///< Pending partial block
+    size_t buffer_len;       ///< Bytes in buffer
+
+    /**
+     * @brief Absorb whole 16-byte blocks.
+     * @param data Input bytes (multiple of 16).
+     * @param len Input length.
+     * @param hibit 1 << 24 for full blocks, 0 for the padded final block.
+     */
+    void blocks(const uint8_t* data, size_t len, uint32_t hibit);
+
+public:
+    /**
+     * @brief Set up the one-time key.
+     * @param key 32-byte key (r || s).
+     */
+    void init(const uint8_t key[32]);
+
+    /**
+     * @brief Absorb data.
+     * @param data Input bytes.
+     * @param len Input length.
+     */
+    void update(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Absorb zero bytes up to the next 16-byte boundary.
+     *
+     * Used by the AEAD construction between AAD, ciphertext and lengths.
+     */
+    void padTo16();
+
+    /**
+     * @brief Output the tag and wipe the context.
+     * @param tag 16-byte output buffer.
+     */
+    void finish(uint8_t tag[16]);
+
+    /**
+     * @brief Erase key, accumulator and pending bytes.
+     *
+     * For a context abandoned before finish(), which wipes on its own.
+     */
+    void wipe();
+};
+
+/**
+ * @brief ChaCha20-Poly1305 AEAD (RFC 8439 section 2.8).
+ */
+class ChaCha20Poly1305 {
+public:
+    /**
+     * @brief Encrypt in place and compute the tag.
+     * @param key 256-bit key.
+     * @param nonce 96-bit nonce.
+     * @param aad Additional authenticated data (may be NULL if aadLen is 0).
+     * @param aadLen AAD length.
+     * @param data Plaintext in, ciphertext out.
+     * @param len Data length.
+     * @param tag 16-byte output tag.
+     */
+    static void seal(const uint8_t key[32], const uint8_t nonce[12],
+                     const uint8_t* aad, size_t aadLen,
+                     uint8_t* data, size_t len, uint8_t tag[16]);
+
+    /**
+     * @brief Verify the tag in constant time, then decrypt in place.
+     *
+     * The data is left untouched when the tag does not match.
+     *
+     * @return true if the tag is valid.
+     */
+    static bool open(const uint8_t key[32], const uint8_t nonce[12],
+                     const uint8_t* aad, size_t aadLen,
+                     uint8_t* data, size_t len, const uint8_t tag[16]);
+
+    /**
+     * @brief Run RFC 8439 known-answer tests (sections 2.5.2 and 2.8.2).
+     * @return true if all vectors match.
+     */
+    static bool selfTest();
+};
+
+#endif // POLY1305_H
@@ -0,0 +1,176 @@
+/**
+ * @file replay_window.cpp
+ * @brief Sliding-window replay protection for pipelined requests.
+ */
+
+#include "replay_window.h"
+#include <string.h>
+
+void ReplayWindow::reset(uint64_t start) {
+    top = start;
+    floor = start;
+    memset(bits, 0, sizeof(bits));
+}
+
+void ReplayWindow::slide(uint64_t shift) {
+    if (shift >= REPLAY_WINDOW_BITS) {
+        memset(bits, 0, sizeof(bits));
+        return;
+    }
+
+    // Move bits towards higher indices (older sequence numbers)
+    const size_t wordShift = (size_t)(shift / 32);
+    const uint32_t bitShift = (uint32_t)(shift % 32);
+    for (size_t i = WORDS; i-- > 0;) {
+        uint32_t v = 0;
+        if (i >= wordShift) {
+            v = bits[i - wordShift] << bitShift;
+            if (bitShift && i > wordShift) v |= bits[i - wordShift - 1] >> (32 - bitShift);
+        }
+        bits[i] = v;
+    }
+}
+
+ReplayVerdict ReplayWindow::check(uint64_t seq) const {
+    if (seq == 0 || seq <= floor) return REPLAY_STALE;
+    if (seq > top) return REPLAY_OK;
+
+    uint64_t offset = top - seq;
+    if (offset >= REPLAY_WINDOW_BITS) return REPLAY_STALE;
+    return (bits[offset / 32] >> (offset % 32)) & 1 ? REPLAY_DUPLICATE : REPLAY_OK;
+}
+
+ReplayVerdict ReplayWindow::accept(uint64_t seq) {
+    ReplayVerdict verdict = check(seq);
+    if (verdict != REPLAY_OK) return verdict;
+
+    if (seq > top) {
+        slide(seq - top);
+        top = seq;
+        bits[0] |= 1;
+    } else {
+        uint64_t offset = top - seq;
+        bits[offset / 32] |= (uint32_t)1 << (offset % 32);
+    }
+    return REPLAY_OK;
+}
+
+void ReplayGuard::reset() {
+    for (size_t i = 0; i < REPLAY_SENDERS; i++) {
+        entries[i].sender[0] = '\0';
+        entries[i].window.reset(floor);
+        entries[i].lastUse = 0;
+    }
+    clock = 0;
+
+    for (size_t i = 0; i < REPLAY_LEGACY_SLOTS; i++) {
+        legacy[i].requestId[0] = '\0';
+        legacy[i].stamp = 0;
+    }
+    legacyNext = 0;
+    legacyNewest = 0;
+}
+
+void ReplayGuard::restore(uint32_t units) {
+    lease = units;
+    leaseDirty = false;
+    uint64_t start = (uint64_t)units << REPLAY_FLOOR_SHIFT;
+    if (start > floor) floor = start;
+    if (floor > legacyFloor) legacyFloor = floor;
+    reset();
+}
+
+ReplayGuard::Entry& ReplayGuard::lookup(const char* sender) {
+    Entry* victim = &entries[0];
+    for (size_t i = 0; i < REPLAY_SENDERS; i++) {
+        Entry& e = entries[i];
+        if (e.lastUse && strncmp(e.sender, sender, REPLAY_SENDER_LEN) == 0) return e;
+        if (e.lastUse < victim->lastUse) victim = &e;
+    }
+
+    // What the recycled window accepted must stay rejected
+    if (victim->lastUse) {
+        evictions++;
+        if (victim->window.getTop() > floor) floor = victim->window.getTop();
+    }
+    strncpy(victim->sender, sender, REPLAY_SENDER_LEN);
+    victim->sender[REPLAY_SENDER_LEN] = '\0';
+    victim->window.reset(floor);
+    victim->lastUse = 0;
+    return *victim;
+}
+
+void ReplayGuard::extendLease(uint64_t seq) {
+    uint64_t units = seq >> REPLAY_FLOOR_SHIFT;
+    if (units < lease) return;
+    lease = units >= UINT32_MAX - REPLAY_FLOOR_LEASE ? UINT32_MAX : (uint32_t)units + REPLAY_FLOOR_LEASE;
+    leaseDirty = true;
+}
+
+bool ReplayGuard::pendingLease(uint32_t& units) const {
+    units = lease;
+    return leaseDirty;
+}
+
+ReplayVerdict ReplayGuard::count(ReplayVerdict verdict) {
+    switch (verdict) {
+        case REPLAY_OK:        accepted++; break;
+        case REPLAY_DUPLICATE: duplicates++; break;
+        case REPLAY_STALE:     stale++; break;
+    }
+    return verdict;
+}
+
+ReplayVerdict ReplayGuard::accept(const char* sender, uint64_t seq) {
+    Entry& e = lookup(sender ? sender : "");
+    e.lastUse = ++clock;
+
+    ReplayVerdict verdict = e.window.accept(seq);
+    if (verdict == REPLAY_OK) extendLease(seq);
+    return count(verdict);
+}
+
+ReplayVerdict ReplayGuard::acceptLegacy(const char* requestId, uint64_t timestamp) {
+    if (!requestId) requestId = "";
+    if (timestamp == 0 || timestamp > UINT64_MAX / 1000000) return count(REPLAY_STALE);
+
+    uint64_t stamp = timestamp * 1000000;
+    if (stamp <= legacyFloor ||
+        stamp + (uint64_t)REPLAY_LEGACY_MAX_AGE_S * 1000000 < legacyNewest) {
+        return count(REPLAY_STALE);
+    }
+    for (size_t i = 0; i < REPLAY_LEGACY_SLOTS; i++) {
+        if (legacy[i].stamp == stamp && strncmp(legacy[i].requestId, requestId, REPLAY_SENDER_LEN) == 0) {
+            return count(REPLAY_DUPLICATE);
+        }
+    }
+
+    // The key pushed out can no longer be matched, so its timestamp becomes the floor
+    LegacyKey& slot = legacy[legacyNext];
+    if (slot.stamp > legacyFloor) legacyFloor = slot.stamp;
+    strncpy(slot.requestId, requestId, REPLAY_SENDER_LEN);
+    slot.requestId[REPLAY_SENDER_LEN] = '\0';
+    slot.stamp = stamp;
+    legacyNext = (legacyNext + 1) % REPLAY_LEGACY_SLOTS;
+
+    if (stamp > legacyNewest) legacyNewest = stamp;
+    extendLease(stamp);
+    return count(REPLAY_OK);
+}
+
+const char* ReplayGuard::verdictName(ReplayVerdict verdict) {
+    switch (verdict) {
+        case REPLAY_OK:        return "ok";
+        case REPLAY_DUPLICATE: return "duplicate";
+        case REPLAY_STALE:     return "stale";
+    }
+    return "unknown";
+}
+
+size_t ReplayGuard::activeSenders() const {
+    size_t n = 0;
+    for (size_t i = 0; i < REPLAY_SENDERS; i++) {
+        if (entries[i].lastUse) n++;
+    }
+    return n;
+}
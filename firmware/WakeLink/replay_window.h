@@ -0,0 +1,236 @@
+/**
+ * @file replay_window.h
+ * @brief Per-sender sliding-window replay protection (RFC 4303 style).
+ *
+ * Every request carries a sender id and a sequence number inside the
+ * authenticated inner JSON. For each sender the device keeps the highest
+ * sequence seen plus a REPLAY_WINDOW_BITS bitmap of the numbers just
+ * below it, so requests may arrive in any order as long as they fall
+ * inside the window, and each number is accepted exactly once.
+ *
+ * Verdicts:
+ * - REPLAY_OK: new number, now marked as seen
+ * - REPLAY_DUPLICATE: number already seen inside the window
+ * - REPLAY_STALE: number older than the window
+ *
+ * Senders:
+ * - REPLAY_SENDERS windows are kept; the least recently used one is
+ *   recycled when a new sender appears
+ * - Windows live in RAM; what survives a reboot or a recycled window is
+ *   the floor below
+ *
+ * Floor (all senders):
+ * - Sequence numbers share one scale, the client's microsecond clock;
+ *   a number at or below the floor a window started with is stale
+ * - A recycled window raises the floor to its highest number, so the
+ *   requests it had accepted cannot come back through a fresh window
+ * - The floor is leased ahead in units of 2^REPLAY_FLOOR_SHIFT: once an
+ *   accepted number reaches the lease, the lease moves REPLAY_FLOOR_LEASE
+ *   units past it and must be persisted (pendingLease()) before the request
+ *   runs. After a reboot the persisted lease becomes the floor, so
+ *   nothing accepted before the reboot is accepted again; clients lose
+ *   at most REPLAY_FLOOR_LEASE units (~8 s) of their clock
+ *
+ * Requests without "seq" (v1.0 only, e.g. the Android app):
+ * - Keyed on request_id + timestamp (seconds, scaled to microseconds)
+ * - Stale if the timestamp is at or below the legacy floor, or more than
+ *   REPLAY_LEGACY_MAX_AGE_S older than the newest one seen
+ * - The last REPLAY_LEGACY_SLOTS keys are remembered; a key pushed out
+ *   raises the legacy floor to its timestamp, and the lease covers them
+ *   like sequence numbers
+ *
+ * @note Pure C++; also built on the host (firmware/host/replay_window_sim.cpp).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef REPLAY_WINDOW_H
+#define REPLAY_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Sequence numbers tracked below the highest one (multiple of 32)
+#define REPLAY_WINDOW_BITS 128
+
+/// @brief Concurrent senders with their own window
+#define REPLAY_SENDERS 8
+
+/// @brief Maximum sender id length (longer ids are truncated)
+#define REPLAY_SENDER_LEN 16
+
+#ifndef REPLAY_FLOOR_SHIFT
+/// @brief Floor resolution: persisted units of 2^shift sequence numbers (~1 s of microseconds)
+#define REPLAY_FLOOR_SHIFT 20
+#endif
+
+#ifndef REPLAY_FLOOR_LEASE
+/// @brief Units the persisted floor is leased ahead (fewer flash writes, longer lockout after reboot)
+#define REPLAY_FLOOR_LEASE 8
+#endif
+
+#ifndef REPLAY_LEGACY_SLOTS
+/// @brief Recent request_id/timestamp keys of requests without "seq"
+#define REPLAY_LEGACY_SLOTS 16
+#endif
+
+#ifndef REPLAY_LEGACY_MAX_AGE_S
+/// @brief Oldest timestamp accepted without "seq", behind the newest one seen
+#define REPLAY_LEGACY_MAX_AGE_S 300
+#endif
+
+/**
+ * @brief Result of a replay check.
+ */
+enum ReplayVerdict {
+    REPLAY_OK = 0,
+    REPLAY_DUPLICATE,
+    REPLAY_STALE
+};
+
+/**
+ * @brief Highest sequence plus bitmap of recently seen numbers.
+ */
+class ReplayWindow {
+private:
+    static const size_t WORDS = REPLAY_WINDOW_BITS / 32;
+
+    uint64_t top = 0;          ///< Highest accepted sequence (0 = none yet)
+    uint64_t floor = 0;        ///< Numbers at or below are stale
+    uint32_t bits[WORDS];      ///< Bit i set = sequence (top - i) seen
+
+    /** @brief Age the bitmap by shift positions. */
+    void slide(uint64_t shift);
+
+public:
+    ReplayWindow() { reset(); }
+
+    /**
+     * @brief Forget all sequence numbers.
+     * @param start Floor of the fresh window (0 = none).
+     */
+    void reset(uint64_t start = 0);
+
+    /**
+     * @brief Check a sequence number without recording it.
+     * @param seq Sequence number (0 is never valid).
+     * @return Verdict.
+     */
+    ReplayVerdict check(uint64_t seq) const;
+
+    /**
+     * @brief Check and, if new, record a sequence number.
+     * @param seq Sequence number (0 is never valid).
+     * @return Verdict.
+     */
+    ReplayVerdict accept(uint64_t seq);
+
+    /** @brief Highest accepted sequence. */
+    uint64_t getTop() const { return top; }
+};
+
+/**
+ * @brief Fixed table of per-sender windows with LRU recycling.
+ */
+class ReplayGuard {
+private:
+    struct Entry {
+        char sender[REPLAY_SENDER_LEN + 1];  ///< Sender id ("" = anonymous)
+        ReplayWindow window;                 ///< Sequence window
+        uint32_t lastUse;                    ///< LRU stamp (0 = free slot)
+    };
+
+    /// @brief Request without "seq": its request_id and timestamp
+    struct LegacyKey {
+        char requestId[REPLAY_SENDER_LEN + 1];
+        uint64_t stamp;                      ///< Timestamp in microseconds (0 = free slot)
+    };
+
+    Entry entries[REPLAY_SENDERS];
+    uint32_t clock = 0;        ///< LRU clock
+    uint64_t floor = 0;        ///< Floor of the next fresh window
+
+    LegacyKey legacy[REPLAY_LEGACY_SLOTS];
+    size_t legacyNext = 0;     ///< Slot the next key overwrites
+    uint64_t legacyFloor = 0;  ///< Timestamps at or below are stale
+    uint64_t legacyNewest = 0; ///< Newest timestamp accepted
+
+    uint32_t lease = 0;        ///< Persisted floor, in units of 2^REPLAY_FLOOR_SHIFT
+    bool leaseDirty = false;   ///< lease moved and is not persisted yet
+
+    uint32_t accepted = 0;     ///< Accepted sequence numbers since boot
+    uint32_t duplicates = 0;   ///< Rejected as duplicate since boot
+    uint32_t stale = 0;        ///< Rejected as older than the window since boot
+    uint32_t evictions = 0;    ///< Windows recycled for a new sender
+
+    /** @brief Find the sender's slot, or recycle one. */
+    Entry& lookup(const char* sender);
+
+    /** @brief Move the lease past an accepted number if it reached it. */
+    void extendLease(uint64_t seq);
+
+    /** @brief Update statistics for a verdict. */
+    ReplayVerdict count(ReplayVerdict verdict);
+
+public:
+    ReplayGuard() { reset(); }
+
+    /** @brief Drop all windows and legacy keys (floor, lease and statistics are kept). */
+    void reset();
+
+    /**
+     * @brief Start from a persisted lease (at boot).
+     *
+     * Every window and the legacy keys start at the lease, so nothing
+     * accepted before it was persisted is accepted again.
+     *
+     * @param units Lease read back from flash.
+     */
+    void restore(uint32_t units);
+
+    /**
+     * @brief Check and record a sender's sequence number.
+     * @param sender Sender id (NUL-terminated, may be empty).
+     * @param seq Sequence number (0 is never valid).
+     * @return Verdict.
+     */
+    ReplayVerdict accept(const char* sender, uint64_t seq);
+
+    /**
+     * @brief Check and record a v1.0 request without "seq".
+     * @param requestId request_id of the inner JSON (may be empty).
+     * @param timestamp timestamp of the inner JSON (seconds, 0 if absent).
+     * @return Verdict (stale without a timestamp).
+     */
+    ReplayVerdict acceptLegacy(const char* requestId, uint64_t timestamp);
+
+    /**
+     * @brief Lease that must be persisted before the request runs.
+     * @param units Receives the lease to store.
+     * @return false if the lease has not moved since leaseStored().
+     */
+    bool pendingLease(uint32_t& units) const;
+
+    /** @brief Report the pending lease as persisted. */
+    void leaseStored() { leaseDirty = false; }
+
+    /** @brief Short name for a verdict ("ok", "duplicate", "stale"). */
+    static const char* verdictName(ReplayVerdict verdict);
+
+    uint32_t getAccepted() const { return accepted; }
+    uint32_t getDuplicates() const { return duplicates; }
+    uint32_t getStale() const { return stale; }
+    uint32_t getEvictions() const { return evictions; }
+
+    /** @brief Floor of the next fresh window. */
+    uint64_t getFloor() const { return floor; }
+
+    /** @brief Current lease in units of 2^REPLAY_FLOOR_SHIFT. */
+    uint32_t getLease() const { return lease; }
+
+    /** @brief Senders currently holding a window. */
+    size_t activeSenders() const;
+};
+
+#endif // REPLAY_WINDOW_H
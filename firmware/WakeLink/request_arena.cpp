@@ -0,0 +1,116 @@
+/**
+ * @file request_arena.cpp
+ * @brief Request-scoped bump arena with heap fallback.
+ */
+
+#include "request_arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+RequestArena requestArena;
+
+#if defined(ARDUINO)
+RequestJsonAllocator requestJson;
+#endif
+
+/// Block header; blocks form a stack through prev so frees can unwind it
+struct ArenaHeader {
+    uint32_t size;   ///< Requested size; FREED bit once deallocated
+    uint32_t prev;   ///< Header offset of the previous block, or NONE
+};
+
+static const uint32_t FREED = 0x80000000u;
+static const uint32_t NONE = 0xFFFFFFFFu;
+
+static_assert(sizeof(ArenaHeader) == REQUEST_ARENA_ALIGN, "header must keep blocks aligned");
+
+static inline size_t round_up(size_t size) {
+    return (size + REQUEST_ARENA_ALIGN - 1) & ~(size_t)(REQUEST_ARENA_ALIGN - 1);
+}
+
+size_t RequestArena::blockSize(const void* ptr) const {
+    const ArenaHeader* h = (const ArenaHeader*)((const uint8_t*)ptr - sizeof(ArenaHeader));
+    return h->size & ~FREED;
+}
+
+void* RequestArena::heapAllocate(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (p) heapLive++;
+    return p;
+}
+
+void* RequestArena::allocate(size_t size) {
+    if (!depth) return heapAllocate(size);
+
+    size_t need = sizeof(ArenaHeader) + round_up(size);
+    if (size >= FREED || need > sizeof(buffer) - offset) {
+        overflows++;
+        return heapAllocate(size);
+    }
+
+    ArenaHeader* h = (ArenaHeader*)(buffer + offset);
+    h->size = (uint32_t)size;
+    h->prev = last == SIZE_MAX ? NONE : (uint32_t)last;
+    last = offset;
+    offset += need;
+    live++;
+    if (offset > highWater) highWater = offset;
+    return h + 1;
+}
+
+void RequestArena::deallocate(void* ptr) {
+    if (!ptr) return;
+    if (!owns(ptr)) {
+        free(ptr);
+        heapLive--;
+        return;
+    }
+
+    ArenaHeader* h = (ArenaHeader*)ptr - 1;
+    h->size |= FREED;
+    live--;
+
+    // Unwind the stack while its top is free
+    while (last != SIZE_MAX) {
+        ArenaHeader* top = (ArenaHeader*)(buffer + last);
+        if (!(top->size & FREED)) break;
+        offset = last;
+        last = top->prev == NONE ? SIZE_MAX : top->prev;
+    }
+}
+
+void* RequestArena::reallocate(void* ptr, size_t size) {
+    if (!ptr) return allocate(size);
+    if (!owns(ptr)) return realloc(ptr, size ? size : 1);
+
+    ArenaHeader* h = (ArenaHeader*)ptr - 1;
+    size_t at = (uint8_t*)h - buffer;
+    if (at == last && size < FREED) {
+        size_t end = at + sizeof(ArenaHeader) + round_up(size);
+        if (end <= sizeof(buffer)) {
+            h->size = (uint32_t)size;
+            offset = end;
+            if (offset > highWater) highWater = offset;
+            return ptr;
+        }
+    }
+
+    void* moved = allocate(size);
+    if (!moved) return nullptr;
+    size_t old = blockSize(ptr);
+    memcpy(moved, ptr, old < size ? old : size);
+    deallocate(ptr);
+    return moved;
+}
+
+void RequestArena::leave() {
+    if (!depth || --depth) return;
+    if (live) {
+        // A block outlived its request; keep everything until it is gone
+        deferred++;
+        return;
+    }
+    offset = 0;
+    last = SIZE_MAX;
+    resets++;
+}
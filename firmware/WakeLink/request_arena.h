@@ -0,0 +1,148 @@
+/**
+ * @file request_arena.h
+ * @brief Fixed-size bump arena for per-request JSON documents and buffers.
+ *
+ * Every request builds several short-lived JsonDocuments (parsed request,
+ * command result, error replies, outer packet pieces) plus the cloud
+ * reply buffer. Taking them from the general heap and releasing them in
+ * a different order left holes that fragmented the ESP8266 heap over
+ * long uptimes. They now come from one static buffer instead:
+ *
+ * - allocate() bumps an offset; each block carries an 8-byte header
+ *   (size, previous block) so the blocks form a stack
+ * - reallocate() of the top block grows or shrinks it in place
+ *   (ArduinoJson's string builder and shrinkToFit() hit this path)
+ * - deallocate() of the top block pops it together with any freed
+ *   blocks below; other frees wait for the top or the reset
+ * - When the outermost RequestScope closes and no block is live, the
+ *   offset returns to 0 in O(1)
+ *
+ * Outside a scope, and when a request outgrows the buffer, blocks come
+ * from malloc() so nothing fails; overflows are counted so
+ * REQUEST_ARENA_SIZE can be tuned. A block still live at scope exit
+ * (a document that escaped the request) postpones the reset instead of
+ * leaving it dangling.
+ *
+ * @note Pure C++; the ArduinoJson adapter is only built on the device.
+ *       Soak test: firmware/host/request_arena_soak.cpp.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef REQUEST_ARENA_SIZE
+/// @brief Arena bytes (one request: parsed doc, result doc, reply buffer)
+#define REQUEST_ARENA_SIZE 8192
+#endif
+
+/// @brief Block alignment and size-header length
+#define REQUEST_ARENA_ALIGN 8
+
+/**
+ * @brief Bump allocator with request-scoped reset.
+ */
+class RequestArena {
+private:
+    alignas(REQUEST_ARENA_ALIGN) uint8_t buffer[REQUEST_ARENA_SIZE]; ///< Backing store
+    size_t offset = 0;        ///< Next free byte
+    size_t last = SIZE_MAX;   ///< Header offset of the most recent block
+    uint32_t depth = 0;       ///< Open RequestScopes
+    uint32_t live = 0;        ///< Arena blocks not yet deallocated
+
+    size_t highWater = 0;     ///< Largest offset since boot
+    uint32_t resets = 0;      ///< Completed resets
+    uint32_t deferred = 0;    ///< Scope exits with live blocks
+    uint32_t overflows = 0;   ///< In-scope allocations served by malloc
+    uint32_t heapLive = 0;    ///< malloc blocks not yet freed
+
+    /** @brief True if ptr lies inside buffer. */
+    bool owns(const void* ptr) const {
+        return (const uint8_t*)ptr >= buffer && (const uint8_t*)ptr < buffer + sizeof(buffer);
+    }
+
+    /** @brief Size stored in the header of an arena block. */
+    size_t blockSize(const void* ptr) const;
+
+    /** @brief malloc() fallback with accounting. */
+    void* heapAllocate(size_t size);
+
+public:
+    /**
+     * @brief Allocate a block.
+     * @return Pointer aligned to REQUEST_ARENA_ALIGN, or nullptr if the
+     *         heap fallback fails too.
+     */
+    void* allocate(size_t size);
+
+    /** @brief Release a block (arena or heap); nullptr is ignored. */
+    void deallocate(void* ptr);
+
+    /**
+     * @brief Resize a block, in place if it is the most recent one.
+     * @return New pointer, or nullptr (ptr stays valid) on failure.
+     */
+    void* reallocate(void* ptr, size_t size);
+
+    /** @brief Open a request scope (nestable). */
+    void enter() { depth++; }
+
+    /** @brief Close a request scope; the outermost one resets the arena. */
+    void leave();
+
+    /** @brief True while a request scope is open. */
+    bool active() const { return depth > 0; }
+
+    size_t getUsed() const { return offset; }
+    size_t getHighWater() const { return highWater; }
+    uint32_t getResets() const { return resets; }
+    uint32_t getDeferred() const { return deferred; }
+    uint32_t getOverflows() const { return overflows; }
+    uint32_t getHeapLive() const { return heapLive; }
+};
+
+/**
+ * @brief RAII request scope. Declare it before any document that uses
+ *        the arena so it is destroyed after them.
+ */
+class RequestScope {
+private:
+    RequestArena& arena;
+
+public:
+    explicit RequestScope(RequestArena& a) : arena(a) { arena.enter(); }
+    ~RequestScope() { arena.leave(); }
+
+    RequestScope(const RequestScope&) = delete;
+    RequestScope& operator=(const RequestScope&) = delete;
+};
+
+extern RequestArena requestArena;
+
+#if defined(ARDUINO)
+
+#include <ArduinoJson.h>
+
+/**
+ * @brief ArduinoJson allocator backed by requestArena.
+ *
+ * Pass &requestJson to a JsonDocument constructor. Copies and moves of
+ * the document keep the allocator.
+ */
+class RequestJsonAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override { return requestArena.allocate(size); }
+    void deallocate(void* ptr) override { requestArena.deallocate(ptr); }
+    void* reallocate(void* ptr, size_t size) override { return requestArena.reallocate(ptr, size); }
+};
+
+extern RequestJsonAllocator requestJson;
+
+#endif // ARDUINO
+
+#endif // REQUEST_ARENA_H
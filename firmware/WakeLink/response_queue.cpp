@@ -0,0 +1,122 @@
+/**
+ * @file response_queue.cpp
+ * @brief Per-connection scatter-gather send queue with backpressure.
+ */
+
+#include "response_queue.h"
+#include <stdlib.h>
+
+uint8_t* ResponseQueue::reserve(size_t bytes) {
+    if (!empty()) return nullptr;
+    if (bytes <= storageSize) return storage;
+
+    free(storage);
+    storage = (uint8_t*)malloc(bytes);
+    storageSize = storage ? bytes : 0;
+    return storage;
+}
+
+bool ResponseQueue::push(const void* data, size_t length) {
+    if (length == 0) return true;
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    if (count > 0) {
+        TxSegment& last = segments[(first + count - 1) % TCP_TX_SEGMENTS];
+        if (last.data + last.length == bytes) {
+            last.length += length;
+            queued += length;
+            return true;
+        }
+    }
+    if (count == TCP_TX_SEGMENTS) return false;
+
+    TxSegment& seg = segments[(first + count) % TCP_TX_SEGMENTS];
+    seg.data = bytes;
+    seg.length = length;
+    count++;
+    queued += length;
+    return true;
+}
+
+bool ResponseQueue::stream(TxSource* src) {
+    if (!src) return false;
+    if (!empty() || !reserve(TCP_TX_CHUNK)) {
+        delete src;
+        return false;
+    }
+    source = src;
+    return true;
+}
+
+bool ResponseQueue::refill() {
+    if (!source) return false;
+    size_t n = source->produce(storage, TCP_TX_CHUNK);
+    if (n == 0) {
+        delete source;
+        source = nullptr;
+        return false;
+    }
+    refills++;
+    return push(storage, n);
+}
+
+size_t ResponseQueue::flush(NetConnection& conn) {
+    if (empty()) return 0;
+
+    size_t window = conn.writable();
+    if (window == 0) {
+        stalls++;
+        return 0;
+    }
+
+    size_t total = 0;
+    while (window > 0) {
+        // The previous chunk is out; the source writes the next one over it
+        if (count == 0 && !refill()) break;
+
+        TxSegment& seg = segments[first];
+        size_t chunk = seg.length - offset;
+        if (chunk > window) chunk = window;
+
+        size_t n = conn.write(seg.data + offset, chunk);
+        writes++;
+        offset += n;
+        window -= n;
+        total += n;
+        queued -= n;
+
+        if (offset == seg.length) {
+            first = (first + 1) % TCP_TX_SEGMENTS;
+            count--;
+            offset = 0;
+        }
+        if (n < chunk) {
+            partial++;  // Socket took less than the window promised
+            break;
+        }
+    }
+    sent += total;
+
+    if (empty() && storageSize > TCP_TX_RETAIN) {
+        free(storage);
+        storage = nullptr;
+        storageSize = 0;
+    }
+    return total;
+}
+
+void ResponseQueue::clear() {
+    delete source;
+    source = nullptr;
+    first = count = 0;
+    offset = queued = 0;
+    free(storage);
+    storage = nullptr;
+    storageSize = 0;
+}
+
+void ResponseQueue::reset() {
+    clear();
+    writes = partial = stalls = refills = 0;
+    sent = 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file response_queue.h
+ * @brief Per-connection scatter-gather send queue with backpressure.
+ *
+ * A reply is serialized once, into storage owned by the queue, and sent
+ * as a short list of segments (e.g. packet + "\n" trailer, or a run of
+ * v2 fragment frames). flush() writes only what the socket's send window
+ * takes right now and remembers where it stopped, so a congested link
+ * delays the reply instead of blocking loop() or cutting it short.
+ *
+ * Segments:
+ * - Point at queue storage or at static data; nothing is copied
+ * - A segment that continues the previous one in memory is merged
+ * - The queue is empty again once every byte has been accepted
+ *
+ * Streamed replies: a reply too large to hold at once is queued as a
+ * TxSource instead. flush() asks it for the next TCP_TX_CHUNK bytes each
+ * time the previous chunk has been accepted, so the queue never holds
+ * more than one chunk of it, whatever the reply size.
+ *
+ * @note Pure C++; runs against any NetConnection, also built on the
+ *       host (firmware/host/tcp_pool_sim.cpp).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef RESPONSE_QUEUE_H
+#define RESPONSE_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net_connection.h"
+
+#ifndef TCP_TX_SEGMENTS
+/// @brief Segments queued per connection
+#define TCP_TX_SEGMENTS 4
+#endif
+
+#ifndef TCP_TX_RETAIN
+/// @brief Storage up to this size is kept for the next reply, larger is freed
+#define TCP_TX_RETAIN 1024
+#endif
+
+#ifndef TCP_TX_CHUNK
+/// @brief Storage of a streamed reply: bytes produced per refill
+#define TCP_TX_CHUNK 1024
+#endif
+
+/**
+ * @brief One contiguous run of bytes to send.
+ */
+struct TxSegment {
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+};
+
+/**
+ * @brief Producer of a reply that is generated piece by piece.
+ */
+class TxSource {
+public:
+    virtual ~TxSource() {}
+
+    /**
+     * @brief Write the next bytes of the reply.
+     * @param buf Chunk storage.
+     * @param capacity Size of buf (TCP_TX_CHUNK).
+     * @return Bytes written; 0 once the reply is complete.
+     */
+    virtual size_t produce(uint8_t* buf, size_t capacity) = 0;
+};
+
+/**
+ * @brief Send queue of one connection.
+ */
+class ResponseQueue {
+private:
+    TxSegment segments[TCP_TX_SEGMENTS];
+    uint8_t first = 0;           ///< Oldest segment
+    uint8_t count = 0;           ///< Segments queued
+    size_t offset = 0;           ///< Bytes of the oldest segment already sent
+    size_t queued = 0;           ///< Bytes not yet sent
+
+    uint8_t* storage = nullptr;  ///< Serialized reply (heap)
+    size_t storageSize = 0;
+    TxSource* source = nullptr;  ///< Streamed reply still producing (owned)
+
+    uint32_t writes = 0;         ///< write() calls
+    uint32_t partial = 0;        ///< write() calls that took less than offered
+    uint32_t stalls = 0;         ///< flush() calls with a full send window
+    uint64_t sent = 0;           ///< Bytes accepted by the socket
+    uint32_t refills = 0;        ///< Chunks produced by streamed replies
+
+    /**
+     * @brief Queue the next chunk of the streamed reply.
+     * @return false once the source is done (and deleted).
+     */
+    bool refill();
+
+public:
+    ResponseQueue() = default;
+    ResponseQueue(const ResponseQueue&) = delete;
+    ResponseQueue& operator=(const ResponseQueue&) = delete;
+    ~ResponseQueue() { clear(); }
+
+    /**
+     * @brief Storage for the next reply, valid until the queue drains.
+     *
+     * Reuses the previous buffer when it is large enough.
+     *
+     * @param bytes Bytes needed.
+     * @return Buffer, or nullptr if out of memory or the queue is not empty.
+     */
+    uint8_t* reserve(size_t bytes);
+
+    /**
+     * @brief Append a segment (not copied; must stay valid until sent).
+     * @return false if the segment table is full.
+     */
+    bool push(const void* data, size_t length);
+
+    /**
+     * @brief Queue a reply produced chunk by chunk.
+     *
+     * The queue takes ownership and deletes the source once it reports
+     * the end or the queue is cleared. One TCP_TX_CHUNK buffer is
+     * reserved up front, so the reply never stops for lack of memory
+     * once it has started.
+     *
+     * @param src Heap-allocated source (deleted on failure too).
+     * @return false if the queue is not empty or out of memory.
+     */
+    bool stream(TxSource* src);
+
+    /**
+     * @brief Write as much as the send window takes, without waiting.
+     * @param conn Connection to write to.
+     * @return Bytes written by this call.
+     */
+    size_t flush(NetConnection& conn);
+
+    /** @brief True once every queued byte has been accepted. */
+    bool empty() const { return count == 0 && !source; }
+
+    /** @brief Bytes still to send. */
+    size_t pending() const { return queued; }
+
+    /** @brief Drop queued segments and free storage (connection closed). */
+    void clear();
+
+    /** @brief clear() and zero the counters, for the next connection. */
+    void reset();
+
+    uint32_t getWrites() const { return writes; }
+    uint32_t getPartial() const { return partial; }
+    uint32_t getStalls() const { return stalls; }
+    uint64_t getSent() const { return sent; }
+    uint32_t getRefills() const { return refills; }
+};
+
+#endif // RESPONSE_QUEUE_H
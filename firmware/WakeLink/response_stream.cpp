@@ -0,0 +1,60 @@
+/**
+ * @file response_stream.cpp
+ * @brief v1.x response packet produced one send-queue chunk at a time.
+ */
+
+#include "response_stream.h"
+#include "request_arena.h"
+
+static_assert(TCP_TX_CHUNK >= 2 * RESPONSE_STREAM_MIN_CHUNK,
+              "TCP_TX_CHUNK too small for a streamed response");
+
+ResponseStream::ResponseStream(PacketManager& pm, const char* version)
+    : manager(pm),
+      aead(strcmp(version, PROTOCOL_V1_1) == 0),
+      payload(pm.crypto, relay, aead) {}
+
+bool ResponseStream::begin(const JsonDocument& result) {
+    JsonDocument tooLarge(&requestJson);
+    const JsonDocument& fitted = PacketManager::fitPayload(result, tooLarge);
+    plainLen = measureJson(fitted);
+    json = (char*)malloc(plainLen + 1);
+    if (!json) return false;
+    serializeJson(fitted, json, plainLen + 1);
+    return true;
+}
+
+size_t ResponseStream::produce(uint8_t* buf, size_t capacity) {
+    BufferPrint sink(buf, capacity);
+    relay.target = &sink;
+
+    if (phase == HEAD) {
+        manager.writeOuterHead(sink);
+        payload.begin(plainLen);
+        phase = BODY;
+    }
+
+    // A step writes 2 hex characters per byte plus what PayloadStream still buffers
+    while (phase == BODY && capacity - sink.length() > PAYLOAD_STREAM_BUFFER + 1) {
+        size_t step = (capacity - sink.length() - PAYLOAD_STREAM_BUFFER) / 2;
+        if (step > plainLen - plainDone) step = plainLen - plainDone;
+        payload.write((const uint8_t*)json + plainDone, step);
+        plainDone += step;
+        if (plainDone == plainLen) {
+            free(json);
+            json = nullptr;
+            phase = TAIL;
+        }
+    }
+
+    if (phase == TAIL && capacity - sink.length() >= RESPONSE_STREAM_MIN_CHUNK) {
+        uint8_t mac[32];
+        payload.end(mac);
+        manager.writeOuterTail(mac, aead, sink);
+        sink.write('\n');
+        phase = DONE;
+    }
+
+    relay.target = nullptr;
+    return sink.length();
+}
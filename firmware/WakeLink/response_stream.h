@@ -0,0 +1,87 @@
+/**
+ * @file response_stream.h
+ * @brief v1.x response packet produced one send-queue chunk at a time.
+ *
+ * A v1.x reply is one line of outer JSON whose hex payload is twice the
+ * size of the result; sealed whole, a result near the 16-bit payload
+ * limit needs a ~131 KB buffer. ResponseStream is a TxSource instead:
+ * the TCP send queue asks it for the next TCP_TX_CHUNK bytes each time
+ * the previous chunk has been accepted.
+ *
+ * - begin() serializes the result once into a heap buffer of its JSON
+ *   length, outside the request arena (which is reset when the request
+ *   returns, long before the last chunk is sent)
+ * - Each refill seals the next slice of that buffer, so serialization,
+ *   encryption and MAC each run exactly once over every byte
+ * - The PayloadStream (cipher, MAC, nonce) lives across refills, so the
+ *   bytes on the wire are identical to PacketManager::writeResponse()
+ *
+ * Memory per streamed reply: the result's JSON text (freed once sealed),
+ * one PayloadStream and the queue's TCP_TX_CHUNK buffer.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef RESPONSE_STREAM_H
+#define RESPONSE_STREAM_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "packet.h"
+#include "payload_stream.h"
+#include "response_queue.h"
+
+/**
+ * @brief Resumable writer of one sealed v1.0/v1.1 response packet plus newline.
+ */
+class ResponseStream : public TxSource {
+private:
+    /// @brief Part of the packet the next produce() continues with
+    enum Phase : uint8_t { HEAD, BODY, TAIL, DONE };
+
+    PacketManager& manager;  ///< Outer packet layout and keys
+    char* json = nullptr;    ///< Serialized result (heap), until sealed
+    bool aead;               ///< v1.1 instead of v1.0
+    RelayPrint relay;        ///< Points PayloadStream at the current chunk
+    PayloadStream payload;   ///< Cipher/MAC state across chunks
+    Phase phase = HEAD;
+    size_t plainLen = 0;     ///< Length of json
+    size_t plainDone = 0;    ///< Plaintext bytes already sealed
+
+public:
+    /**
+     * @param pm Packet manager (layout, keys, request counter).
+     * @param version Protocol version of the request (PROTOCOL_V1_1 for AEAD).
+     */
+    ResponseStream(PacketManager& pm, const char* version);
+
+    ~ResponseStream() override { free(json); }
+
+    ResponseStream(const ResponseStream&) = delete;
+    ResponseStream& operator=(const ResponseStream&) = delete;
+
+    /**
+     * @brief Serialize the result to send.
+     *
+     * A result beyond the 16-bit payload length is replaced by the same
+     * RESPONSE_TOO_LARGE error writeResponse() would send.
+     *
+     * @param result Result document (may live in the request arena).
+     * @return false if the JSON buffer could not be allocated.
+     */
+    bool begin(const JsonDocument& result);
+
+    /**
+     * @brief Write the next part of the packet.
+     * @param buf Chunk storage.
+     * @param capacity Size of buf (at least RESPONSE_STREAM_MIN_CHUNK).
+     * @return Bytes written; 0 once the newline has been written.
+     */
+    size_t produce(uint8_t* buf, size_t capacity) override;
+};
+
+/// @brief Smallest chunk produce() can fill: head, or buffered hex plus nonce, tag and tail
+#define RESPONSE_STREAM_MIN_CHUNK (2 * PAYLOAD_STREAM_BUFFER)
+
+#endif // RESPONSE_STREAM_H
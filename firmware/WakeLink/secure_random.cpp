@@ -0,0 +1,87 @@
+/**
+ * @file secure_random.cpp
+ * @brief ChaCha20 DRBG with fast key erasure and a pooled output buffer.
+ */
+
+#include "secure_random.h"
+#include "crypto_backend.h"
+#include "chacha20.h"
+#include <string.h>
+
+/// Fixed DRBG nonce; uniqueness comes from rotating the key every refill
+static const uint8_t DRBG_NONCE[12] = {'W', 'L', '-', 'D', 'R', 'B', 'G', 0, 0, 0, 0, 0};
+
+void SecureRandom::absorb(const uint8_t* seed, size_t len) {
+    // key = SHA256(key || seed)
+    uint8_t material[32 + 64];
+    size_t take = len > 64 ? 64 : len;
+    memcpy(material, key, 32);
+    memcpy(material + 32, seed, take);
+    CryptoBackend::sha256(material, 32 + take, key);
+    if (len > take) absorb(seed + take, len - take);
+    memset(material, 0, sizeof(material));
+
+    seeded = true;
+    refills = 0;
+    pool_pos = SECURE_RANDOM_POOL;  // Drop output generated from the old key
+}
+
+void SecureRandom::seedFromHardware() {
+    uint8_t entropy[48];
+    CryptoBackend::randomBytes(entropy, sizeof(entropy));
+    if (!seeded) memset(key, 0, sizeof(key));
+    absorb(entropy, sizeof(entropy));
+    memset(entropy, 0, sizeof(entropy));
+}
+
+void SecureRandom::seed(const uint8_t* seed, size_t len) {
+    memset(key, 0, sizeof(key));
+    deterministic = true;
+    absorb(seed, len);
+}
+
+void SecureRandom::refill() {
+    if (!seeded) seedFromHardware();
+    if (!deterministic && refills >= SECURE_RANDOM_RESEED_REFILLS) seedFromHardware();
+
+    ChaCha20 cipher;
+    cipher.init(key, DRBG_NONCE, 0);
+
+    // First 32 bytes become the next key, the rest is served
+    memset(key, 0, sizeof(key));
+    cipher.crypt(key, sizeof(key));
+    memset(pool, 0, sizeof(pool));
+    cipher.crypt(pool, sizeof(pool));
+    cipher.wipe();
+
+    pool_pos = 0;
+    refills++;
+}
+
+void SecureRandom::fill(uint8_t* out, size_t len) {
+    while (len > 0) {
+        if (pool_pos >= SECURE_RANDOM_POOL) refill();
+        size_t take = SECURE_RANDOM_POOL - pool_pos;
+        if (take > len) take = len;
+        memcpy(out, pool + pool_pos, take);
+        memset(pool + pool_pos, 0, take);
+        pool_pos += take;
+        out += take;
+        len -= take;
+    }
+}
+
+uint8_t SecureRandom::uniform(uint16_t bound) {
+    if (bound <= 1 || bound > 256) return 0;
+    // Reject the top partial range so every value is equally likely
+    const uint16_t limit = 256 - (256 % bound);
+    uint8_t b;
+    do {
+        fill(&b, 1);
+    } while (b >= limit);
+    return (uint8_t)(b % bound);
+}
+
+void SecureRandom::idle() {
+    if (available() < SECURE_RANDOM_LOW_WATER) refill();
+}
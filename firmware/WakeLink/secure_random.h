@@ -0,0 +1,105 @@
+/**
+ * @file secure_random.h
+ * @brief Buffered ChaCha20 DRBG for nonces, request IDs and tokens.
+ *
+ * The generator is seeded from the platform entropy source
+ * (CryptoBackend::randomBytes) and expands it with ChaCha20 into a pooled
+ * keystream buffer. Requests are served by memcpy from the pool, so a
+ * 16-byte nonce costs no RNG calls on the response path; idle() tops the
+ * pool up from loop() while nothing else is running.
+ *
+ * Each refill uses fast key erasure: the first 32 bytes of new keystream
+ * replace the key, and served bytes are wiped from the pool, so earlier
+ * outputs cannot be reconstructed from the current state. Fresh entropy
+ * is mixed into the key every SECURE_RANDOM_RESEED_REFILLS refills.
+ *
+ * @note Pure C++. seed() makes the output deterministic for host builds.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef SECURE_RANDOM_H
+#define SECURE_RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Keystream bytes held in the pool (multiple of 64)
+#define SECURE_RANDOM_POOL 256
+
+/// @brief idle() refills once fewer than this many bytes remain
+#define SECURE_RANDOM_LOW_WATER 64
+
+/// @brief Refills between hardware entropy reseeds
+#define SECURE_RANDOM_RESEED_REFILLS 64
+
+/**
+ * @brief ChaCha20-based deterministic random bit generator with a pool.
+ */
+class SecureRandom {
+private:
+    uint8_t key[32];                    ///< Current generator key
+    uint8_t pool[SECURE_RANDOM_POOL];   ///< Buffered output
+    size_t pool_pos = SECURE_RANDOM_POOL; ///< Next unserved byte in pool
+    uint32_t refills = 0;               ///< Refills since last reseed
+    bool seeded = false;                ///< True once a seed was absorbed
+    bool deterministic = false;         ///< True if seeded explicitly (no hardware reseed)
+
+    /** @brief Regenerate the pool and rotate the key. */
+    void refill();
+
+    /**
+     * @brief Mix seed material into the key.
+     * @param seed Seed bytes.
+     * @param len Seed length.
+     */
+    void absorb(const uint8_t* seed, size_t len);
+
+public:
+    /**
+     * @brief Seed from the platform entropy source.
+     *
+     * Called automatically on first use if nothing was seeded.
+     */
+    void seedFromHardware();
+
+    /**
+     * @brief Seed deterministically (host builds and tests).
+     *
+     * Disables hardware reseeding, so the output stream is reproducible.
+     *
+     * @param seed Seed bytes.
+     * @param len Seed length.
+     */
+    void seed(const uint8_t* seed, size_t len);
+
+    /**
+     * @brief Fill a buffer with random bytes.
+     * @param out Output buffer.
+     * @param len Number of bytes.
+     */
+    void fill(uint8_t* out, size_t len);
+
+    /**
+     * @brief Uniform integer in [0, bound) without modulo bias.
+     * @param bound Exclusive upper bound (1..256).
+     * @return Random value.
+     */
+    uint8_t uniform(uint16_t bound);
+
+    /**
+     * @brief Refill the pool if it is running low.
+     *
+     * @note Call from loop(); does nothing when the pool is still full enough.
+     */
+    void idle();
+
+    /** @brief Bytes currently available without a refill. */
+    size_t available() const { return SECURE_RANDOM_POOL - pool_pos; }
+};
+
+/// @brief Global random source (defined in WakeLink.ino)
+extern SecureRandom secureRandom;
+
+#endif // SECURE_RANDOM_H
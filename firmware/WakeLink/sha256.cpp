@@ -0,0 +1,177 @@
+/**
+ * @file sha256.cpp
+ * @brief SHA-256 compression function and HMAC-SHA256 midstate caching.
+ */
+
+#include "sha256.h"
+#include <string.h>
+
+// SHA256 constants
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SIGMA0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define SIGMA1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define GAMMA0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define GAMMA1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+/**
+ * @brief Compress one 64-byte block into state.
+ *
+ * Uses a rolling 16-word message schedule to keep stack usage low.
+ */
+static void sha256_transform(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[16];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int32_t i = 0; i < 64; i++) {
+        uint32_t wi;
+        if (i < 16) {
+            wi = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+                 ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+        } else {
+            wi = GAMMA1(w[(i - 2) & 15]) + w[(i - 7) & 15] + GAMMA0(w[(i - 15) & 15]) + w[i & 15];
+        }
+        w[i & 15] = wi;
+
+        uint32_t t1 = h + SIGMA1(e) + CH(e, f, g) + SHA256_K[i] + wi;
+        uint32_t t2 = SIGMA0(a) + MAJ(a, b, c);
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// ==================== SHA-256 ====================
+
+void Sha256Ctx::init() {
+    bitlen = 0;
+    buffer_len = 0;
+    state[0] = 0x6a09e667; state[1] = 0xbb67ae85;
+    state[2] = 0x3c6ef372; state[3] = 0xa54ff53a;
+    state[4] = 0x510e527f; state[5] = 0x9b05688c;
+    state[6] = 0x1f83d9ab; state[7] = 0x5be0cd19;
+}
+
+void Sha256Ctx::update(const uint8_t* data, size_t len) {
+    // Top up a pending partial block first
+    if (buffer_len > 0) {
+        size_t take = 64 - buffer_len;
+        if (take > len) take = len;
+        memcpy(buffer + buffer_len, data, take);
+        buffer_len += take;
+        data += take;
+        len -= take;
+        if (buffer_len < 64) return;
+        sha256_transform(state, buffer);
+        bitlen += 512;
+        buffer_len = 0;
+    }
+
+    // Whole blocks are compressed straight from the input
+    while (len >= 64) {
+        sha256_transform(state, data);
+        bitlen += 512;
+        data += 64;
+        len -= 64;
+    }
+
+    if (len > 0) {
+        memcpy(buffer, data, len);
+        buffer_len = len;
+    }
+}
+
+void Sha256Ctx::final(uint8_t hash[32]) {
+    uint32_t i = buffer_len;
+    uint64_t total = bitlen + (uint64_t)buffer_len * 8;
+
+    // Append '1' bit
+    buffer[i++] = 0x80;
+
+    // Pad with zeros until 56 bytes
+    if (i > 56) {
+        memset(buffer + i, 0, 64 - i);
+        sha256_transform(state, buffer);
+        i = 0;
+    }
+    memset(buffer + i, 0, 56 - i);
+
+    // Append message length (in bits) - BIG ENDIAN
+    for (int32_t k = 0; k < 8; k++) {
+        buffer[56 + k] = (uint8_t)(total >> (56 - k * 8));
+    }
+    sha256_transform(state, buffer);
+
+    // Get final hash - BIG ENDIAN
+    for (int32_t k = 0; k < 8; k++) {
+        hash[k * 4]     = (uint8_t)(state[k] >> 24);
+        hash[k * 4 + 1] = (uint8_t)(state[k] >> 16);
+        hash[k * 4 + 2] = (uint8_t)(state[k] >> 8);
+        hash[k * 4 + 3] = (uint8_t)state[k];
+    }
+}
+
+void Sha256Ctx::hash(const uint8_t* data, size_t len, uint8_t hash[32]) {
+    Sha256Ctx ctx;
+    ctx.init();
+    ctx.update(data, len);
+    ctx.final(hash);
+}
+
+// ==================== HMAC-SHA256 ====================
+
+void HmacSha256Ctx::begin(const uint8_t* key, size_t key_len) {
+    uint8_t pad[64];
+    uint8_t key_hash[32];
+
+    // Prepare key
+    if (key_len > 64) {
+        Sha256Ctx::hash(key, key_len, key_hash);
+        key = key_hash;
+        key_len = 32;
+    }
+
+    memset(pad, 0, sizeof(pad));
+    memcpy(pad, key, key_len);
+    for (size_t i = 0; i < 64; i++) pad[i] ^= 0x36;
+    inner.init();
+    inner.update(pad, 64);
+
+    // Flip ipad to opad: 0x36 ^ 0x5C = 0x6A
+    for (size_t i = 0; i < 64; i++) pad[i] ^= 0x6A;
+    outer.init();
+    outer.update(pad, 64);
+
+    memset(pad, 0, sizeof(pad));
+    memset(key_hash, 0, sizeof(key_hash));
+}
+
+void HmacSha256Ctx::finish(Sha256Ctx& msg, uint8_t mac[32]) const {
+    uint8_t inner_hash[32];
+    msg.final(inner_hash);
+
+    Sha256Ctx out = outer;
+    out.update(inner_hash, 32);
+    out.final(mac);
+}
+
+void HmacSha256Ctx::compute(const uint8_t* data, size_t len, uint8_t mac[32]) const {
+    Sha256Ctx msg = inner;
+    msg.update(data, len);
+    finish(msg, mac);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file sha256.h
+ * @brief Reentrant SHA-256 and HMAC-SHA256 contexts (FIPS 180-4, RFC 2104).
+ *
+ * Sha256Ctx is a plain value type: it can live on the stack, be copied
+ * to snapshot a midstate, and several can be active at once.
+ *
+ * HmacSha256Ctx absorbs the ipad/opad key blocks once in begin() and
+ * keeps the two resulting midstates. Each message then starts from a
+ * copy of the inner midstate, so a MAC costs only the message blocks
+ * plus one outer block instead of re-hashing both key pads. After
+ * begin() the context is read-only, so one instance can be shared by
+ * the TCP and WSS transports.
+ *
+ * @note Pure C++ with no Arduino dependencies.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Streaming SHA-256 context.
+ */
+class Sha256Ctx {
+private:
+    uint32_t state[8];       ///< Hash state (8x32-bit words)
+    uint8_t buffer[64];      ///< Pending partial block
+    uint64_t bitlen;         ///< Bits compressed so far
+    uint32_t buffer_len;     ///< Bytes in buffer
+
+public:
+    /** @brief Reset to the SHA-256 initial hash value. */
+    void init();
+
+    /**
+     * @brief Absorb data.
+     * @param data Input bytes.
+     * @param len Input length.
+     */
+    void update(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Pad, compress and output the digest.
+     * @param hash 32-byte output buffer.
+     */
+    void final(uint8_t hash[32]);
+
+    /**
+     * @brief One-shot SHA-256.
+     * @param data Input bytes.
+     * @param len Input length.
+     * @param hash 32-byte output buffer.
+     */
+    static void hash(const uint8_t* data, size_t len, uint8_t hash[32]);
+};
+
+/**
+ * @brief HMAC-SHA256 key context with cached ipad/opad midstates.
+ */
+class HmacSha256Ctx {
+private:
+    Sha256Ctx inner;  ///< State after absorbing key ^ ipad
+    Sha256Ctx outer;  ///< State after absorbing key ^ opad
+
+public:
+    /**
+     * @brief Precompute inner and outer key states.
+     * @param key HMAC key.
+     * @param key_len Key length (keys over 64 bytes are hashed first).
+     */
+    void begin(const uint8_t* key, size_t key_len);
+
+    /**
+     * @brief Start a message: copy the cached inner midstate.
+     * @param msg Per-message context to initialise.
+     */
+    void start(Sha256Ctx& msg) const { msg = inner; }
+
+    /**
+     * @brief Finish a message started with start().
+     * @param msg Per-message context (consumed).
+     * @param mac 32-byte output buffer.
+     */
+    void finish(Sha256Ctx& msg, uint8_t mac[32]) const;
+
+    /**
+     * @brief MAC a complete message from the cached midstates.
+     * @param data Message bytes.
+     * @param len Message length.
+     * @param mac 32-byte output buffer.
+     */
+    void compute(const uint8_t* data, size_t len, uint8_t mac[32]) const;
+};
+
+#endif // SHA256_H
@@ -1,11 +1,15 @@
 #include "tcp_handler.h"
 #include "command.h"
+#include "request_arena.h"
+#include "response_stream.h"
 #include "platform.h"
+#include <new>
 
 /**
  * @brief Start the TCP server and log its listening port.
  */
 void TCPHandler::begin() {
+    pool.setFrameFormat(FRAME_V2_VERSION, FRAME_V2_HEADER, PacketManager::frameLength);
     server.begin();
     Serial.printf("TCP server started on port %d\n", TCP_PORT);
 }
@@ -21,88 +25,269 @@ WiFiClient TCPHandler::getClient() {
 }
 
 /**
- * @brief Read a single packet from the client and forward it for processing.
+ * @brief Accept new connections and advance the open ones.
  *
- * The handler waits until a newline or timeout, assembles the packet string,
- * and invokes `processClient`. The client is disconnected afterwards.
+ * Nothing here waits for the network: the pool takes whatever bytes
+ * each connection has, and only complete packets are processed, at
+ * most TCP_PIPELINE_DEPTH pipelined ones per connection and
+ * ADMISSION_MAX_PER_PASS in all per call, so loop() keeps running for
+ * WSS, the web server and OTA while clients trickle data in or flood
+ * the port.
  */
 void TCPHandler::handle() {
-    WiFiClient client = getClient();
-    if (!client) return;
-
-    char buffer[1024];
-    size_t len = 0;
-    unsigned long timeout = millis();
-
-    while (client.connected() && millis() - timeout < 5000) {
-        if (client.available()) {
-            int c = client.read();
-            if (c < 0) break;
-            if (len < sizeof(buffer) - 1) {
-                buffer[len++] = (char)c;
-            } else {
-                Serial.println("Packet too big, dropping");
-                break;
+    uint32_t now = millis();
+    acceptClients(now);
+    pool.poll(now);
+
+    // Round robin; packets refused by admission cost no crypto and are not counted
+    size_t processed = 0;
+    while (processed < ADMISSION_MAX_PER_PASS) {
+        ConnectionSlot* slot = pool.next();
+        if (!slot) break;
+        if (dispatch(*slot)) processed++;
+        pool.complete(*slot, millis());
+    }
+}
+
+/**
+ * @brief Move pending connections into pool slots, refusing the rest.
+ *
+ * Admission is decided on the remote address before anything is read,
+ * so a refused connection costs no parsing or crypto.
+ *
+ * @param now Current millis().
+ */
+void TCPHandler::acceptClients(uint32_t now) {
+    for (size_t i = 0; i < TCP_MAX_SESSIONS; i++) {
+        WiFiClient client = getClient();
+        if (!client) return;
+
+        uint32_t addr = client.remoteIP();
+        AdmissionVerdict verdict = admission.admitConnection(addr, pool.activeFrom(addr), now);
+        if (verdict != ADMIT_OK) {
+            client.stop();
+            logRefused("connection", addr, verdict, now);
+            continue;
+        }
+
+        int index = pool.reserve(now);
+        if (index < 0) {
+            client.stop();
+            if (refusedLog.allow(now)) {
+                Serial.printf("[TCP] All connection slots busy, refused (+%lu suppressed)\n",
+                              (unsigned long)refusedLog.takeSuppressed());
             }
-            if ((char)c == '\n') break;
+            continue;
         }
+        connections[index].client = client;
+        pool.attach((size_t)index, connections[index], now, addr);
     }
+}
 
-    if (len == 0) {
-        client.stop();
-        return;
+/**
+ * @brief Log a refusal, at most LOG_THROTTLE_LINES per window.
+ *
+ * @param what "connection" or "request".
+ * @param addr Remote address.
+ * @param verdict Reason.
+ * @param now Current millis().
+ */
+void TCPHandler::logRefused(const char* what, uint32_t addr, AdmissionVerdict verdict, uint32_t now) {
+    if (!refusedLog.allow(now)) return;
+    const uint8_t* ip = (const uint8_t*)&addr;
+    Serial.printf("[ADMIT] Refused %s from %u.%u.%u.%u (%s, +%lu suppressed)\n",
+                  what, ip[0], ip[1], ip[2], ip[3], AdmissionControl::verdictName(verdict),
+                  (unsigned long)refusedLog.takeSuppressed());
+}
+
+/**
+ * @brief Hand the complete message of a slot to processClient/processFrame.
+ *
+ * The message lies in the slot's receive buffer and is decoded there;
+ * the reply goes to the slot's send queue, which the pool flushes. A
+ * message its source may not send now is dropped with the connection,
+ * unread; one that fails authentication backs its source off.
+ *
+ * @param slot Slot holding a complete message.
+ * @return true if the message was processed (parsing and crypto ran).
+ */
+bool TCPHandler::dispatch(ConnectionSlot& slot) {
+    uint32_t now = millis();
+    AdmissionVerdict verdict = admission.admitRequest(slot.source, now);
+    if (verdict != ADMIT_OK) {
+        logRefused("request", slot.source, verdict, now);
+        pool.close(slot);
+        return false;
     }
 
-    buffer[len] = '\0';
-    String packetData = String(buffer);
-    packetData.trim();
-    Serial.printf("RX %u bytes\n", packetData.length());
+    if (rxLog.allow(now)) {
+        Serial.printf("RX %s%u bytes (+%lu suppressed)\n", slot.frame ? "frame " : "",
+                      (unsigned)slot.messageLength, (unsigned long)rxLog.takeSuppressed());
+    }
 
-    processClient(client, packetData);
+    bool queued;
+    bool rejected = false;
+    if (slot.frame) {
+        queued = processFrame(slot.tx, slot.message, slot.messageLength, rejected);
+    } else {
+        queued = processClient(slot.tx, (char*)slot.message, slot.messageLength, rejected);
+    }
+
+    if (rejected) {
+        admission.failed(slot.source, millis());
+    } else {
+        admission.succeeded(slot.source);
+    }
+
+    if (!queued) {
+        // Never send part of a reply: the client sees the connection close
+        Serial.println("[TCP] No memory for response, closing connection");
+        pool.close(slot);
+    }
+    return true;
 }
 
 /**
  * @brief Validate and dispatch an incoming packet from the TCP client.
  *
  * This method decrypts/validates the packet, executes the associated command,
- * and replies with either the command result or an error packet. The connection
- * is closed after replying.
+ * and serializes either the command result or an error packet into the send
+ * queue: the packet, then a static newline trailer. v1.x replies are sent
+ * as one line, so they are never fragmented here. A reply longer than
+ * TCP_TX_CHUNK is not sealed up front: a ResponseStream holding the
+ * result's JSON on the heap seals it one chunk at a time as the socket
+ * takes it. The connection stays open for the next packet. All other documents
+ * come from the request arena, which is reset when the scope closes; the
+ * queued bytes do not depend on it.
  *
- * @param client Connected client socket.
- * @param packetData Raw packet string received from the client.
+ * @param tx Send queue of the connection.
+ * @param packet Receive buffer holding the packet; decoded in place.
+ * @param length Packet length.
+ * @param rejected Set if the packet failed parsing or authentication.
+ * @return false if no buffer for the response could be allocated.
  */
-void TCPHandler::processClient(WiFiClient& client, const String& packetData) {
-    String response;
-    
-    JsonDocument incoming = packetManager->processIncomingPacket(packetData);
+bool TCPHandler::processClient(ResponseQueue& tx, char* packet, size_t length, bool& rejected) {
+    RequestScope scope(requestArena);
+    JsonDocument incoming = packetManager->processIncomingPacket(packet, length);
+    rejected = isRejected(incoming);
+    // Answer in the protocol version the request used (1.0 if unknown)
+    const char* version = incoming["version"] | PROTOCOL_V1_0;
     
+    JsonDocument result = executeIncoming(incoming);
+
+    size_t size = packetManager->measureResponse(result, version);
+    if (size + 1 > TCP_TX_CHUNK) {
+        ResponseStream* stream = new (std::nothrow) ResponseStream(*packetManager, version);
+        if (!stream) return false;
+        if (!stream->begin(result)) {
+            delete stream;
+            return false;
+        }
+        return tx.stream(stream);
+    }
+
+    uint8_t* out = tx.reserve(size);
+    if (!out) return false;
+
+    size_t outLen = packetManager->createResponsePacket(result, version, (char*)out, size);
+    tx.push(out, outLen);
+    tx.push("\n", 1);
+    return true;
+}
+
+/**
+ * @brief Validate and dispatch an incoming v2 frame from the TCP client.
+ *
+ * Same flow as processClient; the reply is a binary v2 frame without
+ * a trailing newline, or consecutive fragment frames when it does not
+ * fit one. Fragments are built back to back in one buffer, so they go
+ * out as a single segment.
+ *
+ * @param tx Send queue of the connection.
+ * @param frame Receive buffer holding the frame; decrypted in place.
+ * @param length Frame length.
+ * @param rejected Set if the frame failed parsing or authentication.
+ * @return false if no buffer for the response could be allocated.
+ */
+bool TCPHandler::processFrame(ResponseQueue& tx, uint8_t* frame, size_t length, bool& rejected) {
+    RequestScope scope(requestArena);
+    JsonDocument incoming = packetManager->processIncomingFrame(frame, length);
+    rejected = isRejected(incoming);
+    JsonDocument result = executeIncoming(incoming);
+
+    FragmentInfo fragment;
+    if (packetManager->planFragments(result, PROTOCOL_V2, fragment)) {
+        size_t size = (size_t)fragment.count * (FRAME_V2_HEADER + FRAGMENT_HEADER + FRAME_V2_TAG)
+                    + fragment.total;
+        uint8_t* out = tx.reserve(size);
+        if (!out) return false;
+
+        size_t used = 0;
+        for (; fragment.index < fragment.count; fragment.index++) {
+            size_t outLen = packetManager->createResponseFragment(result, fragment,
+                                                                  out + used, size - used);
+            if (!outLen) return false;
+            used += outLen;
+        }
+        tx.push(out, used);
+    } else {
+        uint8_t* out = tx.reserve(FRAME_V2_MAX);
+        if (!out) return false;
+
+        size_t outLen = packetManager->createResponseFrame(result, out, FRAME_V2_MAX);
+        tx.push(out, outLen);
+    }
+    return true;
+}
+
+/**
+ * @brief Whether a processed request failed before its command could run.
+ *
+ * @param incoming Processed request.
+ * @return true unless it authenticated (complete, or a stored fragment).
+ */
+bool TCPHandler::isRejected(JsonDocument& incoming) {
+    return incoming["status"] != "success" && incoming["status"] != "pending";
+}
+
+/**
+ * @brief Run the command of a processed request, or build its error reply.
+ *
+ * @param incoming Processed request.
+ * @return Response document with request_id echoed, or the "pending"
+ *         acknowledgement of a request fragment.
+ */
+JsonDocument TCPHandler::executeIncoming(JsonDocument& incoming) {
+    if (incoming["status"] == "pending") {
+        // Fragment stored; the command runs once the last one is in
+        JsonDocument ack(&requestJson);
+        ack["status"] = "pending";
+        ack["fragment"] = incoming["fragment"];
+        return ack;
+    }
+
     if (incoming["status"] == "success") {
         const char* command = incoming["command"];
-        String requestId = incoming["request_id"] | "unknown";
+        const char* requestId = incoming["request_id"] | "unknown";
         
         if (command && strlen(command) > 0) {
             JsonObject data = incoming["data"].as<JsonObject>();
-            JsonDocument result = CommandManager::executeCommand(String(command), data);
+            JsonDocument result = CommandManager::executeCommand(command, data);
             result["request_id"] = requestId;
-            response = packetManager->createResponsePacket(result);
-        } else {
-            JsonDocument error;
-            error["status"] = "error";
-            error["error"] = "NO_COMMAND_IN_JSON";
-            error["request_id"] = requestId;
-            response = packetManager->createResponsePacket(error);
+            return result;
         }
-    } else {
-        const char* err = incoming["error"] | "PACKET_ERROR";
-        JsonDocument errorResp;
-        errorResp["status"] = "error";
-        errorResp["error"] = err;
-        errorResp["request_id"] = incoming["request_id"];
-        response = packetManager->createResponsePacket(errorResp);
-    }
 
-    if (client.connected()) {
-        client.print(response + "\n");
+        JsonDocument error(&requestJson);
+        error["status"] = "error";
+        error["error"] = "NO_COMMAND_IN_JSON";
+        error["request_id"] = requestId;
+        return error;
     }
-    client.stop();
+
+    const char* err = incoming["error"] | "PACKET_ERROR";
+    JsonDocument errorResp(&requestJson);
+    errorResp["status"] = "error";
+    errorResp["error"] = err;
+    errorResp["request_id"] = incoming["request_id"];
+    return errorResp;
 }
\ No newline at end of file
@@ -3,20 +3,41 @@
  * @brief TCP server handler for local WakeLink communication.
  * 
  * Provides local network communication via TCP on port 99.
- * Handles encrypted protocol v1.0 packets from Python CLI
- * and other local clients.
+ * Handles encrypted protocol v1.0/v1.1 packets and v2 binary frames
+ * from Python CLI and other local clients.
  * 
  * Protocol:
- * - Each connection handles one packet (terminated by newline)
+ * - A connection carries newline-terminated packets and v2 frames (first
+ *   byte 0x02, length taken from its header), answered one by one in
+ *   the order received; clients may pipeline them and match replies by
+ *   their request_id
+ * - Connections are keep-alive sessions: they stay open after a reply
+ *   until the client closes or TCP_IDLE_TIMEOUT_MS pass without a packet;
+ *   clients that close after one reply work as before
+ * - Reading never blocks: every loop() pass advances all connections
+ *   by the bytes they have (connection_pool.h)
+ * - Writing never blocks either: a reply is serialized once into the
+ *   connection's send queue (response_queue.h) and sent as the TCP
+ *   send window allows; the next packet is read once it is all out.
+ *   A v1.x reply longer than TCP_TX_CHUNK is produced chunk by chunk
+ *   instead (response_stream.h), so it never needs its full size in RAM
+ * - Admission (admission.h) runs on the remote address before any
+ *   parsing or crypto: per-source token buckets and connection caps,
+ *   backoff after failed requests, and at most ADMISSION_MAX_PER_PASS
+ *   requests processed per loop() pass
+ * - A fragment of a larger request is answered with "pending"; the
+ *   assembler in PacketManager keeps it across packets and connections
  * - Packet is decrypted, command executed, response encrypted
- * - Connection closed after response sent
  * 
  * Packet Format:
  * - Outer JSON: {device_id, payload, signature, version}
  * - Payload: hex-encoded encrypted inner JSON
  * - Signature: HMAC-SHA256 of payload
+ * - v2: binary frame, see packet.h
  * 
- * @note Timeout: 5 seconds per connection.
+ * @note Up to TCP_MAX_SESSIONS connections; a packet must arrive whole
+ *       within TCP_READ_TIMEOUT_MS once its first byte is in, and its
+ *       reply must be taken by the client within TCP_WRITE_TIMEOUT_MS.
  * 
  * @author deadboizxc
  * @version 1.0
@@ -26,29 +47,118 @@
 #include "platform.h"
 #include "packet.h"
 #include "config.h"
+#include "connection_pool.h"
+#include "admission.h"
+#include "log_throttle.h"
+
+/**
+ * @brief NetConnection over a WiFiClient.
+ */
+class WiFiConnection : public NetConnection {
+public:
+    WiFiClient client;           ///< Accepted socket
+
+    int available() override { return client.available(); }
+    int read() override { return client.read(); }
+    int read(uint8_t* buf, size_t len) override { return client.read(buf, len); }
+    size_t writable() override { return getClientWritable(client); }
+    size_t write(const uint8_t* buf, size_t len) override { return client.write(buf, len); }
+    bool connected() override { return client.connected(); }
+    void stop() override { client.stop(); }
+};
 
 /**
  * @brief TCP server handler class.
  * 
  * Wraps WiFiServer to handle encrypted WakeLink protocol packets.
- * Each connection is processed synchronously: receive, decrypt,
- * execute command, encrypt response, send, close.
+ * Connections are advanced without blocking by a ConnectionPool; each
+ * complete packet is processed synchronously: decrypt, execute command,
+ * encrypt response, send. The connection then waits for the next one.
  */
 class TCPHandler {
 private:
     WiFiServer server;           ///< Underlying WiFi TCP server
     PacketManager* packetManager; ///< Packet encryption/decryption manager
+    ConnectionPool pool;         ///< Per-connection receive state
+    WiFiConnection connections[TCP_MAX_SESSIONS]; ///< Socket of each pool slot
+    AdmissionControl admission;  ///< Per-source rate limits and backoff
+    LogThrottle refusedLog;      ///< Refused connections and requests
+    LogThrottle rxLog;           ///< Per-request receive lines
+
+    /**
+     * @brief Move pending connections into free pool slots.
+     * 
+     * A connection is refused (closed unread) when admission turns its
+     * source away or every slot is busy receiving a message.
+     * 
+     * @param now Current millis().
+     */
+    void acceptClients(uint32_t now);
+
+    /**
+     * @brief Answer the complete message of a pool slot.
+     * 
+     * The request is checked by admission first; a refused one is
+     * dropped with its connection before parsing or crypto.
+     * 
+     * @param slot Slot returned by ConnectionPool::next().
+     * @return true if the message was processed.
+     */
+    bool dispatch(ConnectionSlot& slot);
 
     /**
-     * @brief Process received packet and send response.
+     * @brief Log a refused connection or request (throttled).
+     * 
+     * @param what "connection" or "request".
+     * @param addr Remote address.
+     * @param verdict Reason for the refusal.
+     * @param now Current millis().
+     */
+    void logRefused(const char* what, uint32_t addr, AdmissionVerdict verdict, uint32_t now);
+
+    /**
+     * @brief Process received packet and queue the response.
      * 
      * Decrypts packet, extracts command, executes via CommandManager,
-     * encrypts response, and sends back to client.
+     * and serializes the encrypted response once into the send queue
+     * of the connection; the pool sends it as the socket allows. A
+     * response longer than TCP_TX_CHUNK is streamed through a
+     * ResponseStream instead. The connection stays open.
+     * 
+     * @param tx Send queue of the connection (empty).
+     * @param packet Receive buffer (trimmed, without newline); decoded in place.
+     * @param length Packet length.
+     * @param rejected Set if the packet failed parsing or authentication.
+     * @return false if the response could not be queued (out of memory).
+     */
+    bool processClient(ResponseQueue& tx, char* packet, size_t length, bool& rejected);
+
+    /**
+     * @brief Process a received v2 frame and queue the response frame(s).
+     * 
+     * @param tx Send queue of the connection (empty).
+     * @param frame Receive buffer holding one complete frame; decrypted in place.
+     * @param length Frame length.
+     * @param rejected Set if the frame failed parsing or authentication.
+     * @return false if the response could not be queued (out of memory).
+     */
+    bool processFrame(ResponseQueue& tx, uint8_t* frame, size_t length, bool& rejected);
+
+    /**
+     * @brief Whether a processed request failed parsing or authentication.
+     * 
+     * @param incoming Result of processIncomingPacket/processIncomingFrame.
+     * @return true unless it succeeded or is a stored fragment.
+     */
+    static bool isRejected(JsonDocument& incoming);
+
+    /**
+     * @brief Execute the command of a processed request.
      * 
-     * @param client Connected client socket.
-     * @param packetData Raw packet string (trimmed, without newline).
+     * @param incoming Result of processIncomingPacket/processIncomingFrame.
+     * @return Command result, or an error document if processing failed.
      */
-    void processClient(WiFiClient& client, const String& packetData);
+    JsonDocument executeIncoming(JsonDocument& incoming);
 
     /**
      * @brief Accept next pending client connection.
@@ -79,10 +189,14 @@ public:
     void begin();
 
     /**
-     * @brief Handle pending TCP clients.
+     * @brief Handle pending TCP clients without blocking.
      * 
-     * Checks for new connections, reads packet data,
-     * and processes one client per call.
+     * Accepts new connections, advances every connection by the bytes
+     * it has, and answers the complete packets of each connection (up to
+     * TCP_PIPELINE_DEPTH when a client pipelines them, and at most
+     * ADMISSION_MAX_PER_PASS in all).
+     * Connections closed by the client, idle too long or too slow to
+     * send a packet are released.
      * 
      * @note Call from loop() every iteration.
      */
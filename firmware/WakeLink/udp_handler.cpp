@@ -1,5 +1,6 @@
 #include "udp_handler.h"
 #include "platform.h"
+#include "hex_codec.h"
 
 /**
  * @brief Open the UDP socket for sending WOL packets once the module is ready.
@@ -14,32 +15,35 @@ void initUDP() {
 }
 
 /**
- * @brief Build and send a Wake-on-LAN magic packet to the broadcast address.
+ * @brief Parse a MAC address string into 6 bytes.
  *
  * @param macStr MAC address string, delimiters ("-" or ":") are stripped.
+ * @param addr Receives the address.
+ * @return true if the string held exactly 12 hex digits.
  */
-void sendWOL(const String& macStr) {
-    String mac = macStr;
-    mac.replace(":", "");
-    mac.replace("-", "");
-    mac.toUpperCase();
-
-    if (mac.length() != 12) {
-        Serial.println("Invalid MAC address");
-        return;
-    }
-
-    uint8_t packet[102] = {0};
-
-    for (int i = 0; i < 6; ++i) {
-        packet[i] = 0xFF;
-    }
-
-    uint8_t addr[6];
-    for (int i = 0; i < 6; ++i) {
-        addr[i] = strtoul(mac.substring(i*2, i*2+2).c_str(), nullptr, 16);
+bool parseMac(const String& macStr, uint8_t addr[6]) {
+    size_t digits = 0;
+    for (size_t i = 0; i < macStr.length(); i++) {
+        char c = macStr[i];
+        if (c == ':' || c == '-') continue;
+        int8_t v = HexCodec::nibble(c);
+        if (v < 0 || digits == 12) return false;
+        if (digits % 2 == 0) addr[digits / 2] = (uint8_t)(v << 4);
+        else addr[digits / 2] |= (uint8_t)v;
+        digits++;
     }
+    return digits == 12;
+}
 
+/**
+ * @brief Build and send a Wake-on-LAN magic packet to the broadcast address.
+ *
+ * @param addr Target MAC address.
+ * @return true if the packet was handed to the UDP stack.
+ */
+bool sendWOL(const uint8_t addr[6]) {
+    uint8_t packet[102];
+    memset(packet, 0xFF, 6);
     for (int i = 1; i <= 16; ++i) {
         memcpy(packet + i*6, addr, 6);
     }
@@ -47,8 +51,26 @@ void sendWOL(const String& macStr) {
     if (udp.beginPacket(IPAddress(255,255,255,255), 9)) {
         udp.write(packet, 102);
         udp.endPacket();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Build and send a Wake-on-LAN magic packet to the broadcast address.
+ *
+ * @param macStr MAC address string, delimiters ("-" or ":") are stripped.
+ */
+void sendWOL(const String& macStr) {
+    uint8_t addr[6];
+    if (!parseMac(macStr, addr)) {
+        Serial.println("Invalid MAC address");
+        return;
+    }
+
+    if (sendWOL(addr)) {
         Serial.println("WOL packet sent: " + macStr);
     } else {
         Serial.println("Failed to send WOL packet");
     }
-}
\ No newline at end of file
+}
@@ -45,4 +45,19 @@ void initUDP();
  */
 void sendWOL(const String& macStr);
 
+/**
+ * @brief Parse a MAC address ("AA:BB:CC:DD:EE:FF", "AA-BB-...", or 12 hex digits).
+ * @param macStr MAC address string.
+ * @param addr Receives the 6 address bytes.
+ * @return true if the address is valid.
+ */
+bool parseMac(const String& macStr, uint8_t addr[6]);
+
+/**
+ * @brief Send a Wake-on-LAN magic packet to a parsed address (no logging).
+ * @param addr Target MAC address.
+ * @return true if the packet was handed to the UDP stack.
+ */
+bool sendWOL(const uint8_t addr[6]);
+
 #endif // UDP_HANDLER_H
\ No newline at end of file
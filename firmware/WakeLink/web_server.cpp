@@ -140,8 +140,6 @@ void initWebServer() {
         html += F("</div></div>");
         html += F("<div class='status-item'><div class='status-label'>Requests</div><div class='status-value'>");
         html += String(crypto.getRequestCount());
-        html += F(" / ");
-        html += String(crypto.getRequestLimit());
         html += F("</div></div>");
         html += F("<div class='status-item'><div class='status-label'>Free Heap</div><div class='status-value'>");
         html += String(ESP.getFreeHeap());
@@ -1,5 +1,6 @@
 #include "wifi_manager.h"
 #include "platform.h"
+#include "command_cache.h"
 
 /**
  * @brief Initialize WiFi connection.
@@ -29,6 +30,7 @@ void initWiFi() {
             Serial.println(F("WiFi Connected"));
             Serial.printf("IP: %s\n", WiFi.localIP().toString().c_str());
             inAPMode = false;
+            commandCache.invalidate(CACHE_ALL);
             return;
         } else {
             Serial.println(F("WiFi connection failed"));
@@ -60,6 +62,7 @@ void handleWiFi() {
 
             if (WiFi.status() != WL_CONNECTED) {
                 Serial.println(F("WiFi disconnected, reconnecting..."));
+                commandCache.invalidate(CACHE_ALL);
                 WiFi.reconnect();
                 delay(1000);
 
@@ -73,6 +76,7 @@ void handleWiFi() {
                     startAP();
                 } else {
                     Serial.println(F("WiFi reconnected"));
+                    commandCache.invalidate(CACHE_ALL);
                 }
             }
         }
@@ -88,6 +92,7 @@ void handleWiFi() {
 void startAP() {
     inAPMode = true;
     apModeStartTime = millis();
+    commandCache.invalidate(CACHE_ALL);
 
     WiFi.disconnect();
     delay(100);
@@ -0,0 +1,447 @@
+/**
+ * @file admission_sim.cpp
+ * @brief Host load test for admission control under a connection flood.
+ *
+ * Runs ConnectionPool and AdmissionControl (firmware/WakeLink/) against
+ * real loopback sockets, single-threaded like loop() on the device. The
+ * server pass does what TCPHandler::handle() does: admit at accept on
+ * the remote address, poll, then admit and "process" each request. The
+ * crypto and parsing of a request are simulated by spinning for
+ * SIM_CRYPTO_US, roughly an HMAC check plus JSON on an ESP8266.
+ *
+ * Traffic, every client with its own 127.0.0.x source address:
+ * - legit: one wake request every SIM_LEGIT_PERIOD_MS on a new connection
+ *   (like the CLI), answered "OK" when genuine; it starts SIM_WARMUP_MS
+ *   into the flood (at onset, before the first failures are in, new
+ *   flooders can still hold every slot; see "slots_busy")
+ * - flood: SIM_FLOOD_SOURCES hosts keep SIM_FLOOD_CONNS connections each,
+ *   streaming bad packets that fail authentication and reconnecting as
+ *   soon as they are closed
+ * - scan: one host opens and drops connections without sending
+ *
+ * The same traffic runs twice, with admission off (every request is
+ * processed, as before) and on. Reported per run: wake requests answered,
+ * their latency (connect to reply), crypto operations spent on the flood,
+ * refusals, and the longest server pass. With admission on every wake
+ * request must be answered quickly and the flood must cost only a handful
+ * of crypto operations per source. JSON on stdout; exits non-zero on
+ * failure.
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -IWakeLink host/admission_sim.cpp WakeLink/admission.cpp \
+ *       WakeLink/connection_pool.cpp WakeLink/frame_reader.cpp \
+ *       WakeLink/response_queue.cpp -o admission_sim
+ *
+ * Usage: ./admission_sim [run-ms]   (default 3000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "admission.h"
+#include "connection_pool.h"
+#include "host_test.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// @brief Simulated parse + crypto cost of one request
+#define SIM_CRYPTO_US 2000
+
+/// @brief Interval between wake requests (2 tokens each: connection + request)
+#define SIM_LEGIT_PERIOD_MS 600
+
+/// @brief Flood time before the first wake request
+#define SIM_WARMUP_MS 250
+
+/// @brief Flooding hosts and connections each keeps open
+#define SIM_FLOOD_SOURCES 8
+#define SIM_FLOOD_CONNS 4
+
+/// @brief Bad packets written per flood connection per step
+#define SIM_FLOOD_BATCH 4
+
+static int listener = -1;
+static sockaddr_in serverAddr;
+static ConnectionPool* pool = nullptr;
+static AdmissionControl* admission = nullptr;
+static PosixConnection conns[TCP_MAX_SESSIONS];
+
+/**
+ * @brief Counters of one run.
+ */
+struct RunStats {
+    unsigned long passes = 0;
+    double maxPassMs = 0;
+    unsigned long maxPassOps = 0;      ///< Most requests processed in one pass
+    unsigned long cryptoOps = 0;       ///< Requests processed (all sources)
+    unsigned long floodCryptoOps = 0;  ///< Requests processed that failed authentication
+    unsigned long refusedAccept = 0;   ///< Connections closed unread by admission
+    unsigned long refusedRequest = 0;  ///< Requests dropped by admission
+    unsigned long slotsBusy = 0;       ///< Connections refused by the pool
+};
+
+static RunStats stats;
+static bool admissionOn = false;
+
+static uint32_t nowMs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Stand-in for HMAC/AEAD and JSON work on the device
+static void spendCrypto() {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(SIM_CRYPTO_US);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+/**
+ * @brief Process one request and queue its reply, the way TCPHandler does.
+ * @return true if the request was processed.
+ */
+static bool dispatch(ConnectionSlot& slot, uint32_t now) {
+    if (admissionOn && admission->admitRequest(slot.source, now) != ADMIT_OK) {
+        stats.refusedRequest++;
+        pool->close(slot);
+        return false;
+    }
+
+    spendCrypto();
+    stats.cryptoOps++;
+    bool genuine = slot.messageLength >= 4 && memcmp(slot.message, "WAKE", 4) == 0;
+    if (genuine) {
+        admission->succeeded(slot.source);
+    } else {
+        stats.floodCryptoOps++;
+        admission->failed(slot.source, nowMs());
+    }
+
+    static const char ok[] = "OK\n";
+    static const char err[] = "ERR\n";
+    if (genuine) {
+        slot.tx.push(ok, 3);
+    } else {
+        slot.tx.push(err, 4);
+    }
+    return true;
+}
+
+/**
+ * @brief One loop() pass of the device: accept, poll, answer.
+ */
+static void serverPass() {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t now = nowMs();
+
+    for (size_t i = 0; i < TCP_MAX_SESSIONS; i++) {
+        sockaddr_in peer;
+        socklen_t peerLen = sizeof(peer);
+        int fd = accept4(listener, (sockaddr*)&peer, &peerLen, SOCK_NONBLOCK);
+        if (fd < 0) break;
+
+        uint32_t addr = peer.sin_addr.s_addr;  // Network order, like IPAddress
+        if (admissionOn && admission->admitConnection(addr, pool->activeFrom(addr), now) != ADMIT_OK) {
+            close(fd);
+            stats.refusedAccept++;
+            continue;
+        }
+        int index = pool->reserve(now);
+        if (index < 0) {
+            close(fd);
+            stats.slotsBusy++;
+            continue;
+        }
+        conns[index].fd = fd;
+        pool->attach((size_t)index, conns[index], now, addr);
+    }
+
+    pool->poll(now);
+    size_t processed = 0;
+    while (!admissionOn || processed < ADMISSION_MAX_PER_PASS) {
+        ConnectionSlot* slot = pool->next();
+        if (!slot) break;
+        if (dispatch(*slot, now)) processed++;
+        pool->complete(*slot, nowMs());
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (ms > stats.maxPassMs) stats.maxPassMs = ms;
+    if (processed > stats.maxPassOps) stats.maxPassOps = processed;
+    stats.passes++;
+}
+
+/**
+ * @brief Non-blocking connect from 127.0.0.<host>.
+ */
+static int connectFrom(uint8_t host) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(0x7F000000u | host);
+    int flags = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flags, sizeof(flags));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof(flags));
+    if (bind(fd, (sockaddr*)&local, sizeof(local)) != 0) {
+        perror("bind");
+        exit(2);
+    }
+    if (connect(fd, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Non-blocking receive; -1 once the server has closed.
+ */
+static int pollClosed(int fd, std::string& in) {
+    char buf[512];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            in.append(buf, (size_t)n);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOTCONN)) return -1;
+        return 0;
+    }
+}
+
+// ==================== CLIENTS ====================
+
+struct LegitClient {
+    int fd = -1;
+    uint32_t started = 0;        ///< Connect time of the request in flight
+    uint32_t nextAt = 0;         ///< Time of the next request
+    bool written = false;
+    std::string in;
+    unsigned long sent = 0;
+    unsigned long answered = 0;
+    unsigned long lost = 0;      ///< Connection closed without "OK"
+    std::vector<uint32_t> latency;
+};
+
+struct FloodConn {
+    uint8_t host = 0;
+    int fd = -1;
+    std::string in;
+};
+
+static void stepLegit(LegitClient& c, uint32_t now) {
+    if (c.fd < 0) {
+        if ((int32_t)(now - c.nextAt) < 0) return;
+        c.fd = connectFrom(2);
+        c.started = now;
+        c.nextAt = now + SIM_LEGIT_PERIOD_MS;
+        c.written = false;
+        c.in.clear();
+        c.sent++;
+        return;
+    }
+
+    if (!c.written) {
+        char msg[32];
+        int n = snprintf(msg, sizeof(msg), "WAKE %lu\n", c.sent);
+        if (send(c.fd, msg, (size_t)n, MSG_DONTWAIT | MSG_NOSIGNAL) == n) c.written = true;
+    }
+
+    bool closed = pollClosed(c.fd, c.in) < 0;
+    if (c.in.find('\n') != std::string::npos) {
+        if (c.in.compare(0, 3, "OK\n") == 0) {
+            c.answered++;
+            c.latency.push_back(now - c.started);
+        } else {
+            c.lost++;
+        }
+    } else if (closed) {
+        c.lost++;
+    } else {
+        return;
+    }
+    close(c.fd);
+    c.fd = -1;
+}
+
+static void stepFlood(FloodConn& f) {
+    if (f.fd < 0) {
+        f.fd = connectFrom(f.host);
+        f.in.clear();
+        return;
+    }
+    static const char bad[] =
+        "{\"device_id\":\"x\",\"payload\":\"00\",\"signature\":\"00\",\"version\":\"1.0\"}\n";
+    for (int i = 0; i < SIM_FLOOD_BATCH; i++) {
+        if (send(f.fd, bad, sizeof(bad) - 1, MSG_DONTWAIT | MSG_NOSIGNAL) <= 0) break;
+    }
+    if (pollClosed(f.fd, f.in) < 0) {
+        close(f.fd);
+        f.fd = -1;
+    }
+}
+
+static void stepScan(int& fd) {
+    if (fd >= 0) close(fd);
+    fd = connectFrom(30);
+}
+
+static void freshServer() {
+    if (pool) {
+        for (size_t i = 0; i < TCP_MAX_SESSIONS; i++) pool->close(pool->slot(i));
+        delete pool;
+    }
+    delete admission;
+    pool = new ConnectionPool();
+    admission = new AdmissionControl();
+    stats = RunStats();
+}
+
+/**
+ * @brief Most failed requests one flooding host can get processed in ms.
+ *
+ * One per backoff period, the periods doubling, plus one in flight.
+ */
+static unsigned long failureBound(uint32_t ms) {
+    unsigned long n = 1;
+    uint32_t t = 0, backoff = ADMISSION_BACKOFF_MS;
+    while (t + backoff <= ms) {
+        t += backoff;
+        n++;
+        backoff = std::min<uint32_t>(backoff * 2, ADMISSION_BACKOFF_MAX_MS);
+    }
+    return n + 1;
+}
+
+/// @brief Latency at a percentile (0..100)
+static uint32_t percentile(std::vector<uint32_t> v, int p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, v.size() * (size_t)p / 100)];
+}
+
+/**
+ * @brief Run the traffic mix for ms with admission on or off.
+ */
+static void runLoad(bool on, uint32_t ms, bool last) {
+    admissionOn = on;
+    freshServer();
+
+    LegitClient legit;
+    std::vector<FloodConn> flood;
+    for (int s = 0; s < SIM_FLOOD_SOURCES; s++) {
+        for (int c = 0; c < SIM_FLOOD_CONNS; c++) {
+            FloodConn f;
+            f.host = (uint8_t)(10 + s);
+            flood.push_back(f);
+        }
+    }
+    int scanFd = -1;
+
+    uint32_t start = nowMs();
+    legit.nextAt = start + SIM_WARMUP_MS;
+    while ((int32_t)(nowMs() - start - ms) < 0) {
+        uint32_t now = nowMs();
+        stepLegit(legit, now);
+        for (FloodConn& f : flood) stepFlood(f);
+        stepScan(scanFd);
+        serverPass();
+    }
+
+    // Let the wake request in flight finish, then drop everything
+    uint32_t end = nowMs() + 1000;
+    while (legit.fd >= 0 && (int32_t)(nowMs() - end) < 0) {
+        stepLegit(legit, nowMs());
+        serverPass();
+    }
+    if (legit.fd >= 0) {
+        legit.lost++;
+        close(legit.fd);
+    }
+    for (FloodConn& f : flood) {
+        if (f.fd >= 0) close(f.fd);
+    }
+    if (scanFd >= 0) close(scanFd);
+    end = nowMs() + 100;
+    while ((int32_t)(nowMs() - end) < 0) serverPass();
+
+    const char* name = on ? "admission_on" : "admission_off";
+    printf("  \"%s\": {\n", name);
+    printf("    \"wake_sent\": %lu,\n", legit.sent);
+    printf("    \"wake_answered\": %lu,\n", legit.answered);
+    printf("    \"wake_lost\": %lu,\n", legit.lost);
+    printf("    \"wake_latency_p50_ms\": %u,\n", percentile(legit.latency, 50));
+    printf("    \"wake_latency_p99_ms\": %u,\n", percentile(legit.latency, 99));
+    printf("    \"wake_latency_max_ms\": %u,\n", percentile(legit.latency, 100));
+    printf("    \"crypto_ops\": %lu,\n", stats.cryptoOps);
+    printf("    \"flood_crypto_ops\": %lu,\n", stats.floodCryptoOps);
+    printf("    \"refused_accept\": %lu,\n", stats.refusedAccept);
+    printf("    \"refused_request\": %lu,\n", stats.refusedRequest);
+    printf("    \"slots_busy\": %lu,\n", stats.slotsBusy);
+    printf("    \"evicted\": %u,\n", pool->getEvicted());
+    printf("    \"refused_rate\": %u,\n", admission->getRefusedRate());
+    printf("    \"refused_backoff\": %u,\n", admission->getRefusedBackoff());
+    printf("    \"refused_busy\": %u,\n", admission->getRefusedBusy());
+    printf("    \"server_passes\": %lu,\n", stats.passes);
+    printf("    \"max_pass_ops\": %lu,\n", stats.maxPassOps);
+    printf("    \"max_pass_ms\": %.3f\n", stats.maxPassMs);
+    printf("  }%s\n", last ? "" : ",");
+
+    static unsigned long floodOff = 0;
+    if (!on) {
+        floodOff = stats.floodCryptoOps;
+        return;
+    }
+
+    // Every wake request answered, none waiting behind the flood
+    EXPECT(legit.sent > 0);
+    EXPECT(legit.answered == legit.sent);
+    EXPECT(percentile(legit.latency, 99) < 50);
+
+    // Backoff: a few failed requests per flooding host, not one per packet
+    EXPECT(stats.floodCryptoOps <= SIM_FLOOD_SOURCES * failureBound(ms));
+    EXPECT(stats.floodCryptoOps * 10 < floodOff);
+    EXPECT(stats.refusedAccept > 0);
+
+    // At most ADMISSION_MAX_PER_PASS crypto operations per pass (counted: pass time depends on host load)
+    EXPECT(stats.maxPassOps <= ADMISSION_MAX_PER_PASS);
+}
+
+int main(int argc, char** argv) {
+    int ms = argc > 1 ? atoi(argv[1]) : 3000;
+    if (ms <= 0) ms = 3000;
+
+    listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(serverAddr);
+    if (bind(listener, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0 || listen(listener, 64) != 0 ||
+        getsockname(listener, (sockaddr*)&serverAddr, &addrLen) != 0) {
+        perror("listen");
+        return 2;
+    }
+
+    printf("{\n");
+    printf("  \"slots\": %d,\n", TCP_MAX_SESSIONS);
+    printf("  \"crypto_us\": %d,\n", SIM_CRYPTO_US);
+    printf("  \"flood_sources\": %d,\n", SIM_FLOOD_SOURCES);
+    runLoad(false, (uint32_t)ms, false);
+    runLoad(true, (uint32_t)ms, false);
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    close(listener);
+    return failures ? 1 : 0;
+}
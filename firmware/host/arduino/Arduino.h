@@ -0,0 +1,229 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for native builds of the packet pipeline.
+ *
+ * Just enough of String, Print, Stream, Serial, ESP and the timing
+ * functions for PacketManager, CryptoManager and their dependencies to
+ * compile and run on Linux (fuzz targets and benchmarks in firmware/host).
+ * The shape is that of the ESP32 core, since platform.h takes its ESP32
+ * branch when ESP8266 is not defined.
+ *
+ * Builds must pass -DARDUINO (as the Arduino toolchain does), so that
+ * request_arena.h and flash_region.h pick their device parts, and
+ * -Ihost/arduino ahead of -IWakeLink. Serial output is discarded unless
+ * WAKELINK_SERIAL is set in the environment.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#ifndef ARDUINO
+#error "Native pipeline builds must define ARDUINO (-DARDUINO=10819)"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+
+#define HEX 16
+#define DEC 10
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long max);
+long random(long min, long max);
+
+// ==================== String ====================
+
+/**
+ * @brief Arduino String over std::string.
+ */
+class String {
+private:
+    std::string s;
+
+public:
+    String() {}
+    String(const char* str) : s(str ? str : "") {}
+    String(const String& other) = default;
+    String(char c) : s(1, c) {}
+    String(int v, unsigned char base = DEC) : String((long)v, base) {}
+    String(unsigned int v, unsigned char base = DEC) : String((unsigned long)v, base) {}
+    String(long v, unsigned char base = DEC) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%ld", v);
+        s = buf;
+    }
+    String(unsigned long v, unsigned char base = DEC) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%lu", v);
+        s = buf;
+    }
+    String(float v, unsigned char decimals = 2) : String((double)v, decimals) {}
+    String(double v, unsigned char decimals = 2) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        s = buf;
+    }
+
+    String& operator=(const String& other) = default;
+    String& operator=(const char* str) { s = str ? str : ""; return *this; }
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return (unsigned int)s.size(); }
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+    bool concat(const char* str) { if (str) s += str; return true; }
+    bool concat(const char* str, unsigned int len) { s.append(str, len); return true; }
+    bool concat(const String& str) { s += str.s; return true; }
+    bool concat(char c) { s += c; return true; }
+
+    String& operator+=(const char* str) { concat(str); return *this; }
+    String& operator+=(const String& str) { concat(str); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* str) const { return s == (str ? str : ""); }
+    bool operator!=(const String& other) const { return s != other.s; }
+    bool operator!=(const char* str) const { return !(*this == str); }
+    char operator[](unsigned int i) const { return i < s.size() ? s[i] : 0; }
+
+    bool startsWith(const char* prefix) const { return s.compare(0, strlen(prefix), prefix) == 0; }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t at = s.find(c, from);
+        return at == std::string::npos ? -1 : (int)at;
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > s.size()) from = s.size();
+        if (to > s.size()) to = s.size();
+        return String(s.substr(from, to > from ? to - from : 0).c_str());
+    }
+    String substring(unsigned int from) const { return substring(from, length()); }
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+
+// ==================== Print / Stream ====================
+
+/**
+ * @brief Byte sink; subclasses implement write(uint8_t).
+ */
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+
+    size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+    size_t print(const char* str) { return write(str); }
+    size_t print(const String& str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(int v) { return print((long)v); }
+    size_t print(unsigned int v) { return print((unsigned long)v); }
+
+    size_t println() { return write("\n"); }
+    template <typename T> size_t println(T v) { return print(v) + println(); }
+
+    // Checked like the cores' Print::printf; pass uint32_t to %lu as (unsigned long)
+    __attribute__((format(printf, 2, 3)))
+    size_t printf(const char* format, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+    }
+};
+
+/**
+ * @brief Readable byte source (ArduinoJson reads documents from it).
+ */
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        while (n < length) {
+            int c = read();
+            if (c < 0) break;
+            buffer[n++] = (char)c;
+        }
+        return n;
+    }
+
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    void setTimeout(unsigned long) {}
+};
+
+/**
+ * @brief Serial console (stderr when WAKELINK_SERIAL is set).
+ */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// ==================== ESP ====================
+
+/**
+ * @brief Chip services used by the firmware diagnostics.
+ */
+class EspClass {
+public:
+    /** @brief Time base for the *_cycles diagnostics (TSC, or ns where there is none). */
+    uint32_t getCycleCount();
+    uint32_t getFreeHeap() { return 200000; }
+    uint32_t getMaxAllocHeap() { return 110000; }
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ull; }
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,11 @@
+/**
+ * @file ArduinoOTA.h
+ * @brief Empty stand-in for native builds; the pipeline does not use it.
+ */
+
+#ifndef HOST_ARDUINO_OTA_H
+#define HOST_ARDUINO_OTA_H
+
+#include <WiFi.h>
+
+#endif // HOST_ARDUINO_OTA_H
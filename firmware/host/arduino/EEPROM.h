@@ -0,0 +1,36 @@
+/**
+ * @file EEPROM.h
+ * @brief RAM-backed EEPROM for native builds.
+ */
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+/// @brief Emulated EEPROM size (platform.h uses 1024)
+#define HOST_EEPROM_SIZE 4096
+
+/**
+ * @brief EEPROM with the ESP commit() model; contents live for the process.
+ */
+class EEPROMClass {
+private:
+    uint8_t data[HOST_EEPROM_SIZE];
+    uint32_t commits = 0;
+
+public:
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+    void begin(size_t) {}
+    uint8_t read(int address) const { return address >= 0 && address < HOST_EEPROM_SIZE ? data[address] : 0xFF; }
+    void write(int address, uint8_t value) { if (address >= 0 && address < HOST_EEPROM_SIZE) data[address] = value; }
+    bool commit() { commits++; return true; }
+    void end() {}
+
+    /** @brief commit() calls so far (benchmarks report persistence cost). */
+    uint32_t getCommits() const { return commits; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
@@ -0,0 +1,11 @@
+/**
+ * @file ESPmDNS.h
+ * @brief Empty stand-in for native builds; the pipeline does not use it.
+ */
+
+#ifndef HOST_ESP_MDNS_H
+#define HOST_ESP_MDNS_H
+
+#include <WiFi.h>
+
+#endif // HOST_ESP_MDNS_H
@@ -0,0 +1,11 @@
+/**
+ * @file HTTPClient.h
+ * @brief Empty stand-in for native builds; the pipeline does not use it.
+ */
+
+#ifndef HOST_HTTP_CLIENT_H
+#define HOST_HTTP_CLIENT_H
+
+#include <WiFi.h>
+
+#endif // HOST_HTTP_CLIENT_H
@@ -0,0 +1,18 @@
+/**
+ * @file WebServer.h
+ * @brief HTTP server type for native builds (declaration only).
+ */
+
+#ifndef HOST_WEB_SERVER_H
+#define HOST_WEB_SERVER_H
+
+#include <WiFi.h>
+
+class WebServer {
+public:
+    explicit WebServer(int) {}
+    void begin() {}
+    void handleClient() {}
+};
+
+#endif // HOST_WEB_SERVER_H
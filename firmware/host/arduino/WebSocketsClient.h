@@ -0,0 +1,11 @@
+/**
+ * @file WebSocketsClient.h
+ * @brief Empty stand-in for native builds; the host tools do not use it.
+ */
+
+#ifndef HOST_WEBSOCKETS_CLIENT_H
+#define HOST_WEBSOCKETS_CLIENT_H
+
+#include <WiFi.h>
+
+#endif // HOST_WEBSOCKETS_CLIENT_H
@@ -0,0 +1,83 @@
+/**
+ * @file WiFi.h
+ * @brief Network types for native builds (declarations only, no sockets).
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+#define WIFI_STA 1
+#define WIFI_AP 2
+#define WIFI_AUTH_OPEN 0
+
+/**
+ * @brief IPv4 address.
+ */
+class IPAddress {
+private:
+    uint8_t octets[4] = {0, 0, 0, 0};
+
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+    operator uint32_t() const {
+        uint32_t addr;
+        memcpy(&addr, octets, sizeof(addr));
+        return addr;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(buf);
+    }
+};
+
+/**
+ * @brief TCP client that is never connected.
+ */
+class WiFiClient : public Stream {
+public:
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t*, size_t) override { return 0; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int read(uint8_t*, size_t) { return -1; }
+    uint8_t connected() { return 0; }
+    void stop() {}
+    void setNoDelay(bool) {}
+    IPAddress remoteIP() const { return IPAddress(); }
+    explicit operator bool() const { return false; }
+};
+
+/**
+ * @brief TCP server that never accepts.
+ */
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t) {}
+    void begin() {}
+    WiFiClient accept() { return WiFiClient(); }
+    WiFiClient available() { return WiFiClient(); }
+};
+
+/**
+ * @brief Station/AP state as seen by the firmware.
+ */
+class WiFiClass {
+public:
+    int status() { return WL_CONNECTED; }
+    int getMode() { return WIFI_STA; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    String SSID() { return String("host"); }
+    int32_t RSSI() { return -50; }
+    int encryptionType(int) { return WIFI_AUTH_OPEN; }
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
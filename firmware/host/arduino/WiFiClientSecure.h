@@ -0,0 +1,16 @@
+/**
+ * @file WiFiClientSecure.h
+ * @brief TLS client type for native builds (never connected).
+ */
+
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() {}
+};
+
+#endif // HOST_WIFI_CLIENT_SECURE_H
@@ -0,0 +1,22 @@
+/**
+ * @file WiFiUdp.h
+ * @brief UDP socket type for native builds (never sends, counts packets).
+ */
+
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include <WiFi.h>
+
+/// @brief Packets ended on any WiFiUDP since start (wake sends in the host tools)
+extern uint32_t hostUdpPackets;
+
+class WiFiUDP {
+public:
+    uint8_t begin(uint16_t) { return 1; }
+    int beginPacket(IPAddress, uint16_t) { return 1; }
+    size_t write(const uint8_t*, size_t size) { return size; }
+    int endPacket() { hostUdpPackets++; return 1; }
+};
+
+#endif // HOST_WIFI_UDP_H
@@ -0,0 +1,61 @@
+/**
+ * @file arduino_host.cpp
+ * @brief Globals and timing of the native Arduino shim.
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <chrono>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+HardwareSerial Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+WiFiClass WiFi;
+uint32_t hostUdpPackets = 0;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {}
+
+long random(long max) {
+    return max > 0 ? ::random() % max : 0;
+}
+
+long random(long min, long max) {
+    return max > min ? min + random(max - min) : min;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    static const bool enabled = getenv("WAKELINK_SERIAL") != nullptr;
+    if (enabled) fwrite(buffer, 1, size, stderr);
+    return size;
+}
+
+uint32_t EspClass::getCycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+#endif
+}
@@ -0,0 +1,253 @@
+/**
+ * @file batch_wol_sim.cpp
+ * @brief Host checks of paced Wake-on-LAN in the batch command.
+ *
+ * Runs CommandManager::executeCommand("batch", ...) and
+ * handlePendingWol() from command.cpp unchanged; wake sends are counted
+ * at the WiFiUDP shim (hostUdpPackets):
+ *
+ * - pacing: the first "wol_burst" wakes go out at once, each later group
+ *   gets delay_ms = (n / burst) * interval and is queued; the reply does
+ *   not wait for them
+ * - release: handlePendingWol() never sends a wake before its delay_ms
+ *   and sends every queued wake once it is due
+ * - clamp: wol_interval_ms above BATCH_MAX_WOL_INTERVAL_MS is capped
+ * - queue full: past WOL_QUEUE_SIZE waiting wakes (across batches) a
+ *   paced wake fails with WOL_QUEUE_FULL and the batch is "partial"
+ * - invalid entries: MAC_ADDRESS_REQUIRED / INVALID_MAC, nothing queued
+ *
+ * Cloud, AP, OTA and config are not part of this build; the few hooks
+ * command.cpp calls are stubbed below.
+ *
+ * Build (from firmware/, ArduinoJson v7 source tree at <ArduinoJson>):
+ *   g++ -O2 -DARDUINO=10819 -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/batch_wol_sim.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/command.cpp WakeLink/command_cache.cpp WakeLink/udp_handler.cpp \
+ *       WakeLink/crypto_bench.cpp WakeLink/packet.cpp WakeLink/payload_stream.cpp \
+ *       WakeLink/CryptoManager.cpp WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp \
+ *       WakeLink/crypto_backend.cpp WakeLink/chacha20.cpp WakeLink/sha256.cpp \
+ *       WakeLink/poly1305.cpp WakeLink/secure_random.cpp WakeLink/counter_journal.cpp \
+ *       WakeLink/replay_window.cpp WakeLink/fragment.cpp WakeLink/request_arena.cpp \
+ *       -o batch_wol_sim
+ *
+ * Usage: ./batch_wol_sim
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "command.h"
+#include "cloud.h"
+#include "ota_manager.h"
+#include "request_arena.h"
+#include "wifi_manager.h"
+#include "host_test.h"
+#include <WiFiUdp.h>
+#include <vector>
+
+// ==================== STUBS ====================
+
+bool inAPMode = false;
+bool webServerEnabled = false;
+
+bool saveConfig() { return true; }
+void startAP() {}
+void enterOTAMode() {}
+void enableCloud() {}
+void disableCloud() {}
+bool isCloudEnabled() { return false; }
+String getCloudStatus() { return "disabled"; }
+
+// ==================== HELPERS ====================
+
+/**
+ * @brief Outcome of one batch, copied out of the request arena.
+ */
+struct BatchRun {
+    std::string status;
+    uint32_t failed = 0;
+    uint32_t sentAtOnce = 0;             ///< UDP packets sent while the batch ran
+    std::vector<std::string> results;    ///< Per entry: "result" or "error"
+    std::vector<long> delays;            ///< Per entry: delay_ms, -1 if absent
+};
+
+/**
+ * @brief Run a batch of wake entries.
+ * @param macs Entry MACs (nullptr = entry without "mac").
+ * @param count Number of entries.
+ * @param burst wol_burst.
+ * @param interval wol_interval_ms.
+ */
+static BatchRun runBatch(const char* const* macs, size_t count, uint32_t burst, uint32_t interval) {
+    RequestScope scope(requestArena);
+    JsonDocument request(&requestJson);
+    JsonObject data = request.to<JsonObject>();
+    data["wol_burst"] = burst;
+    data["wol_interval_ms"] = interval;
+    JsonArray commands = data["commands"].to<JsonArray>();
+    for (size_t i = 0; i < count; i++) {
+        JsonObject entry = commands.add<JsonObject>();
+        entry["command"] = "wake";
+        JsonObject args = entry["data"].to<JsonObject>();
+        if (macs[i]) args["mac"] = macs[i];
+    }
+
+    BatchRun run;
+    uint32_t sent = hostUdpPackets;
+    JsonDocument reply = CommandManager::executeCommand("batch", data);
+    run.sentAtOnce = hostUdpPackets - sent;
+    run.status = reply["status"] | "";
+    run.failed = reply["failed"] | 0;
+    for (JsonObject r : reply["results"].as<JsonArray>()) {
+        run.results.push_back(r["result"].is<const char*>() ? r["result"] | "" : r["error"] | "");
+        run.delays.push_back(r["delay_ms"].is<uint32_t>() ? (long)r["delay_ms"].as<uint32_t>() : -1);
+    }
+    return run;
+}
+
+/**
+ * @brief Call handlePendingWol() until want more packets went out.
+ * @param want Packets expected.
+ * @param dueBy Delays (ms after start) of the queued wakes, for the never-early check.
+ * @param start millis() taken before the batch ran.
+ * @param timeoutMs Give up after this long.
+ * @return Packets sent.
+ */
+static uint32_t drain(uint32_t want, const std::vector<long>& dueBy, unsigned long start, unsigned long timeoutMs) {
+    uint32_t sent = hostUdpPackets;
+    unsigned long begin = millis();
+    while (hostUdpPackets - sent < want && millis() - begin < timeoutMs) {
+        CommandManager::handlePendingWol();
+
+        // A wake may go out late, never early: only those due by now may have been sent
+        unsigned long elapsed = millis() - start;
+        uint32_t allowed = 0;
+        for (long d : dueBy) allowed += d >= 0 && (unsigned long)d <= elapsed;
+        EXPECT(hostUdpPackets - sent <= allowed);
+        delay(1);
+    }
+    return hostUdpPackets - sent;
+}
+
+// ==================== CASES ====================
+
+static const char* const MACS[] = {
+    "AA:BB:CC:00:00:01", "AA:BB:CC:00:00:02", "AA:BB:CC:00:00:03", "AA:BB:CC:00:00:04",
+    "AA:BB:CC:00:00:05", "AA:BB:CC:00:00:06", "AA:BB:CC:00:00:07", "AA:BB:CC:00:00:08",
+    "AA:BB:CC:00:00:09", "AA:BB:CC:00:00:0A"};
+
+/**
+ * @brief Burst of 3, then groups of 3 every 40 ms.
+ */
+static void runPacing() {
+    unsigned long start = millis();
+    BatchRun run = runBatch(MACS, 10, 3, 40);
+    EXPECT(run.status == "success");
+    EXPECT(run.sentAtOnce == 3);
+    EXPECT(run.results.size() == 10);
+
+    const long want[10] = {-1, -1, -1, 40, 40, 40, 80, 80, 80, 120};
+    for (size_t i = 0; i < run.results.size() && i < 10; i++) {
+        EXPECT(run.results[i] == (i < 3 ? "wol_sent" : "wol_queued"));
+        EXPECT(run.delays[i] == want[i]);
+    }
+
+    // Nothing is due yet right after the reply
+    uint32_t sent = hostUdpPackets;
+    CommandManager::handlePendingWol();
+    EXPECT(hostUdpPackets == sent || millis() - start >= 40);
+
+    EXPECT(drain(7, run.delays, start, 2000) == 7);
+}
+
+/**
+ * @brief An interval above the cap is sent at the cap.
+ */
+static void runClamp() {
+    unsigned long start = millis();
+    BatchRun run = runBatch(MACS, 2, 1, 60000);
+    EXPECT(run.sentAtOnce == 1);
+    EXPECT(run.delays.size() == 2 && run.delays[1] == BATCH_MAX_WOL_INTERVAL_MS);
+    EXPECT(drain(1, run.delays, start, 3000) == 1);
+}
+
+/**
+ * @brief 64 wakes 1 ms apart: WOL_QUEUE_SIZE wait, the rest fail; the queue is shared.
+ */
+static void runQueueFull() {
+    std::vector<const char*> macs(BATCH_MAX_COMMANDS, MACS[0]);
+    unsigned long start = millis();
+    BatchRun run = runBatch(macs.data(), macs.size(), 1, 1);
+    EXPECT(run.sentAtOnce == 1);
+    EXPECT(run.status == "partial");
+    EXPECT(run.failed == BATCH_MAX_COMMANDS - 1 - WOL_QUEUE_SIZE);
+
+    size_t queued = 0, full = 0;
+    for (size_t i = 1; i < run.results.size(); i++) {
+        if (run.results[i] == "wol_queued") {
+            queued++;
+            EXPECT(run.delays[i] == (long)i);
+        } else {
+            full += run.results[i] == "WOL_QUEUE_FULL";
+            EXPECT(run.delays[i] == -1);
+        }
+    }
+    EXPECT(queued == WOL_QUEUE_SIZE);
+    EXPECT(full == BATCH_MAX_COMMANDS - 1 - WOL_QUEUE_SIZE);
+
+    // Another batch while the queue is still full: its paced wake fails too
+    BatchRun second = runBatch(MACS, 2, 1, 1000);
+    EXPECT(second.sentAtOnce == 1);
+    EXPECT(second.results.size() == 2 && second.results[1] == "WOL_QUEUE_FULL");
+    EXPECT(second.status == "partial");
+
+    EXPECT(drain(WOL_QUEUE_SIZE, run.delays, start, 2000) == WOL_QUEUE_SIZE);
+
+    // Drained: room again
+    start = millis();
+    BatchRun third = runBatch(MACS, 2, 1, 5);
+    EXPECT(third.status == "success");
+    EXPECT(drain(1, third.delays, start, 2000) == 1);
+}
+
+/**
+ * @brief Paced entries without or with a bad MAC fail and are not queued.
+ */
+static void runInvalid() {
+    const char* const macs[] = {MACS[0], nullptr, "not-a-mac", MACS[1]};
+    unsigned long start = millis();
+    BatchRun run = runBatch(macs, 4, 1, 5);
+    EXPECT(run.results.size() == 4);
+    EXPECT(run.results[1] == "MAC_ADDRESS_REQUIRED");
+    EXPECT(run.results[2] == "INVALID_MAC");
+    EXPECT(run.results[3] == "wol_queued" && run.delays[3] == 15);
+    EXPECT(run.status == "partial" && run.failed == 2);
+    EXPECT(drain(1, run.delays, start, 2000) == 1);
+
+    // Nothing else was left behind
+    uint32_t sent = hostUdpPackets;
+    delay(30);
+    CommandManager::handlePendingWol();
+    EXPECT(hostUdpPackets == sent);
+}
+
+int main() {
+    pipelineBegin();
+
+    unsigned long start = millis();
+    runPacing();
+    runClamp();
+    runQueueFull();
+    runInvalid();
+
+    printf("{\n");
+    printf("  \"queue_size\": %u,\n", (unsigned)WOL_QUEUE_SIZE);
+    printf("  \"max_interval_ms\": %u,\n", (unsigned)BATCH_MAX_WOL_INTERVAL_MS);
+    printf("  \"udp_packets\": %lu,\n", (unsigned long)hostUdpPackets);
+    printf("  \"ms\": %lu,\n", millis() - start);
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file command_cache_bench.cpp
+ * @brief Host checks and timings of the polled-command result cache.
+ *
+ * Polls info, crypto_info and counter_info through
+ * CommandManager::executeCommand() from command.cpp unchanged, once
+ * served from the cache slot and once with "fresh": true (rebuilt every
+ * time), the way a client polling the device would:
+ *
+ * - check: a cached poll counts a hit and no build, a fresh poll a build
+ *   and no hit; both carry the same stable fields; invalidate() makes
+ *   the next poll rebuild the slot
+ * - time: ns per poll (whole handler), the cache's own
+ *   cache_hit_cycles / cache_build_cycles for the stable fields, and the
+ *   request-arena bytes each reply holds
+ *
+ * Cycles are host TSC cycles from the shim's ESP.getCycleCount(), so
+ * compare hit against build, not against the device's figures.
+ *
+ * Cloud, AP, OTA and config are not part of this build; the few hooks
+ * command.cpp calls are stubbed below.
+ *
+ * Build (from firmware/, ArduinoJson v7 source tree at <ArduinoJson>):
+ *   g++ -O2 -DARDUINO=10819 -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/command_cache_bench.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/command.cpp WakeLink/command_cache.cpp WakeLink/udp_handler.cpp \
+ *       WakeLink/crypto_bench.cpp WakeLink/packet.cpp WakeLink/payload_stream.cpp \
+ *       WakeLink/CryptoManager.cpp WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp \
+ *       WakeLink/crypto_backend.cpp WakeLink/chacha20.cpp WakeLink/sha256.cpp \
+ *       WakeLink/poly1305.cpp WakeLink/secure_random.cpp WakeLink/counter_journal.cpp \
+ *       WakeLink/replay_window.cpp WakeLink/fragment.cpp WakeLink/request_arena.cpp \
+ *       -o command_cache_bench
+ *
+ * Usage: ./command_cache_bench [polls]   (default 20000 per command and mode)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "command.h"
+#include "command_cache.h"
+#include "request_arena.h"
+#include "host_test.h"
+#include <chrono>
+
+// ==================== STUBS ====================
+
+bool inAPMode = false;
+bool webServerEnabled = false;
+
+bool saveConfig() { return true; }
+void startAP() {}
+void enterOTAMode() {}
+void enableCloud() {}
+void disableCloud() {}
+bool isCloudEnabled() { return false; }
+String getCloudStatus() { return "disabled"; }
+
+// ==================== HELPERS ====================
+
+/**
+ * @brief One polled command and the fields its cache slot holds.
+ */
+struct Polled {
+    const char* command;
+    CacheSlot slot;
+    const char* stable[12];   ///< nullptr-terminated
+};
+
+static const Polled POLLED[] = {
+    {"info", CACHE_INFO,
+     {"status", "device_id", "ip", "ssid", "rssi", "crypto_enabled", "mode", "web_enabled",
+      "cloud_enabled", "cloud_status", nullptr}},
+    {"crypto_info", CACHE_CRYPTO_INFO,
+     {"status", "enabled", "crypto_backend", "cipher_kernel", "counter_store", nullptr}},
+    {"counter_info", CACHE_COUNTER_INFO,
+     {"status", "replay_window", nullptr}},
+};
+
+/**
+ * @brief Totals of the cache counters (averages times counts).
+ */
+struct CacheTotals {
+    uint64_t hits, builds, hitCycles, buildCycles;
+
+    static CacheTotals now() {
+        return {commandCache.getHits(), commandCache.getBuilds(),
+                (uint64_t)commandCache.getHitCycles() * commandCache.getHits(),
+                (uint64_t)commandCache.getBuildCycles() * commandCache.getBuilds()};
+    }
+};
+
+/**
+ * @brief Results of one command polled one way.
+ */
+struct PollRun {
+    double ns = 0;            ///< Per poll, whole handler
+    uint64_t hits = 0;
+    uint64_t builds = 0;
+    double cycles = 0;        ///< Cache cycles per poll (hit or build)
+    size_t arena = 0;         ///< Most request-arena bytes a reply held
+    double fallbacks = 0;     ///< Arena overflows per poll
+    size_t replyBytes = 0;    ///< JSON length of the reply
+};
+
+/**
+ * @brief Poll a command once inside a request scope.
+ * @param command Command name.
+ * @param fresh Set "fresh": true.
+ * @param out If not null, receives the reply as JSON.
+ * @return Request-arena bytes held once the reply was built.
+ */
+static size_t poll(const char* command, bool fresh, std::string* out = nullptr) {
+    RequestScope scope(requestArena);
+    JsonDocument request(&requestJson);
+    JsonObject data = request.to<JsonObject>();
+    if (fresh) data["fresh"] = true;
+    JsonDocument reply = CommandManager::executeCommand(command, data);
+    if (strcmp(reply["status"] | "", "success") != 0) failures++;
+    if (out) {
+        out->clear();
+        serializeJson(reply, *out);
+    }
+    return requestArena.getUsed();
+}
+
+/**
+ * @brief Poll a command n times one way and collect timings.
+ */
+static PollRun measure(const Polled& p, bool fresh, unsigned long n) {
+    PollRun run;
+    std::string reply;
+    poll(p.command, fresh, &reply);   // Fill the slot (cached) or warm up (fresh)
+    run.replyBytes = reply.size();
+
+    CacheTotals before = CacheTotals::now();
+    uint32_t overflows = requestArena.getOverflows();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < n; i++) {
+        size_t used = poll(p.command, fresh);
+        if (used > run.arena) run.arena = used;
+    }
+    run.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    CacheTotals after = CacheTotals::now();
+
+    run.hits = after.hits - before.hits;
+    run.builds = after.builds - before.builds;
+    uint64_t cycles = fresh ? after.buildCycles - before.buildCycles : after.hitCycles - before.hitCycles;
+    run.cycles = (double)cycles / n;
+    run.fallbacks = (double)(requestArena.getOverflows() - overflows) / n;
+    return run;
+}
+
+/**
+ * @brief A cached and a fresh reply carry the same stable fields.
+ */
+static void checkSameStable(const Polled& p) {
+    RequestScope scope(requestArena);
+    JsonDocument cached(&requestJson), fresh(&requestJson);
+    std::string cachedJson, freshJson;
+    poll(p.command, false);
+    poll(p.command, false, &cachedJson);
+    poll(p.command, true, &freshJson);
+    EXPECT(!deserializeJson(cached, cachedJson));
+    EXPECT(!deserializeJson(fresh, freshJson));
+    for (const char* const* key = p.stable; *key; key++) {
+        std::string a, b;
+        serializeJson(cached[*key], a);
+        serializeJson(fresh[*key], b);
+        EXPECT(!cached[*key].isNull());
+        EXPECT(a == b);
+    }
+}
+
+/**
+ * @brief invalidate() makes the next cached poll rebuild the slot, once.
+ */
+static void checkInvalidate(const Polled& p) {
+    poll(p.command, false);
+    commandCache.invalidate(CACHE_BIT(p.slot));
+    CacheTotals before = CacheTotals::now();
+    poll(p.command, false);
+    poll(p.command, false);
+    CacheTotals after = CacheTotals::now();
+    EXPECT(after.builds - before.builds == 1);
+    EXPECT(after.hits - before.hits == 1);
+}
+
+int main(int argc, char** argv) {
+    unsigned long polls = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000;
+    if (polls == 0) polls = 20000;
+
+    pipelineBegin();
+
+    const size_t count = sizeof(POLLED) / sizeof(POLLED[0]);
+    PollRun cached[count], fresh[count];
+
+    fprintf(stderr, "%-14s %-7s %10s %14s %10s %10s\n", "Command", "Mode", "ns/poll", "cache cycles", "Arena", "Reply");
+    for (size_t i = 0; i < count; i++) {
+        const Polled& p = POLLED[i];
+        checkSameStable(p);
+        checkInvalidate(p);
+
+        cached[i] = measure(p, false, polls);
+        fresh[i] = measure(p, true, polls);
+        EXPECT(cached[i].hits == polls && cached[i].builds == 0);
+        EXPECT(fresh[i].builds == polls && fresh[i].hits == 0);
+
+        for (const PollRun* r : {&cached[i], &fresh[i]}) {
+            fprintf(stderr, "%-14s %-7s %10.0f %14.0f %8zu B %8zu B\n", p.command,
+                    r == &cached[i] ? "cached" : "fresh", r->ns, r->cycles, r->arena, r->replyBytes);
+        }
+    }
+
+    printf("{\n");
+    printf("  \"polls\": %lu,\n", polls);
+    printf("  \"commands\": {\n");
+    for (size_t i = 0; i < count; i++) {
+        const PollRun& c = cached[i];
+        const PollRun& f = fresh[i];
+        printf("    \"%s\": {\"hit_ns\": %.0f, \"build_ns\": %.0f, \"cache_hit_cycles\": %.0f, "
+               "\"cache_build_cycles\": %.0f, \"hit_arena_bytes\": %zu, \"build_arena_bytes\": %zu, "
+               "\"hit_heap_fallbacks\": %.2f, \"build_heap_fallbacks\": %.2f, \"reply_bytes\": %zu}%s\n",
+               POLLED[i].command, c.ns, f.ns, c.cycles, f.cycles, c.arena, f.arena,
+               c.fallbacks, f.fallbacks, c.replyBytes, i + 1 < count ? "," : "");
+    }
+    printf("  },\n");
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
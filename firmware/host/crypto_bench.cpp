@@ -0,0 +1,207 @@
+/**
+ * @file crypto_bench.cpp
+ * @brief Native host build of the crypto_bench command.
+ *
+ * Runs the same CryptoBench known-answer tests and timings as the device
+ * command (firmware/WakeLink/crypto_bench.cpp), so a slowdown or a broken
+ * primitive shows up before anything is flashed. Prints one JSON object
+ * in the crypto_bench reply layout and exits non-zero if a self-test fails.
+ *
+ * Host-only comparisons (not part of the device reply):
+ * - "hmac_midstate": textbook HMAC that re-hashes both key pads per MAC
+ *   (the pre-HmacSha256Ctx path) against CryptoBackend::Hmac with the
+ *   cached ipad/opad midstates; both must produce the same MAC
+ * - "bad_signature": forged v1.0 packets (random signature over a 600-char
+ *   hex payload) rejected per second. "string_path" is the old
+ *   verifyHMAC: re-hash the pads, format the MAC as a hex string, compare
+ *   case-insensitively, then compute it again for the [SIGN] log line.
+ *   "binary_path" is PayloadCodec::checkSignature: decode the received
+ *   signature, one HMAC from the midstates, constant-time compare.
+ *
+ * Build (software backend, from firmware/):
+ *   g++ -O2 -IWakeLink host/crypto_bench.cpp WakeLink/crypto_bench.cpp \
+ *       WakeLink/crypto_backend.cpp WakeLink/chacha20.cpp WakeLink/sha256.cpp \
+ *       WakeLink/poly1305.cpp WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp \
+ *       -o crypto_bench
+ *
+ * OpenSSL reference: add WakeLink/crypto_backend_openssl.cpp,
+ * -DCRYPTO_BACKEND=CRYPTO_BACKEND_OPENSSL and -lcrypto.
+ *
+ * Usage: ./crypto_bench [iterations]   (default 20000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "crypto_bench.h"
+#include "crypto_backend.h"
+#include "chacha20.h"
+#include "sha256.h"
+#include "payload_codec.h"
+#include <chrono>
+#include <string>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Print one per-primitive array ("us_per_op" or "mb_per_s").
+ */
+static void printSeries(const char* name, const CryptoBenchResult* results, size_t count, bool us) {
+    printf("  \"%s\": {", name);
+    for (size_t p = 0; p < CRYPTO_BENCH_PRIMITIVES; p++) {
+        printf("%s\n    \"%s\": [", p ? "," : "", results[p].primitive);
+        for (size_t i = p; i < count; i += CRYPTO_BENCH_PRIMITIVES) {
+            printf(us ? "%s%.3f" : "%s%.2f", i == p ? "" : ", ",
+                   us ? results[i].us_per_op : results[i].mb_per_s);
+        }
+        printf("]");
+    }
+    printf("\n  }");
+}
+
+/**
+ * @brief Textbook HMAC-SHA256: absorbs key ^ ipad and key ^ opad on every call.
+ */
+static void hmacRehashPads(const uint8_t* key, size_t key_len,
+                           const uint8_t* data, size_t len, uint8_t mac[32]) {
+    uint8_t pad[64] = {0};
+    uint8_t inner_hash[32];
+    memcpy(pad, key, key_len);  // Bench keys are 32 bytes
+
+    Sha256Ctx ctx;
+    for (size_t i = 0; i < 64; i++) pad[i] ^= 0x36;
+    ctx.init();
+    ctx.update(pad, 64);
+    ctx.update(data, len);
+    ctx.final(inner_hash);
+
+    for (size_t i = 0; i < 64; i++) pad[i] ^= 0x36 ^ 0x5C;
+    ctx.init();
+    ctx.update(pad, 64);
+    ctx.update(inner_hash, 32);
+    ctx.final(mac);
+}
+
+/**
+ * @brief Microseconds per call of fn over iterations calls.
+ */
+template <typename Fn>
+static double usPerCall(uint32_t iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) fn();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+           (iterations ? iterations : 1);
+}
+
+/**
+ * @brief Print the "hmac_midstate" comparison; false if the two MACs differ.
+ */
+static bool printHmacMidstate(uint32_t iterations) {
+    static const uint32_t sizes[] = CRYPTO_BENCH_SIZES;
+    uint8_t key[32], data[500], macA[32], macB[32];
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = (uint8_t)(i * 7 + 1);
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 13 + 5);
+
+    CryptoBackend::Hmac hmac;
+    hmac.begin(key, sizeof(key));
+
+    bool same = true;
+    printf("  \"hmac_midstate\": {");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t len = sizes[s];
+        hmacRehashPads(key, sizeof(key), data, len, macA);
+        hmac.compute(data, len, macB);
+        same = same && memcmp(macA, macB, 32) == 0;
+
+        double rehash = usPerCall(iterations, [&] { hmacRehashPads(key, sizeof(key), data, len, macA); });
+        double cached = usPerCall(iterations, [&] { hmac.compute(data, len, macB); });
+        printf("%s\n    \"%u\": {\"rehash_pads_us\": %.3f, \"cached_us\": %.3f, \"speedup\": %.2f}",
+               s ? "," : "", (unsigned)len, rehash, cached, cached > 0 ? rehash / cached : 0.0);
+    }
+    printf("\n  },\n  \"hmac_midstate_match\": %s", same ? "true" : "false");
+    return same;
+}
+
+/**
+ * @brief Old verifyHMAC on a forged packet: hex String compare plus the log recomputation.
+ */
+static bool verifyStringPath(const uint8_t* key, const char* payload, size_t len, const std::string& sig) {
+    uint8_t mac[32];
+    char hex[65];
+    hmacRehashPads(key, 32, (const uint8_t*)payload, len, mac);
+    for (size_t i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", mac[i]);
+    std::string calculated(hex);
+    if (calculated.size() == sig.size() && strcasecmp(calculated.c_str(), sig.c_str()) == 0) return true;
+
+    // parseOuterPacket printed the expected signature, computed once more
+    hmacRehashPads(key, 32, (const uint8_t*)payload, len, mac);
+    for (size_t i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", mac[i]);
+    std::string expected(hex);
+    return expected.empty();
+}
+
+/**
+ * @brief Print the "bad_signature" comparison; false if a forgery was accepted.
+ */
+static bool printBadSignature(uint32_t iterations) {
+    static const char digits[] = "0123456789abcdef";
+    uint8_t key[32];
+    char payload[600];
+    char sig[65];
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = (uint8_t)(i * 7 + 1);
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = digits[(i * 11 + 3) & 15];
+    for (size_t i = 0; i < 64; i++) sig[i] = digits[(i * 5 + 9) & 15];
+    sig[64] = 0;
+    std::string sigString(sig);
+
+    CryptoBackend::Hmac hmac;
+    hmac.begin(key, sizeof(key));
+
+    uint32_t accepted = 0;
+    double stringUs = usPerCall(iterations, [&] {
+        accepted += verifyStringPath(key, payload, sizeof(payload), sigString);
+    });
+    double binaryUs = usPerCall(iterations, [&] {
+        accepted += PayloadCodec::checkSignature(hmac, (const uint8_t*)payload, sizeof(payload), sig, 64);
+    });
+
+    printf("  \"bad_signature\": {\"payload_hex_chars\": %u, "
+           "\"string_path_per_s\": %.0f, \"binary_path_per_s\": %.0f, \"accepted\": %u}",
+           (unsigned)sizeof(payload), stringUs > 0 ? 1e6 / stringUs : 0.0,
+           binaryUs > 0 ? 1e6 / binaryUs : 0.0, (unsigned)accepted);
+    return accepted == 0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 20000;
+
+    CryptoSelfTest kat = CryptoBench::selfTest();
+    CryptoBenchResult results[CRYPTO_BENCH_RESULTS];
+    size_t count = CryptoBench::run(results, iterations);
+
+    printf("{\n");
+    printf("  \"status\": \"%s\",\n", kat.passed() ? "success" : "error");
+    printf("  \"backend\": \"%s\",\n", CryptoBackend::name());
+    printf("  \"cipher_kernel\": \"%s\",\n", CHACHA20_KERNEL);
+    printf("  \"iterations\": %u,\n", (unsigned)iterations);
+    printf("  \"self_test\": {\"sha256\": %s, \"hmac\": %s, \"chacha20\": %s, \"aead\": %s},\n",
+           kat.sha256 ? "true" : "false", kat.hmac ? "true" : "false",
+           kat.chacha20 ? "true" : "false", kat.aead ? "true" : "false");
+    printf("  \"sizes\": [");
+    for (size_t i = 0; i < count; i += CRYPTO_BENCH_PRIMITIVES) {
+        printf("%s%u", i ? ", " : "", (unsigned)results[i].bytes);
+    }
+    printf("],\n");
+    printSeries("us_per_op", results, count, true);
+    printf(",\n");
+    printSeries("mb_per_s", results, count, false);
+    printf(",\n");
+    bool hmacSame = printHmacMidstate(iterations);
+    printf(",\n");
+    bool forgeriesRejected = printBadSignature(iterations);
+    printf("\n}\n");
+
+    return kat.passed() && hmacSame && forgeriesRejected ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file crypto_diff.cpp
+ * @brief Packet-level differential test of the crypto backends.
+ *
+ * Seals and opens whole payloads through the device code paths, so the
+ * software backend and the OpenSSL reference are compared on what goes
+ * over the wire rather than on single primitives:
+ *
+ * - v1.0: PayloadStream seal (ChaCha20 + HMAC over the hex), then
+ *   CryptoManager::verifyHMAC and processSecurePacket
+ * - v1.1: PayloadStream seal (streaming ChaCha20-Poly1305), then
+ *   CryptoManager::processAeadPacket
+ * - v2:   CryptoManager::sealFrame / openFrame with a random header
+ *
+ * Plaintext is fed to PayloadStream in random-sized pieces. Every case
+ * is also tampered with (one hex digit or tag byte) and must be
+ * rejected, with a v1.1/v2 body left as ciphertext. Nonces come from a
+ * deterministically seeded SecureRandom, so every backend produces the
+ * same transcript; with a reference transcript the run fails on the
+ * first case that differs.
+ *
+ * No JSON is involved (CryptoManager needs ArduinoJson only through
+ * platform.h, which the Allocator-only declaration in any ArduinoJson
+ * v7 checkout satisfies). Flash is absent, so the counter runs on the
+ * EEPROM shim.
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -DARDUINO=10819 -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/crypto_diff.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/CryptoManager.cpp WakeLink/payload_stream.cpp \
+ *       WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp \
+ *       WakeLink/crypto_backend.cpp WakeLink/chacha20.cpp WakeLink/sha256.cpp \
+ *       WakeLink/poly1305.cpp WakeLink/secure_random.cpp \
+ *       WakeLink/counter_journal.cpp WakeLink/replay_window.cpp -o crypto_diff
+ *
+ * OpenSSL reference: add WakeLink/crypto_backend_openssl.cpp,
+ * -DCRYPTO_BACKEND=CRYPTO_BACKEND_OPENSSL and -lcrypto.
+ *
+ * Usage: ./crypto_diff [cases] [transcript] [reference]   (default 2000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "CryptoManager.h"
+#include "payload_stream.h"
+#include "payload_codec.h"
+#include "hex_codec.h"
+#include "secure_random.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// ==================== DEVICE GLOBALS ====================
+
+DeviceConfig cfg;
+String DEVICE_TOKEN;
+String DEVICE_ID;
+SecureRandom secureRandom;
+CryptoManager crypto;
+
+/// No flash in this build: CryptoManager falls back to the EEPROM shim
+bool DeviceFlashRegion::begin() { return false; }
+bool DeviceFlashRegion::read(uint32_t, void*, size_t) { return false; }
+bool DeviceFlashRegion::program(uint32_t, const void*, size_t) { return false; }
+bool DeviceFlashRegion::erase(size_t) { return false; }
+
+// ==================== CASE GENERATOR ====================
+
+/// @brief Case parameters; independent of the backend under test
+static uint64_t caseState = 0x5741'4b45'4c49'4e4bULL;
+
+static uint32_t next(uint32_t bound) {
+    caseState ^= caseState << 13;
+    caseState ^= caseState >> 7;
+    caseState ^= caseState << 17;
+    return (uint32_t)(caseState % bound);
+}
+
+static void fillCase(uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) out[i] = (uint8_t)next(256);
+}
+
+static std::string hexOf(const uint8_t* data, size_t len) {
+    std::string s(2 * len, '0');
+    HexCodec::encode(data, len, &s[0]);
+    return s;
+}
+
+/**
+ * @brief Replace one hex digit with a different one.
+ */
+static void flipDigit(std::string& hex, size_t at) {
+    hex[at] = hex[at] == '0' ? '1' : '0';
+}
+
+// ==================== CASES ====================
+
+/**
+ * @brief Seal plaintext with PayloadStream, writing it in random pieces.
+ */
+static std::string seal(const uint8_t* plain, size_t len, bool aead, uint8_t mac[32]) {
+    String out;
+    out.reserve(PayloadStream::hexLength(len, aead));
+    StringPrint sink(out);
+    PayloadStream payload(crypto, sink, aead);
+    payload.begin(len);
+    for (size_t done = 0; done < len;) {
+        size_t piece = 1 + next(97);
+        if (piece > len - done) piece = len - done;
+        payload.write(plain + done, piece);
+        done += piece;
+    }
+    payload.end(mac);
+    return std::string(out.c_str(), out.length());
+}
+
+/**
+ * @brief One v1.0 payload: seal, verify, open, reject a tampered copy.
+ */
+static std::string runSigned(const uint8_t* plain, size_t len) {
+    uint8_t mac[32];
+    std::string hex = seal(plain, len, false, mac);
+    std::string sig = hexOf(mac, sizeof(mac));
+    EXPECT(hex.size() == PayloadStream::hexLength(len, false));
+
+    EXPECT(crypto.verifyHMAC((const uint8_t*)hex.data(), hex.size(), sig.data(), sig.size()));
+
+    std::string opened = hex;
+    char* text = nullptr;
+    size_t textLen = 0;
+    EXPECT(crypto.processSecurePacket(&opened[0], opened.size(), text, textLen) == nullptr);
+    EXPECT(textLen == len && text && memcmp(text, plain, len) == 0);
+
+    std::string tampered = hex;
+    flipDigit(tampered, next((uint32_t)tampered.size()));
+    EXPECT(!crypto.verifyHMAC((const uint8_t*)tampered.data(), tampered.size(),
+                              sig.data(), sig.size()));
+
+    return "v1.0 " + std::to_string(len) + " " + hex + " " + sig + "\n";
+}
+
+/**
+ * @brief One v1.1 payload: seal, open, reject a tampered copy untouched.
+ */
+static std::string runAead(const uint8_t* plain, size_t len) {
+    uint8_t unused[32];
+    std::string hex = seal(plain, len, true, unused);
+    EXPECT(hex.size() == PayloadStream::hexLength(len, true));
+
+    std::string opened = hex;
+    char* text = nullptr;
+    size_t textLen = 0;
+    EXPECT(crypto.processAeadPacket(&opened[0], opened.size(), text, textLen) == nullptr);
+    EXPECT(textLen == len && text && memcmp(text, plain, len) == 0);
+
+    // Past the length prefix, so the packet still parses and only the tag fails
+    std::string tampered = hex;
+    flipDigit(tampered, 4 + next((uint32_t)tampered.size() - 4));
+    std::string raw(tampered.size() / 2, '\0');
+    HexCodec::decode(tampered.data(), raw.size(), (uint8_t*)&raw[0]);
+    const char* error = crypto.processAeadPacket(&tampered[0], tampered.size(), text, textLen);
+    EXPECT(error && strcmp(error, "ERROR:INVALID_SIGNATURE") == 0);
+    EXPECT(memcmp(tampered.data(), raw.data(), raw.size()) == 0);
+
+    return "v1.1 " + std::to_string(len) + " " + hex + "\n";
+}
+
+/**
+ * @brief One v2 frame body: seal, open, reject a bad tag untouched.
+ */
+static std::string runFrame(const uint8_t* plain, size_t len) {
+    uint8_t header[40];
+    size_t headerLen = next(sizeof(header) + 1);
+    fillCase(header, headerLen);
+    uint8_t nonce[12];
+    secureRandom.fill(nonce, sizeof(nonce));
+
+    std::string body((const char*)plain, len);
+    uint8_t tag[16];
+    crypto.sealFrame(nonce, header, headerLen, (uint8_t*)&body[0], len, tag);
+    std::string line = "v2 " + std::to_string(len) + " " + hexOf(header, headerLen) + " " +
+                       hexOf((const uint8_t*)body.data(), len) + " " + hexOf(tag, 16) + "\n";
+
+    std::string sealed = body;
+    uint8_t bad[16];
+    memcpy(bad, tag, sizeof(bad));
+    bad[next(sizeof(bad))] ^= (uint8_t)(1 + next(255));
+    EXPECT(crypto.openFrame(nonce, header, headerLen, (uint8_t*)&body[0], len, bad) != nullptr);
+    EXPECT(body == sealed);
+
+    EXPECT(crypto.openFrame(nonce, header, headerLen, (uint8_t*)&body[0], len, tag) == nullptr);
+    EXPECT(memcmp(body.data(), plain, len) == 0);
+    return line;
+}
+
+// ==================== MAIN ====================
+
+int main(int argc, char** argv) {
+    unsigned long cases = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    const char* transcriptPath = argc > 2 ? argv[2] : nullptr;
+    const char* referencePath = argc > 3 ? argv[3] : nullptr;
+
+    const uint8_t seed[] = "wakelink-crypto-diff";
+    secureRandom.seed(seed, sizeof(seed));
+    memset(&cfg, 0, sizeof(cfg));
+    strncpy(cfg.device_token, "crypto-diff-token-0123456789abcdef", sizeof(cfg.device_token) - 1);
+    strncpy(cfg.device_id, "WL-DIFF", sizeof(cfg.device_id) - 1);
+    cfg.initialized = 1;
+    DEVICE_TOKEN = cfg.device_token;
+    DEVICE_ID = cfg.device_id;
+    if (!crypto.begin()) {
+        fprintf(stderr, "crypto_diff: crypto.begin() failed\n");
+        return 1;
+    }
+
+    FILE* transcript = transcriptPath ? fopen(transcriptPath, "w") : nullptr;
+    FILE* reference = referencePath ? fopen(referencePath, "r") : nullptr;
+    if ((transcriptPath && !transcript) || (referencePath && !reference)) {
+        fprintf(stderr, "crypto_diff: cannot open transcript files\n");
+        return 1;
+    }
+
+    unsigned long counts[3] = {0, 0, 0};
+    long firstMismatch = -1;
+    size_t bytes = 0;
+    static uint8_t plain[2048];
+    std::string expected;
+    char* refLine = nullptr;
+    size_t refCap = 0;
+
+    for (unsigned long i = 0; i < cases; i++) {
+        uint32_t kind = next(3);
+        // Requests are capped at PAYLOAD_MAX_REQUEST; frame bodies go further
+        size_t len = kind == 2 ? next(sizeof(plain) + 1) : 1 + next(PAYLOAD_MAX_REQUEST);
+        fillCase(plain, len);
+
+        std::string line = kind == 0 ? runSigned(plain, len)
+                         : kind == 1 ? runAead(plain, len)
+                                     : runFrame(plain, len);
+        counts[kind]++;
+        bytes += len;
+
+        if (transcript) fputs(line.c_str(), transcript);
+        if (reference && firstMismatch < 0) {
+            ssize_t n = getline(&refLine, &refCap, reference);
+            if (n < 0 || line != std::string(refLine, (size_t)n)) {
+                firstMismatch = (long)i;
+                fprintf(stderr, "crypto_diff: case %lu differs from %s\n  got:      %.120s\n",
+                        i, referencePath, line.c_str());
+                if (n >= 0) fprintf(stderr, "  expected: %.120s\n", refLine);
+            }
+        }
+    }
+    free(refLine);
+    if (transcript) fclose(transcript);
+    if (reference) fclose(reference);
+    if (firstMismatch >= 0) failures++;
+
+    printf("{\"backend\":\"%s\",\"cases\":%lu,\"v1_0\":%lu,\"v1_1\":%lu,\"v2\":%lu,"
+           "\"plain_bytes\":%zu,\"reference\":%s,\"first_mismatch\":%ld,"
+           "\"signature_failures\":%lu,\"failures\":%d}\n",
+           CryptoBackend::name(), cases, counts[0], counts[1], counts[2], bytes,
+           reference ? "true" : "false", firstMismatch,
+           (unsigned long)crypto.getSignatureFailures(), failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file fragment_sim.cpp
+ * @brief Host checks and soak run for message fragmentation.
+ *
+ * Exercises FragmentInfo / FragmentAssembler (firmware/WakeLink/fragment.cpp)
+ * without a device:
+ *
+ * - unit: sender plans tile the message exactly, round trips at sizes
+ *   around the chunk boundaries, duplicates, gaps, inconsistent headers,
+ *   oversized messages, eviction and expiry
+ * - soak: several senders interleave fragmented messages with random
+ *   duplicates, drops and stalls; every completed message must equal
+ *   what was sent, and buffered memory never exceeds
+ *   FRAGMENT_SLOTS * FRAGMENT_MAX_MESSAGE
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -IWakeLink host/fragment_sim.cpp WakeLink/fragment.cpp \
+ *       -o fragment_sim
+ *
+ * Usage: ./fragment_sim [messages]   (default 200000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "fragment.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @brief Fragment plaintexts of a message, as the device sends them.
+ */
+static std::vector<Bytes> split(const Bytes& message, uint32_t id) {
+    std::vector<Bytes> out;
+    FragmentInfo info;
+    info.plan(id, message.size());
+    for (; info.index < info.count; info.index++) {
+        Bytes f(FRAGMENT_HEADER + info.chunkLength());
+        info.writeHeader(f.data());
+        memcpy(f.data() + FRAGMENT_HEADER, message.data() + info.offset(), info.chunkLength());
+        out.push_back(f);
+    }
+    return out;
+}
+
+static Bytes pattern(size_t length, uint32_t seed) {
+    Bytes b(length);
+    for (size_t i = 0; i < length; i++) b[i] = (uint8_t)(seed * 31 + i * 7);
+    return b;
+}
+
+/**
+ * @brief Fixed cases.
+ */
+static void runUnit() {
+    // Plans tile the message with no gap or overlap
+    static const size_t sizes[] = {1, FRAGMENT_CHUNK - 1, FRAGMENT_CHUNK, FRAGMENT_CHUNK + 1,
+                                   3 * FRAGMENT_CHUNK, FRAGMENT_MAX_MESSAGE, 0xFFFF};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        FragmentInfo info;
+        info.plan(7, sizes[s]);
+        size_t covered = 0;
+        for (; info.index < info.count; info.index++) {
+            EXPECT(info.offset() == covered);
+            EXPECT(info.chunkLength() > 0 && info.chunkLength() <= FRAGMENT_CHUNK);
+            covered += info.chunkLength();
+        }
+        EXPECT(covered == sizes[s]);
+    }
+
+    // Round trips
+    for (size_t len = 1; len <= FRAGMENT_MAX_MESSAGE; len += len < 2 * FRAGMENT_CHUNK + 2 ? 1 : 97) {
+        FragmentAssembler a;
+        Bytes msg = pattern(len, (uint32_t)len);
+        std::vector<Bytes> frags = split(msg, (uint32_t)len);
+        for (size_t i = 0; i < frags.size(); i++) {
+            FragmentInfo info;
+            EXPECT(a.add(frags[i].data(), frags[i].size(), 0, info) == nullptr);
+            size_t outLen;
+            const uint8_t* out = a.message(outLen);
+            if (i + 1 < frags.size()) {
+                EXPECT(out == nullptr);
+            } else {
+                EXPECT(out && outLen == len && memcmp(out, msg.data(), len) == 0);
+            }
+        }
+        a.release();
+        EXPECT(a.buffered() == 0);
+    }
+
+    Bytes msg = pattern(1000, 1);
+    std::vector<Bytes> frags = split(msg, 42);
+    FragmentInfo info;
+    size_t outLen;
+
+    // Duplicate is refused and does not break the message
+    {
+        FragmentAssembler a;
+        EXPECT(a.add(frags[0].data(), frags[0].size(), 0, info) == nullptr);
+        EXPECT(strcmp(a.add(frags[0].data(), frags[0].size(), 0, info), "FRAGMENT_DUPLICATE") == 0);
+        EXPECT(a.add(frags[1].data(), frags[1].size(), 0, info) == nullptr);
+        EXPECT(a.add(frags[2].data(), frags[2].size(), 0, info) == nullptr);
+        EXPECT(a.message(outLen) && outLen == msg.size());
+    }
+
+    // A gap drops the message; a tail without its head is refused
+    {
+        FragmentAssembler a;
+        EXPECT(a.add(frags[0].data(), frags[0].size(), 0, info) == nullptr);
+        EXPECT(strcmp(a.add(frags[2].data(), frags[2].size(), 0, info), "FRAGMENT_OUT_OF_ORDER") == 0);
+        EXPECT(a.buffered() == 0);
+        EXPECT(strcmp(a.add(frags[1].data(), frags[1].size(), 0, info), "FRAGMENT_OUT_OF_ORDER") == 0);
+        EXPECT(a.getDropped() == 1);
+    }
+
+    // Headers that disagree with the first fragment, or lie about the length
+    {
+        FragmentAssembler a;
+        Bytes bad = frags[1];
+        bad[9]++;  // count
+        EXPECT(a.add(frags[0].data(), frags[0].size(), 0, info) == nullptr);
+        EXPECT(strcmp(a.add(bad.data(), bad.size(), 0, info), "BAD_FRAGMENT") == 0);
+        EXPECT(a.buffered() == 0);
+
+        Bytes shortTail = frags[2];
+        shortTail.pop_back();
+        EXPECT(a.add(frags[0].data(), frags[0].size(), 0, info) == nullptr);
+        EXPECT(a.add(frags[1].data(), frags[1].size(), 0, info) == nullptr);
+        EXPECT(strcmp(a.add(shortTail.data(), shortTail.size(), 0, info), "BAD_FRAGMENT") == 0);
+        EXPECT(a.message(outLen) == nullptr);
+
+        Bytes noMarker = frags[0];
+        noMarker[0] = '{';
+        EXPECT(strcmp(a.add(noMarker.data(), noMarker.size(), 0, info), "BAD_FRAGMENT") == 0);
+        EXPECT(strcmp(a.add(frags[0].data(), FRAGMENT_HEADER, 0, info), "BAD_FRAGMENT") == 0);
+    }
+
+    // Announced length over the limit is refused before any allocation
+    {
+        FragmentAssembler a;
+        std::vector<Bytes> big = split(pattern(FRAGMENT_MAX_MESSAGE + 1, 2), 9);
+        EXPECT(strcmp(a.add(big[0].data(), big[0].size(), 0, info), "FRAGMENT_TOO_LARGE") == 0);
+        EXPECT(a.buffered() == 0);
+    }
+
+    // A new message evicts the least recently used slot; idle slots expire
+    {
+        FragmentAssembler a;
+        for (uint32_t m = 0; m < FRAGMENT_SLOTS + 1; m++) {
+            std::vector<Bytes> f = split(msg, 100 + m);
+            EXPECT(a.add(f[0].data(), f[0].size(), m * 10, info) == nullptr);
+        }
+        EXPECT(a.getDropped() == 1);
+        EXPECT(a.buffered() == FRAGMENT_SLOTS * msg.size());
+
+        std::vector<Bytes> first = split(msg, 100);
+        EXPECT(strcmp(a.add(first[1].data(), first[1].size(), 30, info), "FRAGMENT_OUT_OF_ORDER") == 0);
+
+        a.expire(30 + FRAGMENT_TIMEOUT_MS);
+        EXPECT(a.buffered() == 0);
+        EXPECT(a.getDropped() == 1 + FRAGMENT_SLOTS);
+    }
+
+    // Single-fragment message
+    {
+        FragmentAssembler a;
+        Bytes one = pattern(10, 3);
+        std::vector<Bytes> f = split(one, 5);
+        EXPECT(f.size() == 1);
+        EXPECT(a.add(f[0].data(), f[0].size(), 0, info) == nullptr);
+        EXPECT(a.message(outLen) && outLen == 10 && memcmp(a.message(outLen), one.data(), 10) == 0);
+    }
+}
+
+/**
+ * @brief Interleaved senders with duplicates, drops and stalls.
+ */
+static void runSoak(uint32_t messages) {
+    struct Sender {
+        Bytes message;
+        std::vector<Bytes> frags;
+        size_t next = 0;
+        bool broken = false;
+    };
+
+    srand(1515);
+    FragmentAssembler a;
+    Sender senders[FRAGMENT_SLOTS + 1];
+    uint32_t started = 0, done = 0, mismatches = 0;
+    size_t peak = 0;
+    uint32_t now = 0;
+    uint32_t ids = 1;
+
+    while (done < messages) {
+        Sender& s = senders[rand() % (FRAGMENT_SLOTS + 1)];
+        if (s.next >= s.frags.size()) {
+            size_t len = 1 + (size_t)(rand() % (rand() % 8 ? 1500 : FRAGMENT_MAX_MESSAGE));
+            s.message = pattern(len, ids);
+            s.frags = split(s.message, ids++);
+            s.next = 0;
+            s.broken = false;
+            started++;
+        }
+
+        now += (uint32_t)(rand() % 50);
+        if (rand() % 2000 == 0) now += FRAGMENT_TIMEOUT_MS;  // stall
+
+        FragmentInfo info;
+        int action = rand() % 100;
+        if (action < 2 && s.next > 1 && !s.broken) {
+            // Replayed fragment: refused whether or not its message is still held
+            const Bytes& f = s.frags[s.next - 1];
+            EXPECT(a.add(f.data(), f.size(), now, info) != nullptr);
+        } else if (action < 3) {
+            // Lost fragment: the rest of the message must be refused
+            s.next++;
+            s.broken = true;
+            if (s.next == s.frags.size()) done++;
+        } else {
+            const Bytes& f = s.frags[s.next];
+            if (a.add(f.data(), f.size(), now, info)) s.broken = true;
+            if (++s.next == s.frags.size()) {
+                size_t outLen;
+                const uint8_t* out = a.message(outLen);
+                // Eviction and expiry are silent, so only a gap guarantees no message
+                if ((out && s.broken) ||
+                    (out && (outLen != s.message.size() || memcmp(out, s.message.data(), outLen) != 0))) {
+                    mismatches++;
+                }
+                done++;
+            }
+        }
+
+        size_t held = a.buffered();
+        if (held > peak) peak = held;
+    }
+
+    EXPECT(mismatches == 0);
+    EXPECT(peak <= FRAGMENT_SLOTS * FRAGMENT_MAX_MESSAGE);
+    printf("  \"soak\": {\"messages\": %u, \"completed\": %u, \"dropped\": %u, \"mismatches\": %u, "
+           "\"peak_buffered\": %zu, \"limit\": %u},\n",
+           (unsigned)started, (unsigned)a.getCompleted(), (unsigned)a.getDropped(),
+           (unsigned)mismatches, peak, (unsigned)(FRAGMENT_SLOTS * FRAGMENT_MAX_MESSAGE));
+}
+
+int main(int argc, char** argv) {
+    uint32_t messages = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+
+    printf("{\n");
+    printf("  \"chunk\": %d,\n", FRAGMENT_CHUNK);
+    printf("  \"slots\": %d,\n", FRAGMENT_SLOTS);
+    runUnit();
+    runSoak(messages);
+    printf("  \"unit_and_soak\": \"%s\"\n", failures ? "failed" : "passed");
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,432 @@
+/**
+ * @file frame_reader_bench.cpp
+ * @brief Host checks and ingest throughput of the TCP frame reader.
+ *
+ * Exercises FrameReader (firmware/WakeLink/frame_reader.cpp) without a
+ * device, over an in-memory NetConnection that hands out at most one
+ * receive window at a time, as lwIP does:
+ *
+ * - unit: blank lines, CRLF and whitespace trimming, messages split
+ *   across reads, several messages in one read, compaction, oversized
+ *   packets and frames, bad frame headers, EOF with an unterminated
+ *   packet or a partial frame
+ * - stream: a long mix of v1.x-sized packets and v2-sized frames cut by
+ *   random windows; every message must come out intact and in order,
+ *   from both FrameReader and the byte-at-a-time loop it replaced
+ * - throughput: bytes per second ingested and socket calls per KB for
+ *   both, at 536 (TCP MSS on the device), 1460 and 4096 byte windows
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -IWakeLink host/frame_reader_bench.cpp WakeLink/frame_reader.cpp \
+ *       -o frame_reader_bench
+ *
+ * Usage: ./frame_reader_bench [megabytes]   (default 64)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "frame_reader.h"
+#include "host_test.h"
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/// @brief v2 frame layout (packet.h), repeated here to stay free of ArduinoJson
+#define BENCH_FRAME_MARKER 0x02
+#define BENCH_FRAME_HEADER 28
+#define BENCH_FRAME_TAG 16
+#define BENCH_FRAME_MAX_BODY 500
+
+static size_t frameLength(const uint8_t* header) {
+    size_t body = ((size_t)header[26] << 8) | header[27];
+    return body > BENCH_FRAME_MAX_BODY ? 0 : BENCH_FRAME_HEADER + body + BENCH_FRAME_TAG;
+}
+
+static FrameFormat format;
+
+/**
+ * @brief NetConnection over a byte string, one receive window at a time.
+ */
+class MemoryConnection : public NetConnection {
+public:
+    const std::string* data = nullptr;
+    size_t pos = 0;
+    size_t window = 536;         ///< Bytes "in the socket" at once
+    size_t windowLeft = 0;
+    uint32_t (*nextWindow)() = nullptr; ///< Random window sizes if set
+    bool open = true;
+    uint64_t calls = 0;          ///< available() + read() calls
+
+    void start(const std::string& bytes) {
+        data = &bytes;
+        pos = 0;
+        windowLeft = 0;
+        calls = 0;
+        open = true;
+    }
+
+    size_t remaining() const { return data->size() - pos; }
+
+    int available() override {
+        calls++;
+        if (windowLeft == 0) {
+            size_t w = nextWindow ? 1 + nextWindow() % window : window;
+            windowLeft = w < remaining() ? w : remaining();
+        }
+        return (int)windowLeft;
+    }
+
+    int read() override {
+        calls++;
+        if (windowLeft == 0) return -1;
+        windowLeft--;
+        return (uint8_t)(*data)[pos++];
+    }
+
+    int read(uint8_t* buf, size_t len) override {
+        calls++;
+        size_t n = len < windowLeft ? len : windowLeft;
+        memcpy(buf, data->data() + pos, n);
+        pos += n;
+        windowLeft -= n;
+        return (int)n;
+    }
+
+    size_t writable() override { return SIZE_MAX; }
+    size_t write(const uint8_t*, size_t len) override { return len; }
+    bool connected() override { return open && remaining() > 0; }
+    void stop() override { open = false; }
+};
+
+/// @brief xorshift32 (reproducible)
+static uint32_t rng = 2463534242u;
+static uint32_t next() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static uint32_t fnv(const uint8_t* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+/**
+ * @brief Messages of a stream, as the reader should hand them out.
+ */
+struct Expected {
+    std::vector<size_t> lengths;
+    std::vector<uint32_t> hashes;
+};
+
+static std::string v2Frame(size_t body) {
+    std::string f(BENCH_FRAME_HEADER + body + BENCH_FRAME_TAG, '\0');
+    for (char& c : f) c = (char)next();
+    f[0] = BENCH_FRAME_MARKER;
+    f[26] = (char)(body >> 8);
+    f[27] = (char)(body & 0xFF);
+    return f;
+}
+
+/**
+ * @brief Mix of hex packets (with CRLF now and then) and v2 frames.
+ */
+static std::string makeStream(size_t bytes, Expected& expected) {
+    static const char hex[] = "0123456789abcdef";
+    std::string s;
+    while (s.size() < bytes) {
+        if (next() % 4 == 0) {
+            std::string f = v2Frame(1 + next() % BENCH_FRAME_MAX_BODY);
+            expected.lengths.push_back(f.size());
+            expected.hashes.push_back(fnv((const uint8_t*)f.data(), f.size()));
+            s += f;
+        } else {
+            std::string p = "{\"device_id\":\"WL0001\",\"payload\":\"";
+            size_t n = 2 * (64 + next() % 400);
+            for (size_t i = 0; i < n; i++) p += hex[next() & 15];
+            p += "\",\"version\":\"1.1\"}";
+            expected.lengths.push_back(p.size());
+            expected.hashes.push_back(fnv((const uint8_t*)p.data(), p.size()));
+            s += p;
+            s += next() % 8 == 0 ? "\r\n" : "\n";
+        }
+    }
+    return s;
+}
+
+// ==================== BYTE-AT-A-TIME BASELINE ====================
+
+/**
+ * @brief The receive loop FrameReader replaced: available()/read() per
+ *        byte into a 1 KB buffer, newline or header-length framing, trim.
+ */
+class ByteReader {
+public:
+    uint8_t buffer[FRAME_READER_SIZE];
+    size_t len = 0;
+    size_t frameLen = 0;
+
+    bool next(NetConnection& conn, FrameView& out) {
+        while (conn.available() > 0) {
+            int c = conn.read();
+            if (c < 0) break;
+            if (len >= sizeof(buffer) - 1) return false;
+            buffer[len++] = (uint8_t)c;
+
+            if (buffer[0] == BENCH_FRAME_MARKER) {
+                if (len == BENCH_FRAME_HEADER) frameLen = frameLength(buffer);
+                if (frameLen && len == frameLen) {
+                    out.data = buffer;
+                    out.length = len;
+                    out.frame = true;
+                    len = frameLen = 0;
+                    return true;
+                }
+                continue;
+            }
+            if (c == '\n') {
+                uint8_t* p = buffer;
+                size_t n = len;
+                while (n > 0 && isspace(p[n - 1])) n--;
+                while (n > 0 && isspace(*p)) {
+                    p++;
+                    n--;
+                }
+                p[n] = '\0';
+                len = 0;
+                if (n == 0) continue;
+                out.data = p;
+                out.length = n;
+                out.frame = false;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// ==================== UNIT ====================
+
+static std::vector<std::string> drain(const std::string& input, size_t window, FrameStatus* last = nullptr,
+                                      bool eof = true) {
+    static FrameReader reader;
+    reader.reset(&format);
+    MemoryConnection conn;
+    conn.window = window;
+    conn.start(input);
+
+    std::vector<std::string> out;
+    FrameStatus status = FRAME_NONE;
+    for (int guard = 0; guard < 100000; guard++) {
+        reader.fill(conn);
+        FrameView view;
+        status = reader.next(view, eof && conn.remaining() == 0);
+        if (status == FRAME_READY) {
+            EXPECT(view.frame || view.data[view.length] == '\0');
+            out.push_back(std::string((const char*)view.data, view.length));
+            reader.release();
+            continue;
+        }
+        if (status != FRAME_NONE || conn.remaining() == 0) break;
+    }
+    if (last) *last = status;
+    return out;
+}
+
+static void runUnit() {
+    std::vector<std::string> v;
+    FrameStatus status;
+
+    v = drain("alpha\n\n  \r\nbeta\r\n  gamma  \n", 3);
+    EXPECT(v.size() == 3 && v[0] == "alpha" && v[1] == "beta" && v[2] == "gamma");
+
+    v = drain("one\ntwo\nthree\n", 64);  // All in one read
+    EXPECT(v.size() == 3 && v[2] == "three");
+
+    v = drain("tail without newline", 5, &status);
+    EXPECT(v.size() == 1 && v[0] == "tail without newline");
+    drain("half", 2, &status, false);
+    EXPECT(status == FRAME_NONE);
+
+    std::string f = v2Frame(100);
+    v = drain(f + "after\n" + f, 7);
+    EXPECT(v.size() == 3 && v[0] == f && v[1] == "after" && v[2] == f);
+
+    // A newline inside a frame body does not end it
+    std::string g = v2Frame(40);
+    g[BENCH_FRAME_HEADER + 3] = '\n';
+    v = drain(g + "x\n", 11);
+    EXPECT(v.size() == 2 && v[0] == g && v[1] == "x");
+
+    drain(f.substr(0, f.size() - 5), 16, &status);
+    EXPECT(status == FRAME_INVALID);  // Cut short by EOF
+
+    std::string bad = v2Frame(10);
+    bad[26] = 0x7F;
+    drain(bad, 64, &status);
+    EXPECT(status == FRAME_INVALID);
+
+    drain(std::string(FRAME_READER_SIZE + 10, 'x') + "\n", 200, &status, false);
+    EXPECT(status == FRAME_OVERSIZE);
+
+    // Largest packet that fits, then more after it (forces compaction)
+    std::string big(FRAME_READER_SIZE - 2, 'y');
+    v = drain("a\n" + big + "\nz\n", 300);
+    EXPECT(v.size() == 3 && v[1] == big && v[2] == "z");
+}
+
+// ==================== STREAM + THROUGHPUT ====================
+
+static uint32_t randomWindow() { return next(); }
+
+static bool checkReader(const std::string& stream, const Expected& expected, size_t window, bool random) {
+    static FrameReader reader;
+    reader.reset(&format);
+    MemoryConnection conn;
+    conn.window = window;
+    conn.nextWindow = random ? randomWindow : nullptr;
+    conn.start(stream);
+
+    size_t index = 0;
+    bool ok = true;
+    while (conn.remaining() > 0 || reader.pending() > 0) {
+        reader.fill(conn);
+        FrameView view;
+        FrameStatus status;
+        while ((status = reader.next(view)) == FRAME_READY) {
+            if (index >= expected.lengths.size() || view.length != expected.lengths[index] ||
+                fnv(view.data, view.length) != expected.hashes[index]) {
+                ok = false;
+            }
+            index++;
+            reader.release();
+        }
+        if (status != FRAME_NONE) return false;
+        if (conn.remaining() == 0) break;
+    }
+    return ok && index == expected.lengths.size() && reader.pending() == 0;
+}
+
+static bool checkBytes(const std::string& stream, const Expected& expected, size_t window) {
+    static ByteReader reader;
+    reader.len = reader.frameLen = 0;
+    MemoryConnection conn;
+    conn.window = window;
+    conn.start(stream);
+
+    size_t index = 0;
+    bool ok = true;
+    FrameView view;
+    while (conn.remaining() > 0) {
+        while (reader.next(conn, view)) {
+            if (index >= expected.lengths.size() || view.length != expected.lengths[index] ||
+                fnv(view.data, view.length) != expected.hashes[index]) {
+                ok = false;
+            }
+            index++;
+        }
+    }
+    return ok && index == expected.lengths.size();
+}
+
+struct Result {
+    double mbps = 0;
+    double callsPerKB = 0;
+};
+
+static volatile size_t sink;
+
+static Result timeReader(const std::string& stream, size_t window) {
+    static FrameReader reader;
+    reader.reset(&format);
+    MemoryConnection conn;
+    conn.window = window;
+    conn.start(stream);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    while (conn.remaining() > 0) {
+        reader.fill(conn);
+        FrameView view;
+        while (reader.next(view) == FRAME_READY) {
+            total += view.length;
+            reader.release();
+        }
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = total;
+    return {stream.size() / s / 1e6, conn.calls * 1024.0 / stream.size()};
+}
+
+static Result timeBytes(const std::string& stream, size_t window) {
+    static ByteReader reader;
+    reader.len = reader.frameLen = 0;
+    MemoryConnection conn;
+    conn.window = window;
+    conn.start(stream);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    FrameView view;
+    while (conn.remaining() > 0) {
+        while (reader.next(conn, view)) total += view.length;
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = total;
+    return {stream.size() / s / 1e6, conn.calls * 1024.0 / stream.size()};
+}
+
+int main(int argc, char** argv) {
+    double megabytes = argc > 1 ? atof(argv[1]) : 64;
+    if (megabytes <= 0) megabytes = 64;
+
+    format.marker = BENCH_FRAME_MARKER;
+    format.header = BENCH_FRAME_HEADER;
+    format.lengthOf = frameLength;
+
+    runUnit();
+
+    Expected expected;
+    std::string stream = makeStream((size_t)(megabytes * 1e6), expected);
+
+    // Correctness over random and fixed windows, for both readers
+    Expected small;
+    std::string shortStream = makeStream(2000000, small);
+    EXPECT(checkReader(shortStream, small, 1460, true));
+    EXPECT(checkReader(shortStream, small, 1, false));
+    EXPECT(checkBytes(shortStream, small, 536));
+    EXPECT(checkReader(stream, expected, 536, false));
+
+    static const size_t windows[] = {536, 1460, 4096};
+    Result reader[3], bytes[3];
+    for (size_t i = 0; i < 3; i++) {
+        reader[i] = timeReader(stream, windows[i]);
+        bytes[i] = timeBytes(stream, windows[i]);
+        fprintf(stderr, "window %4zu: frame_reader %8.1f MB/s %7.2f calls/KB | byte loop %7.1f MB/s %8.1f calls/KB | %.1fx\n",
+                windows[i], reader[i].mbps, reader[i].callsPerKB, bytes[i].mbps, bytes[i].callsPerKB,
+                reader[i].mbps / bytes[i].mbps);
+    }
+
+    printf("{\n");
+    printf("  \"stream_bytes\": %zu,\n", stream.size());
+    printf("  \"messages\": %zu,\n", expected.lengths.size());
+    printf("  \"windows\": {\n");
+    for (size_t i = 0; i < 3; i++) {
+        printf("    \"%zu\": {\"frame_reader_mb_s\": %.1f, \"frame_reader_calls_per_kb\": %.2f, "
+               "\"byte_loop_mb_s\": %.1f, \"byte_loop_calls_per_kb\": %.1f, \"speedup\": %.1f}%s\n",
+               windows[i], reader[i].mbps, reader[i].callsPerKB, bytes[i].mbps, bytes[i].callsPerKB,
+               reader[i].mbps / bytes[i].mbps, i < 2 ? "," : "");
+    }
+    printf("  },\n");
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file fuzz_hex_payload.cpp
+ * @brief libFuzzer target: hex payload stage (CryptoManager).
+ *
+ * Feeds CryptoManager::processSecurePacket (v1.0) and processAeadPacket
+ * (v1.1) directly, i.e. after the outer envelope and past the v1.0
+ * signature check, so the in-place hex decode, length prefix and layout
+ * checks see arbitrary input. First byte: bit 0 selects v1.1, bit 1
+ * hex-encodes the rest first (valid hex, arbitrary layout) instead of
+ * using it as hex text.
+ *
+ * The input is copied into an exactly sized heap buffer, so ASan flags
+ * any access outside the payload. Checked after every call:
+ * - errors are "ERROR:*" strings
+ * - on success the plaintext lies inside the buffer, is at most
+ *   PAYLOAD_MAX_REQUEST bytes and NUL-terminated
+ *
+ * Build (clang, from firmware/):
+ *   clang++ -g -O1 -fsanitize=fuzzer,address,undefined -DARDUINO=10819 \
+ *       -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/fuzz_hex_payload.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/packet.cpp WakeLink/payload_stream.cpp WakeLink/CryptoManager.cpp \
+ *       WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp WakeLink/crypto_backend.cpp \
+ *       WakeLink/chacha20.cpp WakeLink/sha256.cpp WakeLink/poly1305.cpp \
+ *       WakeLink/secure_random.cpp WakeLink/counter_journal.cpp WakeLink/replay_window.cpp \
+ *       WakeLink/fragment.cpp WakeLink/request_arena.cpp -o fuzz_hex_payload
+ *   (g++ without libFuzzer: drop "fuzzer," and add host/fuzz_main.cpp;
+ *   host/CMakeLists.txt builds all targets with a pinned ArduinoJson)
+ *
+ * Usage: ./fuzz_hex_payload [corpus-dir]   (libFuzzer flags apply)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "hex_codec.h"
+#include "payload_codec.h"
+
+#define FUZZ_CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "CHECK %s:%d: %s\n", __FILE__, __LINE__, #cond); abort(); } \
+} while (0)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    pipelineBegin();
+    if (size < 1) return 0;
+
+    uint8_t mode = data[0];
+    data++;
+    size--;
+
+    bool aead = mode & 1;
+    size_t hexLen = (mode & 2) ? 2 * size : size;
+    char* hex = (char*)malloc(hexLen ? hexLen : 1);
+    if (mode & 2) {
+        HexCodec::encode(data, size, hex);
+    } else {
+        memcpy(hex, data, size);
+    }
+
+    char* plain = nullptr;
+    size_t plainLen = 0;
+    const char* error = aead
+        ? crypto.processAeadPacket(hex, hexLen, plain, plainLen)
+        : crypto.processSecurePacket(hex, hexLen, plain, plainLen);
+
+    if (error) {
+        FUZZ_CHECK(strncmp(error, "ERROR:", 6) == 0);
+    } else {
+        FUZZ_CHECK(plain >= hex && plain + plainLen < hex + hexLen);
+        FUZZ_CHECK(plainLen >= 1 && plainLen <= PAYLOAD_MAX_REQUEST);
+        FUZZ_CHECK(plain[plainLen] == '\0');
+    }
+
+    free(hex);
+    return 0;
+}
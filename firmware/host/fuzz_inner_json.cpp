@@ -0,0 +1,79 @@
+/**
+ * @file fuzz_inner_json.cpp
+ * @brief libFuzzer target: inner message stage (PacketManager).
+ *
+ * The input is the plaintext of a request. It is sealed with the device
+ * key by PipelineClient and processed like a real packet, so every
+ * input passes the envelope and crypto and reaches the inner decoder,
+ * fragment reassembly, the "command"/"data" checks and the replay
+ * window. First byte mod 3: v1.0 (JSON), v1.1 (JSON), v2 (MessagePack,
+ * header counter increasing per input).
+ *
+ * Checked after every call: the envelope and crypto layers never reject
+ * (no "ERROR:*", JSON_PARSE, BAD_PACKET, INVALID_FRAME, WRONG_DEVICE),
+ * "status" is "success", "error" or "pending", and a success has a
+ * command and a data object.
+ *
+ * Build (clang, from firmware/): as fuzz_outer_packet.cpp with
+ *   host/fuzz_inner_json.cpp in place of host/fuzz_outer_packet.cpp
+ *   (g++ without libFuzzer: drop "fuzzer," and add host/fuzz_main.cpp)
+ *
+ * Usage: ./fuzz_inner_json [corpus-dir]   (libFuzzer flags apply)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "payload_codec.h"
+#include "request_arena.h"
+
+#define FUZZ_CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "CHECK %s:%d: %s\n", __FILE__, __LINE__, #cond); abort(); } \
+} while (0)
+
+static PipelineClient client;
+static uint64_t frameSeq = 0;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool started = false;
+    if (!started) {
+        pipelineBegin();
+        client.begin(PIPELINE_HOST_TOKEN, PIPELINE_HOST_DEVICE_ID);
+        started = true;
+    }
+    if (size < 1) return 0;
+
+    uint8_t mode = data[0] % 3;
+    data++;
+    size--;
+
+    static char packet[PIPELINE_MAX_PACKET];
+    static uint8_t frame[FRAME_V2_MAX];
+    size_t length = mode == 2
+        ? client.sealFrame(data, size, ++frameSeq, frame, sizeof(frame))
+        : client.sealPacket(mode ? PROTOCOL_V1_1 : PROTOCOL_V1_0, data, size, packet, sizeof(packet));
+    if (length == 0) return 0;  // empty or over the single-packet limit
+
+    RequestScope scope(requestArena);
+    JsonDocument result(&requestJson);
+    if (mode == 2) {
+        packetManager.processIncomingFrame(frame, length, result);
+    } else {
+        packetManager.processIncomingPacket(packet, length, result);
+    }
+
+    const char* status = result["status"] | "";
+    const char* error = result["error"] | "";
+    FUZZ_CHECK(strncmp(error, "ERROR:", 6) != 0);
+    FUZZ_CHECK(strcmp(error, "JSON_PARSE") != 0 && strcmp(error, "BAD_PACKET") != 0);
+    FUZZ_CHECK(strcmp(error, "INVALID_FRAME") != 0 && strcmp(error, "INVALID_LENGTH") != 0 &&
+               strcmp(error, "WRONG_DEVICE") != 0);
+    FUZZ_CHECK(strcmp(status, "success") == 0 || strcmp(status, "error") == 0 ||
+               strcmp(status, "pending") == 0);
+    if (strcmp(status, "success") == 0) {
+        FUZZ_CHECK(!result["command"].isNull());
+        FUZZ_CHECK(result["data"].is<JsonObject>());
+    }
+    return 0;
+}
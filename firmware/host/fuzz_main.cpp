@@ -0,0 +1,133 @@
+/**
+ * @file fuzz_main.cpp
+ * @brief Standalone driver for the fuzz targets when libFuzzer is absent.
+ *
+ * Links against any fuzz_*.cpp instead of -fsanitize=fuzzer (e.g. with
+ * g++ on CI images without clang). Every file or directory given is
+ * replayed once (a saved crash or a corpus); then -runs=N random inputs
+ * are generated, half of them mutations of the replayed files, stopping
+ * early once -max_total_time=S seconds have passed (as libFuzzer). Crashes
+ * abort the process like under libFuzzer, so the exit code is the
+ * verdict; with -fsanitize=address,undefined memory errors do too.
+ *
+ * Build: add host/fuzz_main.cpp to the build line of a target, e.g.
+ *   g++ -O1 -g -fsanitize=address,undefined -DARDUINO=10819 -Ihost/arduino \
+ *       -IWakeLink -I<ArduinoJson>/src host/fuzz_hex_payload.cpp host/fuzz_main.cpp ...
+ *
+ * Usage: ./fuzz_target [-runs=N] [-max_total_time=S] [-max_len=N] [-seed=N] [file|dir ...]
+ *        (defaults 100000 runs, no time limit, 1024 bytes, seed 1)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static std::vector<std::vector<uint8_t>> corpus;
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static void load(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "fuzz_main: cannot open %s\n", path.c_str());
+        exit(2);
+    }
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        if (!dir) return;
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            load(path + "/" + entry->d_name);
+        }
+        closedir(dir);
+        return;
+    }
+    std::vector<uint8_t> input;
+    if (readFile(path, input)) corpus.push_back(input);
+}
+
+/// @brief xorshift64* (reproducible with -seed)
+static uint64_t rngState = 1;
+static uint64_t next() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ull;
+}
+
+static void mutate(std::vector<uint8_t>& input, size_t maxLen) {
+    size_t edits = 1 + next() % 8;
+    for (size_t i = 0; i < edits; i++) {
+        size_t at = input.empty() ? 0 : next() % input.size();
+        switch (next() % 5) {
+            case 0: if (!input.empty()) input[at] ^= (uint8_t)(1u << (next() % 8)); break;
+            case 1: if (!input.empty()) input[at] = (uint8_t)next(); break;
+            case 2: if (input.size() < maxLen) input.insert(input.begin() + at, (uint8_t)next()); break;
+            case 3: if (!input.empty()) input.erase(input.begin() + at); break;
+            case 4: if (!input.empty()) input.resize(at); break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned long runs = 100000;
+    size_t maxLen = 1024;
+    double maxSeconds = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) runs = strtoul(argv[i] + 6, NULL, 10);
+        else if (strncmp(argv[i], "-max_total_time=", 16) == 0) maxSeconds = atof(argv[i] + 16);
+        else if (strncmp(argv[i], "-max_len=", 9) == 0) maxLen = strtoul(argv[i] + 9, NULL, 10);
+        else if (strncmp(argv[i], "-seed=", 6) == 0) rngState = strtoull(argv[i] + 6, NULL, 10) | 1;
+        else if (argv[i][0] == '-') continue;  // other libFuzzer flags
+        else load(argv[i]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const std::vector<uint8_t>& input : corpus) {
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+
+    std::vector<uint8_t> input;
+    unsigned long r = 0;
+    for (; r < runs; r++) {
+        // Checking the clock every 256 inputs keeps it off the profile
+        if (maxSeconds > 0 && (r & 255) == 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= maxSeconds) {
+            break;
+        }
+        if (!corpus.empty() && (next() & 1)) {
+            input = corpus[next() % corpus.size()];
+            mutate(input, maxLen);
+        } else {
+            input.resize(next() % (maxLen + 1));
+            for (uint8_t& b : input) b = (uint8_t)next();
+        }
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("{\"replayed\": %zu, \"runs\": %lu, \"seconds\": %.2f, \"execs_per_s\": %.0f}\n",
+           corpus.size(), r, seconds, seconds > 0 ? (corpus.size() + r) / seconds : 0.0);
+    return 0;
+}
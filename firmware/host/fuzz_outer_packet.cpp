@@ -0,0 +1,66 @@
+/**
+ * @file fuzz_outer_packet.cpp
+ * @brief libFuzzer target: outer envelope stage (PacketManager).
+ *
+ * Hands arbitrary bytes to PacketManager the way the transports do: a
+ * first byte of 0x02 goes to processIncomingFrame (v2 header checks),
+ * anything else to processIncomingPacket (in-place outer JSON scan,
+ * version/field checks and the v1.0 HMAC over the payload span).
+ * Inputs that get past authentication are not expected here; the
+ * inner stage is fuzz_inner_json.cpp.
+ *
+ * The packet sits in an exactly sized heap buffer (it is decoded in
+ * place), with documents on the request arena as on the device.
+ * Checked after every call: "status" is "success", "error" or
+ * "pending", and errors carry an "error" code.
+ *
+ * Build (clang, from firmware/):
+ *   clang++ -g -O1 -fsanitize=fuzzer,address,undefined -DARDUINO=10819 \
+ *       -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/fuzz_outer_packet.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/packet.cpp WakeLink/payload_stream.cpp WakeLink/CryptoManager.cpp \
+ *       WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp WakeLink/crypto_backend.cpp \
+ *       WakeLink/chacha20.cpp WakeLink/sha256.cpp WakeLink/poly1305.cpp \
+ *       WakeLink/secure_random.cpp WakeLink/counter_journal.cpp WakeLink/replay_window.cpp \
+ *       WakeLink/fragment.cpp WakeLink/request_arena.cpp -o fuzz_outer_packet
+ *   (g++ without libFuzzer: drop "fuzzer," and add host/fuzz_main.cpp)
+ *
+ * Usage: ./fuzz_outer_packet [corpus-dir]   (libFuzzer flags apply)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "request_arena.h"
+
+#define FUZZ_CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "CHECK %s:%d: %s\n", __FILE__, __LINE__, #cond); abort(); } \
+} while (0)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    pipelineBegin();
+
+    uint8_t* packet = (uint8_t*)malloc(size ? size : 1);
+    memcpy(packet, data, size);
+
+    {
+        RequestScope scope(requestArena);
+        JsonDocument result(&requestJson);
+
+        if (PacketManager::isFrame(packet, size)) {
+            packetManager.processIncomingFrame(packet, size, result);
+            FUZZ_CHECK(strcmp(result["version"] | "", PROTOCOL_V2) == 0);
+        } else {
+            packetManager.processIncomingPacket((char*)packet, size, result);
+        }
+
+        const char* status = result["status"] | "";
+        FUZZ_CHECK(strcmp(status, "success") == 0 || strcmp(status, "error") == 0 ||
+                   strcmp(status, "pending") == 0);
+        if (strcmp(status, "error") == 0) FUZZ_CHECK(!result["error"].isNull());
+    }
+
+    free(packet);
+    return 0;
+}
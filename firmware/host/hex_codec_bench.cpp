@@ -0,0 +1,237 @@
+/**
+ * @file hex_codec_bench.cpp
+ * @brief Host checks, fuzzing and throughput run for the hex codec.
+ *
+ * Exercises HexCodec (firmware/WakeLink/hex_codec.cpp) without a device:
+ *
+ * - unit: all 256 byte values, mixed case, a bad character at every
+ *   position of a multi-step input, in-place decoding
+ * - fuzz: random lengths and contents (valid digits, mutated digits and
+ *   raw bytes) decoded by the selected kernel, the byte-at-a-time path
+ *   and an independent strtoul() reference, which must all agree on the
+ *   verdict and the bytes; encode is checked the same way against
+ *   snprintf("%02x")
+ * - throughput: MB/s of input for the kernel, the byte-at-a-time path
+ *   and the snprintf/branchy code it replaced, at payload-sized inputs
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -IWakeLink host/hex_codec_bench.cpp WakeLink/hex_codec.cpp \
+ *       -o hex_codec_bench
+ *
+ * Add -mssse3 (or -march=native) for the SSSE3 kernel, -m32 for SWAR32.
+ *
+ * Usage: ./hex_codec_bench [fuzz-cases]   (default 200000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "hex_codec.h"
+#include "host_test.h"
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * @brief Reference decoder with no shared code (strtoul per pair).
+ */
+static bool referenceDecode(const char* in, size_t len, uint8_t* out) {
+    for (size_t i = 0; i < len; i++) {
+        char pair[3] = {in[2 * i], in[2 * i + 1], 0};
+        for (int k = 0; k < 2; k++) {
+            if (!strchr("0123456789abcdefABCDEF", pair[k]) || !pair[k]) return false;
+        }
+        out[i] = (uint8_t)strtoul(pair, NULL, 16);
+    }
+    return true;
+}
+
+/**
+ * @brief Decoder as it was before the codec (branchy per character).
+ */
+static uint8_t legacyNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+/**
+ * @brief Fixed cases.
+ */
+static void runUnit() {
+    uint8_t all[256];
+    for (int i = 0; i < 256; i++) all[i] = (uint8_t)i;
+
+    char hex[512];
+    HexCodec::encode(all, sizeof(all), hex);
+    for (int i = 0; i < 256; i++) {
+        char want[3];
+        snprintf(want, sizeof(want), "%02x", i);
+        EXPECT(memcmp(hex + 2 * i, want, 2) == 0);
+    }
+
+    uint8_t back[256];
+    EXPECT(HexCodec::decode(hex, sizeof(back), back));
+    EXPECT(memcmp(back, all, sizeof(all)) == 0);
+
+    // Uppercase and mixed case decode to the same bytes
+    char upper[512];
+    for (size_t i = 0; i < sizeof(upper); i++) {
+        upper[i] = (i % 3) ? (char)toupper((unsigned char)hex[i]) : hex[i];
+    }
+    memset(back, 0, sizeof(back));
+    EXPECT(HexCodec::decode(upper, sizeof(back), back));
+    EXPECT(memcmp(back, all, sizeof(all)) == 0);
+
+    // Characters next to the digit ranges and with the high bit set
+    static const char bad[] = {'/', ':', '@', 'G', '`', 'g', ' ', '\0', 'x', (char)0xB0, (char)0xE1};
+    for (size_t pos = 0; pos < 96; pos++) {
+        for (size_t b = 0; b < sizeof(bad); b++) {
+            char probe[96];
+            memcpy(probe, hex, sizeof(probe));
+            probe[pos] = bad[b];
+            EXPECT(!HexCodec::decode(probe, sizeof(probe) / 2, back));
+        }
+    }
+
+    // In place: bytes land on the front of the digit buffer
+    char inplace[512];
+    memcpy(inplace, hex, sizeof(inplace));
+    EXPECT(HexCodec::decode(inplace, 256, (uint8_t*)inplace));
+    EXPECT(memcmp(inplace, all, sizeof(all)) == 0);
+
+    EXPECT(HexCodec::nibble('0') == 0 && HexCodec::nibble('F') == 15 && HexCodec::nibble('g') == -1);
+    EXPECT(HexCodec::decode("", 0, back));
+}
+
+/**
+ * @brief Random inputs against the byte-at-a-time path and the reference.
+ */
+static void runFuzz(uint32_t cases) {
+    static const char digits[] = "0123456789abcdefABCDEF";
+    srand(1313);
+    std::vector<char> in;
+    std::vector<uint8_t> raw, a, b, c;
+    std::vector<char> enc, want;
+
+    for (uint32_t n = 0; n < cases; n++) {
+        size_t len = (size_t)(rand() % 600);
+        in.resize(2 * len + 1);
+        int mode = rand() % 4;
+        for (size_t i = 0; i < 2 * len; i++) {
+            if (mode == 3) in[i] = (char)(rand() & 0xFF);
+            else in[i] = digits[rand() % 22];
+        }
+        if (mode == 1 && len) in[(size_t)rand() % (2 * len)] = (char)(rand() & 0xFF);
+        if (mode == 2 && len) in[2 * len - 1 - (size_t)(rand() % 2)] = (char)(rand() & 0xFF);
+
+        a.assign(len + 1, 0);
+        b.assign(len + 1, 0);
+        c.assign(len + 1, 0);
+        bool ok = HexCodec::decode(in.data(), len, a.data());
+        bool okScalar = HexCodec::decodeScalar(in.data(), len, b.data());
+        bool okRef = referenceDecode(in.data(), len, c.data());
+        if (ok != okRef || okScalar != okRef || (okRef && (a != c || b != c))) {
+            fprintf(stderr, "decode mismatch case %u len %zu: kernel %d scalar %d ref %d\n",
+                    (unsigned)n, len, ok, okScalar, okRef);
+            failures++;
+            return;
+        }
+
+        // Same input decoded onto itself
+        if (okRef) {
+            std::vector<char> self(in.begin(), in.begin() + 2 * len);
+            EXPECT(HexCodec::decode(self.data(), len, (uint8_t*)self.data()));
+            EXPECT(len == 0 || memcmp(self.data(), c.data(), len) == 0);
+        }
+
+        raw.resize(len);
+        for (size_t i = 0; i < len; i++) raw[i] = (uint8_t)(rand() & 0xFF);
+        enc.assign(2 * len, 0);
+        want.assign(2 * len + 1, 0);
+        HexCodec::encode(raw.data(), len, enc.data());
+        for (size_t i = 0; i < len; i++) snprintf(&want[2 * i], 3, "%02x", raw[i]);
+        if (len && memcmp(enc.data(), want.data(), 2 * len) != 0) {
+            fprintf(stderr, "encode mismatch case %u len %zu\n", (unsigned)n, len);
+            failures++;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Run fn until ~0.2 s have passed; return MB/s of input.
+ */
+template <typename Fn>
+static double measure(size_t bytesPerCall, Fn fn) {
+    uint32_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double secs = 0;
+    do {
+        for (int i = 0; i < 64; i++) fn();
+        calls += 64;
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (secs < 0.2);
+    return (double)bytesPerCall * calls / secs / 1e6;
+}
+
+/**
+ * @brief Throughput per input size.
+ */
+static void runThroughput() {
+    static const size_t sizes[] = {32, 500, 4096};
+    uint8_t raw[4096];
+    char hex[8193];
+    for (size_t i = 0; i < sizeof(raw); i++) raw[i] = (uint8_t)(i * 131 + 7);
+    HexCodec::encode(raw, sizeof(raw), hex);
+
+    volatile uint8_t sink = 0;
+    printf("  \"throughput_mb_per_s\": [\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        uint8_t out[4096];
+        char text[8193];
+
+        double enc = measure(n, [&] { HexCodec::encode(raw, n, text); sink ^= (uint8_t)text[n]; });
+        double encScalar = measure(n, [&] { HexCodec::encodeScalar(raw, n, text); sink ^= (uint8_t)text[n]; });
+        double encSprintf = measure(n, [&] {
+            for (size_t i = 0; i < n; i++) snprintf(text + 2 * i, 3, "%02x", raw[i]);
+            sink ^= (uint8_t)text[n];
+        });
+
+        double dec = measure(2 * n, [&] { sink ^= HexCodec::decode(hex, n, out) ? out[n - 1] : 0; });
+        double decScalar = measure(2 * n, [&] { sink ^= HexCodec::decodeScalar(hex, n, out) ? out[n - 1] : 0; });
+        double decLegacy = measure(2 * n, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = (uint8_t)((legacyNibble(hex[2 * i]) << 4) | legacyNibble(hex[2 * i + 1]));
+            }
+            sink ^= out[n - 1];
+        });
+
+        printf("    {\"bytes\": %zu, \"encode\": %.0f, \"encode_scalar\": %.0f, \"encode_snprintf\": %.0f, "
+               "\"decode\": %.0f, \"decode_scalar\": %.0f, \"decode_branchy\": %.0f}%s\n",
+               n, enc, encScalar, encSprintf, dec, decScalar, decLegacy,
+               s + 1 < sizeof(sizes) / sizeof(sizes[0]) ? "," : "");
+    }
+    printf("  ]\n");
+    (void)sink;
+}
+
+int main(int argc, char** argv) {
+    uint32_t cases = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+
+    printf("{\n");
+    printf("  \"kernel\": \"%s\",\n", HEX_CODEC_KERNEL);
+    runUnit();
+    runFuzz(cases);
+    printf("  \"unit_and_fuzz\": \"%s\",\n", failures ? "failed" : "passed");
+    printf("  \"fuzz_cases\": %u,\n", (unsigned)cases);
+    runThroughput();
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file host_test.h
+ * @brief Check macro and loopback connection shared by the host tools.
+ *
+ * - EXPECT(cond): report a failed check on stderr and count it in
+ *   `failures`; each tool prints its JSON and exits non-zero if any
+ *   check failed
+ * - PosixConnection: NetConnection over a non-blocking POSIX socket, so
+ *   ConnectionPool, FrameReader and ResponseQueue run unchanged over
+ *   loopback (tcp_pool_sim.cpp, admission_sim.cpp)
+ *
+ * Header only; every host tool is a single translation unit plus the
+ * device sources, so each gets its own counter. Linux (SIOCOUTQ).
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include "net_connection.h"
+#include <errno.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/sockios.h>
+
+/// @brief Checks that failed so far
+static int failures = 0;
+
+#define EXPECT(cond) do { \
+    if (!(cond)) { fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+/**
+ * @brief NetConnection over a non-blocking POSIX socket.
+ */
+class PosixConnection : public NetConnection {
+public:
+    int fd = -1;
+
+    int available() override {
+        int n = 0;
+        return fd >= 0 && ioctl(fd, FIONREAD, &n) == 0 ? n : 0;
+    }
+
+    int read() override {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+
+    int read(uint8_t* buf, size_t len) override {
+        ssize_t n = fd >= 0 ? recv(fd, buf, len, MSG_DONTWAIT) : -1;
+        return n > 0 ? (int)n : 0;
+    }
+
+    size_t writable() override {
+        int size = 0, queued = 0;
+        socklen_t len = sizeof(size);
+        if (fd < 0 || getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, &len) != 0 ||
+            ioctl(fd, SIOCOUTQ, &queued) != 0) {
+            return 0;
+        }
+        return size > queued ? (size_t)(size - queued) : 0;
+    }
+
+    size_t write(const uint8_t* buf, size_t len) override {
+        ssize_t n = fd >= 0 ? send(fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL) : -1;
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    bool connected() override {
+        if (fd < 0) return false;
+        uint8_t b;
+        ssize_t n = recv(fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+
+    void stop() override {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+};
+
+#endif // HOST_TEST_H
@@ -0,0 +1,294 @@
+/**
+ * @file pipeline_bench.cpp
+ * @brief Native throughput benchmark of the packet/crypto pipeline.
+ *
+ * Times the device code (PacketManager, CryptoManager, ArduinoJson on the
+ * request arena) per stage and per protocol version, Google Benchmark
+ * style: each stage runs in batches of BENCH_BATCH freshly sealed packets
+ * (sealing is untimed, processing is in place) until it has run for the
+ * minimum time, then reports ns per packet and packets per second.
+ *
+ * Stages (every request carries "sender"/"seq", so "total" includes the
+ * replay window and the counter journal write, as on the device):
+ * - verify: HMAC-SHA256 of the payload span (v1.0 only)
+ * - decode: hex decode + decrypt in place (v1.0 ChaCha20, v1.1 AEAD)
+ * - inner:  deserializeJson / deserializeMsgPack of the plaintext
+ * - total:  processIncomingPacket / processIncomingFrame end to end
+ * - reply:  createResponsePacket / createResponseFrame into a buffer
+ * "envelope" is total minus the timed stages (outer scan, field checks,
+ * replay window, bookkeeping), derived rather than measured.
+ * "inner" and "total" also report the most request-arena bytes one
+ * packet holds once parsed, and how many allocations per packet did not
+ * fit the arena and fell back to malloc().
+ *
+ * The human-readable table goes to stderr, JSON to stdout. Exits
+ * non-zero if a sealed request is not accepted.
+ *
+ * Build (from firmware/, ArduinoJson v7 source tree at <ArduinoJson>):
+ *   g++ -O2 -DARDUINO=10819 -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/pipeline_bench.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/packet.cpp WakeLink/payload_stream.cpp WakeLink/CryptoManager.cpp \
+ *       WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp WakeLink/crypto_backend.cpp \
+ *       WakeLink/chacha20.cpp WakeLink/sha256.cpp WakeLink/poly1305.cpp \
+ *       WakeLink/secure_random.cpp WakeLink/counter_journal.cpp WakeLink/replay_window.cpp \
+ *       WakeLink/fragment.cpp WakeLink/request_arena.cpp -o pipeline_bench
+ *
+ * Usage: ./pipeline_bench [seconds-per-stage]   (default 0.5)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "request_arena.h"
+#include "host_test.h"
+#include <chrono>
+
+/// @brief Packets sealed per timed batch
+#define BENCH_BATCH 256
+
+static PipelineClient client;
+static uint64_t nextSeq = 0;
+static unsigned long rejected = 0;
+
+// Batch slots; packets are consumed in place, so each batch is resealed
+static char packets[BENCH_BATCH][PIPELINE_MAX_PACKET];
+static uint8_t frames[BENCH_BATCH][FRAME_V2_MAX];
+static size_t lengths[BENCH_BATCH];
+static char* payloads[BENCH_BATCH];
+static size_t payloadLengths[BENCH_BATCH];
+static const char* signatures[BENCH_BATCH];
+
+static const char* benchVersion = PROTOCOL_V1_0;
+
+/**
+ * @brief One timed stage.
+ */
+struct BenchStage {
+    const char* name;
+    void (*prepare)(size_t slot);   ///< Untimed, once per slot per batch
+    void (*run)(size_t slot);       ///< Timed
+    double ns = 0;
+    uint64_t iterations = 0;
+    size_t arena = 0;               ///< Most request-arena bytes held by one run
+    double fallbacks = 0;           ///< Arena overflows (malloc fallbacks) per run
+};
+
+static size_t arenaPeak = 0;  ///< Of the stage being measured
+
+/** @brief Record the arena bytes in use; call before the run's scope closes. */
+static void noteArena() {
+    if (requestArena.getUsed() > arenaPeak) arenaPeak = requestArena.getUsed();
+}
+
+// ==================== PREPARE ====================
+
+static void sealRequest(size_t slot) {
+    char inner[160];
+    size_t innerLen = pipelineInnerJson(inner, sizeof(inner), "ping", ++nextSeq);
+    lengths[slot] = client.sealPacket(benchVersion, (const uint8_t*)inner, innerLen,
+                                      packets[slot], sizeof(packets[slot]));
+
+    // Locate payload and signature as the outer scan would
+    char* payload = strstr(packets[slot], "\"payload\":\"") + 11;
+    payloads[slot] = payload;
+    payloadLengths[slot] = (size_t)(strchr(payload, '"') - payload);
+    const char* sig = strstr(packets[slot], "\"signature\":\"");
+    signatures[slot] = sig ? sig + 13 : nullptr;
+}
+
+static void sealFrameRequest(size_t slot) {
+    uint8_t body[64];
+    size_t bodyLen = pipelineInnerMsgPack(body, sizeof(body), "ping");
+    lengths[slot] = client.sealFrame(body, bodyLen, ++nextSeq, frames[slot], sizeof(frames[slot]));
+}
+
+static void innerJson(size_t slot) {
+    lengths[slot] = pipelineInnerJson(packets[slot], sizeof(packets[slot]), "ping", ++nextSeq);
+}
+
+static void innerMsgPack(size_t slot) {
+    lengths[slot] = pipelineInnerMsgPack(frames[slot], sizeof(frames[slot]), "ping");
+}
+
+static void nothing(size_t) {}
+
+// ==================== RUN ====================
+
+static void runVerify(size_t slot) {
+    if (!crypto.verifyHMAC((const uint8_t*)payloads[slot], payloadLengths[slot], signatures[slot], 64)) {
+        rejected++;
+    }
+}
+
+static void runDecode(size_t slot) {
+    char* plain;
+    size_t plainLen;
+    const char* error = strcmp(benchVersion, PROTOCOL_V1_1) == 0
+        ? crypto.processAeadPacket(payloads[slot], payloadLengths[slot], plain, plainLen)
+        : crypto.processSecurePacket(payloads[slot], payloadLengths[slot], plain, plainLen);
+    if (error) rejected++;
+}
+
+static void runInnerJson(size_t slot) {
+    RequestScope scope(requestArena);
+    JsonDocument doc(&requestJson);
+    if (deserializeJson(doc, (const char*)packets[slot], lengths[slot])) rejected++;
+    noteArena();
+}
+
+static void runInnerMsgPack(size_t slot) {
+    RequestScope scope(requestArena);
+    JsonDocument doc(&requestJson);
+    if (deserializeMsgPack(doc, (const char*)frames[slot], lengths[slot])) rejected++;
+    noteArena();
+}
+
+static void runTotal(size_t slot) {
+    RequestScope scope(requestArena);
+    JsonDocument result(&requestJson);
+    packetManager.processIncomingPacket(packets[slot], lengths[slot], result);
+    if (strcmp(result["status"] | "", "success") != 0) rejected++;
+    noteArena();
+}
+
+static void runTotalFrame(size_t slot) {
+    RequestScope scope(requestArena);
+    JsonDocument result(&requestJson);
+    packetManager.processIncomingFrame(frames[slot], lengths[slot], result);
+    if (strcmp(result["status"] | "", "success") != 0) rejected++;
+    noteArena();
+}
+
+/// @brief Reply of a typical command, built once
+static JsonDocument reply;
+static char replyOut[PIPELINE_MAX_PACKET];
+
+static void runReply(size_t) {
+    RequestScope scope(requestArena);
+    if (!packetManager.createResponsePacket(reply, benchVersion, replyOut, sizeof(replyOut))) rejected++;
+}
+
+static void runReplyFrame(size_t) {
+    RequestScope scope(requestArena);
+    if (!packetManager.createResponseFrame(reply, (uint8_t*)replyOut, sizeof(replyOut))) rejected++;
+}
+
+// ==================== RUNNER ====================
+
+static void measure(BenchStage& stage, double minSeconds) {
+    double timed = 0;
+    uint64_t done = 0;
+    arenaPeak = 0;
+    uint32_t overflows = requestArena.getOverflows();
+
+    while (timed < minSeconds) {
+        for (size_t i = 0; i < BENCH_BATCH; i++) stage.prepare(i);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < BENCH_BATCH; i++) stage.run(i);
+        timed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done += BENCH_BATCH;
+    }
+
+    stage.iterations = done;
+    stage.ns = timed * 1e9 / done;
+    stage.arena = arenaPeak;
+    stage.fallbacks = (double)(requestArena.getOverflows() - overflows) / done;
+}
+
+static void printRow(const char* version, const char* name, double ns, uint64_t iterations, size_t arena) {
+    char label[32], bytes[24] = "";
+    snprintf(label, sizeof(label), "%s/%s", version, name);
+    if (arena) snprintf(bytes, sizeof(bytes), "%zu B", arena);
+    if (iterations) {
+        fprintf(stderr, "%-16s %10.0f ns %12llu %14.0f/s %9s\n", label, ns,
+                (unsigned long long)iterations, ns > 0 ? 1e9 / ns : 0.0, bytes);
+    } else {
+        fprintf(stderr, "%-16s %10.0f ns %12s %16s\n", label, ns, "(derived)", "");
+    }
+}
+
+int main(int argc, char** argv) {
+    double minSeconds = argc > 1 ? atof(argv[1]) : 0.5;
+    if (minSeconds <= 0) minSeconds = 0.5;
+
+    pipelineBegin();
+    client.begin(PIPELINE_HOST_TOKEN, PIPELINE_HOST_DEVICE_ID);
+
+    reply["status"] = "success";
+    reply["device_id"] = PIPELINE_HOST_DEVICE_ID;
+    reply["ip"] = "192.168.1.50";
+    reply["ssid"] = "home-network";
+    reply["rssi"] = -61;
+    reply["request_counter"] = 123456;
+    reply["free_heap"] = 41234;
+    reply["request_id"] = "R0000001";
+
+    struct Suite {
+        const char* version;
+        BenchStage stages[5];
+        size_t count;
+    } suites[] = {
+        {PROTOCOL_V1_0, {
+            {"verify", sealRequest, runVerify},
+            {"decode", sealRequest, runDecode},
+            {"inner", innerJson, runInnerJson},
+            {"total", sealRequest, runTotal},
+            {"reply", nothing, runReply}}, 5},
+        {PROTOCOL_V1_1, {
+            {"decode", sealRequest, runDecode},
+            {"inner", innerJson, runInnerJson},
+            {"total", sealRequest, runTotal},
+            {"reply", nothing, runReply}}, 4},
+        {PROTOCOL_V2, {
+            {"inner", innerMsgPack, runInnerMsgPack},
+            {"total", sealFrameRequest, runTotalFrame},
+            {"reply", nothing, runReplyFrame}}, 3},
+    };
+
+    fprintf(stderr, "%-16s %13s %12s %16s %9s\n", "Benchmark", "Time", "Iterations", "Packets", "Arena");
+    fprintf(stderr, "---------------------------------------------------------------------\n");
+
+    for (Suite& suite : suites) {
+        benchVersion = suite.version;
+        double total = 0, parts = 0;
+        for (size_t i = 0; i < suite.count; i++) {
+            BenchStage& stage = suite.stages[i];
+            measure(stage, minSeconds);
+            printRow(suite.version, stage.name, stage.ns, stage.iterations, stage.arena);
+            if (strcmp(stage.name, "total") == 0) total = stage.ns;
+            else if (strcmp(stage.name, "reply") != 0) parts += stage.ns;
+        }
+        printRow(suite.version, "envelope", total > parts ? total - parts : 0, 0, 0);
+    }
+
+    EXPECT(rejected == 0);
+
+    printf("{\n");
+    printf("  \"backend\": \"%s\",\n", CryptoBackend::name());
+    printf("  \"cipher_kernel\": \"%s\",\n", CHACHA20_KERNEL);
+    printf("  \"batch\": %u,\n", (unsigned)BENCH_BATCH);
+    printf("  \"versions\": {\n");
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++) {
+        Suite& suite = suites[s];
+        printf("    \"%s\": {", suite.version);
+        for (size_t i = 0; i < suite.count; i++) {
+            const BenchStage& stage = suite.stages[i];
+            printf("%s\"%s\": {\"ns\": %.0f, \"packets_per_s\": %.0f", i ? ", " : "",
+                   stage.name, stage.ns, stage.ns > 0 ? 1e9 / stage.ns : 0.0);
+            if (stage.arena) {
+                printf(", \"arena_bytes\": %zu, \"heap_fallbacks\": %.2f", stage.arena, stage.fallbacks);
+            }
+            printf("}");
+        }
+        printf("}%s\n", s + 1 < sizeof(suites) / sizeof(suites[0]) ? "," : "");
+    }
+    printf("  },\n");
+    printf("  \"request_counter\": %lu,\n", (unsigned long)crypto.getRequestCount());
+    printf("  \"journal_programs\": %lu,\n", (unsigned long)crypto.getCounterJournal().getProgramOps());
+    printf("  \"rejected\": %lu\n", rejected);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file pipeline_host.cpp
+ * @brief Device globals, RAM flash and client sealing for native builds.
+ */
+
+#include "pipeline_host.h"
+#include "hex_codec.h"
+#include "payload_codec.h"
+#include "poly1305.h"
+
+// ==================== DEVICE GLOBALS ====================
+
+DeviceConfig cfg;
+String DEVICE_TOKEN;
+String DEVICE_ID;
+SecureRandom secureRandom;
+CryptoManager crypto;
+PacketManager packetManager(crypto);
+
+void pipelineBegin() {
+    static bool started = false;
+    if (started) return;
+    started = true;
+
+    const uint8_t seed[] = "wakelink-pipeline-host";
+    secureRandom.seed(seed, sizeof(seed));
+
+    memset(&cfg, 0, sizeof(cfg));
+    strncpy(cfg.device_token, PIPELINE_HOST_TOKEN, sizeof(cfg.device_token) - 1);
+    strncpy(cfg.device_id, PIPELINE_HOST_DEVICE_ID, sizeof(cfg.device_id) - 1);
+    cfg.initialized = 1;
+    DEVICE_TOKEN = cfg.device_token;
+    DEVICE_ID = cfg.device_id;
+
+    if (!crypto.begin()) {
+        fprintf(stderr, "pipeline_host: crypto.begin() failed\n");
+        abort();
+    }
+}
+
+// ==================== RAM FLASH ====================
+
+/// Counter and replay floor journal sectors; each region erases its own on first begin()
+static uint8_t hostFlash[FLASH_RESERVED_SECTORS * 4096];
+
+uint32_t hostFlashPrograms = 0;
+uint32_t hostFlashErases = 0;
+
+bool DeviceFlashRegion::begin() {
+    if (!ready) memset(hostFlash + first * 4096, 0xFF, count * 4096);
+    base = (uint32_t)(first * 4096);
+    ready = true;
+    return true;
+}
+
+bool DeviceFlashRegion::read(uint32_t offset, void* buf, size_t len) {
+    if (offset > count * 4096 || len > count * 4096 - offset) return false;
+    memcpy(buf, hostFlash + base + offset, len);
+    return true;
+}
+
+bool DeviceFlashRegion::program(uint32_t offset, const void* buf, size_t len) {
+    if (offset > count * 4096 || len > count * 4096 - offset) return false;
+    hostFlashPrograms++;
+    // NOR flash only clears bits
+    const uint8_t* src = (const uint8_t*)buf;
+    for (size_t i = 0; i < len; i++) hostFlash[base + offset + i] &= src[i];
+    return true;
+}
+
+bool DeviceFlashRegion::erase(size_t sector) {
+    if (sector >= count) return false;
+    hostFlashErases++;
+    memset(hostFlash + base + sector * 4096, 0xFF, 4096);
+    return true;
+}
+
+// ==================== CLIENT ====================
+
+static void write_be(uint8_t* p, uint64_t v, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+void PipelineClient::begin(const char* token, const char* deviceId) {
+    CryptoBackend::sha256((const uint8_t*)token, strlen(token), key);
+    hmac.begin(key, sizeof(key));
+
+    uint8_t hash[32];
+    CryptoBackend::sha256((const uint8_t*)deviceId, strlen(deviceId), hash);
+    deviceHash = ((uint32_t)hash[0] << 24) | ((uint32_t)hash[1] << 16) | ((uint32_t)hash[2] << 8) | hash[3];
+}
+
+void PipelineClient::nextNonce(uint8_t nonce[12]) {
+    memset(nonce, 0, 12);
+    write_be(nonce + 4, ++nonceCounter, 8);
+}
+
+size_t PipelineClient::sealPacket(const char* version, const uint8_t* inner, size_t length,
+                                  char* out, size_t capacity) {
+    bool aead = strcmp(version, PROTOCOL_V1_1) == 0;
+    if (length == 0 || length > PAYLOAD_MAX_REQUEST) return 0;
+
+    // len(2) | ciphertext | nonce(16) or nonce(12) + tag(16)
+    uint8_t raw[2 + PAYLOAD_MAX_REQUEST + 16 + 12];
+    size_t rawLen = 2 + length + (aead ? 12 + 16 : 16);
+    write_be(raw, length, 2);
+    memcpy(raw + 2, inner, length);
+
+    uint8_t* nonce = raw + 2 + length;
+    nextNonce(nonce);
+    if (aead) {
+        ChaCha20Poly1305::seal(key, nonce, raw, 2, raw + 2, length, nonce + 12);
+    } else {
+        memset(nonce + 12, 0, 4);
+        CryptoBackend::chacha20(key, nonce, 0, raw + 2, raw + 2, length);
+    }
+
+    static const char head[] = "{\"device_id\":\"" PIPELINE_HOST_DEVICE_ID "\",\"payload\":\"";
+    size_t need = sizeof(head) - 1 + 2 * rawLen + 96 + 1;
+    if (need > capacity) return 0;
+
+    size_t pos = sizeof(head) - 1;
+    memcpy(out, head, pos);
+    char* payload = out + pos;
+    HexCodec::encode(raw, rawLen, payload);
+    pos += 2 * rawLen;
+
+    if (aead) {
+        pos += (size_t)snprintf(out + pos, capacity - pos, "\",\"version\":\"%s\"}", version);
+    } else {
+        uint8_t mac[32];
+        hmac.compute((const uint8_t*)payload, 2 * rawLen, mac);
+        memcpy(out + pos, "\",\"signature\":\"", 15);
+        pos += 15;
+        HexCodec::encode(mac, sizeof(mac), out + pos);
+        pos += 64;
+        pos += (size_t)snprintf(out + pos, capacity - pos, "\",\"version\":\"%s\"}", version);
+    }
+    return pos;
+}
+
+size_t PipelineClient::sealFrame(const uint8_t* body, size_t length, uint64_t seq,
+                                 uint8_t* out, size_t capacity) {
+    if (length > FRAME_V2_MAX_BODY || FRAME_V2_HEADER + length + FRAME_V2_TAG > capacity) return 0;
+
+    out[0] = FRAME_V2_VERSION;
+    out[1] = 0;
+    write_be(out + 2, deviceHash, 4);
+    write_be(out + 6, seq, 8);
+    nextNonce(out + 14);
+    write_be(out + 26, length, 2);
+
+    uint8_t* data = out + FRAME_V2_HEADER;
+    memcpy(data, body, length);
+    ChaCha20Poly1305::seal(key, out + 14, out, FRAME_V2_HEADER, data, length, data + length);
+    return FRAME_V2_HEADER + length + FRAME_V2_TAG;
+}
+
+// ==================== INNER MESSAGES ====================
+
+size_t pipelineInnerJson(char* out, size_t capacity, const char* command, uint64_t seq) {
+    int n = seq
+        ? snprintf(out, capacity,
+                   "{\"command\":\"%s\",\"data\":{},\"request_id\":\"R%07llu\",\"timestamp\":0,"
+                   "\"sender\":\"host\",\"seq\":%llu}",
+                   command, (unsigned long long)(seq % 10000000), (unsigned long long)seq)
+        : snprintf(out, capacity, "{\"command\":\"%s\",\"data\":{},\"request_id\":\"R0000000\",\"timestamp\":0}",
+                   command);
+    return n > 0 && (size_t)n < capacity ? (size_t)n : 0;
+}
+
+/// @brief Append a MessagePack fixstr (< 32 bytes).
+static uint8_t* put_fixstr(uint8_t* p, const char* s) {
+    size_t n = strlen(s);
+    *p++ = (uint8_t)(0xA0 | n);
+    memcpy(p, s, n);
+    return p + n;
+}
+
+size_t pipelineInnerMsgPack(uint8_t* out, size_t capacity, const char* command) {
+    size_t n = strlen(command);
+    if (n >= 32 || capacity < 36 + n) return 0;
+    uint8_t* p = out;
+    *p++ = 0x83;                      // fixmap, 3 entries
+    p = put_fixstr(p, "command");
+    p = put_fixstr(p, command);
+    p = put_fixstr(p, "data");
+    *p++ = 0x80;                      // empty fixmap
+    p = put_fixstr(p, "request_id");
+    p = put_fixstr(p, "R0000000");
+    return (size_t)(p - out);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file pipeline_host.h
+ * @brief Native device context for the packet/crypto pipeline.
+ *
+ * Shared by the fuzz targets (fuzz_*.cpp) and pipeline_bench.cpp:
+ *
+ * - the globals WakeLink.ino and config.cpp define on the device (cfg,
+ *   DEVICE_ID, crypto, packetManager, secureRandom), with a fixed token
+ *   and a deterministic DRBG so runs are reproducible
+ * - DeviceFlashRegion over RAM (NOR semantics), so the request counter
+ *   and the replay floor go through the real CounterJournal as on the
+ *   device
+ * - PipelineClient, which seals requests the way the Python client does
+ *   (key = SHA256(token), own hex/HMAC/AEAD code paths) so valid v1.0,
+ *   v1.1 and v2 input reaches the inner parsers
+ *
+ * The device sources are built unchanged against the shim in
+ * host/arduino (String, Print, Serial, ESP, EEPROM) and ArduinoJson v7.
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#ifndef PIPELINE_HOST_H
+#define PIPELINE_HOST_H
+
+#include <Arduino.h>
+#include "packet.h"
+#include "secure_random.h"
+
+/// @brief Token of the host device (key = SHA256 of it)
+#define PIPELINE_HOST_TOKEN "host-pipeline-token-0123456789abcdef0123456789abcdef"
+
+/// @brief Device ID of the host device
+#define PIPELINE_HOST_DEVICE_ID "WLHOST01"
+
+/// @brief Largest sealed v1.x packet (outer JSON) built by PipelineClient
+#define PIPELINE_MAX_PACKET 2048
+
+extern PacketManager packetManager;
+
+/// @brief Program and erase calls on the RAM flash since start (all regions)
+extern uint32_t hostFlashPrograms;
+extern uint32_t hostFlashErases;
+
+/**
+ * @brief Configure the globals and start CryptoManager (idempotent).
+ */
+void pipelineBegin();
+
+/**
+ * @brief Client half of the protocol, independent of the device code.
+ */
+class PipelineClient {
+private:
+    uint8_t key[32];
+    CryptoBackend::Hmac hmac;
+    uint32_t deviceHash = 0;
+    uint64_t nonceCounter = 0;
+
+    /** @brief Unique 12-byte nonce (counter based). */
+    void nextNonce(uint8_t nonce[12]);
+
+public:
+    /**
+     * @brief Derive the keys from a device token.
+     * @param token Device token.
+     * @param deviceId Device ID (v2 device hash).
+     */
+    void begin(const char* token, const char* deviceId);
+
+    /**
+     * @brief Seal an inner message as a v1.0 or v1.1 outer JSON packet.
+     * @param version PROTOCOL_V1_0 or PROTOCOL_V1_1.
+     * @param inner Inner message (1..PAYLOAD_MAX_REQUEST bytes).
+     * @param length Length of inner.
+     * @param out Output buffer (NUL-terminated).
+     * @param capacity Size of out.
+     * @return Packet length, or 0 if it does not fit.
+     */
+    size_t sealPacket(const char* version, const uint8_t* inner, size_t length,
+                      char* out, size_t capacity);
+
+    /**
+     * @brief Seal a MessagePack body as a v2 request frame.
+     * @param body Body (0..FRAME_V2_MAX_BODY bytes).
+     * @param length Length of body.
+     * @param seq Header counter (replay sequence).
+     * @param out Output buffer.
+     * @param capacity Size of out.
+     * @return Frame length, or 0 if it does not fit.
+     */
+    size_t sealFrame(const uint8_t* body, size_t length, uint64_t seq,
+                     uint8_t* out, size_t capacity);
+};
+
+/**
+ * @brief Inner JSON of a request, as the Python client sends it.
+ * @param out Output buffer.
+ * @param capacity Size of out.
+ * @param command Command name.
+ * @param seq Replay sequence (0 = omit "sender"/"seq").
+ * @return Length, or 0 if it does not fit.
+ */
+size_t pipelineInnerJson(char* out, size_t capacity, const char* command, uint64_t seq);
+
+/**
+ * @brief MessagePack body of a v2 request ({command, data: {}, request_id}).
+ * @param out Output buffer.
+ * @param capacity Size of out.
+ * @param command Command name (< 32 characters).
+ * @return Length, or 0 if it does not fit.
+ */
+size_t pipelineInnerMsgPack(uint8_t* out, size_t capacity, const char* command);
+
+#endif // PIPELINE_HOST_H
@@ -0,0 +1,257 @@
+/**
+ * @file pipeline_replay_sim.cpp
+ * @brief End-to-end replay checks through PacketManager.
+ *
+ * replay_window_sim.cpp checks ReplayGuard on its own; this tool sends
+ * sealed packets through processIncomingPacket / processIncomingFrame,
+ * so the outer checks, the inner parse, finishIncoming, the floor lease
+ * and the counter journal all run as on the device:
+ *
+ * - each version: a fresh request is accepted; the same bytes again,
+ *   an older seq below the window and a tampered copy are rejected
+ * - seq policy: v1.1 without "seq" gets NO_SEQUENCE, v1.0 without it
+ *   is checked on request_id + timestamp
+ * - reboot: after CryptoManager::begin() reloads the journals, every
+ *   packet accepted before is rejected as stale and the request counter
+ *   is where it was
+ *
+ * Every rejected packet must leave the request counter and the flash
+ * (counter and replay floor journals, counted at DeviceFlashRegion)
+ * without a single program or erase: a replay flood costs no wear.
+ *
+ * Build (from firmware/, ArduinoJson v7 source tree at <ArduinoJson>):
+ *   g++ -O2 -DARDUINO=10819 -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/pipeline_replay_sim.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/packet.cpp WakeLink/payload_stream.cpp WakeLink/CryptoManager.cpp \
+ *       WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp WakeLink/crypto_backend.cpp \
+ *       WakeLink/chacha20.cpp WakeLink/sha256.cpp WakeLink/poly1305.cpp \
+ *       WakeLink/secure_random.cpp WakeLink/counter_journal.cpp WakeLink/replay_window.cpp \
+ *       WakeLink/fragment.cpp WakeLink/request_arena.cpp -o pipeline_replay_sim
+ *
+ * Usage: ./pipeline_replay_sim [replays]   (default 1000 replayed packets per version)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "request_arena.h"
+#include "host_test.h"
+
+/// @brief First seq, on the microsecond wall-clock scale the Python client uses
+#define REPLAY_SIM_SEQ0 1700000000000000ull
+
+static PipelineClient client;
+
+/// @brief Counter and flash state that a rejected packet must not change
+struct FlashState {
+    uint32_t requests;
+    uint32_t programs;
+    uint32_t erases;
+
+    static FlashState now() { return {crypto.getRequestCount(), hostFlashPrograms, hostFlashErases}; }
+
+    bool operator==(const FlashState& o) const {
+        return requests == o.requests && programs == o.programs && erases == o.erases;
+    }
+};
+
+static unsigned long rejectedWrites = 0;  ///< Rejections that changed the counter or the flash
+
+/**
+ * @brief A sealed request kept intact; processing works on a copy.
+ */
+struct Sealed {
+    bool frame = false;
+    char bytes[PIPELINE_MAX_PACKET];
+    size_t length = 0;
+};
+
+static Sealed sealJson(const char* version, const char* inner) {
+    Sealed s;
+    s.length = client.sealPacket(version, (const uint8_t*)inner, strlen(inner), s.bytes, sizeof(s.bytes));
+    EXPECT(s.length > 0);
+    return s;
+}
+
+static Sealed sealSeq(const char* version, uint64_t seq) {
+    char inner[160];
+    EXPECT(pipelineInnerJson(inner, sizeof(inner), "ping", seq) > 0);
+    return sealJson(version, inner);
+}
+
+static Sealed sealFrame(uint64_t seq) {
+    uint8_t body[64];
+    size_t bodyLen = pipelineInnerMsgPack(body, sizeof(body), "ping");
+    Sealed s;
+    s.frame = true;
+    s.length = client.sealFrame(body, bodyLen, seq, (uint8_t*)s.bytes, sizeof(s.bytes));
+    EXPECT(s.length > 0);
+    return s;
+}
+
+/**
+ * @brief Run a copy of a sealed request through the device pipeline.
+ * @param s Request.
+ * @param error Receives the "error" field ("" on success).
+ * @param replay Receives the "replay" verdict name ("" if none).
+ * @return true if the request was accepted.
+ */
+static bool deliver(const Sealed& s, char* error = nullptr, char* replay = nullptr) {
+    char copy[PIPELINE_MAX_PACKET];
+    memcpy(copy, s.bytes, s.length);
+    copy[s.length < sizeof(copy) ? s.length : sizeof(copy) - 1] = '\0';
+
+    RequestScope scope(requestArena);
+    JsonDocument result(&requestJson);
+    if (s.frame) {
+        packetManager.processIncomingFrame((uint8_t*)copy, s.length, result);
+    } else {
+        packetManager.processIncomingPacket(copy, s.length, result);
+    }
+    if (error) snprintf(error, 32, "%s", result["error"] | "");
+    if (replay) snprintf(replay, 16, "%s", result["replay"] | "");
+    return strcmp(result["status"] | "", "success") == 0;
+}
+
+/**
+ * @brief Deliver a request that must be rejected without touching flash.
+ * @param s Request.
+ * @param wantError Expected "error" field.
+ * @param wantReplay Expected "replay" verdict, or nullptr to skip.
+ */
+static void expectRejected(const Sealed& s, const char* wantError, const char* wantReplay = nullptr) {
+    FlashState before = FlashState::now();
+    char error[32], replay[16];
+    EXPECT(!deliver(s, error, replay));
+    EXPECT(strcmp(error, wantError) == 0);
+    if (wantReplay) EXPECT(strcmp(replay, wantReplay) == 0);
+    if (!(FlashState::now() == before)) rejectedWrites++;
+}
+
+/**
+ * @brief Deliver a request that must be accepted, counted and journaled once.
+ */
+static void expectAccepted(const Sealed& s) {
+    uint32_t requests = crypto.getRequestCount();
+    uint32_t journaled = crypto.getCounterJournal().getProgramOps();
+    EXPECT(deliver(s));
+    EXPECT(crypto.getRequestCount() == requests + 1);
+    EXPECT(crypto.getCounterJournal().getProgramOps() > journaled);
+}
+
+/**
+ * @brief Flip one byte inside the sealed payload or frame body.
+ */
+static Sealed tamper(const Sealed& s) {
+    Sealed t = s;
+    if (s.frame) {
+        t.bytes[FRAME_V2_HEADER] ^= 0x01;
+    } else {
+        char* payload = strstr(t.bytes, "\"payload\":\"") + 11;
+        payload[8] = payload[8] == '0' ? '1' : '0';
+    }
+    return t;
+}
+
+/**
+ * @brief Fresh, replayed, stale and tampered requests of one version.
+ * @param version Protocol version (PROTOCOL_V2 for frames).
+ * @param replays How many times the accepted request is replayed.
+ * @param seq Next fresh seq; advanced past the numbers used here.
+ * @param accepted Receives the request accepted first (for the reboot case).
+ */
+static void runVersion(const char* version, unsigned long replays, uint64_t& seq, Sealed& accepted) {
+    bool v2 = strcmp(version, PROTOCOL_V2) == 0;
+    auto seal = [&](uint64_t n) { return v2 ? sealFrame(n) : sealSeq(version, n); };
+
+    uint64_t first = seq;
+    accepted = seal(first);
+    expectAccepted(accepted);
+    for (unsigned long i = 0; i < replays; i++) expectRejected(accepted, "REPLAY_DETECTED", "duplicate");
+
+    // Move the window on, then go below it
+    seq += 2 * REPLAY_WINDOW_BITS;
+    expectAccepted(seal(seq));
+    expectRejected(seal(first + 1), "REPLAY_DETECTED", "stale");
+
+    // Out of order inside the window is still fresh, but only once
+    Sealed late = seal(seq - 3);
+    expectAccepted(late);
+    expectRejected(late, "REPLAY_DETECTED", "duplicate");
+
+    // A forged copy never reaches the replay window
+    Sealed forged = tamper(seal(++seq));
+    expectRejected(forged, strcmp(version, PROTOCOL_V1_0) == 0 ? "INVALID_SIGNATURE" : "ERROR:INVALID_SIGNATURE");
+    seq++;
+}
+
+/**
+ * @brief Requests without "seq".
+ */
+static void runSeqPolicy() {
+    char inner[160];
+
+    // v1.1 must carry seq
+    snprintf(inner, sizeof(inner), "{\"command\":\"ping\",\"data\":{},\"request_id\":\"R1\",\"timestamp\":1700000000}");
+    expectRejected(sealJson(PROTOCOL_V1_1, inner), "NO_SEQUENCE");
+
+    // v1.0 without seq (the Android app) is checked on request_id + timestamp
+    snprintf(inner, sizeof(inner), "{\"command\":\"ping\",\"data\":{},\"request_id\":\"A0000001\",\"timestamp\":1700000000}");
+    Sealed legacy = sealJson(PROTOCOL_V1_0, inner);
+    expectAccepted(legacy);
+    expectRejected(legacy, "REPLAY_DETECTED", "duplicate");
+
+    // Same request_id with a new timestamp is a new request; far older is stale
+    snprintf(inner, sizeof(inner), "{\"command\":\"ping\",\"data\":{},\"request_id\":\"A0000001\",\"timestamp\":1700000001}");
+    expectAccepted(sealJson(PROTOCOL_V1_0, inner));
+    snprintf(inner, sizeof(inner), "{\"command\":\"ping\",\"data\":{},\"request_id\":\"A0000002\",\"timestamp\":%d}",
+             1700000001 - REPLAY_LEGACY_MAX_AGE_S - 1);
+    expectRejected(sealJson(PROTOCOL_V1_0, inner), "REPLAY_DETECTED", "stale");
+
+    // Without a timestamp there is nothing to order it by
+    snprintf(inner, sizeof(inner), "{\"command\":\"ping\",\"data\":{},\"request_id\":\"A0000003\"}");
+    expectRejected(sealJson(PROTOCOL_V1_0, inner), "REPLAY_DETECTED", "stale");
+}
+
+int main(int argc, char** argv) {
+    unsigned long replays = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+
+    pipelineBegin();
+    client.begin(PIPELINE_HOST_TOKEN, PIPELINE_HOST_DEVICE_ID);
+
+    uint64_t seq = REPLAY_SIM_SEQ0;
+    const char* versions[] = {PROTOCOL_V1_0, PROTOCOL_V1_1, PROTOCOL_V2};
+    Sealed accepted[3];
+    for (size_t i = 0; i < 3; i++) runVersion(versions[i], replays, seq, accepted[i]);
+    runSeqPolicy();
+
+    uint32_t leaseBefore = crypto.getReplayGuard().getLease();
+    uint32_t requestsBefore = crypto.getRequestCount();
+
+    // Reboot: the journals are mounted again from flash, the windows start at the stored lease
+    EXPECT(crypto.begin());
+    EXPECT(crypto.getReplayGuard().getLease() == leaseBefore);
+    EXPECT(crypto.getRequestCount() == requestsBefore);
+    for (size_t i = 0; i < 3; i++) expectRejected(accepted[i], "REPLAY_DETECTED", "stale");
+
+    // New numbers past the lease are accepted again
+    seq = ((uint64_t)leaseBefore << REPLAY_FLOOR_SHIFT) + 1;
+    expectAccepted(sealSeq(PROTOCOL_V1_1, seq));
+    expectAccepted(sealFrame(seq + 1));
+
+    EXPECT(rejectedWrites == 0);
+
+    printf("{\n");
+    printf("  \"replays_per_version\": %lu,\n", replays);
+    printf("  \"request_counter\": %lu,\n", (unsigned long)crypto.getRequestCount());
+    printf("  \"flash_programs\": %lu,\n", (unsigned long)hostFlashPrograms);
+    printf("  \"flash_erases\": %lu,\n", (unsigned long)hostFlashErases);
+    printf("  \"floor_programs\": %lu,\n", (unsigned long)crypto.getFloorJournal().getProgramOps());
+    printf("  \"lease\": %lu,\n", (unsigned long)crypto.getReplayGuard().getLease());
+    printf("  \"rejections_that_wrote_flash\": %lu,\n", rejectedWrites);
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
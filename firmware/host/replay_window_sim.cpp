@@ -0,0 +1,286 @@
+/**
+ * @file replay_window_sim.cpp
+ * @brief Host checks and throughput run for the replay window.
+ *
+ * Exercises ReplayWindow / ReplayGuard (firmware/WakeLink/replay_window.cpp)
+ * without a device:
+ *
+ * - unit: fixed cases (in-order, out-of-order inside the window,
+ *   duplicates, stale numbers, jumps past the window, LRU recycling)
+ * - model: random sequences checked against a reference that remembers
+ *   every accepted number
+ * - floor: a recycled window cannot reopen its numbers, the lease moves
+ *   ahead of accepted numbers, and a guard restored from the lease (a
+ *   reboot) rejects everything accepted before it
+ * - legacy: requests without "seq" are accepted once per request_id +
+ *   timestamp, stale when too old or pushed out of the ring
+ * - throughput: REPLAY_SENDERS senders pipelining requests with bounded
+ *   reordering through one guard; every fresh number must be accepted
+ *   once and every replay rejected
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -IWakeLink host/replay_window_sim.cpp WakeLink/replay_window.cpp \
+ *       -o replay_window_sim
+ *
+ * Usage: ./replay_window_sim [requests]   (default 5000000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "replay_window.h"
+#include "host_test.h"
+#include <chrono>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * @brief Fixed cases.
+ */
+static void runUnit() {
+    ReplayWindow w;
+    EXPECT(w.accept(0) == REPLAY_STALE);
+    EXPECT(w.accept(1) == REPLAY_OK);
+    EXPECT(w.accept(1) == REPLAY_DUPLICATE);
+    EXPECT(w.accept(5) == REPLAY_OK);
+    EXPECT(w.accept(3) == REPLAY_OK);       // Out of order, inside the window
+    EXPECT(w.accept(3) == REPLAY_DUPLICATE);
+    EXPECT(w.accept(2) == REPLAY_OK);
+    EXPECT(w.accept(4) == REPLAY_OK);
+    EXPECT(w.getTop() == 5);
+
+    // Oldest slot still inside, one beyond is stale
+    const uint64_t top = 1000;
+    EXPECT(w.accept(top) == REPLAY_OK);
+    EXPECT(w.accept(top - (REPLAY_WINDOW_BITS - 1)) == REPLAY_OK);
+    EXPECT(w.accept(top - REPLAY_WINDOW_BITS) == REPLAY_STALE);
+
+    // Bits survive word-boundary shifts
+    ReplayWindow s;
+    for (uint64_t i = 1; i <= 40; i += 3) EXPECT(s.accept(i) == REPLAY_OK);
+    EXPECT(s.accept(70) == REPLAY_OK);
+    for (uint64_t i = 1; i <= 40; i += 3) EXPECT(s.accept(i) == REPLAY_DUPLICATE);
+    EXPECT(s.accept(2) == REPLAY_OK);
+
+    // Jump clears history
+    EXPECT(s.accept(70 + REPLAY_WINDOW_BITS * 3) == REPLAY_OK);
+    EXPECT(s.accept(70) == REPLAY_STALE);
+
+    // 64-bit sequence space (microsecond clocks)
+    ReplayWindow big;
+    EXPECT(big.accept(1792130529106469ULL) == REPLAY_OK);
+    EXPECT(big.accept(1792130529106400ULL) == REPLAY_OK);
+    EXPECT(big.accept(1792130529106469ULL) == REPLAY_DUPLICATE);
+
+    // Senders are independent; LRU recycles the oldest one
+    ReplayGuard g;
+    EXPECT(g.accept("alice", 7) == REPLAY_OK);
+    EXPECT(g.accept("bob", 7) == REPLAY_OK);
+    EXPECT(g.accept("alice", 7) == REPLAY_DUPLICATE);
+    EXPECT(g.accept("", 1) == REPLAY_OK);
+    EXPECT(g.activeSenders() == 3);
+
+    char name[8];
+    for (int i = 0; i < REPLAY_SENDERS; i++) {
+        snprintf(name, sizeof(name), "s%d", i);
+        g.accept(name, 1);
+    }
+    EXPECT(g.activeSenders() == REPLAY_SENDERS);
+    EXPECT(g.getEvictions() == 3);
+
+    // Long ids compare on their first REPLAY_SENDER_LEN characters
+    ReplayGuard t;
+    EXPECT(t.accept("0123456789abcdefXYZ", 9) == REPLAY_OK);
+    EXPECT(t.accept("0123456789abcdef", 9) == REPLAY_DUPLICATE);
+}
+
+/**
+ * @brief Shared floor, lease and restore after a reboot.
+ */
+static void runFloor() {
+    const uint64_t unit = 1ULL << REPLAY_FLOOR_SHIFT;
+    const uint64_t now = 1792130529106469ULL;  // Microsecond clock
+    ReplayGuard g;
+    uint32_t lease = 0;
+    EXPECT(!g.pendingLease(lease));
+
+    // First accepted number moves the lease REPLAY_FLOOR_LEASE units past it
+    EXPECT(g.accept("alice", now) == REPLAY_OK);
+    EXPECT(g.pendingLease(lease));
+    EXPECT(lease == (uint32_t)(now / unit) + REPLAY_FLOOR_LEASE);
+    g.leaseStored();
+
+    // Numbers inside the lease need no flash write
+    EXPECT(g.accept("alice", now + unit) == REPLAY_OK);
+    EXPECT(!g.pendingLease(lease));
+    EXPECT(g.accept("alice", now + REPLAY_FLOOR_LEASE * unit) == REPLAY_OK);
+    EXPECT(g.pendingLease(lease));
+    g.leaseStored();
+
+    // A recycled window takes its numbers with it into the floor
+    for (int i = 0; i < REPLAY_SENDERS; i++) {
+        char name[8];
+        snprintf(name, sizeof(name), "s%d", i);
+        EXPECT(g.accept(name, now + (REPLAY_FLOOR_LEASE + 1) * unit + (uint64_t)i) == REPLAY_OK);
+    }
+    EXPECT(g.getFloor() >= now + REPLAY_FLOOR_LEASE * unit);
+    EXPECT(g.accept("alice", now) == REPLAY_STALE);
+    EXPECT(g.accept("alice", now + unit) == REPLAY_STALE);
+
+    // Reboot: everything accepted so far stays rejected, later numbers pass
+    ReplayGuard after;
+    after.restore(lease);
+    EXPECT(after.accept("alice", now) == REPLAY_STALE);
+    EXPECT(after.accept("alice", now + REPLAY_FLOOR_LEASE * unit) == REPLAY_STALE);
+    EXPECT(after.accept("s0", now + (REPLAY_FLOOR_LEASE + 1) * unit) == REPLAY_STALE);
+    EXPECT(after.acceptLegacy("R1", (now + unit) / 1000000) == REPLAY_STALE);
+    EXPECT(after.accept("alice", (uint64_t)lease * unit + 1) == REPLAY_OK);
+    EXPECT(after.accept("bob", (uint64_t)(lease + 1) * unit) == REPLAY_OK);
+
+    // Lease saturates instead of wrapping
+    ReplayGuard top;
+    EXPECT(top.accept("x", UINT64_MAX - 1) == REPLAY_OK);
+    EXPECT(top.pendingLease(lease) && lease == UINT32_MAX);
+
+    printf("  \"floor\": {\"unit_us\": %llu, \"lease_units\": %d, \"evictions\": %u},\n",
+           (unsigned long long)unit, REPLAY_FLOOR_LEASE, (unsigned)g.getEvictions());
+}
+
+/**
+ * @brief Requests without "seq": request_id + timestamp.
+ */
+static void runLegacy() {
+    const uint64_t now = 1792130529ULL;  // Seconds
+    ReplayGuard g;
+    EXPECT(g.acceptLegacy("R1", 0) == REPLAY_STALE);      // No timestamp
+    EXPECT(g.acceptLegacy("R1", now) == REPLAY_OK);
+    EXPECT(g.acceptLegacy("R1", now) == REPLAY_DUPLICATE);
+    EXPECT(g.acceptLegacy("R2", now) == REPLAY_OK);        // Same second, other request
+    EXPECT(g.acceptLegacy("R1", now + 1) == REPLAY_OK);    // Same id, other second
+    EXPECT(g.acceptLegacy("R3", now - 10) == REPLAY_OK);   // Late but inside the age limit
+    EXPECT(g.acceptLegacy("R4", now - REPLAY_LEGACY_MAX_AGE_S - 2) == REPLAY_STALE);
+
+    // Keys pushed out of the ring raise the floor to their timestamp
+    for (int i = 0; i < REPLAY_LEGACY_SLOTS; i++) {
+        char id[8];
+        snprintf(id, sizeof(id), "N%d", i);
+        EXPECT(g.acceptLegacy(id, now + 2 + (uint64_t)i) == REPLAY_OK);
+    }
+    EXPECT(g.acceptLegacy("R1", now) == REPLAY_STALE);
+    EXPECT(g.acceptLegacy("R3", now - 10) == REPLAY_STALE);
+    EXPECT(g.acceptLegacy("N15", now + 2 + REPLAY_LEGACY_SLOTS - 1) == REPLAY_DUPLICATE);
+
+    // Sequenced senders are unaffected
+    EXPECT(g.accept("alice", 5) == REPLAY_OK);
+}
+
+/**
+ * @brief Random sequences against a reference set.
+ */
+static void runModel(uint32_t rounds) {
+    srand(4242);
+    for (uint32_t r = 0; r < rounds; r++) {
+        ReplayWindow w;
+        std::set<uint64_t> seen;
+        uint64_t top = 0, cursor = 1;
+        for (int i = 0; i < 2000; i++) {
+            // Mostly near the front, sometimes far ahead or far behind
+            int pick = rand() % 100;
+            uint64_t seq;
+            if (pick < 70) seq = cursor + (uint64_t)(rand() % 8);
+            else if (pick < 95) seq = cursor > 200 ? cursor - (uint64_t)(rand() % 200) : 1;
+            else seq = cursor + (uint64_t)(rand() % 400);
+            cursor = seq > cursor ? seq : cursor + 1;
+
+            ReplayVerdict expected;
+            if (seq + REPLAY_WINDOW_BITS <= top) expected = REPLAY_STALE;
+            else if (seen.count(seq)) expected = REPLAY_DUPLICATE;
+            else expected = REPLAY_OK;
+
+            ReplayVerdict got = w.accept(seq);
+            if (got != expected) {
+                fprintf(stderr, "model mismatch round %u seq %llu: got %d want %d\n",
+                        (unsigned)r, (unsigned long long)seq, got, expected);
+                failures++;
+                return;
+            }
+            if (got == REPLAY_OK) {
+                seen.insert(seq);
+                if (seq > top) top = seq;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Concurrent pipelined senders with bounded reordering.
+ */
+static void runThroughput(uint32_t requests) {
+    const uint32_t depth = 32;   // In-flight requests per sender
+    ReplayGuard g;
+    char names[REPLAY_SENDERS][REPLAY_SENDER_LEN + 1];
+    uint64_t next[REPLAY_SENDERS];
+    std::vector<uint64_t> inflight[REPLAY_SENDERS];
+    for (int s = 0; s < REPLAY_SENDERS; s++) {
+        snprintf(names[s], sizeof(names[s]), "client-%d", s);
+        next[s] = 1;
+    }
+
+    srand(99);
+    uint32_t accepted = 0, wrongReject = 0, replays = 0, replayAccepted = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < requests; i++) {
+        int s = rand() % REPLAY_SENDERS;
+        std::vector<uint64_t>& q = inflight[s];
+        if (q.empty()) {
+            // Next batch of in-flight requests, delivered in shuffled order
+            for (uint32_t j = 0; j < depth; j++) q.push_back(next[s]++);
+            for (size_t j = q.size() - 1; j > 0; j--) {
+                size_t k = (size_t)rand() % (j + 1);
+                uint64_t t = q[j]; q[j] = q[k]; q[k] = t;
+            }
+        }
+        uint64_t seq = q.back();
+        q.pop_back();
+
+        if (g.accept(names[s], seq) == REPLAY_OK) accepted++;
+        else wrongReject++;
+
+        // Every 16th request an attacker replays it
+        if ((i & 15) == 0) {
+            replays++;
+            if (g.accept(names[s], seq) == REPLAY_OK) replayAccepted++;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint32_t checks = requests + replays;
+
+    EXPECT(wrongReject == 0);
+    EXPECT(replayAccepted == 0);
+
+    printf("  \"throughput\": {\"senders\": %d, \"in_flight\": %u, \"requests\": %u, "
+           "\"accepted\": %u, \"replays_rejected\": %u, \"ns_per_check\": %.1f, "
+           "\"checks_per_s\": %.0f}\n",
+           REPLAY_SENDERS, (unsigned)depth, (unsigned)requests, (unsigned)accepted,
+           (unsigned)(replays - replayAccepted), secs * 1e9 / checks, checks / secs);
+}
+
+int main(int argc, char** argv) {
+    uint32_t requests = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 5000000;
+
+    printf("{\n");
+    printf("  \"window_bits\": %d,\n", REPLAY_WINDOW_BITS);
+    runUnit();
+    runModel(200);
+    runLegacy();
+    runFloor();
+    printf("  \"unit_and_model\": \"%s\",\n", failures ? "failed" : "passed");
+    runThroughput(requests);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
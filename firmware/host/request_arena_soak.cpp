@@ -0,0 +1,433 @@
+/**
+ * @file request_arena_soak.cpp
+ * @brief Host soak test of the request arena against a device-style heap.
+ *
+ * Replays the allocation pattern of a request through RequestArena
+ * (firmware/WakeLink/request_arena.cpp) and, for comparison, straight
+ * through a first-fit coalescing heap modelled on the ESP8266 one
+ * (umm_malloc: 8-byte headers, in-place realloc into a free neighbour).
+ *
+ * Per request, mirroring ArduinoJson 7 documents:
+ * - parsed request: pool list, one slot pool, strings grown by the
+ *   string builder (31 bytes, doubled, shrunk to fit), shrinkToFit()
+ * - command result and sometimes an error reply: pool list, pool, strings
+ * - outer packet pieces: a small document created and destroyed
+ * - cloud requests: the whole reply buffer (hex payload + envelope)
+ *
+ * Between requests the rest of the firmware keeps a ring of long-lived
+ * Strings on the heap, replaced at random, in both modes.
+ *
+ * Reported per checkpoint: free heap and largest free block of the
+ * modelled heap (smaller by REQUEST_ARENA_SIZE in arena mode, since the
+ * arena is carved out of the same RAM), plus arena high water. The run
+ * fails on any arena overflow, deferred reset or leaked block.
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -IWakeLink host/request_arena_soak.cpp WakeLink/request_arena.cpp \
+ *       -o request_arena_soak
+ *
+ * Usage: ./request_arena_soak [requests]   (default 2000000)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "request_arena.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/// Heap left for the application on an ESP8266 with WiFi up
+static const size_t MODEL_HEAP = 40 * 1024;
+
+/// ArduinoJson 7 on 32-bit: 128 slots of 12 bytes per pool
+static const size_t POOL_BYTES = 128 * 12;
+static const size_t POOL_LIST_BYTES = 4 * sizeof(uint32_t);
+
+static const size_t LONG_LIVED_SLOTS = 48;
+static const int CHECKPOINTS = 8;
+
+/**
+ * @brief Fixed cases on a private arena.
+ */
+static void runUnit() {
+    static RequestArena t;
+
+    // Outside a scope everything is heap
+    void* outside = t.allocate(10);
+    EXPECT(t.getHeapLive() == 1 && t.getUsed() == 0);
+    t.deallocate(outside);
+    EXPECT(t.getHeapLive() == 0);
+
+    {
+        RequestScope scope(t);
+        uint8_t* a = (uint8_t*)t.allocate(5);
+        uint8_t* b = (uint8_t*)t.allocate(20);
+        EXPECT(((uintptr_t)a % REQUEST_ARENA_ALIGN) == 0 && ((uintptr_t)b % REQUEST_ARENA_ALIGN) == 0);
+        memset(b, 0x5A, 20);
+
+        // Top block grows and shrinks in place
+        EXPECT(t.reallocate(b, 200) == b && b[19] == 0x5A);
+        EXPECT(t.reallocate(b, 8) == b);
+
+        // A buried block moves and keeps its bytes
+        memcpy(a, "abcd", 5);
+        uint8_t* a2 = (uint8_t*)t.reallocate(a, 64);
+        EXPECT(a2 != a && memcmp(a2, "abcd", 5) == 0);
+
+        // Freeing the top unwinds through already-freed blocks
+        size_t before = t.getUsed();
+        t.deallocate(b);
+        EXPECT(t.getUsed() == before);          // a2 still on top
+        t.deallocate(a2);
+        EXPECT(t.getUsed() == 0);
+
+        // Too big for the arena: heap, counted
+        void* big = t.allocate(REQUEST_ARENA_SIZE);
+        EXPECT(big && t.getOverflows() == 1 && t.getHeapLive() == 1);
+        t.deallocate(big);
+    }
+    EXPECT(t.getResets() == 1 && t.getHeapLive() == 0);
+
+    // A block that escapes its scope postpones the reset
+    void* escaped;
+    {
+        RequestScope scope(t);
+        escaped = t.allocate(32);
+        {
+            RequestScope nested(t);
+            t.allocate(16);
+        }
+        EXPECT(t.getResets() == 1);             // Inner scope never resets
+    }
+    EXPECT(t.getDeferred() == 1 && t.getUsed() > 0);
+    {
+        RequestScope scope(t);
+    }
+    EXPECT(t.getDeferred() == 2);
+    (void)escaped;
+}
+
+/**
+ * @brief First-fit heap with boundary tags and an explicit free list.
+ */
+class ModelHeap {
+private:
+    struct Hdr {
+        uint32_t size;      ///< Block bytes including header; bit 0 = used
+        uint32_t prevSize;  ///< Size of the block before (0 for the first)
+    };
+    struct FreeLinks {
+        uint32_t next, prev;
+    };
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    std::vector<uint8_t> mem;
+    uint32_t freeHead = NIL;
+    size_t used = 0;
+    size_t peak = 0;
+
+    Hdr* at(uint32_t off) { return (Hdr*)&mem[off]; }
+    FreeLinks* links(uint32_t off) { return (FreeLinks*)&mem[off + sizeof(Hdr)]; }
+    uint32_t sizeOf(uint32_t off) { return at(off)->size & ~1u; }
+    bool isUsed(uint32_t off) { return at(off)->size & 1u; }
+
+    void unlink(uint32_t off) {
+        FreeLinks* l = links(off);
+        if (l->prev != NIL) links(l->prev)->next = l->next; else freeHead = l->next;
+        if (l->next != NIL) links(l->next)->prev = l->prev;
+    }
+
+    void push(uint32_t off) {
+        FreeLinks* l = links(off);
+        l->prev = NIL;
+        l->next = freeHead;
+        if (freeHead != NIL) links(freeHead)->prev = off;
+        freeHead = off;
+    }
+
+    void setSize(uint32_t off, uint32_t size, bool inUse) {
+        at(off)->size = size | (inUse ? 1u : 0u);
+        at(off + size)->prevSize = size;
+    }
+
+    static uint32_t need(size_t n) {
+        size_t payload = n < sizeof(FreeLinks) ? sizeof(FreeLinks) : (n + 7) & ~(size_t)7;
+        return (uint32_t)(payload + sizeof(Hdr));
+    }
+
+    /** @brief Mark off used at want bytes, returning the tail to the free list. */
+    void carve(uint32_t off, uint32_t want) {
+        uint32_t have = sizeOf(off);
+        if (have - want >= 2 * sizeof(Hdr) + sizeof(FreeLinks)) {
+            uint32_t tail = off + want, tailSize = have - want;
+            if (!isUsed(tail + tailSize)) {
+                unlink(tail + tailSize);
+                tailSize += sizeOf(tail + tailSize);
+            }
+            setSize(off, want, true);
+            setSize(tail, tailSize, false);
+            push(tail);
+        } else {
+            setSize(off, have, true);
+        }
+    }
+
+public:
+    explicit ModelHeap(size_t bytes) : mem(bytes) {
+        uint32_t end = (uint32_t)bytes - sizeof(Hdr);   // Used sentinel stops coalescing
+        at(0)->prevSize = 0;
+        setSize(0, end, false);
+        at(end)->size = 1;
+        push(0);
+    }
+
+    void* alloc(size_t n) {
+        uint32_t want = need(n);
+        for (uint32_t off = freeHead; off != NIL; off = links(off)->next) {
+            if (sizeOf(off) < want) continue;
+            unlink(off);
+            carve(off, want);
+            used += sizeOf(off);
+            if (used > peak) peak = used;
+            return &mem[off + sizeof(Hdr)];
+        }
+        return nullptr;
+    }
+
+    void release(void* p) {
+        if (!p) return;
+        uint32_t off = (uint32_t)((uint8_t*)p - &mem[0]) - sizeof(Hdr);
+        uint32_t size = sizeOf(off);
+        used -= size;
+
+        uint32_t next = off + size;
+        if (!isUsed(next)) {
+            unlink(next);
+            size += sizeOf(next);
+        }
+        if (off && !isUsed(off - at(off)->prevSize)) {
+            uint32_t prev = off - at(off)->prevSize;
+            unlink(prev);
+            size += sizeOf(prev);
+            off = prev;
+        }
+        setSize(off, size, false);
+        push(off);
+    }
+
+    void* resize(void* p, size_t n) {
+        if (!p) return alloc(n);
+        uint32_t off = (uint32_t)((uint8_t*)p - &mem[0]) - sizeof(Hdr);
+        uint32_t want = need(n);
+        uint32_t size = sizeOf(off);
+        uint32_t next = off + size;
+        if (want > size && !isUsed(next) && size + sizeOf(next) >= want) {
+            unlink(next);
+            used += sizeOf(next);
+            setSize(off, size + sizeOf(next), true);
+            size = sizeOf(off);
+        }
+        if (want <= size) {
+            used -= size;
+            carve(off, want);
+            used += sizeOf(off);
+            if (used > peak) peak = used;
+            return p;
+        }
+        void* q = alloc(n);
+        if (!q) return nullptr;
+        memcpy(q, p, size - sizeof(Hdr));
+        release(p);
+        return q;
+    }
+
+    size_t freeBytes() const { return mem.size() - sizeof(Hdr) - used; }
+    size_t peakUsed() const { return peak; }
+
+    size_t largestFree() {
+        size_t best = 0;
+        for (uint32_t off = freeHead; off != NIL; off = links(off)->next) {
+            if (sizeOf(off) - sizeof(Hdr) > best) best = sizeOf(off) - sizeof(Hdr);
+        }
+        return best;
+    }
+};
+
+/**
+ * @brief Where per-request blocks come from.
+ */
+struct RequestAlloc {
+    ModelHeap* heap;      ///< Heap mode when arena is null
+    RequestArena* arena;
+
+    void* alloc(size_t n) { return arena ? arena->allocate(n) : heap->alloc(n); }
+    void* resize(void* p, size_t n) { return arena ? arena->reallocate(p, n) : heap->resize(p, n); }
+    void release(void* p) { if (arena) arena->deallocate(p); else heap->release(p); }
+};
+
+/**
+ * @brief One JsonDocument's blocks, freed the way ArduinoJson frees them.
+ */
+struct Doc {
+    RequestAlloc& a;
+    void* poolList = nullptr;
+    void* pool = nullptr;
+    std::vector<void*> strings;
+
+    explicit Doc(RequestAlloc& alloc) : a(alloc) {}
+
+    void addPool() {
+        poolList = a.alloc(POOL_LIST_BYTES);
+        pool = a.alloc(POOL_BYTES);
+    }
+
+    /** @brief String built by the deserializer's string builder. */
+    void buildString(size_t len) {
+        size_t cap = 31;
+        void* s = a.alloc(cap);
+        while (cap < len + 1) {
+            cap = cap * 2 + 1;
+            s = a.resize(s, cap);
+        }
+        strings.push_back(a.resize(s, len + 1));
+    }
+
+    void copyString(size_t len) { strings.push_back(a.alloc(len + 1)); }
+
+    void shrinkToFit(size_t slots) { pool = a.resize(pool, slots * 12); }
+
+    ~Doc() {
+        for (size_t i = strings.size(); i-- > 0;) a.release(strings[i]);
+        a.release(pool);
+        a.release(poolList);
+    }
+};
+
+/**
+ * @brief One request's documents and buffers.
+ */
+static void runRequest(RequestAlloc& a) {
+    bool cloud = rand() % 2;
+
+    Doc incoming(a);
+    incoming.addPool();
+    int fields = 3 + rand() % 6;
+    for (int i = 0; i < fields; i++) incoming.buildString(4 + (size_t)(rand() % 90));
+    incoming.shrinkToFit((size_t)fields * 2 + 2);
+
+    Doc result(a);
+    result.addPool();
+    int out = 2 + rand() % 10;
+    for (int i = 0; i < out; i++) result.copyString(6 + (size_t)(rand() % 40));
+
+    if (rand() % 5 == 0) {
+        Doc error(a);
+        error.addPool();
+        error.copyString(24);
+        error.copyString(9);
+    }
+
+    {
+        Doc id(a);   // Outer packet device_id
+        id.addPool();
+        id.copyString(12);
+    }
+
+    if (cloud) {
+        size_t plain = 40 + (size_t)(rand() % 440);
+        size_t reply = 2 * (2 + plain + 16) + 190;
+        char* buf = (char*)a.alloc(reply);
+        if (buf) memset(buf, 'x', reply);
+        a.release(buf);
+    }
+}
+
+struct SoakResult {
+    size_t minFree, minLargest, finalFree, finalLargest, peakUsed;
+};
+
+/**
+ * @brief Run requests with (arena) or without the arena.
+ */
+static SoakResult soak(const char* name, uint32_t requests, RequestArena* arena) {
+    // The arena is static RAM taken from what would otherwise be heap
+    ModelHeap heap(arena ? MODEL_HEAP - REQUEST_ARENA_SIZE : MODEL_HEAP);
+    RequestAlloc a = {&heap, arena};
+    void* longLived[LONG_LIVED_SLOTS] = {};
+
+    srand(2024);
+    SoakResult r = {heap.freeBytes(), heap.largestFree(), 0, 0, 0};
+    printf("    \"%s\": [", name);
+    for (uint32_t i = 1; i <= requests; i++) {
+        // Firmware Strings that outlive requests
+        if (rand() % 4 == 0) {
+            size_t slot = (size_t)rand() % LONG_LIVED_SLOTS;
+            heap.release(longLived[slot]);
+            longLived[slot] = heap.alloc(16 + (size_t)(rand() % 160));
+        }
+
+        if (arena) {
+            RequestScope scope(*arena);
+            runRequest(a);
+        } else {
+            runRequest(a);
+        }
+        if (arena && arena->getUsed() != 0) failures++;
+
+        if (i % 1024 == 0) {
+            size_t f = heap.freeBytes(), l = heap.largestFree();
+            if (f < r.minFree) r.minFree = f;
+            if (l < r.minLargest) r.minLargest = l;
+        }
+        if (i % (requests / CHECKPOINTS) == 0) {
+            printf("%s\n      {\"requests\": %u, \"free_heap\": %zu, \"largest_free_block\": %zu",
+                   i == requests / CHECKPOINTS ? "" : ",", (unsigned)i,
+                   heap.freeBytes(), heap.largestFree());
+            if (arena) printf(", \"arena_high_water\": %zu", arena->getHighWater());
+            printf("}");
+        }
+    }
+    printf("\n    ]");
+
+    r.finalFree = heap.freeBytes();
+    r.finalLargest = heap.largestFree();
+    r.peakUsed = heap.peakUsed();
+    for (size_t s = 0; s < LONG_LIVED_SLOTS; s++) heap.release(longLived[s]);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    uint32_t requests = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000000;
+    if (requests < CHECKPOINTS) requests = CHECKPOINTS;
+
+    printf("{\n");
+    printf("  \"arena_size\": %d,\n", REQUEST_ARENA_SIZE);
+    printf("  \"model_heap\": %zu,\n", MODEL_HEAP);
+    runUnit();
+    printf("  \"unit\": \"%s\",\n", failures ? "failed" : "passed");
+    printf("  \"checkpoints\": {\n");
+    SoakResult heap = soak("heap", requests, nullptr);
+    printf(",\n");
+    SoakResult arena = soak("arena", requests, &requestArena);
+    printf("\n  },\n");
+
+    EXPECT(requestArena.getOverflows() == 0);
+    EXPECT(requestArena.getDeferred() == 0);
+    EXPECT(requestArena.getHeapLive() == 0);
+    EXPECT(requestArena.getResets() == requests);
+
+    printf("  \"heap\": {\"min_free\": %zu, \"min_largest_block\": %zu, \"peak_used\": %zu},\n",
+           heap.minFree, heap.minLargest, heap.peakUsed);
+    printf("  \"arena\": {\"min_free\": %zu, \"min_largest_block\": %zu, \"peak_used\": %zu, "
+           "\"high_water\": %zu, \"resets\": %u, \"overflows\": %u, \"deferred\": %u},\n",
+           arena.minFree, arena.minLargest, arena.peakUsed, requestArena.getHighWater(),
+           (unsigned)requestArena.getResets(), (unsigned)requestArena.getOverflows(),
+           (unsigned)requestArena.getDeferred());
+    printf("  \"result\": \"%s\"\n", failures ? "failed" : "passed");
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
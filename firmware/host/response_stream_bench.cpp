@@ -0,0 +1,210 @@
+/**
+ * @file response_stream_bench.cpp
+ * @brief Checks and times streamed v1.x replies (ResponseStream).
+ *
+ * Builds result documents of about 2, 16 and 60 KB of JSON and sends
+ * each, as v1.0 and v1.1, through ResponseStream::produce() in
+ * TCP_TX_CHUNK pieces the way ResponseQueue::flush() asks for them:
+ *
+ * - check: the joined chunks form one line whose payload verifies
+ *   (HMAC for v1.0, tag for v1.1) and decrypts to the result's JSON
+ * - time: ns per reply and per KB of plaintext for the stream, next to
+ *   the one-shot createResponsePacket() into a buffer of
+ *   measureResponse() bytes
+ *
+ * The per-KB cost of the stream must stay flat as replies grow; a
+ * refill that re-serialized the whole result would grow with the size.
+ *
+ * Build (from firmware/, ArduinoJson v7 source tree at <ArduinoJson>):
+ *   g++ -O2 -DARDUINO=10819 -Ihost/arduino -IWakeLink -I<ArduinoJson>/src \
+ *       host/response_stream_bench.cpp host/pipeline_host.cpp host/arduino/arduino_host.cpp \
+ *       WakeLink/response_stream.cpp WakeLink/response_queue.cpp \
+ *       WakeLink/packet.cpp WakeLink/payload_stream.cpp WakeLink/CryptoManager.cpp \
+ *       WakeLink/payload_codec.cpp WakeLink/hex_codec.cpp WakeLink/crypto_backend.cpp \
+ *       WakeLink/chacha20.cpp WakeLink/sha256.cpp WakeLink/poly1305.cpp \
+ *       WakeLink/secure_random.cpp WakeLink/counter_journal.cpp WakeLink/replay_window.cpp \
+ *       WakeLink/fragment.cpp WakeLink/request_arena.cpp -o response_stream_bench
+ *
+ * Usage: ./response_stream_bench [seconds-per-case]   (default 0.3)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "pipeline_host.h"
+#include "hex_codec.h"
+#include "poly1305.h"
+#include "request_arena.h"
+#include "response_stream.h"
+#include "host_test.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Result of a batch wake: one entry per target, about 80 bytes each.
+ * @param doc Receives the result.
+ * @param target JSON length to reach.
+ */
+static void buildResult(JsonDocument& doc, size_t target) {
+    doc.clear();
+    doc["status"] = "success";
+    doc["command"] = "batch";
+    JsonArray results = doc["results"].to<JsonArray>();
+    for (unsigned i = 0; measureJson(doc) < target; i++) {
+        char mac[18];
+        snprintf(mac, sizeof(mac), "AA:BB:CC:%02X:%02X:%02X", (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+        JsonObject entry = results.add<JsonObject>();
+        entry["mac"] = mac;
+        entry["status"] = "wol_queued";
+        entry["delay_ms"] = (i / 4) * 250;
+    }
+}
+
+/**
+ * @brief Produce one streamed reply the way the send queue pulls it.
+ * @param result Result to send.
+ * @param version Protocol version.
+ * @param out Receives the packet, newline included.
+ * @param chunks Receives the number of produce() calls that wrote bytes.
+ * @return false if begin() failed.
+ */
+static bool streamReply(const JsonDocument& result, const char* version, std::string& out, size_t& chunks) {
+    ResponseStream stream(packetManager, version);
+    {
+        RequestScope scope(requestArena);
+        if (!stream.begin(result)) return false;
+    }
+    uint8_t chunk[TCP_TX_CHUNK];
+    out.clear();
+    chunks = 0;
+    while (size_t n = stream.produce(chunk, sizeof(chunk))) {
+        out.append((const char*)chunk, n);
+        chunks++;
+    }
+    return true;
+}
+
+/**
+ * @brief Check that a streamed packet opens to the result's JSON.
+ *
+ * Opened client-side (key = SHA256(token)): the device's own decoder
+ * only takes request-sized payloads.
+ */
+static bool opens(const std::string& packet, const JsonDocument& result, const char* version) {
+    if (packet.empty() || packet.back() != '\n' || packet.find('\n') != packet.size() - 1) return false;
+
+    const char* payload = strstr(packet.c_str(), "\"payload\":\"");
+    if (!payload) return false;
+    payload += 11;
+    size_t hexLen = (size_t)(strchr(payload, '"') - payload);
+    bool aead = strcmp(version, PROTOCOL_V1_1) == 0;
+
+    // len(2) | ciphertext | nonce(16), or len(2) | ciphertext | nonce(12) | tag(16)
+    std::vector<uint8_t> raw(hexLen / 2);
+    if (hexLen % 2 || raw.size() < 2 + 28 || !HexCodec::decode(payload, raw.size(), raw.data())) return false;
+    size_t plainLen = ((size_t)raw[0] << 8) | raw[1];
+    if (2 + plainLen + (aead ? 28 : 16) != raw.size()) return false;
+
+    uint8_t key[32];
+    CryptoBackend::sha256((const uint8_t*)PIPELINE_HOST_TOKEN, strlen(PIPELINE_HOST_TOKEN), key);
+    uint8_t* data = raw.data() + 2;
+    const uint8_t* nonce = data + plainLen;
+    if (aead) {
+        if (!ChaCha20Poly1305::open(key, nonce, raw.data(), 2, data, plainLen, nonce + 12)) return false;
+    } else {
+        const char* sig = strstr(payload + hexLen, "\"signature\":\"");
+        if (!sig || !crypto.verifyHMAC((const uint8_t*)payload, hexLen, sig + 13, 64)) return false;
+        CryptoBackend::chacha20(key, nonce, 0, data, data, plainLen);
+    }
+
+    std::string expected;
+    serializeJson(result, expected);
+    return expected.size() == plainLen && memcmp(expected.data(), data, plainLen) == 0;
+}
+
+/**
+ * @brief Run fn repeatedly for at least minSeconds.
+ * @return ns per call.
+ */
+template <typename Fn>
+static double timeIt(double minSeconds, Fn fn) {
+    uint64_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < minSeconds) {
+        fn();
+        calls++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return elapsed * 1e9 / calls;
+}
+
+int main(int argc, char** argv) {
+    double minSeconds = argc > 1 ? atof(argv[1]) : 0.3;
+    if (minSeconds <= 0) minSeconds = 0.3;
+
+    pipelineBegin();
+
+    struct Case {
+        size_t target;
+        const char* version;
+        size_t plainLen = 0;
+        size_t chunks = 0;
+        double streamNs = 0;
+        double oneShotNs = 0;
+    };
+    std::vector<Case> cases;
+    for (size_t target : {2048, 16384, 61440}) {
+        for (const char* version : {PROTOCOL_V1_0, PROTOCOL_V1_1}) {
+            Case c;
+            c.target = target;
+            c.version = version;
+            cases.push_back(c);
+        }
+    }
+
+    fprintf(stderr, "%-6s %9s %7s %14s %12s %14s\n", "Ver", "JSON", "Chunks", "Stream ns", "ns/KB", "One-shot ns");
+
+    JsonDocument result;
+    std::string packet;
+    std::vector<char> oneShot;
+    for (Case& c : cases) {
+        buildResult(result, c.target);
+        c.plainLen = measureJson(result);
+
+        EXPECT(streamReply(result, c.version, packet, c.chunks));
+        EXPECT(opens(packet, result, c.version));
+        EXPECT(c.chunks > 1);
+
+        c.streamNs = timeIt(minSeconds, [&] {
+            size_t chunks;
+            if (!streamReply(result, c.version, packet, chunks)) failures++;
+        });
+
+        oneShot.resize(packetManager.measureResponse(result, c.version));
+        c.oneShotNs = timeIt(minSeconds, [&] {
+            RequestScope scope(requestArena);
+            if (!packetManager.createResponsePacket(result, c.version, oneShot.data(), oneShot.size())) failures++;
+        });
+
+        fprintf(stderr, "%-6s %9zu %7zu %14.0f %12.0f %14.0f\n", c.version, c.plainLen, c.chunks,
+                c.streamNs, c.streamNs * 1024 / c.plainLen, c.oneShotNs);
+    }
+
+    printf("{\n");
+    printf("  \"chunk\": %u,\n", (unsigned)TCP_TX_CHUNK);
+    printf("  \"cases\": [\n");
+    for (size_t i = 0; i < cases.size(); i++) {
+        const Case& c = cases[i];
+        printf("    {\"version\": \"%s\", \"json_bytes\": %zu, \"chunks\": %zu, \"stream_ns\": %.0f, "
+               "\"stream_ns_per_kb\": %.0f, \"one_shot_ns\": %.0f}%s\n",
+               c.version, c.plainLen, c.chunks, c.streamNs, c.streamNs * 1024 / c.plainLen, c.oneShotNs,
+               i + 1 < cases.size() ? "," : "");
+    }
+    printf("  ],\n");
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,369 @@
+/**
+ * @file span_api_bench.cpp
+ * @brief Host check that the span-based receive/reply path never allocates.
+ *
+ * Runs the crypto half of a request through the same code the device
+ * uses behind PacketManager/CryptoManager, on caller-owned buffers only:
+ *
+ * - v1.0: PayloadCodec::checkSignature over the hex payload,
+ *   PayloadCodec::decodeSigned in place, ChaCha20 in place
+ * - v1.1: PayloadCodec::decodeAead in place, CryptoBackend::aeadOpen
+ * - v2:   CryptoBackend::aeadOpen of the frame body (header as AAD)
+ * - reply: sealed into a fixed buffer in the same version (hex + HMAC
+ *   for v1.0, hex + tag for v1.1, response frame for v2)
+ *
+ * malloc/calloc/realloc (and with them operator new) are interposed and
+ * counted while packets are processed. The run fails if the span path
+ * allocates at all. For comparison, a "string" variant does the same
+ * work with a std::string copy at every boundary, as the String API did.
+ * Error paths (bad hex, bad length, wrong signature/tag) are counted too.
+ *
+ * JSON, outer envelope and transport are not part of this build
+ * (ArduinoJson and the Arduino core are device-only); the documents use
+ * the request arena there (see request_arena_soak.cpp).
+ *
+ * Build (software backend, from firmware/, glibc):
+ *   g++ -O2 -IWakeLink host/span_api_bench.cpp WakeLink/payload_codec.cpp \
+ *       WakeLink/hex_codec.cpp WakeLink/crypto_backend.cpp WakeLink/chacha20.cpp \
+ *       WakeLink/sha256.cpp WakeLink/poly1305.cpp WakeLink/secure_random.cpp \
+ *       -o span_api_bench
+ *
+ * Usage: ./span_api_bench [packets]   (default 200000 per version)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "payload_codec.h"
+#include "hex_codec.h"
+#include "crypto_backend.h"
+#include "secure_random.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+/// @brief DRBG instance (WakeLink.ino on the device)
+SecureRandom secureRandom;
+
+// ==================== ALLOCATION COUNTER ====================
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+static volatile bool counting = false;
+static unsigned long allocations = 0;
+
+extern "C" void* malloc(size_t n) {
+    if (counting) allocations++;
+    return __libc_malloc(n);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    if (counting) allocations++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t n) {
+    if (counting) allocations++;
+    return __libc_realloc(p, n);
+}
+
+/**
+ * @brief Allocations made by fn.
+ */
+template <typename F>
+static unsigned long countAllocations(F fn) {
+    allocations = 0;
+    counting = true;
+    fn();
+    counting = false;
+    return allocations;
+}
+
+// ==================== PACKETS ====================
+
+static const char INNER[] =
+    "{\"command\":\"wake\",\"data\":{\"mac\":\"AA:BB:CC:DD:EE:FF\"},\"request_id\":\"K3Q9ZX1M\","
+    "\"timestamp\":1732924800000,\"sender\":\"fa860740\",\"seq\":1792130529106469}";
+
+static const char REPLY[] =
+    "{\"status\":\"success\",\"result\":\"wol_sent\",\"mac\":\"AA:BB:CC:DD:EE:FF\","
+    "\"request_id\":\"K3Q9ZX1M\"}";
+
+#define INNER_LEN (sizeof(INNER) - 1)
+#define REPLY_LEN (sizeof(REPLY) - 1)
+
+/// @brief Hex payload of a request, as the client sends it
+struct Request {
+    char hex[2 * (2 + 500 + 12 + 16)];
+    size_t hexLen = 0;
+    char sig[64];
+    uint8_t frame[28 + 500 + 16];
+    size_t frameLen = 0;
+};
+
+static uint8_t key[32];
+static CryptoBackend::Hmac hmac;
+
+static void putLength(uint8_t* p, size_t len) {
+    p[0] = (uint8_t)(len >> 8);
+    p[1] = (uint8_t)len;
+}
+
+/**
+ * @brief Build the v1.0, v1.1 and v2 encodings of INNER.
+ */
+static void buildRequests(Request& v10, Request& v11, Request& v2) {
+    uint8_t raw[2 + 500 + 12 + 16];
+
+    // v1.0: len | ciphertext | nonce(16), HMAC over the hex text
+    putLength(raw, INNER_LEN);
+    memcpy(raw + 2, INNER, INNER_LEN);
+    secureRandom.fill(raw + 2 + INNER_LEN, 16);
+    CryptoBackend::chacha20(key, raw + 2 + INNER_LEN, 0, raw + 2, raw + 2, INNER_LEN);
+    v10.hexLen = 2 * (2 + INNER_LEN + 16);
+    HexCodec::encode(raw, v10.hexLen / 2, v10.hex);
+    uint8_t mac[32];
+    hmac.compute((const uint8_t*)v10.hex, v10.hexLen, mac);
+    HexCodec::encode(mac, sizeof(mac), v10.sig);
+
+    // v1.1: len | ciphertext | nonce(12) | tag(16), length prefix is AAD
+    putLength(raw, INNER_LEN);
+    memcpy(raw + 2, INNER, INNER_LEN);
+    uint8_t* nonce = raw + 2 + INNER_LEN;
+    secureRandom.fill(nonce, 12);
+    CryptoBackend::aeadSeal(key, nonce, raw, 2, raw + 2, INNER_LEN, nonce + 12);
+    v11.hexLen = 2 * (2 + INNER_LEN + 12 + 16);
+    HexCodec::encode(raw, v11.hexLen / 2, v11.hex);
+
+    // v2: header(28) | ciphertext | tag(16), header is AAD
+    uint8_t* f = v2.frame;
+    memset(f, 0, 28);
+    f[0] = 0x02;
+    secureRandom.fill(f + 14, 12);
+    putLength(f + 26, INNER_LEN);
+    memcpy(f + 28, INNER, INNER_LEN);
+    CryptoBackend::aeadSeal(key, f + 14, f, 28, f + 28, INNER_LEN, f + 28 + INNER_LEN);
+    v2.frameLen = 28 + INNER_LEN + 16;
+}
+
+// ==================== SPAN PATH ====================
+
+/// @brief Reply buffer, large enough for any reply here
+static char replyBuf[2 * (2 + REPLY_LEN + 16) + 64 + 64];
+static uint8_t replyFrame[28 + REPLY_LEN + 16];
+
+/**
+ * @brief v1.x reply sealed into replyBuf; returns its length.
+ */
+static size_t sealReply(bool aead) {
+    uint8_t raw[2 + REPLY_LEN + 12 + 16];
+    putLength(raw, REPLY_LEN);
+    memcpy(raw + 2, REPLY, REPLY_LEN);
+    uint8_t* nonce = raw + 2 + REPLY_LEN;
+    if (aead) {
+        secureRandom.fill(nonce, 12);
+        CryptoBackend::aeadSeal(key, nonce, raw, 2, raw + 2, REPLY_LEN, nonce + 12);
+        HexCodec::encode(raw, 2 + REPLY_LEN + 28, replyBuf);
+        return 2 * (2 + REPLY_LEN + 28);
+    }
+    secureRandom.fill(nonce, 16);
+    CryptoBackend::chacha20(key, nonce, 0, raw + 2, raw + 2, REPLY_LEN);
+    size_t hexLen = 2 * (2 + REPLY_LEN + 16);
+    HexCodec::encode(raw, hexLen / 2, replyBuf);
+    uint8_t mac[32];
+    hmac.compute((const uint8_t*)replyBuf, hexLen, mac);
+    HexCodec::encode(mac, sizeof(mac), replyBuf + hexLen);
+    return hexLen + 64;
+}
+
+/**
+ * @brief One v1.x request through the span path: receive, open, reply.
+ * @return true if the plaintext matched.
+ */
+static bool spanPayload(const Request& req, bool aead, char* rx) {
+    memcpy(rx, req.hex, req.hexLen);  // socket read into the receive buffer
+
+    PayloadView view;
+    if (aead) {
+        if (PayloadCodec::decodeAead(rx, req.hexLen, view)) return false;
+        if (!CryptoBackend::aeadOpen(key, view.nonce, view.prefix, 2, view.data, view.length, view.tag)) {
+            return false;
+        }
+    } else {
+        if (!PayloadCodec::checkSignature(hmac, (const uint8_t*)rx, req.hexLen, req.sig, 64)) return false;
+        if (PayloadCodec::decodeSigned(rx, req.hexLen, view)) return false;
+        CryptoBackend::chacha20(key, view.nonce, 0, view.data, view.data, view.length);
+    }
+    view.terminate();
+    bool ok = view.length == INNER_LEN && memcmp(view.data, INNER, INNER_LEN) == 0;
+
+    sealReply(aead);
+    return ok;
+}
+
+/**
+ * @brief One v2 frame through the span path.
+ */
+static bool spanFrame(const Request& req, uint8_t* rx) {
+    memcpy(rx, req.frame, req.frameLen);
+    size_t len = req.frameLen - 28 - 16;
+    if (!CryptoBackend::aeadOpen(key, rx + 14, rx, 28, rx + 28, len, rx + 28 + len)) return false;
+    bool ok = len == INNER_LEN && memcmp(rx + 28, INNER, INNER_LEN) == 0;
+
+    uint8_t* f = replyFrame;
+    memset(f, 0, 28);
+    f[0] = 0x02;
+    f[1] = 0x01;
+    secureRandom.fill(f + 14, 12);
+    putLength(f + 26, REPLY_LEN);
+    memcpy(f + 28, REPLY, REPLY_LEN);
+    CryptoBackend::aeadSeal(key, f + 14, f, 28, f + 28, REPLY_LEN, f + 28 + REPLY_LEN);
+    return ok;
+}
+
+// ==================== STRING PATH (comparison) ====================
+
+/**
+ * @brief The same v1.0 work with a std::string at every boundary.
+ */
+static bool stringPayload(const Request& req) {
+    std::string packet(req.hex, req.hexLen);               // received packet
+    std::string payload = packet;                          // payload field
+    std::string signature(req.sig, 64);                    // signature field
+
+    uint8_t mac[32];
+    hmac.compute((const uint8_t*)payload.data(), payload.size(), mac);
+    char macHex[65];
+    HexCodec::encode(mac, sizeof(mac), macHex);
+    if (std::string(macHex, 64) != signature) return false;
+
+    std::string raw(payload.size() / 2, '\0');
+    if (!HexCodec::decode(payload.data(), raw.size(), (uint8_t*)&raw[0])) return false;
+    size_t len = ((size_t)(uint8_t)raw[0] << 8) | (uint8_t)raw[1];
+    std::string plain = raw.substr(2, len);
+    CryptoBackend::chacha20(key, (const uint8_t*)raw.data() + 2 + len, 0,
+                            (uint8_t*)&plain[0], (uint8_t*)&plain[0], len);
+    bool ok = plain == std::string(INNER, INNER_LEN);
+
+    std::string reply(REPLY, REPLY_LEN);                   // serialized result
+    std::string sealed(2 + REPLY_LEN + 16, '\0');
+    putLength((uint8_t*)&sealed[0], REPLY_LEN);
+    memcpy(&sealed[2], reply.data(), REPLY_LEN);
+    secureRandom.fill((uint8_t*)&sealed[2 + REPLY_LEN], 16);
+    CryptoBackend::chacha20(key, (const uint8_t*)&sealed[2 + REPLY_LEN], 0,
+                            (uint8_t*)&sealed[2], (uint8_t*)&sealed[2], REPLY_LEN);
+    std::string hex(2 * sealed.size(), '\0');
+    HexCodec::encode((const uint8_t*)sealed.data(), sealed.size(), &hex[0]);
+    hmac.compute((const uint8_t*)hex.data(), hex.size(), mac);
+    HexCodec::encode(mac, sizeof(mac), macHex);
+    std::string out = "{\"payload\":\"" + hex + "\",\"signature\":\"" + std::string(macHex, 64) + "\"}";
+    return ok && out.size() > hex.size();
+}
+
+// ==================== RUN ====================
+
+/**
+ * @brief Time and count allocations of n runs of fn.
+ */
+template <typename F>
+static void runCase(const char* name, uint32_t n, bool last, F fn) {
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    unsigned long count = countAllocations([&] {
+        for (uint32_t i = 0; i < n; i++) ok &= fn();
+    });
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+    EXPECT(ok);
+    printf("    \"%s\": {\"ns_per_packet\": %.0f, \"allocations_per_packet\": %.2f}%s\n",
+           name, ns, (double)count / n, last ? "" : ",");
+}
+
+/**
+ * @brief Rejected inputs must not allocate either.
+ */
+static void runErrors(const Request& v10, const Request& v11) {
+    char rx[sizeof(v10.hex)];
+    PayloadView view;
+
+    unsigned long count = countAllocations([&] {
+        memcpy(rx, v10.hex, v10.hexLen);
+        rx[10] = 'g';
+        EXPECT(strcmp(PayloadCodec::decodeSigned(rx, v10.hexLen, view), "ERROR:HEX_CHAR") == 0);
+
+        memcpy(rx, v10.hex, v10.hexLen);
+        EXPECT(strcmp(PayloadCodec::decodeSigned(rx, v10.hexLen - 1, view), "ERROR:HEX_LEN") == 0);
+        EXPECT(strcmp(PayloadCodec::decodeSigned(rx, v10.hexLen - 2, view), "ERROR:INVALID_PACKET_SIZE") == 0);
+        EXPECT(strcmp(PayloadCodec::decodeSigned(rx, 8, view), "ERROR:INVALID_PACKET_SIZE") == 0);
+
+        char sig[64];
+        memcpy(sig, v10.sig, sizeof(sig));
+        sig[0] = sig[0] == '0' ? '1' : '0';
+        EXPECT(!PayloadCodec::checkSignature(hmac, (const uint8_t*)v10.hex, v10.hexLen, sig, 64));
+        EXPECT(!PayloadCodec::checkSignature(hmac, (const uint8_t*)v10.hex, v10.hexLen, v10.sig, 63));
+
+        memcpy(rx, v11.hex, v11.hexLen);
+        rx[v11.hexLen - 1] = rx[v11.hexLen - 1] == '0' ? '1' : '0';
+        EXPECT(PayloadCodec::decodeAead(rx, v11.hexLen, view) == nullptr);
+        EXPECT(!CryptoBackend::aeadOpen(key, view.nonce, view.prefix, 2, view.data, view.length, view.tag));
+
+        // Announced length that disagrees with the payload size
+        memcpy(rx, v11.hex, v11.hexLen);
+        rx[3] = rx[3] == '0' ? '1' : '0';
+        EXPECT(strcmp(PayloadCodec::decodeAead(rx, v11.hexLen, view), "ERROR:INVALID_PACKET_SIZE") == 0);
+    });
+    EXPECT(count == 0);
+    printf("  \"error_path_allocations\": %lu,\n", count);
+}
+
+int main(int argc, char** argv) {
+    uint32_t packets = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+    if (packets == 0) packets = 1;
+
+    static const uint8_t seed[] = "span_api_bench";
+    secureRandom.seed(seed, sizeof(seed));
+    CryptoBackend::sha256((const uint8_t*)"0123456789abcdef0123456789abcdef", 32, key);
+    hmac.begin(key, sizeof(key));
+
+    static Request v10, v11, v2;
+    buildRequests(v10, v11, v2);
+
+    static char rx[sizeof(Request::hex)];
+    static uint8_t rxFrame[sizeof(Request::frame)];
+
+    printf("{\n");
+    printf("  \"backend\": \"%s\",\n", CryptoBackend::name());
+    printf("  \"packets\": %u,\n", (unsigned)packets);
+    runErrors(v10, v11);
+    printf("  \"paths\": {\n");
+
+    // Warm-up outside the counted runs (lazy DRBG seeding, first-use tables)
+    spanPayload(v10, false, rx);
+    stringPayload(v10);
+
+    unsigned long spanAllocations = countAllocations([&] {
+        for (uint32_t i = 0; i < packets; i++) {
+            spanPayload(v10, false, rx);
+            spanPayload(v11, true, rx);
+            spanFrame(v2, rxFrame);
+        }
+    });
+    EXPECT(spanAllocations == 0);
+
+    runCase("span_v1_0", packets, false, [&] { return spanPayload(v10, false, rx); });
+    runCase("span_v1_1", packets, false, [&] { return spanPayload(v11, true, rx); });
+    runCase("span_v2", packets, false, [&] { return spanFrame(v2, rxFrame); });
+    runCase("string_v1_0", packets, true, [&] { return stringPayload(v10); });
+    printf("  },\n");
+
+    printf("  \"span_allocations\": %lu,\n", spanAllocations);
+    printf("  \"zero_alloc\": \"%s\"\n", failures ? "failed" : "passed");
+    printf("}\n");
+
+    return failures ? 1 : 0;
+}
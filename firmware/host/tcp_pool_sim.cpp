@@ -0,0 +1,643 @@
+/**
+ * @file tcp_pool_sim.cpp
+ * @brief Host checks for the non-blocking TCP connection pool.
+ *
+ * Runs ConnectionPool (firmware/WakeLink/connection_pool.cpp) against
+ * real loopback sockets, single-threaded like loop() on the device: the
+ * "server pass" accepts, polls and answers without waiting, and the
+ * clients are advanced between passes.
+ *
+ * - concurrent: 8 keep-alive clients send newline packets in random
+ *   chunks, 1 client sends length-prefixed frames, 2 slowloris clients
+ *   drip one byte at a time; every message must be answered intact
+ *   while the slowloris connections are cut at the read deadline
+ * - limits: a full pool of half-sent messages refuses a new connection,
+ *   a full pool of idle ones evicts the quietest, oversized messages are
+ *   dropped, idle connections expire, an unterminated packet followed
+ *   by a half-close is still answered, packets arriving together are
+ *   answered one by one, in order
+ * - pipelining: 10 packets sent back to back are answered in order in
+ *   ceil(10 / TCP_PIPELINE_DEPTH) passes
+ * - backpressure: a 1 MB reply to a client that is not reading goes out
+ *   over many passes as its receive window opens, arrives intact and is
+ *   followed by the reply to a request pipelined behind it; a client
+ *   that never reads is cut at the write deadline
+ * - streaming: a 1 MB reply produced by a TxSource (as ResponseStream
+ *   does for large v1.x replies) arrives intact over refills of at
+ *   most TCP_TX_CHUNK bytes; a source whose client is cut is deleted
+ *
+ * Every server pass is timed; the longest must stay far below the read
+ * timeout (nothing blocks). Counters go to stdout as JSON; exits
+ * non-zero on failure.
+ *
+ * Build (from firmware/):
+ *   g++ -O2 -DTCP_MAX_SESSIONS=12 -DTCP_READ_TIMEOUT_MS=300 -DTCP_IDLE_TIMEOUT_MS=600 \
+ *       -DTCP_WRITE_TIMEOUT_MS=300 -IWakeLink host/tcp_pool_sim.cpp WakeLink/connection_pool.cpp \
+ *       WakeLink/frame_reader.cpp WakeLink/response_queue.cpp -o tcp_pool_sim
+ *
+ * Usage: ./tcp_pool_sim [messages-per-client]   (default 200)
+ *
+ * @author deadboizxc
+ * @version 1.0
+ */
+
+#include "connection_pool.h"
+#include "host_test.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if TCP_MAX_SESSIONS < 11
+#error "build with -DTCP_MAX_SESSIONS=12 (see the build line above)"
+#endif
+
+/// @brief Frame marker and header of the simulated length-prefixed format
+#define SIM_FRAME_MARKER 0x02
+#define SIM_FRAME_HEADER 4
+#define SIM_FRAME_MAX_BODY 900
+
+static int listener = -1;
+static sockaddr_in serverAddr;
+static ConnectionPool* pool = nullptr;
+static PosixConnection conns[TCP_MAX_SESSIONS];
+static double maxPassMs = 0;
+static unsigned long passes = 0;
+
+static uint32_t nowMs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t simFrameLength(const uint8_t* header) {
+    size_t body = ((size_t)header[2] << 8) | header[3];
+    return body == 0 || body > SIM_FRAME_MAX_BODY ? 0 : SIM_FRAME_HEADER + body;
+}
+
+static unsigned checksum(const uint8_t* data, size_t len) {
+    unsigned sum = 0;
+    for (size_t i = 0; i < len; i++) sum = (sum * 31 + data[i]) & 0xFFFF;
+    return sum;
+}
+
+/// @brief Byte i of a "BIG <n>" reply
+static char bigByte(size_t i) { return (char)('a' + i % 26); }
+
+/// @brief PatternSource objects not yet deleted
+static int liveSources = 0;
+
+/**
+ * @brief "STREAM <n>" reply: n pattern bytes and a newline, produced in
+ *        uneven pieces that never fill the chunk, like ResponseStream.
+ */
+class PatternSource : public TxSource {
+public:
+    size_t length;
+    size_t done = 0;
+
+    explicit PatternSource(size_t n) : length(n + 1) { liveSources++; }
+    ~PatternSource() override { liveSources--; }
+
+    size_t produce(uint8_t* buf, size_t capacity) override {
+        size_t n = capacity - 1 - done % 97;
+        if (n > length - done) n = length - done;
+        for (size_t i = 0; i < n; i++, done++) {
+            buf[i] = done + 1 == length ? '\n' : (uint8_t)bigByte(done);
+        }
+        return n;
+    }
+};
+
+/**
+ * @brief Queue the reply to a message, the way TCPHandler does.
+ *
+ * "BIG <n>" gets n pattern bytes plus a static newline trailer, "STREAM
+ * <n>" the same through a PatternSource; anything else gets "<OK|F>
+ * <length> <checksum>\n".
+ */
+static void queueReply(ConnectionSlot& slot) {
+    ResponseQueue& tx = slot.tx;
+    if (!slot.frame && slot.messageLength > 7 && memcmp(slot.message, "STREAM ", 7) == 0) {
+        tx.stream(new PatternSource((size_t)atol((const char*)slot.message + 7)));
+        return;
+    }
+    if (!slot.frame && slot.messageLength > 4 && memcmp(slot.message, "BIG ", 4) == 0) {
+        size_t n = (size_t)atol((const char*)slot.message + 4);
+        uint8_t* out = tx.reserve(n);
+        for (size_t i = 0; i < n; i++) out[i] = (uint8_t)bigByte(i);
+        tx.push(out, n);
+        tx.push("\n", 1);
+        return;
+    }
+
+    char reply[48];
+    int n = snprintf(reply, sizeof(reply), "%s %u %u\n", slot.frame ? "F" : "OK",
+                     (unsigned)slot.messageLength, checksum(slot.message, slot.messageLength));
+    uint8_t* out = tx.reserve((size_t)n);
+    memcpy(out, reply, (size_t)n);
+    tx.push(out, (size_t)n);
+}
+
+/**
+ * @brief One loop() pass of the device: accept, poll, answer.
+ */
+static void serverPass() {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t now = nowMs();
+
+    for (;;) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) break;
+        int index = pool->reserve(now);
+        if (index < 0) {
+            close(fd);
+            continue;
+        }
+        // A fixed send buffer, as on the device (no autotuning to megabytes)
+        int sndbuf = 32768;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        conns[index].fd = fd;
+        pool->attach((size_t)index, conns[index], now);
+    }
+
+    pool->poll(now);
+    while (ConnectionSlot* slot = pool->next()) {
+        queueReply(*slot);
+        pool->complete(*slot, nowMs());
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (ms > maxPassMs) maxPassMs = ms;
+    passes++;
+}
+
+static void freshPool() {
+    if (pool) {
+        for (size_t i = 0; i < TCP_MAX_SESSIONS; i++) pool->close(pool->slot(i));
+        delete pool;
+    }
+    pool = new ConnectionPool();
+    pool->setFrameFormat(SIM_FRAME_MARKER, SIM_FRAME_HEADER, simFrameLength);
+}
+
+static int connectClient() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0) {
+        perror("connect");
+        exit(2);
+    }
+    int flags = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof(flags));
+    return fd;
+}
+
+/// @brief xorshift32 (reproducible)
+static uint32_t rng = 12345;
+static uint32_t next() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+/**
+ * @brief Non-blocking receive; -1 once the server has closed.
+ */
+static int pollClosed(int fd, std::string& in) {
+    char buf[512];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            in.append(buf, (size_t)n);
+            continue;
+        }
+        if (n == 0) return -1;
+        return 0;
+    }
+}
+
+// ==================== CONCURRENT ====================
+
+struct SimClient {
+    int fd = -1;
+    bool frames = false;         ///< Sends length-prefixed frames
+    std::string out;             ///< Message being sent
+    size_t sent = 0;
+    std::string in;              ///< Reply being received
+    std::string expected;        ///< Reply for the message in flight
+    int remaining = 0;           ///< Messages still to send
+    int answered = 0;
+    int wrong = 0;
+    bool closed = false;
+};
+
+static void nextMessage(SimClient& c) {
+    size_t len = 1 + next() % SIM_FRAME_MAX_BODY;
+    std::string body(len, 'x');
+    for (char& ch : body) {
+        ch = c.frames ? (char)next() : (char)('!' + next() % 94);
+    }
+    std::string message;
+    if (c.frames) {
+        c.out = std::string(1, (char)SIM_FRAME_MARKER) + '\0' + (char)(len >> 8) + (char)(len & 0xFF) + body;
+        message = c.out;  // A frame is handed out whole
+    } else {
+        c.out = body + "\n";
+        message = body;
+    }
+
+    char reply[48];
+    snprintf(reply, sizeof(reply), "%s %u %u\n", c.frames ? "F" : "OK", (unsigned)message.size(),
+             checksum((const uint8_t*)message.data(), message.size()));
+    c.expected = reply;
+    c.sent = 0;
+    c.remaining--;
+}
+
+static void stepClient(SimClient& c) {
+    if (c.closed) return;
+    if (pollClosed(c.fd, c.in) < 0) c.closed = true;
+
+    size_t nl = c.in.find('\n');
+    if (nl != std::string::npos) {
+        if (c.in.compare(0, nl + 1, c.expected) != 0) c.wrong++;
+        c.in.erase(0, nl + 1);
+        c.answered++;
+        c.expected.clear();
+        if (c.remaining > 0) nextMessage(c);
+    }
+
+    if (c.sent < c.out.size()) {
+        size_t chunk = 1 + next() % 256;
+        if (chunk > c.out.size() - c.sent) chunk = c.out.size() - c.sent;
+        ssize_t n = send(c.fd, c.out.data() + c.sent, chunk, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) c.sent += (size_t)n;
+    }
+}
+
+static void runConcurrent(int messages) {
+    freshPool();
+
+    std::vector<SimClient> clients(9);
+    for (size_t i = 0; i < clients.size(); i++) {
+        clients[i].fd = connectClient();
+        clients[i].frames = i == 8;
+        clients[i].remaining = messages;
+        nextMessage(clients[i]);
+    }
+
+    int slow[2];
+    bool slowClosed[2] = {false, false};
+    uint32_t slowSince = nowMs();
+    uint32_t slowClosedAt[2] = {0, 0};
+    for (int& fd : slow) fd = connectClient();
+    uint32_t lastDrip = 0;
+
+    uint32_t deadline = nowMs() + 60000;
+    for (;;) {
+        bool done = true;
+        for (SimClient& c : clients) {
+            stepClient(c);
+            if (!c.closed && c.answered < messages) done = false;
+        }
+
+        if (nowMs() - lastDrip >= 20) {
+            lastDrip = nowMs();
+            for (int i = 0; i < 2; i++) {
+                std::string ignored;
+                if (slowClosed[i]) continue;
+                if (pollClosed(slow[i], ignored) < 0) {
+                    slowClosed[i] = true;
+                    slowClosedAt[i] = nowMs() - slowSince;
+                    continue;
+                }
+                send(slow[i], "s", 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+        }
+
+        serverPass();
+        if ((done && slowClosed[0] && slowClosed[1]) || (int32_t)(nowMs() - deadline) >= 0) break;
+        usleep(200);
+    }
+
+    int answered = 0, wrong = 0;
+    for (SimClient& c : clients) {
+        EXPECT(!c.closed);
+        EXPECT(c.answered == messages);
+        answered += c.answered;
+        wrong += c.wrong;
+        close(c.fd);
+    }
+    EXPECT(wrong == 0);
+    for (int i = 0; i < 2; i++) {
+        EXPECT(slowClosed[i]);
+        // Cut at the read deadline, not left open until idle expiry
+        EXPECT(slowClosedAt[i] < TCP_READ_TIMEOUT_MS + 250);
+        close(slow[i]);
+    }
+    EXPECT(pool->getTimeouts() == 2);
+    EXPECT(pool->getMessages() == (uint32_t)answered);
+
+    printf("  \"concurrent\": {\"clients\": %u, \"slowloris\": 2, \"answered\": %d, \"wrong\": %d, "
+           "\"timeouts\": %u, \"slowloris_cut_ms\": [%u, %u]},\n",
+           (unsigned)clients.size(), answered, wrong, pool->getTimeouts(), slowClosedAt[0], slowClosedAt[1]);
+}
+
+// ==================== LIMITS ====================
+
+/**
+ * @brief Run server passes until cond holds or ms pass.
+ */
+template <typename Cond>
+static bool runUntil(uint32_t ms, Cond cond) {
+    uint32_t end = nowMs() + ms;
+    while ((int32_t)(nowMs() - end) < 0) {
+        serverPass();
+        if (cond()) return true;
+        usleep(500);
+    }
+    serverPass();
+    return cond();
+}
+
+static bool waitReply(int fd, std::string& in) {
+    return runUntil(200, [&] { pollClosed(fd, in); return in.find('\n') != std::string::npos; });
+}
+
+static void runLimits() {
+    freshPool();
+
+    // Every slot in the middle of a message: a new connection is refused
+    std::vector<int> busy;
+    for (int i = 0; i < TCP_MAX_SESSIONS; i++) {
+        busy.push_back(connectClient());
+        send(busy.back(), "partial", 7, MSG_NOSIGNAL);
+    }
+    runUntil(50, [] { return pool->active() == TCP_MAX_SESSIONS; });
+    int extra = connectClient();
+    std::string in;
+    bool refused = runUntil(200, [&] { return pollClosed(extra, in) < 0; });
+    EXPECT(refused);
+    EXPECT(pool->getRefused() == 1);
+    close(extra);
+
+    // ... until their read deadline frees the slots
+    runUntil(TCP_READ_TIMEOUT_MS + 200, [] { return pool->active() == 0; });
+    EXPECT(pool->active() == 0);
+    EXPECT(pool->getTimeouts() == TCP_MAX_SESSIONS);
+    for (int fd : busy) close(fd);
+
+    // Every slot idle: the quietest is evicted for a new connection
+    std::vector<int> idle;
+    for (int i = 0; i < TCP_MAX_SESSIONS; i++) {
+        idle.push_back(connectClient());
+        runUntil(2, [] { return false; });
+    }
+    runUntil(50, [] { return pool->active() == TCP_MAX_SESSIONS; });
+    int fresh = connectClient();
+    send(fresh, "hello\n", 6, MSG_NOSIGNAL);
+    in.clear();
+    EXPECT(waitReply(fresh, in));
+    EXPECT(in == "OK 5 " + std::to_string(checksum((const uint8_t*)"hello", 5)) + "\n");
+    EXPECT(pool->getEvicted() == 1);
+    in.clear();
+    EXPECT(runUntil(100, [&] { return pollClosed(idle[0], in) < 0; }));
+
+    // Oversized packet and frame are dropped with their connection
+    int big = connectClient();
+    std::string blob(FRAME_READER_SIZE + 100, 'b');
+    send(big, blob.data(), blob.size(), MSG_NOSIGNAL);
+    in.clear();
+    EXPECT(runUntil(200, [&] { return pollClosed(big, in) < 0; }));
+    close(big);
+    int badFrame = connectClient();
+    const char header[4] = {SIM_FRAME_MARKER, 0, 0x7F, (char)0xFF};
+    send(badFrame, header, sizeof(header), MSG_NOSIGNAL);
+    in.clear();
+    EXPECT(runUntil(200, [&] { return pollClosed(badFrame, in) < 0; }));
+    close(badFrame);
+    EXPECT(pool->getDropped() == 2);
+
+    // Unterminated packet then half-close: still answered
+    int half = connectClient();
+    send(half, "  tail  ", 8, MSG_NOSIGNAL);
+    shutdown(half, SHUT_WR);
+    in.clear();
+    EXPECT(waitReply(half, in));
+    EXPECT(in == "OK 4 " + std::to_string(checksum((const uint8_t*)"tail", 4)) + "\n");
+    close(half);
+
+    // Several packets in one segment: answered one by one, in order
+    int burst = connectClient();
+    send(burst, "one\r\ntwo\n\nthree\n", 17, MSG_NOSIGNAL);
+    in.clear();
+    EXPECT(runUntil(200, [&] { pollClosed(burst, in); return std::count(in.begin(), in.end(), '\n') == 3; }));
+    EXPECT(in == "OK 3 " + std::to_string(checksum((const uint8_t*)"one", 3)) + "\n" +
+                 "OK 3 " + std::to_string(checksum((const uint8_t*)"two", 3)) + "\n" +
+                 "OK 5 " + std::to_string(checksum((const uint8_t*)"three", 5)) + "\n");
+    close(burst);
+
+    // Pipelined packets: up to TCP_PIPELINE_DEPTH answered per pass
+    int pipe = connectClient();
+    std::string pipeline, expected;
+    for (int i = 0; i < 10; i++) {
+        std::string body = "p" + std::to_string(i);
+        pipeline += body + "\n";
+        expected += "OK " + std::to_string(body.size()) + " " +
+                    std::to_string(checksum((const uint8_t*)body.data(), body.size())) + "\n";
+    }
+    uint32_t pipelinedBefore = pool->getPipelined();
+    runUntil(50, [] { return pool->active() > 0; });
+    send(pipe, pipeline.data(), pipeline.size(), MSG_NOSIGNAL);
+    usleep(20000);
+    in.clear();
+    int pipePasses = 0;
+    while (pipePasses < 20 && std::count(in.begin(), in.end(), '\n') < 10) {
+        serverPass();
+        pipePasses++;
+        usleep(2000);
+        pollClosed(pipe, in);
+    }
+    EXPECT(in == expected);
+    EXPECT(pipePasses == (10 + TCP_PIPELINE_DEPTH - 1) / TCP_PIPELINE_DEPTH);
+    EXPECT(pool->getPipelined() - pipelinedBefore == 10 - (uint32_t)pipePasses);
+    close(pipe);
+
+    // Blank lines keep a connection alive; silence closes it
+    uint32_t before = pool->getIdleClosed();
+    int keep = connectClient();
+    for (int i = 0; i < 3; i++) {
+        runUntil(TCP_IDLE_TIMEOUT_MS / 2, [] { return false; });
+        send(keep, "\n", 1, MSG_NOSIGNAL);
+    }
+    in.clear();
+    EXPECT(pollClosed(keep, in) == 0);
+    EXPECT(runUntil(TCP_IDLE_TIMEOUT_MS + 200, [&] { return pollClosed(keep, in) < 0; }));
+    EXPECT(pool->getIdleClosed() > before);
+    close(keep);
+    for (int fd : idle) close(fd);
+    close(fresh);
+
+    printf("  \"limits\": {\"refused\": %u, \"evicted\": %u, \"timeouts\": %u, \"dropped\": %u, "
+           "\"idle_closed\": %u, \"accepted\": %u, \"pipelined\": %u, \"pipeline_passes\": %d},\n",
+           pool->getRefused(), pool->getEvicted(), pool->getTimeouts(), pool->getDropped(),
+           pool->getIdleClosed(), pool->getAccepted(), pool->getPipelined(), pipePasses);
+}
+
+// ==================== BACKPRESSURE ====================
+
+static int connectSmallWindow() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int size = 16384;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    if (connect(fd, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0) {
+        perror("connect");
+        exit(2);
+    }
+    return fd;
+}
+
+static void runBackpressure() {
+    freshPool();
+    const size_t big = 1 << 20;
+    std::string request = "BIG " + std::to_string(big) + "\nhello\n";
+
+    // Not reading for a while: the reply waits in the queue, passes stay short
+    int slow = connectSmallWindow();
+    send(slow, request.data(), request.size(), MSG_NOSIGNAL);
+    runUntil(TCP_WRITE_TIMEOUT_MS / 3, [] { return false; });
+    EXPECT(pool->slot(0).state == SLOT_WRITING);
+    EXPECT(pool->slot(0).tx.pending() > 0);
+    EXPECT(pool->slot(0).tx.getStalls() > 0 || pool->slot(0).tx.getPartial() > 0);
+
+    // Reading slowly: every byte arrives, then the pipelined reply
+    std::string in;
+    std::string hello = "OK 5 " + std::to_string(checksum((const uint8_t*)"hello", 5)) + "\n";
+    size_t want = big + 1 + hello.size();
+    uint32_t end = nowMs() + 10000;
+    while (in.size() < want && (int32_t)(nowMs() - end) < 0) {
+        char buf[4096];
+        ssize_t n = recv(slow, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) in.append(buf, (size_t)n);
+        serverPass();
+    }
+    EXPECT(in.size() == want);
+    bool intact = in.size() == want && in[big] == '\n' && in.compare(big + 1, hello.size(), hello) == 0;
+    for (size_t i = 0; intact && i < big; i++) intact = in[i] == bigByte(i);
+    EXPECT(intact);
+    uint32_t partial = pool->slot(0).tx.getPartial();
+    uint32_t stalls = pool->slot(0).tx.getStalls();
+    uint32_t writes = pool->slot(0).tx.getWrites();
+    EXPECT(writes > 2);  // Sent over many passes, not in one blocking call
+    EXPECT(pool->slot(0).state == SLOT_IDLE);
+    close(slow);
+    runUntil(50, [] { return pool->active() == 0; });
+
+    // Never reading: cut at the write deadline, counted, not left hanging
+    int deaf = connectSmallWindow();
+    std::string deafRequest = "BIG " + std::to_string(big) + "\n";
+    send(deaf, deafRequest.data(), deafRequest.size(), MSG_NOSIGNAL);
+    in.clear();
+    EXPECT(runUntil(TCP_WRITE_TIMEOUT_MS * 3, [] { return pool->getWriteTimeouts() == 1; }));
+    EXPECT(pool->active() == 0);
+    EXPECT(pool->getTruncated() == 1);
+    close(deaf);
+
+    printf("  \"backpressure\": {\"reply_bytes\": %zu, \"writes\": %u, \"partial\": %u, \"stalls\": %u, "
+           "\"write_timeouts\": %u, \"truncated\": %u, \"sent\": %llu},\n",
+           big, writes, partial, stalls, pool->getWriteTimeouts(), pool->getTruncated(),
+           (unsigned long long)pool->getSent());
+}
+
+static void runStreaming() {
+    freshPool();
+    const size_t big = 1 << 20;
+    std::string request = "STREAM " + std::to_string(big) + "\nhello\n";
+
+    int slow = connectSmallWindow();
+    send(slow, request.data(), request.size(), MSG_NOSIGNAL);
+    runUntil(TCP_WRITE_TIMEOUT_MS / 3, [] { return false; });
+    EXPECT(pool->slot(0).state == SLOT_WRITING);
+    EXPECT(liveSources == 1);
+
+    // Never more than one chunk queued, whatever the reply size
+    size_t maxPending = 0;
+    std::string in;
+    std::string hello = "OK 5 " + std::to_string(checksum((const uint8_t*)"hello", 5)) + "\n";
+    size_t want = big + 1 + hello.size();
+    uint32_t end = nowMs() + 10000;
+    while (in.size() < want && (int32_t)(nowMs() - end) < 0) {
+        char buf[4096];
+        ssize_t n = recv(slow, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) in.append(buf, (size_t)n);
+        serverPass();
+        maxPending = std::max(maxPending, pool->slot(0).tx.pending());
+    }
+    EXPECT(in.size() == want);
+    bool intact = in.size() == want && in[big] == '\n' && in.compare(big + 1, hello.size(), hello) == 0;
+    for (size_t i = 0; intact && i < big; i++) intact = in[i] == bigByte(i);
+    EXPECT(intact);
+    EXPECT(maxPending < TCP_TX_CHUNK);
+    uint32_t refills = pool->slot(0).tx.getRefills();
+    EXPECT(refills > big / TCP_TX_CHUNK);
+    EXPECT(liveSources == 0);
+    EXPECT(pool->slot(0).state == SLOT_IDLE);
+    close(slow);
+    runUntil(50, [] { return pool->active() == 0; });
+
+    // Cut at the write deadline: the unfinished source goes with the slot
+    int deaf = connectSmallWindow();
+    std::string deafRequest = "STREAM " + std::to_string(big) + "\n";
+    send(deaf, deafRequest.data(), deafRequest.size(), MSG_NOSIGNAL);
+    EXPECT(runUntil(TCP_WRITE_TIMEOUT_MS * 3, [] { return pool->getWriteTimeouts() == 1; }));
+    EXPECT(pool->active() == 0);
+    EXPECT(liveSources == 0);
+    close(deaf);
+
+    printf("  \"streaming\": {\"reply_bytes\": %zu, \"chunk\": %d, \"refills\": %u, \"max_pending\": %zu, "
+           "\"live_sources\": %d},\n",
+           big, TCP_TX_CHUNK, refills, maxPending, liveSources);
+}
+
+int main(int argc, char** argv) {
+    int messages = argc > 1 ? atoi(argv[1]) : 200;
+    if (messages <= 0) messages = 200;
+
+    listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(serverAddr);
+    if (bind(listener, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0 || listen(listener, 64) != 0 ||
+        getsockname(listener, (sockaddr*)&serverAddr, &addrLen) != 0) {
+        perror("listen");
+        return 2;
+    }
+
+    printf("{\n");
+    printf("  \"slots\": %d,\n", TCP_MAX_SESSIONS);
+    runConcurrent(messages);
+    runLimits();
+    runBackpressure();
+    runStreaming();
+
+    // Nothing may wait for the network inside a pass
+    EXPECT(maxPassMs < TCP_READ_TIMEOUT_MS / 10);
+
+    printf("  \"server_passes\": %lu,\n", passes);
+    printf("  \"max_pass_ms\": %.3f,\n", maxPassMs);
+    printf("  \"failures\": %d\n", failures);
+    printf("}\n");
+
+    close(listener);
+    return failures ? 1 : 0;
+}
@@ -8,16 +8,44 @@ Key concepts:
 - Clients connect to /ws/client/{client_id}
 - When client sends command to device, relay tracks the pending response
 - When device responds, relay forwards to the waiting client
+- Protocol v2 frames are relayed as binary messages, byte for byte
 """
 
 from fastapi import WebSocket
-from typing import Dict, List, Any, Optional
+from typing import Dict, List, Any, Optional, Union
 import asyncio
+import hashlib
 import logging
 import json
 
 logger = logging.getLogger("wakelink_cloud")
 
+# Protocol v2 binary frame layout (see firmware packet.h)
+FRAME_V2_VERSION = 0x02
+FRAME_V2_HEADER = 28
+FRAME_V2_TAG = 16
+
+
+def device_hash(device_id: str) -> bytes:
+    """v2 device-id hash: first 4 bytes of SHA256(device_id)."""
+    return hashlib.sha256(device_id.encode("utf-8")).digest()[:4]
+
+
+def is_frame(data: bytes) -> bool:
+    """Check that data looks like a complete v2 frame (length from header)."""
+    if len(data) < FRAME_V2_HEADER + FRAME_V2_TAG or data[0] != FRAME_V2_VERSION:
+        return False
+    body_len = int.from_bytes(data[26:28], "big")
+    return len(data) == FRAME_V2_HEADER + body_len + FRAME_V2_TAG
+
+
+async def _send(ws: WebSocket, data: Union[dict, bytes]):
+    """Send a JSON packet as text or a v2 frame as a binary message."""
+    if isinstance(data, (bytes, bytearray)):
+        await ws.send_bytes(bytes(data))
+    else:
+        await ws.send_text(json.dumps(data))
+
 
 class WebSocketManager:
     """Manages WebSocket connections and message relay for WakeLink.
@@ -60,7 +88,7 @@ class WebSocketManager:
             logger.info(f"Delivering {len(queued)} queued messages to {connection_id}")
             for msg in queued:
                 try:
-                    await ws.send_text(json.dumps(msg))
+                    await _send(ws, msg)
                 except Exception:
                     logger.exception("Failed to send queued message")
                     break
@@ -89,14 +117,14 @@ class WebSocketManager:
                 pass
         logger.info(f"WebSocket disconnected: {connection_id}")
 
-    async def push(self, target_id: str, data: dict, sender_id: Optional[str] = None) -> bool:
+    async def push(self, target_id: str, data: Union[dict, bytes], sender_id: Optional[str] = None) -> bool:
         """Send data to a connected device/client.
 
         If target is connected, sends immediately. Otherwise queues for later.
 
         Args:
             target_id: Target device_id or client_id.
-            data: The message data (outer JSON packet).
+            data: The message data (outer JSON packet or v2 frame).
             sender_id: Optional sender connection_id for response tracking.
 
         Returns:
@@ -112,7 +140,7 @@ class WebSocketManager:
 
         if ws:
             try:
-                await ws.send_text(json.dumps(data))
+                await _send(ws, data)
                 logger.info(f"Pushed message to {target_id}")
                 return True
             except Exception:
@@ -125,21 +153,24 @@ class WebSocketManager:
         logger.info(f"Message queued for {target_id}")
         return False
 
-    async def push_response(self, device_id: str, data: dict) -> bool:
+    async def push_response(self, device_id: str, data: Union[dict, bytes]) -> bool:
         """Forward device response to the waiting client.
 
         When a device sends a response, this finds the client that
-        is waiting for it and forwards the encrypted response.
+        is waiting for it and forwards the encrypted response. The
+        client stays registered until it disconnects or another client
+        sends to the device, so fragment acknowledgements and fragmented
+        responses (several messages per command) all reach it.
 
         Args:
             device_id: The device that sent the response.
-            data: The response packet.
+            data: The response packet (outer JSON or v2 frame).
 
         Returns:
             bool: True if forwarded to client, False otherwise.
         """
         async with self._lock:
-            client_id = self.pending_responses.pop(device_id, None)
+            client_id = self.pending_responses.get(device_id)
 
         if not client_id:
             logger.debug(f"No client waiting for response from {device_id}")
@@ -150,7 +181,7 @@ class WebSocketManager:
 
         if ws:
             try:
-                await ws.send_text(json.dumps(data))
+                await _send(ws, data)
                 logger.info(f"Forwarded response from {device_id} to {client_id}")
                 return True
             except Exception:
@@ -8,6 +8,8 @@ The server acts as a blind relay:
 - Validates API token from first JSON message (auth message)
 - Does NOT decrypt the inner payload
 - Forwards outer JSON {device_id, payload, signature, version} as-is
+- Forwards protocol v2 binary frames as-is; client frames are routed
+  by the device-id hash in the frame header
 
 Authentication Protocol:
 1. Client connects to /ws/{device_id} or /ws/client/{client_id}
@@ -31,7 +33,7 @@ from sqlalchemy.orm import Session
 from core.database import get_db
 from core.auth import validate_api_token
 from core.models import Message, Device
-from core.relay import relay
+from core.relay import relay, device_hash, is_frame
 
 router = APIRouter(tags=["websocket"])
 logger = logging.getLogger("wakelink_cloud")
@@ -165,6 +167,25 @@ async def _authenticate_websocket(
     return True, user, db, first_message
 
 
+async def _receive(websocket: WebSocket) -> tuple[Optional[str], Optional[bytes]]:
+    """Receive the next message as (text, None) or (None, frame bytes)."""
+    message = await websocket.receive()
+    if message["type"] == "websocket.disconnect":
+        raise WebSocketDisconnect(message.get("code", 1000))
+    if message.get("bytes") is not None:
+        return None, message["bytes"]
+    return message.get("text") or "", None
+
+
+def _device_for_frame(db: Session, user, frame: bytes) -> Optional[Device]:
+    """Find the user's device whose v2 device-id hash matches the frame header."""
+    target = frame[2:6]
+    for device in db.query(Device).filter(Device.user_id == user.id).all():
+        if device_hash(device.device_id) == target:
+            return device
+    return None
+
+
 @router.websocket("/ws/{device_id}")
 async def websocket_device_endpoint(
     websocket: WebSocket,
@@ -253,7 +274,23 @@ async def websocket_device_endpoint(
                     db.commit()
         
         while True:
-            raw_data = await websocket.receive_text()
+            raw_data, frame = await _receive(websocket)
+            
+            if frame is not None:
+                # v2 response frame: opaque to the server, forward as-is
+                if not is_frame(frame):
+                    await websocket.send_json({
+                        "status": "error",
+                        "error": "INVALID_FRAME"
+                    })
+                    continue
+                device = db.query(Device).filter(Device.device_id == device_id).first()
+                if device:
+                    device.last_seen = datetime.now().astimezone()
+                    db.commit()
+                if not await relay.push_response(device_id, frame):
+                    logger.debug(f"[WSS] Device {device_id} frame dropped, no client waiting")
+                continue
             
             try:
                 message_data = json.loads(raw_data)
@@ -383,7 +420,11 @@ async def websocket_client_endpoint(
                 message_data = pending_message
                 pending_message = None
             else:
-                raw_data = await websocket.receive_text()
+                raw_data, frame = await _receive(websocket)
+                
+                if frame is not None:
+                    await _relay_client_frame(websocket, db, user, connection_id, frame)
+                    continue
                 
                 try:
                     message_data = json.loads(raw_data)
@@ -459,4 +500,53 @@ async def websocket_client_endpoint(
     except Exception as e:
         logger.error(f"[WSS] Client error {client_id}: {e}")
     finally:
-        await relay.disconnect(connection_id)
\ No newline at end of file
+        await relay.disconnect(connection_id)
+
+
+async def _relay_client_frame(
+    websocket: WebSocket,
+    db: Session,
+    user,
+    connection_id: str,
+    frame: bytes
+):
+    """Relay a protocol v2 command frame from a client to its device.
+
+    The target is found by the device-id hash in the frame header among
+    the user's devices. Frames for offline devices are queued in memory
+    only; HTTP polling does not carry v2.
+
+    Args:
+        websocket: The client WebSocket.
+        db: Database session.
+        user: Authenticated user.
+        connection_id: Relay id of the client.
+        frame: Complete v2 frame.
+    """
+    if not is_frame(frame):
+        await websocket.send_json({
+            "status": "error",
+            "error": "INVALID_FRAME"
+        })
+        return
+    
+    device = _device_for_frame(db, user, frame)
+    if not device:
+        await websocket.send_json({
+            "status": "error",
+            "error": "UNKNOWN_DEVICE"
+        })
+        return
+    
+    device.last_seen = datetime.now().astimezone()
+    db.commit()
+    
+    delivered = await relay.push(device.device_id, frame, sender_id=connection_id)
+    await websocket.send_json({
+        "status": "success",
+        "device_id": device.device_id,
+        "delivered": delivered,
+        "queued": not delivered,
+        "message": "Delivered to device" if delivered else "Device offline, queued"
+    })
+    logger.debug(f"[WSS] Client {connection_id} -> {device.device_id} frame delivered={delivered}")